@@ -4,6 +4,7 @@
  ****************************************/
 
 #include <cstdio>
+#include <cstdlib>
 #include <iostream>
 #include <cstring>
 #include "ZDD.h"
@@ -35,6 +36,14 @@ int NextV(const GB_v v, const GB_v lastv)
   return v2;
 }
 
+static void PrintCard(const ZDD &);
+void PrintCard(const ZDD& f)
+{
+  char* s = f.CardMP10(0);
+  cerr << s << "\n";
+  free(s);
+}
+
 static void PrintPaths(const ZDD &);
 void PrintPaths(const ZDD& f)
 {
@@ -227,18 +236,10 @@ int main(int argc, char *argv[])
     return 0;
   }
 
-  char s[256];
-  bddword card = f.Card();
   if(all) cerr << "all sets:       ";
   else if(cycle) cerr << "all cycles:     ";
   else cerr << "all paths:      ";
-  if(card < ZDD(-1).GetID())
-    cerr << card << "\n";
-  else 
-  {
-    f.CardMP16(s);
-    cerr << "0x" << s << "\n";
-  }
+  PrintCard(f);
   bddword size = f.Size();
   cerr << "(ZDD size)      " << size << "\n";
 
@@ -269,17 +270,10 @@ int main(int argc, char *argv[])
   
     if(l_bound != bddcost_null)
     {
-      card = h.Card();
       if(all) cerr << "bounded sets:   ";
       else if(cycle) cerr << "bounded cycles: ";
       else cerr << " bounded paths: ";
-      if(card < ZDD(-1).GetID())
-        cerr << card << "\n";
-      else 
-      {
-        h.CardMP16(s);
-        cerr << "0x" << s << "\n";
-      }
+      PrintCard(h);
       size = h.Size();
       cerr << " (ZDD size)     " << size << "\n";
       cerr << " (total calls)  " << ct._call << "\n";
@@ -292,34 +286,20 @@ int main(int argc, char *argv[])
       cerr << " accept_best:   ";
       if(rej_best != bddcost_null) cerr << rej_best << "\n";
       else cerr << "-\n";
-      card = h_lb.Card();
       if(all) cerr << "bounded sets:   ";
       else if(cycle) cerr << "bounded cycles: ";
       else cerr << " bounded paths: ";
-      if(card < ZDD(-1).GetID())
-        cerr << card << "\n";
-      else 
-      {
-        h_lb.CardMP16(s);
-        cerr << "0x" << s << "\n";
-      }
+      PrintCard(h_lb);
       size = h_lb.Size();
       cerr << " (ZDD size)     " << size << "\n";
       cerr << " (total calls)  " << ct._call << "\n";
       h -= h_lb;
     }
   
-    card = h.Card();
     if(all) cerr << "bounded sets:   ";
     else if(cycle) cerr << "bounded cycles: ";
     else cerr << "bounded paths:  ";
-    if(card < ZDD(-1).GetID())
-      cerr << card << "\n";
-    else 
-    {
-      h.CardMP16(s);
-      cerr << "0x" << s << "\n";
-    }
+    PrintCard(h);
     size = h.Size();
     cerr << "(ZDD size)      " << size << "\n";
     if(l_bound == bddcost_null)
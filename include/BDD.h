@@ -11,6 +11,8 @@
 #include <cstring>
 #include <cctype>
 #include <iostream>
+#include <vector>
+#include <utility>
 
 #define BDD_CPP
 #include "bddc.h"
@@ -33,7 +35,6 @@ extern const bddword BDD_MaxNode;
 extern const int BDD_MaxVar;
 
 //----- External constant data for BDDV ---------
-extern int BDDV_Active;
 extern const int BDDV_SysVarTop;
 extern const int BDDV_MaxLen;
 extern const int BDDV_MaxLenImport;
@@ -44,55 +45,118 @@ extern const int BDDV_MaxLenImport;
   BDDerr("BDD_RECUR_INC:Stack overflow ", (bddword) BDD_RecurCount, ExceptionType::InternalError);}
 #define BDD_RECUR_DEC BDD_RecurCount--
 
+// bddmcopy/bddmfree, called directly if m is current (the usual case)
+inline bddword BDD_MCopy(BDDManager *m, bddword f)
+  { return (m == BDD_CurMgr)? bddcopy(f): bddmcopy(m, f); }
+inline void BDD_MFree(BDDManager *m, bddword f)
+  { if(m == BDD_CurMgr) bddfree(f); else bddmfree(m, f); }
+
+// Makes m the current manager until the end of the scope
+class BDD_MgrScope
+{
+  BDDManager *_old;
+public:
+  explicit BDD_MgrScope(BDDManager *m) : _old(bddmgrswitch(m)) { }
+  ~BDD_MgrScope(void) { bddmgrswitch(_old); }
+  BDD_MgrScope(const BDD_MgrScope&) = delete;
+  BDD_MgrScope& operator=(const BDD_MgrScope&) = delete;
+};
+
+// A BDD object belongs to the manager that was current when it was made.
+// Copying and destroying it update the reference counts in that manager,
+// even if another manager is current or on another thread. Operations
+// are done in the current manager, which must own the operands.
 class BDD
 {
-  bddword _bdd;
+  mutable bddword _bdd;
+  BDDManager *_mgr;
+  mutable unsigned _epoch;
+
+  // Renumbers _bdd if the nodes were moved since _epoch (see bddmfwd)
+  void Fwd(void) const
+  {
+    unsigned e = BDD_FwdEpoch.load(std::memory_order_relaxed);
+    if(_epoch != e) { _bdd = bddmfwd(_mgr, _bdd, _epoch); _epoch = e; }
+  }
 
 public:
-  BDD(void) { _bdd = bddfalse; }
-  BDD(int a) { _bdd = (a==0)? bddfalse:(a>0)? bddtrue:bddnull; }
-  BDD(const BDD& f) { _bdd = bddcopy(f._bdd); }
+  BDD(void)
+    { _bdd = bddfalse; _mgr = BDD_CurMgr; _epoch = BDD_FwdEpoch.load(); }
+  BDD(int a)
+  {
+    _bdd = (a==0)? bddfalse:(a>0)? bddtrue:bddnull;
+    _mgr = BDD_CurMgr;
+    _epoch = BDD_FwdEpoch.load();
+  }
+  BDD(const BDD& f)
+    { f.Fwd(); _mgr = f._mgr; _epoch = f._epoch; _bdd = BDD_MCopy(_mgr, f._bdd); }
+  BDD(BDD&& f) noexcept : _bdd(f._bdd), _mgr(f._mgr), _epoch(f._epoch)
+    { f._bdd = bddfalse; }
 
-  ~BDD(void) { bddfree(_bdd); }
+  ~BDD(void) { Fwd(); BDD_MFree(_mgr, _bdd); }
 
   BDD& operator=(const BDD& f) { 
-    if(_bdd != f._bdd) { bddfree(_bdd); _bdd = bddcopy(f._bdd); }
+    Fwd();
+    f.Fwd();
+    if(_bdd != f._bdd || _mgr != f._mgr)
+    {
+      BDD_MFree(_mgr, _bdd);
+      _mgr = f._mgr;
+      _bdd = BDD_MCopy(_mgr, f._bdd);
+    }
+    _epoch = f._epoch;
+    return *this; 
+  }
+
+  // The reference of f is taken over without bddcopy/bddfree
+  BDD& operator=(BDD&& f) noexcept { 
+    if(this != &f)
+    {
+      Fwd();
+      BDD_MFree(_mgr, _bdd);
+      _bdd = f._bdd;
+      _mgr = f._mgr;
+      _epoch = f._epoch;
+      f._bdd = bddfalse;
+    }
     return *this; 
   }
 
   BDD& operator&=(const BDD& f)
-    { BDD h; h._bdd = bddand(_bdd, f._bdd); return *this = h; }
+    { BDD h; h._bdd = bddand(GetID(), f.GetID()); return *this = std::move(h); }
   BDD& operator|=(const BDD& f)
-    { BDD h; h._bdd = bddor(_bdd, f._bdd); return *this = h; }
+    { BDD h; h._bdd = bddor(GetID(), f.GetID()); return *this = std::move(h); }
   BDD& operator^=(const BDD& f)
-    { BDD h; h._bdd = bddxor(_bdd, f._bdd); return *this = h; }
+    { BDD h; h._bdd = bddxor(GetID(), f.GetID()); return *this = std::move(h); }
   BDD& operator<<=(const int s)
-    { BDD h; h._bdd = bddlshift(_bdd, s); return *this = h; }
+    { BDD h; h._bdd = bddlshift(GetID(), s); return *this = std::move(h); }
   BDD& operator>>=(const int s)
-    { BDD h; h._bdd = bddrshift(_bdd, s); return *this = h; }
+    { BDD h; h._bdd = bddrshift(GetID(), s); return *this = std::move(h); }
 
-  BDD operator~(void) const { BDD h; h._bdd = bddnot(_bdd); return h; }
+  BDD operator~(void) const { BDD h; h._bdd = bddnot(GetID()); return h; }
   BDD operator<<(int s) const
-    { BDD h; h._bdd = bddlshift(_bdd, s); return h; }
+    { BDD h; h._bdd = bddlshift(GetID(), s); return h; }
   BDD operator>>(int s) const
-    { BDD h; h._bdd = bddrshift(_bdd, s); return h; }
+    { BDD h; h._bdd = bddrshift(GetID(), s); return h; }
 
-  int Top(void) const { return bddtop(_bdd); }
-  BDD At0(int v) const { BDD h; h._bdd = bddat0(_bdd, v); return h; }
-  BDD At1(int v) const { BDD h; h._bdd = bddat1(_bdd, v); return h; }
+  int Top(void) const { return bddtop(GetID()); }
+  BDD At0(int v) const { BDD h; h._bdd = bddat0(GetID(), v); return h; }
+  BDD At1(int v) const { BDD h; h._bdd = bddat1(GetID(), v); return h; }
   BDD Cofact(const BDD& f) const
-    { BDD h; h._bdd = bddcofactor(_bdd, f._bdd); return h; }
+    { BDD h; h._bdd = bddcofactor(GetID(), f.GetID()); return h; }
   BDD Univ(const BDD& f) const
-    { BDD h; h._bdd = bdduniv(_bdd, f._bdd); return h; }
+    { BDD h; h._bdd = bdduniv(GetID(), f.GetID()); return h; }
   BDD Exist(const BDD& f) const
-    { BDD h; h._bdd = bddexist(_bdd, f._bdd); return h; }
+    { BDD h; h._bdd = bddexist(GetID(), f.GetID()); return h; }
   BDD Support(void) const
-    { BDD h; h._bdd = bddsupport(_bdd); return h; }
+    { BDD h; h._bdd = bddsupport(GetID()); return h; }
 
-  bddword GetID(void) const {return _bdd; }
+  bddword GetID(void) const { Fwd(); return _bdd; }
+  BDDManager* GetManager(void) const { return _mgr; }
    
   bddword Size(void) const;
   void Export(FILE *strm = stdout) const;
+  void ExportBin(FILE *strm) const;
   void Print(void) const;
   void XPrint0(void) const;
   void XPrint(void) const;
@@ -100,29 +164,58 @@ public:
   BDD Swap(const int&, const int&) const;
   BDD Smooth(const int&) const;
   BDD Spread(const int&) const;
+  BDD Permute(const std::vector<int>&) const;
 
   friend BDD BDD_ID(bddword);
 };
 
 //--------- External functions for BDD ---------
-extern int     BDD_Init(bddword init=256, bddword limit=BDD_MaxNode, double cacheRatio=0.5);
+extern int     BDD_Init(bddword init=256, bddword limit=BDD_MaxNode, double cacheRatio=0.5,
+                         int threads=1);
 extern int     BDD_NewVarOfLev(int);
 extern int     BDD_VarUsed(void);
 extern bddword BDD_Used(void);
 extern void    BDD_GC(void);
+extern bddword BDD_Compact(int order = BDD_COMPACT_DFS);
 extern void    BDD_SetCacheRatio(double ratio);
 extern double  BDD_GetCacheRatio(void);
 extern void    BDD_SetGCThreshold(bddword threshold);
 extern bddword BDD_GetGCThreshold(void);
+extern void    BDD_SetGCMode(int mode);
+extern int     BDD_GetGCMode(void);
+extern void    BDD_SetCacheWays(int ways);
+extern int     BDD_GetCacheWays(void);
+extern void    BDD_SetUniqueTable(int type);
+extern int     BDD_GetUniqueTable(void);
+extern void    BDD_SetNodeTable(int type);
+extern int     BDD_GetNodeTable(void);
+extern void    BDD_SetGCThreads(int n);
+extern int     BDD_GetGCThreads(void);
+extern void    BDD_SetApplyThreads(int n);
+extern int     BDD_GetApplyThreads(void);
+extern bddword BDD_Reorder(void);
+extern void    BDD_SetAutoReorder(bddword threshold);
+extern bddword BDD_GetAutoReorder(void);
+extern void    BDD_SetBFSThreshold(bddword threshold);
+extern bddword BDD_GetBFSThreshold(void);
+extern void    BDD_VarGroup(int lev, int n, int type);
+extern void    BDD_SetReorderCost(int cost);
+extern int     BDD_GetReorderCost(void);
 extern BDD BDD_Import(FILE *strm = stdin);
+extern BDD BDD_Import(std::istream &is);
+extern BDD BDD_ImportBin(const char *path);
 extern BDD BDD_Random(int, int density = 50);
 extern void BDDerr(const char *, ExceptionType);
 extern void BDDerr(const char *, bddword, ExceptionType);
 extern void BDDerr(const char *, const char *, ExceptionType);
 
 //--------- Inline functions for BDD ---------
+// The system variables of BDDV_Init are below the user levels
 inline int BDD_TopLev(void)
-  { return BDDV_Active? bddvarused() - BDDV_SysVarTop: bddvarused(); }
+{
+  return bddmgrpkg(BDD_PKG_BDDV)? bddvarused() - BDDV_SysVarTop:
+                                  bddvarused();
+}
 
 inline int BDD_NewVar(void)
   { return bddnewvaroflev(BDD_TopLev() + 1); }
@@ -162,6 +255,14 @@ inline int operator!=(const BDD& f, const BDD& g)
 inline int BDD_Imply(const BDD& f, const BDD& g) 
   { return bddimply(f.GetID(), g.GetID()); }
 
+inline BDD BDD_Ite(const BDD& f, const BDD& g, const BDD& h) 
+  { return BDD_ID(bddite(f.GetID(), g.GetID(), h.GetID())); }
+
+inline BDD BDD_AndExist(const BDD& f, const BDD& g, const BDD& c) 
+  { return BDD_ID(bddandexist(f.GetID(), g.GetID(), c.GetID())); }
+
+extern BDD BDD_VectorCompose(const BDD&, const std::vector<BDD>&);
+
 class BDDV
 {
   BDD _bdd;
@@ -180,6 +281,9 @@ public:
   BDDV(const BDDV& fv)
     { _bdd = fv._bdd; _len = fv._len; _lev = fv._lev; } 
 
+  BDDV(BDDV&& fv) noexcept
+    : _bdd(std::move(fv._bdd)), _len(fv._len), _lev(fv._lev) { }
+
   BDDV(const BDD& f) {
     int t = f.Top();
     if(t > 0 && BDD_LevOfVar(t) > BDD_TopLev())
@@ -196,6 +300,9 @@ public:
   BDDV& operator=(const BDDV& fv)
     { _bdd = fv._bdd; _len = fv._len; _lev = fv._lev; return *this; } 
 
+  BDDV& operator=(BDDV&& fv) noexcept
+    { _bdd = std::move(fv._bdd); _len = fv._len; _lev = fv._lev; return *this; } 
+
   BDDV& operator&=(const BDDV&);
   BDDV& operator|=(const BDDV&);
   BDDV& operator^=(const BDDV&);
@@ -280,7 +387,9 @@ extern BDDV operator||(const BDDV&, const BDDV&);
 extern BDDV BDDV_Mask1(int, int);
 extern BDDV BDDV_Mask2(int, int);
 extern BDDV BDDV_Import(FILE *strm = stdin);
+extern BDDV BDDV_Import(std::istream &is);
 extern BDDV BDDV_ImportPla(FILE *strm = stdin, int sopf = 0);
+extern BDDV BDDV_ImportPla(std::istream &is, int sopf = 0);
 
 //----- Inline functions for BDDV ---------
 inline int BDDV_UserTopLev(void) { return BDD_TopLev(); }
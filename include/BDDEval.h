@@ -0,0 +1,130 @@
+/*********************************************
+ * Semiring evaluation of BDD/ZDD - Header   *
+ *********************************************/
+
+#ifndef _BDDEval_
+#define _BDDEval_
+
+#include <thread>
+#include <vector>
+#include "bddc.h"
+
+namespace sapporobdd {
+
+/* A semiring for bddeval provides value_type, zero(), one(), plus(a, b)
+ * and times(a, b). BDD_RealSemiring gives the weighted model count with
+ * double values (the probability for w0[v] = 1 - p[v], w1[v] = p[v]). */
+struct BDD_RealSemiring
+{
+  typedef double value_type;
+  static double zero(void) { return 0; }
+  static double one(void) { return 1; }
+  static double plus(double a, double b) { return a + b; }
+  static double times(double a, double b) { return a * b; }
+};
+
+/* Evaluates f in the semiring S. Each assignment of the variables (BDD)
+ * or each set of the variables (ZDD) is weighted by the product of
+ * w1[v] for the true (included) variables and w0[v] for the others, and
+ * the weights of the assignments (sets) in f are summed up. w0 and w1
+ * are indexed by VarID. The levels having many nodes are evaluated by
+ * the given number of threads. A constant is taken as a BDD. */
+template<class S> typename S::value_type
+bddeval(bddp f, const typename S::value_type *w0,
+        const typename S::value_type *w1, int threads = 1)
+{
+  typedef typename S::value_type T;
+  const bddp minsize = 1024; /* nodes of a level to be split */
+
+  if(f == bddnull) return S::zero();
+  bddvar used = bddvarused();
+  int z = (!(f & B_CST_MASK) && bddiszbdd(f))? 1: 0;
+
+  /* skip[lev]: factor for a variable not on the path */
+  std::vector<T> skip(used + 1, S::one());
+  for(bddvar lev=1; lev<=used; lev++)
+  {
+    bddvar v = bddvaroflev(lev);
+    skip[lev] = z? w0[v]: S::plus(w0[v], w1[v]);
+  }
+
+  /* between(a, b): product of skip[k] for a < k < b in O(1), without
+   * the inverses that prefix products would need. For the boundary m of
+   * each aligned block of 2 << j levels, tab[j][k] is the product of
+   * skip[k..m-1] for k < m and of skip[m..k] for k >= m. */
+  int bits = 1;
+  while(((bddvar)1 << bits) <= used) bits++;
+  std::vector<std::vector<T> > tab(bits, std::vector<T>(used + 1, S::one()));
+  for(int j=0; j<bits; j++)
+  {
+    bddvar half = (bddvar)1 << j;
+    for(bddvar m=half; m<=used; m+=2*half)
+    {
+      tab[j][m-1] = skip[m-1];
+      for(bddvar k=m-1; k>m-half; k--)
+        tab[j][k-1] = S::times(skip[k-1], tab[j][k]);
+      tab[j][m] = skip[m];
+      for(bddvar k=m+1; k<m+half && k<=used; k++)
+        tab[j][k] = S::times(tab[j][k-1], skip[k]);
+    }
+  }
+  std::vector<unsigned char> high((bddvar)1 << bits, 0);
+  for(bddvar d=2; d<high.size(); d++) high[d] = high[d>>1] + 1;
+  auto between = [&](bddvar a, bddvar b)
+  {
+    if(a + 1 >= b) return S::one();
+    bddvar lo = a + 1, hi = b - 1, d = lo ^ hi;
+    if(d == 0) return skip[lo];
+    return S::times(tab[high[d]][lo], tab[high[d]][hi]);
+  };
+
+  bddp n = bddnodelist(f, 0, 0);
+  std::vector<struct bddnode> list(n);
+  bddnodelist(f, list.data(), n);
+  std::vector<bddvar> lev(n + 1, 0);
+  for(bddp i=0; i<n; i++) lev[i+1] = bddlevofvar(list[i].v);
+
+  /* val[2*(i+1)+1]: value of the negated edge to list[i], taken on the
+   * variables up to its level */
+  std::vector<T> val(2 * (n + 1));
+  val[0] = S::zero();
+  val[1] = S::one();
+  auto edge = [&](bddp c, bddvar l)
+    { return S::times(val[c], between(lev[c>>1], l)); };
+  auto node = [&](bddp i)
+  {
+    bddvar v = list[i].v, l = lev[i+1];
+    for(int g=0; g<2; g++)
+    {
+      bddp lo = list[i].lo ^ g, hi = list[i].hi ^ (z? 0: g);
+      val[2*(i+1)+g] = S::plus(S::times(w0[v], edge(lo, l)),
+                               S::times(w1[v], edge(hi, l)));
+    }
+  };
+
+  /* The nodes of a level depend only on the lower levels */
+  for(bddp b=0, e; b<n; b=e)
+  {
+    for(e=b+1; e<n && lev[e+1]==lev[b+1]; e++) ;
+    if(threads <= 1 || e - b < minsize)
+    {
+      for(bddp i=b; i<e; i++) node(i);
+      continue;
+    }
+    std::vector<std::thread> th;
+    bddp chunk = (e - b + threads - 1) / threads;
+    for(bddp s=b; s<e; s+=chunk)
+    {
+      bddp t = (s + chunk < e)? s + chunk: e;
+      th.emplace_back([&node, s, t] { for(bddp i=s; i<t; i++) node(i); });
+    }
+    for(auto &x: th) x.join();
+  }
+
+  bddp r = n? (n << 1) | (f & B_INV_MASK): ((f & B_INV_MASK)? 1: 0);
+  return edge(r, used + 1);
+}
+
+} // namespace sapporobdd
+
+#endif // _BDDEval_
@@ -0,0 +1,45 @@
+/*********************************************
+ * BDDImage Class (SAPPOROBDD++) - Header    *
+ *********************************************/
+
+#ifndef _BDDImage_
+#define _BDDImage_
+
+#include <vector>
+#include "BDD.h"
+
+namespace sapporobdd {
+
+/* Image computation by a partitioned transition relation T(x, y),
+ * which is the conjunction of the parts. x is the current-state
+ * variables and y is the next-state variables. */
+class BDDImage
+{
+  std::vector<BDD> _cluster;   /* Conjunction of parts */
+  std::vector<BDD> _imgCube;   /* Variables quantified with each cluster */
+  std::vector<BDD> _preCube;   /* Same as _imgCube for PreImage */
+  std::vector<int> _last;      /* Last cluster using each variable (-1: none) */
+  std::vector<int> _cur;       /* Current-state variables */
+  std::vector<int> _next;      /* Next-state variables */
+  std::vector<char> _isCur;    /* 1 for the current-state variables */
+  std::vector<char> _isNext;   /* 1 for the next-state variables */
+  std::vector<int> _perm;      /* Exchanges cur[i] and next[i] */
+
+  BDD Product(const BDD&, const std::vector<BDD>&, const std::vector<char>&) const;
+  BDD Rename(const BDD&) const;
+
+public:
+  BDDImage(void) { }
+  BDDImage(const std::vector<BDD>& parts, const std::vector<int>& cur,
+           const std::vector<int>& next, bddword limit = 5000);
+  ~BDDImage(void) { }
+
+  BDD Image(const BDD& s) const;
+  BDD PreImage(const BDD& s) const;
+  int Clusters(void) const { return (int)_cluster.size(); }
+  BDD Cluster(int i) const;
+};
+
+} // namespace sapporobdd
+
+#endif // _BDDImage_
@@ -0,0 +1,148 @@
+/*********************************************
+ * Tokenizer of import formats - Header      *
+ *********************************************/
+
+#ifndef _BDDTokenizer_
+#define _BDDTokenizer_
+
+#include <climits>
+#include <cstdio>
+#include <cstring>
+#include <istream>
+#include <string>
+#include "BDDException.h"
+
+namespace sapporobdd {
+
+/* Splits an input into the tokens separated by white spaces, as
+ * fscanf("%s") does. A FILE is read through its stdio buffer and an
+ * istream through its streambuf, and the separator after a token is left
+ * unread, so the input can be read on after an import. The end of an
+ * istream sets eofbit (and failbit if no token is left) as >> does.
+ * A memory buffer is not copied. */
+class BDD_Tokenizer
+{
+  FILE *_fp;
+  std::istream *_is;
+  std::streambuf *_sb;
+  const char *_p, *_end; /* Memory buffer */
+  std::string _s;        /* Token read from a stream */
+  const char *_tok;
+  size_t _len;
+
+  static bool Space(int c)
+  {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r' ||
+           c == '\v' || c == '\f';
+  }
+
+  static int Getc(FILE *strm)
+  {
+#if defined(__unix__) || defined(__APPLE__)
+    return getc_unlocked(strm);
+#else
+    return getc(strm);
+#endif
+  }
+
+public:
+  explicit BDD_Tokenizer(FILE *strm)
+    : _fp(strm), _is(0), _sb(0), _p(0), _end(0), _tok(0), _len(0) {}
+  explicit BDD_Tokenizer(std::istream &is)
+    : _fp(0), _is(&is), _sb(is.rdbuf()), _p(0), _end(0), _tok(0), _len(0) {}
+  BDD_Tokenizer(const char *data, size_t size)
+    : _fp(0), _is(0), _sb(0), _p(data), _end(data + size), _tok(0), _len(0) {}
+
+  /* Reads the next token. Returns 0 at the end of the input. */
+  int Next(void)
+  {
+    int c;
+
+    if(_fp)
+    {
+      do c = Getc(_fp); while(c != EOF && Space(c));
+      if(c == EOF) return 0;
+      _s.clear();
+      do { _s.push_back((char)c); c = Getc(_fp); }
+      while(c != EOF && !Space(c));
+      if(c != EOF) ungetc(c, _fp);
+      _tok = _s.data();
+      _len = _s.size();
+      return 1;
+    }
+    if(_is)
+    {
+      const int eof = std::char_traits<char>::eof();
+      if(!_sb || !_is->good())
+      {
+        _is->setstate(std::ios_base::failbit);
+        return 0;
+      }
+      c = _sb->sgetc();
+      while(c != eof && Space(c)) c = _sb->snextc();
+      if(c == eof)
+      {
+        _is->setstate(std::ios_base::eofbit | std::ios_base::failbit);
+        return 0;
+      }
+      _s.clear();
+      do { _s.push_back((char)c); c = _sb->snextc(); }
+      while(c != eof && !Space(c));
+      if(c == eof) _is->setstate(std::ios_base::eofbit);
+      _tok = _s.data();
+      _len = _s.size();
+      return 1;
+    }
+    while(_p < _end && Space((unsigned char)*_p)) _p++;
+    if(_p == _end) return 0;
+    _tok = _p;
+    while(_p < _end && !Space((unsigned char)*_p)) _p++;
+    _len = _p - _tok;
+    return 1;
+  }
+
+  /* The current token, which is not null-terminated */
+  const char *Data(void) const { return _tok; }
+  size_t Size(void) const { return _len; }
+
+  bool Is(const char *s) const
+  {
+    return strlen(s) == _len && memcmp(s, _tok, _len) == 0;
+  }
+
+  /* Decimal value of the token, which must be an optional sign and one
+   * or more digits in the range of long long. Returns false otherwise. */
+  bool Int(long long &v) const
+  {
+    unsigned long long x = 0, lim;
+    size_t i = 0;
+    bool neg = false;
+
+    if(i < _len && (_tok[i] == '+' || _tok[i] == '-')) neg = (_tok[i++] == '-');
+    if(i == _len) return false;
+    lim = neg? (unsigned long long)LLONG_MAX + 1: (unsigned long long)LLONG_MAX;
+    for(; i < _len; i++)
+    {
+      if(_tok[i] < '0' || _tok[i] > '9') return false;
+      unsigned d = _tok[i] - '0';
+      if(x > (lim - d) / 10) return false;
+      x = x * 10 + d;
+    }
+    v = neg? (long long)(0 - x): (long long)x;
+    return true;
+  }
+
+  /* Same as above, but throws BDDFileFormatException for a bad token */
+  long long Int(void) const
+  {
+    long long v;
+    if(!Int(v))
+      throw BDDFileFormatException("Import error: Invalid integer '" +
+                                   std::string(_tok, _len) + "'", 0);
+    return v;
+  }
+};
+
+} // namespace sapporobdd
+
+#endif // _BDDTokenizer_
@@ -22,11 +22,14 @@ class CtoI
 public:
   CtoI(void) { _zdd = 0; }
   CtoI(const CtoI& a) { _zdd = a._zdd; }
+  CtoI(CtoI&& a) noexcept : _zdd(std::move(a._zdd)) { }
   CtoI(const ZDD& f) { _zdd = f; }
+  CtoI(ZDD&& f) noexcept : _zdd(std::move(f)) { }
   CtoI(int);
   ~CtoI(void) { }
 
   CtoI& operator=(const CtoI& a) { _zdd = a._zdd; return *this; }
+  CtoI& operator=(CtoI&& a) noexcept { _zdd = std::move(a._zdd); return *this; }
   CtoI& operator+=(const CtoI&); // inline
   CtoI& operator-=(const CtoI&); // inline
   CtoI& operator*=(const CtoI&); // inline
@@ -24,10 +24,21 @@ class PiDD;
 #define PiDD_Y_Lev(lev) (PiDD_LevOfX[PiDD_XOfLev[lev]] -lev +1)
 #define PiDD_Lev_XY(x,y) (PiDD_LevOfX[x] -y +1)
 
-extern int PiDD_TopVar;
-extern int PiDD_VarTableSize;
-extern int PiDD_LevOfX[PiDD_MaxVar];
-extern int *PiDD_XOfLev;
+// Variables of the current manager (see PiDD_Vars)
+struct PiDD_VarTable
+{
+  int TopVar;
+  int VarTableSize;
+  int LevOfX[PiDD_MaxVar + 1];
+  int *XOfLev;
+  int TopBDDVar;  // BDD variable on LevOfX[TopVar]
+};
+extern PiDD_VarTable *PiDD_Vars(void);
+
+#define PiDD_TopVar (PiDD_Vars()->TopVar)
+#define PiDD_VarTableSize (PiDD_Vars()->VarTableSize)
+#define PiDD_LevOfX (PiDD_Vars()->LevOfX)
+#define PiDD_XOfLev (PiDD_Vars()->XOfLev)
 
 extern int PiDD_NewVar(void);
 extern int PiDD_VarUsed(void);
@@ -42,11 +53,14 @@ public:
   PiDD(void) { _zdd = 0; }
   PiDD(int a) { _zdd = a; }
   PiDD(const PiDD& f) { _zdd = f._zdd; }
+  PiDD(PiDD&& f) noexcept : _zdd(std::move(f._zdd)) { }
   PiDD(const ZDD& zdd) { _zdd = zdd; }
+  PiDD(ZDD&& zdd) noexcept : _zdd(std::move(zdd)) { }
 
   ~PiDD(void) { }
 
   PiDD& operator=(const PiDD& f) { _zdd = f._zdd; return *this; }
+  PiDD& operator=(PiDD&& f) noexcept { _zdd = std::move(f._zdd); return *this; }
   PiDD& operator&=(const PiDD&); // inline
   PiDD& operator+=(const PiDD&); // inline
   PiDD& operator-=(const PiDD&); // inline
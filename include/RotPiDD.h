@@ -26,10 +26,21 @@ class RotPiDD;
 #define RotPiDD_Y_Lev(lev) (RotPiDD_LevOfX[RotPiDD_XOfLev[lev]] -lev +1)
 #define RotPiDD_Lev_XY(x,y) (RotPiDD_LevOfX[x] -y +1)
 
-extern int RotPiDD_TopVar;
-extern int RotPiDD_VarTableSize;
-extern int RotPiDD_LevOfX[RotPiDD_MaxVar];
-extern int *RotPiDD_XOfLev;
+// Variables of the current manager (see RotPiDD_Vars)
+struct RotPiDD_VarTable
+{
+  int TopVar;
+  int VarTableSize;
+  int LevOfX[RotPiDD_MaxVar + 1];
+  int *XOfLev;
+  int TopBDDVar;  // BDD variable on LevOfX[TopVar]
+};
+extern RotPiDD_VarTable *RotPiDD_Vars(void);
+
+#define RotPiDD_TopVar (RotPiDD_Vars()->TopVar)
+#define RotPiDD_VarTableSize (RotPiDD_Vars()->VarTableSize)
+#define RotPiDD_LevOfX (RotPiDD_Vars()->LevOfX)
+#define RotPiDD_XOfLev (RotPiDD_Vars()->XOfLev)
 
 extern int RotPiDD_NewVar(void);
 extern int RotPiDD_VarUsed(void);
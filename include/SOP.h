@@ -30,10 +30,13 @@ public:
   SOP() { _zdd = ZDD(); }
   SOP(int val) { _zdd = ZDD(val); }
   SOP(const SOP& f) { _zdd = f._zdd; }
+  SOP(SOP&& f) noexcept : _zdd(std::move(f._zdd)) { }
   SOP(const ZDD& zdd) { _zdd = zdd; }
+  SOP(ZDD&& zdd) noexcept : _zdd(std::move(zdd)) { }
   ~SOP() { }
   
   SOP& operator=(const SOP& f) { _zdd = f._zdd; return *this; }
+  SOP& operator=(SOP&& f) noexcept { _zdd = std::move(f._zdd); return *this; }
 
   SOP& operator&=(const SOP& f)
     { _zdd = _zdd & f._zdd; return *this; }
@@ -27,10 +27,13 @@ public:
   SeqBDD(void){ _zdd = ZDD(); }
   SeqBDD(int val) { _zdd = ZDD(val); }
   SeqBDD(const SeqBDD& f){ _zdd = f._zdd; }
+  SeqBDD(SeqBDD&& f) noexcept : _zdd(std::move(f._zdd)) { }
   SeqBDD(const ZDD& zdd){ _zdd = zdd; }
+  SeqBDD(ZDD&& zdd) noexcept : _zdd(std::move(zdd)) { }
   ~SeqBDD(void){ }
 
   SeqBDD& operator=(const SeqBDD& f) { _zdd = f._zdd; return *this; }
+  SeqBDD& operator=(SeqBDD&& f) noexcept { _zdd = std::move(f._zdd); return *this; }
   SeqBDD operator&=(const SeqBDD& f)
     { _zdd = _zdd & f._zdd; return *this; }
 
@@ -14,79 +14,128 @@ class SeqBDD;
 class ZDD;
 class ZDDV;
 
+// A ZDD object belongs to a manager as a BDD object does (see BDD.h)
 class ZDD
 {
-  bddword _zdd;
+  mutable bddword _zdd;
+  BDDManager *_mgr;
+  mutable unsigned _epoch;
+
+  // Renumbers _zdd if the nodes were moved since _epoch (see bddmfwd)
+  void Fwd(void) const
+  {
+    unsigned e = BDD_FwdEpoch.load(std::memory_order_relaxed);
+    if(_epoch != e) { _zdd = bddmfwd(_mgr, _zdd, _epoch); _epoch = e; }
+  }
 
 public:
-  ZDD(void) { _zdd = bddempty; }
-  ZDD(int v) { _zdd = (v==0)? bddempty:(v>0)? bddsingle:bddnull; }
-  ZDD(const ZDD& f) { _zdd = bddcopy(f._zdd); }
+  ZDD(void)
+    { _zdd = bddempty; _mgr = BDD_CurMgr; _epoch = BDD_FwdEpoch.load(); }
+  ZDD(int v)
+  {
+    _zdd = (v==0)? bddempty:(v>0)? bddsingle:bddnull;
+    _mgr = BDD_CurMgr;
+    _epoch = BDD_FwdEpoch.load();
+  }
+  ZDD(const ZDD& f)
+    { f.Fwd(); _mgr = f._mgr; _epoch = f._epoch; _zdd = BDD_MCopy(_mgr, f._zdd); }
+  ZDD(ZDD&& f) noexcept : _zdd(f._zdd), _mgr(f._mgr), _epoch(f._epoch)
+    { f._zdd = bddempty; }
 
-  ~ZDD(void) { bddfree(_zdd); }
+  ~ZDD(void) { Fwd(); BDD_MFree(_mgr, _zdd); }
 
   ZDD& operator=(const ZDD& f) { 
-    if(_zdd != f._zdd) { bddfree(_zdd); _zdd = bddcopy(f._zdd); } 
+    Fwd();
+    f.Fwd();
+    if(_zdd != f._zdd || _mgr != f._mgr)
+    {
+      BDD_MFree(_mgr, _zdd);
+      _mgr = f._mgr;
+      _zdd = BDD_MCopy(_mgr, f._zdd);
+    }
+    _epoch = f._epoch;
+    return *this;
+  }
+
+  // The reference of f is taken over without bddcopy/bddfree
+  ZDD& operator=(ZDD&& f) noexcept { 
+    if(this != &f)
+    {
+      Fwd();
+      BDD_MFree(_mgr, _zdd);
+      _zdd = f._zdd;
+      _mgr = f._mgr;
+      _epoch = f._epoch;
+      f._zdd = bddempty;
+    }
     return *this;
   }
 
   ZDD& operator&=(const ZDD& f)
-    { ZDD h; h._zdd = bddintersec(_zdd, f._zdd); return *this = h; }
+    { ZDD h; h._zdd = bddintersec(GetID(), f.GetID()); return *this = std::move(h); }
 
   ZDD& operator+=(const ZDD& f)
-    { ZDD h; h._zdd = bddunion(_zdd, f._zdd); return *this = h; }
+    { ZDD h; h._zdd = bddunion(GetID(), f.GetID()); return *this = std::move(h); }
 
   ZDD& operator-=(const ZDD& f)
-    { ZDD h; h._zdd = bddsubtract(_zdd, f._zdd); return *this = h; }
+    { ZDD h; h._zdd = bddsubtract(GetID(), f.GetID()); return *this = std::move(h); }
 
   ZDD& operator<<=(int s)
-    { ZDD h; h._zdd = bddlshift(_zdd, s); return *this = h; }
+    { ZDD h; h._zdd = bddlshift(GetID(), s); return *this = std::move(h); }
 
   ZDD& operator>>=(int s)
-    { ZDD h; h._zdd = bddrshift(_zdd, s); return *this = h; }
+    { ZDD h; h._zdd = bddrshift(GetID(), s); return *this = std::move(h); }
 
   ZDD& operator*=(const ZDD&);
   ZDD& operator/=(const ZDD&);
   ZDD& operator%=(const ZDD&);
 
   ZDD operator<<(int s) const
-    { ZDD h; h._zdd = bddlshift(_zdd, s); return h; }
+    { ZDD h; h._zdd = bddlshift(GetID(), s); return h; }
 
   ZDD operator>>(int s) const
-    { ZDD h; h._zdd = bddrshift(_zdd, s); return h; }
+    { ZDD h; h._zdd = bddrshift(GetID(), s); return h; }
 
-  int Top(void) const { return bddtop(_zdd); }
+  int Top(void) const { return bddtop(GetID()); }
 
   ZDD OffSet(int v) const
-    { ZDD h; h._zdd = bddoffset(_zdd, v); return h; }
+    { ZDD h; h._zdd = bddoffset(GetID(), v); return h; }
 
   ZDD OnSet(int v) const
-    { ZDD h; h._zdd = bddonset(_zdd, v); return h; }
+    { ZDD h; h._zdd = bddonset(GetID(), v); return h; }
 
   ZDD OnSet0(int v) const
-    { ZDD h; h._zdd = bddonset0(_zdd, v); return h; }
+    { ZDD h; h._zdd = bddonset0(GetID(), v); return h; }
 
   ZDD Change(int v) const
-    { ZDD h; h._zdd = bddchange(_zdd, v); return h; }
-
-  bddword GetID(void) const { return _zdd; }
-  bddword Size(void) const { return bddsize(_zdd); }
-  bddword Card(void) const { return bddcard(_zdd); }
-  bddword Lit(void) const { return bddlit(_zdd); }
-  bddword Len(void) const { return bddlen(_zdd); }
-  char* CardMP16(char* s) const { return bddcardmp16(_zdd, s); }
+    { ZDD h; h._zdd = bddchange(GetID(), v); return h; }
+
+  bddword GetID(void) const { Fwd(); return _zdd; }
+  BDDManager* GetManager(void) const { return _mgr; }
+  bddword Size(void) const { return bddsize(GetID()); }
+  bddword Card(void) const { return bddcard(GetID()); }
+  bddword Lit(void) const { return bddlit(GetID()); }
+  bddword Len(void) const { return bddlen(GetID()); }
+  char* CardMP16(char* s) const { return bddcardmp16(GetID(), s); }
+  char* CardMP10(char* s) const { return bddcardmp10(GetID(), s); }
+  unsigned long long Card64(void) const { return bddcard64(GetID()); }
+#ifdef __SIZEOF_INT128__
+  unsigned __int128 Card128(void) const { return bddcard128(GetID()); }
+#endif
 
   void Export(FILE *strm = stdout) const;
+  void ExportBin(FILE *strm) const;
   void XPrint(void) const;
   void Print(void) const;
   void PrintPla(void) const;
 
   ZDD Swap(int, int) const;
+  ZDD Permute(const std::vector<int>&) const;
   ZDD Restrict(const ZDD&) const;
   ZDD Permit(const ZDD&) const;
   ZDD PermitSym(int) const;
   ZDD Support(void) const
-    { ZDD h; h._zdd = bddsupport(_zdd); return h; }
+    { ZDD h; h._zdd = bddsupport(GetID()); return h; }
   ZDD Always(void) const;
 
   int SymChk(int, int) const;
@@ -119,6 +168,8 @@ extern ZDD operator/(const ZDD&, const ZDD&);
 extern ZDD ZDD_Meet(const ZDD&, const ZDD&);
 extern ZDD ZDD_Random(int, int density = 50);
 extern ZDD ZDD_Import(FILE *strm = stdin);
+extern ZDD ZDD_Import(std::istream &is);
+extern ZDD ZDD_ImportBin(const char *path);
 
 extern ZDD ZDD_LCM_A(char *, int);
 extern ZDD ZDD_LCM_C(char *, int);
@@ -153,6 +204,70 @@ inline ZDD operator-(const ZDD& f, const ZDD& g)
 inline ZDD operator%(const ZDD& f, const ZDD& p)
   { return f - (f/p) * p; }
 
+// A chain of + (Op == '+') or & (Op == '&') started by ZDD_Expr, such as
+// ZDD_Expr<'+'>(f) + g + h. The operands are collected and evaluated by
+// bddunionN or bddintersecN in one pass when the chain is converted to ZDD.
+template<char Op> class ZDD_Expr
+{
+  std::vector<bddp> _f;
+  BDDManager *_mgr;
+
+public:
+  ZDD_Expr(void) : _mgr(BDD_CurMgr) { }
+  explicit ZDD_Expr(const ZDD& f) : _mgr(f.GetManager())
+    { _f.reserve(4); Append(f); }
+  ZDD_Expr(const ZDD_Expr& e) : _f(e._f), _mgr(e._mgr)
+    { for(bddp f : _f) BDD_MCopy(_mgr, f); }
+  ZDD_Expr(ZDD_Expr&& e) noexcept : _f(std::move(e._f)), _mgr(e._mgr)
+    { e._f.clear(); }
+  ZDD_Expr& operator=(const ZDD_Expr&) = delete;
+
+  ~ZDD_Expr(void) { for(bddp f : _f) BDD_MFree(_mgr, f); }
+
+  ZDD_Expr& Append(const ZDD& f)
+  {
+    Join(f.GetManager());
+    _f.push_back(BDD_MCopy(_mgr, f.GetID()));
+    return *this;
+  }
+
+  ZDD_Expr& Append(ZDD_Expr&& e)
+  {
+    if(e._f.empty()) return *this;
+    Join(e._mgr);
+    _f.insert(_f.end(), e._f.begin(), e._f.end());
+    e._f.clear();
+    return *this;
+  }
+
+  // Evaluated on the manager of the operands, whichever is current
+  operator ZDD(void) const
+  {
+    BDD_MgrScope ms(_mgr);
+    return ZDD_ID((Op == '+')? bddunionN(_f.data(), (int)_f.size()):
+                  bddintersecN(_f.data(), (int)_f.size()));
+  }
+
+private:
+  // All the operands must belong to one manager, that of the first one
+  void Join(BDDManager *m)
+  {
+    if(_f.empty()) _mgr = m;
+    else if(m != _mgr)
+      BDDerr("ZDD_Expr: operands of different managers",
+             ExceptionType::InvalidBDDValue);
+  }
+};
+
+inline ZDD_Expr<'&'> operator&(ZDD_Expr<'&'>&& e, const ZDD& g)
+  { return std::move(e.Append(g)); }
+inline ZDD_Expr<'&'> operator&(ZDD_Expr<'&'>&& e, ZDD_Expr<'&'>&& d)
+  { return std::move(e.Append(std::move(d))); }
+inline ZDD_Expr<'+'> operator+(ZDD_Expr<'+'>&& e, const ZDD& g)
+  { return std::move(e.Append(g)); }
+inline ZDD_Expr<'+'> operator+(ZDD_Expr<'+'>&& e, ZDD_Expr<'+'>&& d)
+  { return std::move(e.Append(std::move(d))); }
+
 inline int operator==(const ZDD& f, const ZDD& g)
   { return f.GetID() == g.GetID(); }
 
@@ -179,10 +294,12 @@ class ZDDV
 public:
   ZDDV(void) { _zdd = 0; }
   ZDDV(const ZDDV& fv) { _zdd = fv._zdd; }
+  ZDDV(ZDDV&& fv) noexcept : _zdd(std::move(fv._zdd)) { }
   ZDDV(const ZDD& f, int location = 0);
   ~ZDDV(void) { }
 
   ZDDV& operator=(const ZDDV& fv) { _zdd = fv._zdd; return *this; }
+  ZDDV& operator=(ZDDV&& fv) noexcept { _zdd = std::move(fv._zdd); return *this; }
   ZDDV& operator&=(const ZDDV& fv) { _zdd &= fv._zdd; return *this; }
   ZDDV& operator+=(const ZDDV& fv) { _zdd += fv._zdd; return *this; }
   ZDDV& operator-=(const ZDDV& fv) { _zdd -= fv._zdd; return *this; }
@@ -218,6 +335,7 @@ public:
 typedef ZDDV ZBDDV; // for backward compatibility
 
 extern ZDDV ZDDV_Import(FILE *strm = stdin);
+extern ZDDV ZDDV_Import(std::istream &is);
 inline ZDDV ZBDDV_Import(FILE *strm = stdin) { return ZDDV_Import(strm); } // for backward compatibility
 
 inline ZDDV operator&(const ZDDV& fv, const ZDDV& gv)
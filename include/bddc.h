@@ -6,6 +6,10 @@
 #ifndef bddc_h
 #define bddc_h
 
+#include <atomic>
+#include <cstddef>
+#include <iosfwd>
+
 #define SAPPOROBDD_PLUS_PLUS
 #define SAPPOROBDDPP_MAJOR_VERSION 1
 #define SAPPOROBDDPP_MINOR_VERSION 0
@@ -38,6 +42,7 @@ namespace sapporobdd {
 
 /***************** External typedef *****************/
 typedef unsigned int bddvar;
+struct BDDManager; /* Opaque BDD manager (see bddmgrnew) */
 
 #ifdef B_32
   typedef unsigned int bddp;
@@ -59,16 +64,84 @@ typedef unsigned int bddvar;
 
 #define CACHE_OP_USER_START   100   /* Start of user-defined cache operations */
 
+/* GC modes (see bddsetgcmode) */
+#define BDD_GC_FULL   0  /* Sweep the cache at every GC (default) */
+#define BDD_GC_EPOCH  1  /* Check cache entries lazily by GC epochs */
+
+/* Statistics of operation cache per operation code (see bddcachestats) */
+#define BDD_CACHE_OPMAX 256
+struct bddcachestat
+{
+  unsigned long long hit;   /* Lookups found in cache */
+  unsigned long long miss;  /* Lookups not found in cache */
+  unsigned long long evict; /* Entries of this code pushed out by others */
+};
+
+/* Operations of bddbfsapply */
+#define BDD_BFS_AND       0
+#define BDD_BFS_OR        1
+#define BDD_BFS_XOR       2
+#define BDD_BFS_INTERSEC  3
+#define BDD_BFS_UNION     4
+#define BDD_BFS_SUBTRACT  5
+
+/* Orders of the nodes renumbered by bddcompact */
+#define BDD_COMPACT_DFS    0  /* Depth-first from the roots (default) */
+#define BDD_COMPACT_LEVEL  1  /* By levels from the top */
+#define BDD_COMPACT_MOVE   4  /* OR-ed: also moves the nodes held by BDD and
+                                 ZDD objects (see bddmfwd) */
+
+/* Statistics of garbage collection (see bddgcstats) */
+struct bddgcstat
+{
+  unsigned long long count; /* Number of bddgc() calls */
+  unsigned long long freed; /* Total number of freed nodes */
+  double time;              /* Total wall time of bddgc() in seconds */
+  double lasttime;          /* Wall time of the last bddgc() in seconds */
+};
+
+/* Unique-table engines (see bddsetuniquetable) */
+#define BDD_UT_CHAIN  0  /* Chained hash per variable (default) */
+#define BDD_UT_OPEN   1  /* Open addressing with fingerprints */
+
+/* Node-table allocations (see bddsetnodetable) */
+#define BDD_NT_MALLOC    0  /* Allocate and copy at every enlargement (default) */
+#define BDD_NT_MMAP      1  /* Reserve address space and grow in place */
+#define BDD_NT_HUGEPAGE  2  /* BDD_NT_MMAP with transparent huge pages */
+
+/* Variable groups for reordering (see bddvargroup) */
+#define BDD_GROUP_MOVE  0  /* Moved as a unit keeping the inner order */
+#define BDD_GROUP_FIX   1  /* Never moved nor crossed */
+
+/* Nodes counted by reordering (see bddsetreordercost) */
+#define BDD_REORDER_ALL  0  /* All nodes (default) */
+#define BDD_REORDER_ZDD  1  /* ZDD nodes only */
+#define BDD_REORDER_BDD  2  /* BDD nodes only */
+
+/* A node listed by bddnodelist. A child is 2 * (i + 1) for list[i], or 0
+ * for the constant bddfalse (bddempty), plus 1 if the edge is negated.
+ * The 0-child of a ZDD node is given without the ZDD mark. */
+struct bddnode
+{
+  bddvar v;  /* VarID */
+  bddp lo;   /* 0-child */
+  bddp hi;   /* 1-child */
+};
+
 /***************** For stack overflow limit *****************/
 extern const int BDD_RecurLimit;
-extern int BDD_RecurCount;
+extern thread_local int BDD_RecurCount;
 
 /***************** External operations *****************/
 
 /***************** Init. and config. ****************/
-extern int    bddinit (bddp initsize, bddp limitsize, double cacheRatio = 0.5);
+extern int    bddinit (bddp initsize, bddp limitsize, double cacheRatio = 0.5,
+                       int threads = 1);
 extern bddvar bddnewvar (void);
 extern bddvar bddnewvaroflev (bddvar lev);
+extern void   bddswaplev (bddvar lev);
+extern bddp   bddreorder (void);
+extern void   bddvargroup (bddvar lev, bddvar n, int type);
 extern bddvar bddlevofvar (bddvar v);
 extern bddvar bddvaroflev (bddvar lev);
 extern bddvar bddvarused(void);
@@ -84,6 +157,7 @@ extern bddp   bddxor(bddp f, bddp g);
 extern bddp   bddnand(bddp f, bddp g);
 extern bddp   bddnor(bddp f, bddp g);
 extern bddp   bddxnor(bddp f, bddp g);
+extern bddp   bddite(bddp f, bddp g, bddp h);
 extern bddp   bddat0(bddp f, bddvar v);
 extern bddp   bddat1(bddp f, bddvar v);
 
@@ -91,6 +165,9 @@ extern bddp   bddat1(bddp f, bddvar v);
 extern void   bddfree(bddp f);
 extern bddp   bddused(void);
 extern int    bddgc(void);
+extern bddp   bddcompact(int order = BDD_COMPACT_DFS);
+extern void   bddregroot(bddp *p);
+extern void   bddunregroot(bddp *p);
 extern bddp   bddsize(bddp f);
 extern bddp   bddvsize(bddp *p, int lim);
 extern void   bddexport(FILE *strm, bddp *p, int lim);
@@ -108,6 +185,11 @@ extern bddp   bddrshift(bddp f, bddvar shift);
 extern bddp   bddsupport(bddp f);
 extern bddp   bdduniv(bddp f, bddp g);
 extern bddp   bddexist(bddp f, bddp g);
+extern bddp   bddandexist(bddp f, bddp g, bddp c);
+extern bddp   bddvectorcompose(bddp f, const bddp *vec, int lim);
+extern bddp   bddpermute(bddp f, const bddvar *perm, int lim);
+extern bddp   bddnodelist(bddp f, struct bddnode *list, bddp lim);
+extern double bddprob(bddp f, const double *p);
 extern bddp   bddcofactor(bddp f, bddp g);
 extern int    bddimply(bddp f, bddp g);
 extern bddp   bddrcache(unsigned char op, bddp f, bddp g);
@@ -122,11 +204,29 @@ extern bddp   bddchange(bddp f, bddvar v);
 extern bddp   bddintersec(bddp f, bddp g);
 extern bddp   bddunion(bddp f, bddp g);
 extern bddp   bddsubtract(bddp f, bddp g);
+extern bddp   bddbfsapply(int op, bddp f, bddp g);
+extern bddp   bddmult(bddp f, bddp g);
+extern bddp   bdddiv(bddp f, bddp p);
+extern bddp   bddmeet(bddp f, bddp g);
+extern bddp   bddunionN(const bddp *fs, int n);
+extern bddp   bddintersecN(const bddp *fs, int n);
 extern bddp   bddcard(bddp f);
 extern bddp   bddlit(bddp f);
 extern bddp   bddlen(bddp f);
 extern int    bddimportz(FILE* strm, bddp* p, int lim);
+extern int    bddimport(std::istream &is, bddp *p, int lim);
+extern int    bddimportz(std::istream &is, bddp *p, int lim);
+extern int    bddimportmem(const char *buf, size_t size, bddp *p, int lim);
+extern int    bddimportzmem(const char *buf, size_t size, bddp *p, int lim);
+extern void   bddexportbin(FILE *strm, bddp *p, int lim);
+extern int    bddimportbin(const char *path, bddp *p, int lim);
 extern char  *bddcardmp16(bddp f, char *s);
+extern char  *bddcardmp10(bddp f, char *s);
+extern unsigned long long bddcard64(bddp f);
+#ifdef __SIZEOF_INT128__
+extern unsigned __int128 bddcard128(bddp f);
+#endif
+extern int    bddcardmp(bddp f, unsigned long long *w, int lim);
 extern int    bddisbdd(bddp f);
 extern int    bddiszdd(bddp f);
 extern int    bddiszbdd(bddp f); // for compatibility
@@ -139,6 +239,166 @@ extern void   bddsetcacheratio(double ratio);
 extern double bddgetcacheratio(void);
 extern void   bddsetgcthreshold(bddp threshold);
 extern bddp   bddgetgcthreshold(void);
+extern void   bddsetgcmode(int mode);
+extern int    bddgetgcmode(void);
+extern void   bddsetcacheways(int ways);
+extern int    bddgetcacheways(void);
+extern void   bddcachestats(struct bddcachestat *stats);
+extern void   bddclearcachestats(void);
+extern void   bddsetuniquetable(int type);
+extern int    bddgetuniquetable(void);
+extern void   bddsetnodetable(int type);
+extern int    bddgetnodetable(void);
+extern void   bddsetgcthreads(int n);
+extern int    bddgetgcthreads(void);
+extern void   bddgcstats(struct bddgcstat *stats);
+extern void   bddsetautoreorder(bddp threshold);
+extern bddp   bddgetautoreorder(void);
+extern void   bddsetbfsthreshold(bddp threshold);
+extern bddp   bddgetbfsthreshold(void);
+extern void   bddsetapplythreads(int n);
+extern int    bddgetapplythreads(void);
+extern void   bddsetreordercost(int cost);
+extern int    bddgetreordercost(void);
+
+/************** BDD managers *************/
+/* The functions above work on the current manager of the calling thread.
+   Every thread starts with the default manager, which is shared. A bddp
+   does not record its manager, so it must be passed while its manager is
+   current. A manager must not be used by two threads at the same time.
+   The BDD and ZDD classes record their manager, so their objects can be
+   copied and destroyed while another manager is current, but they must
+   be destroyed before bddmgrdelete deletes their manager. */
+extern BDDManager *bddmgrnew(bddp initsize, bddp limitsize, double cacheRatio = 0.5,
+                             int threads = 1);
+extern void   bddmgrdelete(BDDManager *m);
+extern BDDManager *bddmgrswitch(BDDManager *m);
+extern BDDManager *bddmgrcurrent(void);
+/* The current manager of the calling thread, as bddmgrcurrent returns.
+   The inline members of the BDD and ZDD classes read it; it is changed
+   only by bddmgrswitch. */
+extern thread_local BDDManager *BDD_CurMgr;
+/* bddcompact with BDD_COMPACT_MOVE increments BDD_FwdEpoch and keeps the
+   new indices of the moved nodes. A BDD or ZDD object records the value
+   of BDD_FwdEpoch at which its bddp was valid, and when it differs, gets
+   its bddp renumbered by bddmfwd from the manager m that owns it. */
+extern std::atomic<unsigned> BDD_FwdEpoch;
+extern bddp   bddmfwd(BDDManager *m, bddp f, unsigned epoch);
+extern BDDManager *bddmgrdefault(void);
+/* Data kept per manager by the C++ packages. The slot n (BDD_PKG_XXX)
+   of the current manager holds a pointer owned by the package, which
+   bddmgrdelete passes to del unless del is 0. */
+#define BDD_PKG_BDDV    0
+#define BDD_PKG_PIDD    1
+#define BDD_PKG_ROTPIDD 2
+#define BDD_PKG_MAX     4
+extern void  *bddmgrpkg(int n);
+extern void   bddmgrsetpkg(int n, void *data, void (*del)(void *));
+
+/* Same as bddXXX() but on the manager m */
+extern int    bddminit(BDDManager *m, bddp initsize, bddp limitsize, double cacheRatio = 0.5,
+                       int threads = 1);
+extern bddvar bddmnewvar(BDDManager *m);
+extern bddvar bddmnewvaroflev(BDDManager *m, bddvar lev);
+extern bddvar bddmlevofvar(BDDManager *m, bddvar v);
+extern bddvar bddmvaroflev(BDDManager *m, bddvar lev);
+extern bddvar bddmvarused(BDDManager *m);
+extern bddp   bddmprime(BDDManager *m, bddvar v);
+extern bddvar bddmtop(BDDManager *m, bddp f);
+extern bddp   bddmcopy(BDDManager *m, bddp f);
+extern bddp   bddmnot(BDDManager *m, bddp f);
+extern bddp   bddmand(BDDManager *m, bddp f, bddp g);
+extern bddp   bddmor(BDDManager *m, bddp f, bddp g);
+extern bddp   bddmxor(BDDManager *m, bddp f, bddp g);
+extern bddp   bddmnand(BDDManager *m, bddp f, bddp g);
+extern bddp   bddmnor(BDDManager *m, bddp f, bddp g);
+extern bddp   bddmxnor(BDDManager *m, bddp f, bddp g);
+extern bddp   bddmite(BDDManager *m, bddp f, bddp g, bddp h);
+extern bddp   bddmandexist(BDDManager *m, bddp f, bddp g, bddp c);
+extern bddp   bddmvectorcompose(BDDManager *m, bddp f, const bddp *vec, int lim);
+extern bddp   bddmpermute(BDDManager *m, bddp f, const bddvar *perm, int lim);
+extern bddp   bddmnodelist(BDDManager *m, bddp f, struct bddnode *list, bddp lim);
+extern double bddmprob(BDDManager *m, bddp f, const double *p);
+extern bddp   bddmat0(BDDManager *m, bddp f, bddvar v);
+extern bddp   bddmat1(BDDManager *m, bddp f, bddvar v);
+extern void   bddmfree(BDDManager *m, bddp f);
+extern bddp   bddmused(BDDManager *m);
+extern int    bddmgc(BDDManager *m);
+extern bddp   bddmcompact(BDDManager *m, int order = BDD_COMPACT_DFS);
+extern void   bddmregroot(BDDManager *m, bddp *p);
+extern void   bddmunregroot(BDDManager *m, bddp *p);
+extern bddp   bddmsize(BDDManager *m, bddp f);
+extern bddp   bddmvsize(BDDManager *m, bddp *p, int lim);
+extern void   bddmexport(BDDManager *m, FILE *strm, bddp *p, int lim);
+extern int    bddmimport(BDDManager *m, FILE *strm, bddp *p, int lim);
+extern bddp   bddmlshift(BDDManager *m, bddp f, bddvar shift);
+extern bddp   bddmrshift(BDDManager *m, bddp f, bddvar shift);
+extern bddp   bddmsupport(BDDManager *m, bddp f);
+extern bddp   bddmuniv(BDDManager *m, bddp f, bddp g);
+extern bddp   bddmexist(BDDManager *m, bddp f, bddp g);
+extern bddp   bddmcofactor(BDDManager *m, bddp f, bddp g);
+extern int    bddmimply(BDDManager *m, bddp f, bddp g);
+extern bddp   bddmrcache(BDDManager *m, unsigned char op, bddp f, bddp g);
+extern void   bddmwcache(BDDManager *m, unsigned char op, bddp f, bddp g, bddp h);
+extern bddp   bddmoffset(BDDManager *m, bddp f, bddvar v);
+extern bddp   bddmonset(BDDManager *m, bddp f, bddvar v);
+extern bddp   bddmonset0(BDDManager *m, bddp f, bddvar v);
+extern bddp   bddmchange(BDDManager *m, bddp f, bddvar v);
+extern bddp   bddmintersec(BDDManager *m, bddp f, bddp g);
+extern bddp   bddmunion(BDDManager *m, bddp f, bddp g);
+extern bddp   bddmsubtract(BDDManager *m, bddp f, bddp g);
+extern bddp   bddmbfsapply(BDDManager *m, int op, bddp f, bddp g);
+extern bddp   bddmmult(BDDManager *m, bddp f, bddp g);
+extern bddp   bddmdiv(BDDManager *m, bddp f, bddp p);
+extern bddp   bddmmeet(BDDManager *m, bddp f, bddp g);
+extern bddp   bddmunionN(BDDManager *m, const bddp *fs, int n);
+extern bddp   bddmintersecN(BDDManager *m, const bddp *fs, int n);
+extern bddp   bddmcard(BDDManager *m, bddp f);
+extern bddp   bddmlit(BDDManager *m, bddp f);
+extern bddp   bddmlen(BDDManager *m, bddp f);
+extern int    bddmimportz(BDDManager *m, FILE *strm, bddp *p, int lim);
+extern int    bddmimportmem(BDDManager *m, const char *buf, size_t size, bddp *p, int lim);
+extern int    bddmimportzmem(BDDManager *m, const char *buf, size_t size, bddp *p, int lim);
+extern void   bddmexportbin(BDDManager *m, FILE *strm, bddp *p, int lim);
+extern int    bddmimportbin(BDDManager *m, const char *path, bddp *p, int lim);
+extern char  *bddmcardmp16(BDDManager *m, bddp f, char *s);
+extern char  *bddmcardmp10(BDDManager *m, bddp f, char *s);
+extern unsigned long long bddmcard64(BDDManager *m, bddp f);
+#ifdef __SIZEOF_INT128__
+extern unsigned __int128 bddmcard128(BDDManager *m, bddp f);
+#endif
+extern int    bddmcardmp(BDDManager *m, bddp f, unsigned long long *w, int lim);
+extern int    bddmisbdd(BDDManager *m, bddp f);
+extern int    bddmiszdd(BDDManager *m, bddp f);
+extern bddp   bddmpush(BDDManager *m, bddp f, bddvar v);
+extern void   bddmsetcacheratio(BDDManager *m, double cacheRatio);
+extern double bddmgetcacheratio(BDDManager *m);
+extern void   bddmsetgcthreshold(BDDManager *m, bddp threshold);
+extern bddp   bddmgetgcthreshold(BDDManager *m);
+extern void   bddmsetgcmode(BDDManager *m, int mode);
+extern int    bddmgetgcmode(BDDManager *m);
+extern void   bddmsetcacheways(BDDManager *m, int ways);
+extern int    bddmgetcacheways(BDDManager *m);
+extern void   bddmcachestats(BDDManager *m, struct bddcachestat *stats);
+extern void   bddmclearcachestats(BDDManager *m);
+extern void   bddmsetuniquetable(BDDManager *m, int type);
+extern int    bddmgetuniquetable(BDDManager *m);
+extern void   bddmsetnodetable(BDDManager *m, int type);
+extern int    bddmgetnodetable(BDDManager *m);
+extern void   bddmsetgcthreads(BDDManager *m, int n);
+extern int    bddmgetgcthreads(BDDManager *m);
+extern void   bddmgcstats(BDDManager *m, struct bddgcstat *stats);
+extern void   bddmswaplev(BDDManager *m, bddvar lev);
+extern bddp   bddmreorder(BDDManager *m);
+extern void   bddmsetautoreorder(BDDManager *m, bddp threshold);
+extern bddp   bddmgetautoreorder(BDDManager *m);
+extern void   bddmsetbfsthreshold(BDDManager *m, bddp threshold);
+extern bddp   bddmgetbfsthreshold(BDDManager *m);
+extern void   bddmsetapplythreads(BDDManager *m, int n);
+extern int    bddmgetapplythreads(BDDManager *m);
+extern void   bddmvargroup(BDDManager *m, bddvar lev, bddvar n, int type);
+extern void   bddmsetreordercost(BDDManager *m, int cost);
+extern int    bddmgetreordercost(BDDManager *m);
 
 } // namespace sapporobdd
 
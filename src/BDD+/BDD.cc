@@ -6,6 +6,7 @@
 
 #include "BDDException.h"
 #include "BDD.h"
+#include "BDDTokenizer.h"
 
 using std::cout;
 using std::cerr;
@@ -27,7 +28,8 @@ const int BDD_MaxVar = bddvarmax;
 
 //--- SBDD class for default initialization ----
 
-int BDDV_Active = 0;
+// Set in the slot BDD_PKG_BDDV of the managers initialized by BDDV_Init
+static int BDDV_Active;
 
 class SBDD
 {
@@ -39,14 +41,20 @@ static SBDD BDD_Manager;
 
 //-------------- class BDD --------------------
 
-bddword BDD::Size() const { return bddsize(_bdd); }
+bddword BDD::Size() const { return bddsize(GetID()); }
 
 void BDD::Export(FILE *strm) const 
 {
-  bddword p = _bdd;
+  bddword p = GetID();
   bddexport(strm, &p, 1);
 }
 
+void BDD::ExportBin(FILE *strm) const
+{
+  bddword p = GetID();
+  bddexportbin(strm, &p, 1);
+}
+
 void BDD::Print() const
 {
   cout << "[ " << GetID();
@@ -62,8 +70,14 @@ BDD BDD::Swap(const int& v1, const int& v2) const
   BDD y = BDDvar(v2);
   BDD fx0 = At0(v1);
   BDD fx1 = At1(v1);
-  return (x & ((~y & fx0.At1(v2) )|(y & fx1.At1(v2) )))|
-        (~x & ((~y & fx0.At0(v2) )|(y & fx1.At0(v2) )));
+  return BDD_Ite(x, BDD_Ite(y, fx1.At1(v2), fx0.At1(v2)),
+                    BDD_Ite(y, fx1.At0(v2), fx0.At0(v2)));
+}
+
+BDD BDD::Permute(const std::vector<int>& perm) const
+{
+  std::vector<bddvar> p(perm.begin(), perm.end());
+  return BDD_ID(bddpermute(GetID(), p.data(), (int)p.size()));
 }
 
 #define BDD_CACHE_CHK_RETURN(op, fx, gx) \
@@ -85,7 +99,7 @@ BDD BDD::Smooth(const int& v) const
   bddword gx = BDDvar(v).GetID();
   BDD_CACHE_CHK_RETURN(BC_Smooth, fx, gx);
   BDD x = BDDvar(t);
-  BDD h = (~x & At0(t).Smooth(v))|(x & At1(t).Smooth(v));
+  BDD h = BDD_Ite(x, At1(t).Smooth(v), At0(t).Smooth(v));
   BDD_CACHE_ENT_RETURN(BC_Smooth, fx, gx, h);
 }
 
@@ -101,17 +115,17 @@ BDD BDD::Spread(const int& k) const
   BDD x = BDDvar(t);
   BDD f0 = At0(t);
   BDD f1 = At1(t);
-  BDD h = (~x & f0.Spread(k)) | (x & f1.Spread(k))
-    | (~x & f1.Spread(k-1)) | (x & f0.Spread(k-1));
+  BDD h = BDD_Ite(x, f1.Spread(k) | f0.Spread(k-1),
+                     f0.Spread(k) | f1.Spread(k-1));
   BDD_CACHE_ENT_RETURN(BC_Spread, fx, gx, h);
 }
 
 //----- External functions for BDD -------
 
-int BDD_Init(bddword init, bddword limit, double cacheRatio)
+int BDD_Init(bddword init, bddword limit, double cacheRatio, int threads)
 {
-  if(bddinit(init, limit, cacheRatio)) return 1;
-  BDDV_Active = 0;
+  if(bddinit(init, limit, cacheRatio, threads)) return 1;
+  bddmgrsetpkg(BDD_PKG_BDDV, 0, 0);
   return 0;
 }
 	
@@ -128,6 +142,10 @@ bddword BDD_Used(void) { return bddused(); }
 
 void BDD_GC() { bddgc(); }
 
+// The objects follow their moved nodes (see BDD::Fwd)
+bddword BDD_Compact(int order)
+  { return bddcompact(order | BDD_COMPACT_MOVE); }
+
 void BDD_SetCacheRatio(double ratio) { bddsetcacheratio(ratio); }
 
 double BDD_GetCacheRatio(void) { return bddgetcacheratio(); }
@@ -136,6 +154,58 @@ void BDD_SetGCThreshold(bddword threshold) { bddsetgcthreshold(threshold); }
 
 bddword BDD_GetGCThreshold(void) { return bddgetgcthreshold(); }
 
+void BDD_SetGCMode(int mode) { bddsetgcmode(mode); }
+
+int BDD_GetGCMode(void) { return bddgetgcmode(); }
+
+void BDD_SetCacheWays(int ways) { bddsetcacheways(ways); }
+
+int BDD_GetCacheWays(void) { return bddgetcacheways(); }
+
+void BDD_SetUniqueTable(int type) { bddsetuniquetable(type); }
+
+int BDD_GetUniqueTable(void) { return bddgetuniquetable(); }
+
+void BDD_SetNodeTable(int type) { bddsetnodetable(type); }
+
+int BDD_GetNodeTable(void) { return bddgetnodetable(); }
+
+void BDD_SetGCThreads(int n) { bddsetgcthreads(n); }
+
+int BDD_GetGCThreads(void) { return bddgetgcthreads(); }
+
+void BDD_SetApplyThreads(int n) { bddsetapplythreads(n); }
+
+int BDD_GetApplyThreads(void) { return bddgetapplythreads(); }
+
+bddword BDD_Reorder(void) { return bddreorder(); }
+
+void BDD_SetAutoReorder(bddword threshold) { bddsetautoreorder(threshold); }
+
+bddword BDD_GetAutoReorder(void) { return bddgetautoreorder(); }
+
+void BDD_SetBFSThreshold(bddword threshold) { bddsetbfsthreshold(threshold); }
+
+bddword BDD_GetBFSThreshold(void) { return bddgetbfsthreshold(); }
+
+void BDD_VarGroup(int lev, int n, int type)
+{
+  if(lev <= 0 || n <= 0)
+    BDDerr("BDD_VarGroup: Invalid level", lev, ExceptionType::OutOfRange);
+  bddvargroup(lev, n, type);
+}
+
+void BDD_SetReorderCost(int cost) { bddsetreordercost(cost); }
+
+int BDD_GetReorderCost(void) { return bddgetreordercost(); }
+
+BDD BDD_VectorCompose(const BDD& f, const std::vector<BDD>& vec)
+{
+  std::vector<bddp> p(vec.size());
+  for(size_t i=0; i<vec.size(); i++) p[i] = vec[i].GetID();
+  return BDD_ID(bddvectorcompose(f.GetID(), p.data(), (int)p.size()));
+}
+
 BDD BDD_Import(FILE *strm)
 {
   bddword bdd;
@@ -146,6 +216,22 @@ BDD BDD_Import(FILE *strm)
   return BDD_ID(bdd);
 }
 
+BDD BDD_Import(std::istream &is)
+{
+  bddword bdd;
+  // bddimport throws an exception on failure
+  bddimport(is, &bdd, 1);
+  return BDD_ID(bdd);
+}
+
+BDD BDD_ImportBin(const char *path)
+{
+  bddword bdd;
+  // bddimportbin throws an exception on failure
+  bddimportbin(path, &bdd, 1);
+  return BDD_ID(bdd);
+}
+
 BDD BDD_Random(int level, int density)
 {
   if(level < 0)
@@ -351,7 +437,8 @@ int BDDV_Init(bddword init, bddword limit)
 {
   if(bddinit(init, limit)) return 1;
   for(int i=0; i<BDDV_SysVarTop; i++) bddnewvar();
-  BDDV_Active = 1;
+  bddvargroup(1, BDDV_SysVarTop, BDD_GROUP_FIX);
+  bddmgrsetpkg(BDD_PKG_BDDV, &BDDV_Active, 0);
   return 0;
 }
 	
@@ -365,7 +452,7 @@ BDDV operator||(const BDDV& fv, const BDDV& gv)
     return (fv || BDDV(gv).Former()) || BDDV(gv).Latter();
   BDDV hv;
   BDD x = BDDvar(fv._lev + 1);
-  if((hv._bdd = (~x & fv._bdd)|(x & gv._bdd)) == -1) 
+  if((hv._bdd = BDD_Ite(x, gv._bdd, fv._bdd)) == -1) 
     BDDerr("BDDV::operator||: Operation failed.", ExceptionType::InternalError);
   if((hv._len = fv._len + gv._len) > BDDV_MaxLen)
     BDDerr("BDDV::operatop||: Too large len.", hv._len, ExceptionType::OutOfRange);
@@ -391,45 +478,38 @@ BDDV BDDV_Mask2(int index, int len)
 
 #define IMPORTHASH(x) ((((x)>>1)^((x)<<8)^((x)<<16)) & (hashsize-1))
 
-#ifdef B_32
-#  define B_STRTOI strtol
-#else
-#  define B_STRTOI strtoll
-#endif
-
-BDDV BDDV_Import(FILE *strm)
+static BDDV bddv_import(BDD_Tokenizer &tk)
 {
   int inv, e;
   bddword hashsize;
   BDD f, f0, f1;
-  char s[256];
   bddword *hash1 = 0;
   BDD *hash2 = 0;
 
-  if(fscanf(strm, "%s", s) == EOF) 
+  if(!tk.Next()) 
     BDDerr("BDDV_Import: Unexpected end of file.", ExceptionType::FileFormat);
-  if(strcmp(s, "_i") != 0) 
+  if(!tk.Is("_i")) 
     BDDerr("BDDV_Import: Invalid format, expected '_i'.", ExceptionType::FileFormat);
-  if(fscanf(strm, "%s", s) == EOF) 
+  if(!tk.Next()) 
     BDDerr("BDDV_Import: Unexpected end of file.", ExceptionType::FileFormat);
-  int n = strtol(s, NULL, 10);
+  int n = tk.Int();
   while(n > BDD_TopLev()) BDD_NewVar();
 
-  if(fscanf(strm, "%s", s) == EOF) 
+  if(!tk.Next()) 
     BDDerr("BDDV_Import: Unexpected end of file.", ExceptionType::FileFormat);
-  if(strcmp(s, "_o") != 0) 
+  if(!tk.Is("_o")) 
     BDDerr("BDDV_Import: Invalid format, expected '_o'.", ExceptionType::FileFormat);
-  if(fscanf(strm, "%s", s) == EOF) 
+  if(!tk.Next()) 
     BDDerr("BDDV_Import: Unexpected end of file.", ExceptionType::FileFormat);
-  int m = strtol(s, NULL, 10);
+  int m = tk.Int();
 
-  if(fscanf(strm, "%s", s) == EOF) 
+  if(!tk.Next()) 
     BDDerr("BDDV_Import: Unexpected end of file.", ExceptionType::FileFormat);
-  if(strcmp(s, "_n") != 0) 
+  if(!tk.Is("_n")) 
     BDDerr("BDDV_Import: Invalid format, expected '_n'.", ExceptionType::FileFormat);
-  if(fscanf(strm, "%s", s) == EOF) 
+  if(!tk.Next()) 
     BDDerr("BDDV_Import: Unexpected end of file.", ExceptionType::FileFormat);
-  bddword n_nd = B_STRTOI(s, NULL, 10);
+  bddword n_nd = tk.Int();
 
   for(hashsize = 1; hashsize < (n_nd<<1); hashsize <<= 1)
     ; /* empty */
@@ -450,19 +530,19 @@ BDDV BDDV_Import(FILE *strm)
   e = 0;
   for(bddword ix=0; ix<n_nd; ix++)
   {
-    if(fscanf(strm, "%s", s) == EOF) { e = 1; break; }
-    bddword nd = B_STRTOI(s, NULL, 10);
+    if(!tk.Next()) { e = 1; break; }
+    bddword nd = tk.Int();
     
-    if(fscanf(strm, "%s", s) == EOF) { e = 1; break; }
-    int lev = strtol(s, NULL, 10);
+    if(!tk.Next()) { e = 1; break; }
+    int lev = tk.Int();
     int var = bddvaroflev(lev);
 
-    if(fscanf(strm, "%s", s) == EOF) { e = 1; break; }
-    if(strcmp(s, "F") == 0) f0 = 0;
-    else if(strcmp(s, "T") == 0) f0 = 1;
+    if(!tk.Next()) { e = 1; break; }
+    if(tk.Is("F")) f0 = 0;
+    else if(tk.Is("T")) f0 = 1;
     else
     {
-      bddword nd0 = B_STRTOI(s, NULL, 10);
+      bddword nd0 = tk.Int();
 
       bddword ixx = IMPORTHASH(nd0);
       while(hash1[ixx] != nd0)
@@ -475,12 +555,12 @@ BDDV BDDV_Import(FILE *strm)
       f0 = hash2[ixx];
     }
 
-    if(fscanf(strm, "%s", s) == EOF) { e = 1; break; }
-    if(strcmp(s, "F") == 0) f1 = 0;
-    else if(strcmp(s, "T") == 0) f1 = 1;
+    if(!tk.Next()) { e = 1; break; }
+    if(tk.Is("F")) f1 = 0;
+    else if(tk.Is("T")) f1 = 1;
     else
     {
-      bddword nd1 = B_STRTOI(s, NULL, 10);
+      bddword nd1 = tk.Int();
       if(nd1 & 1) { inv = 1; nd1 ^= 1; }
       else inv = 0;
   
@@ -496,7 +576,7 @@ BDDV BDDV_Import(FILE *strm)
     }
 
     BDD x = BDDvar(var);
-    f = (x & f1) | (~x & f0);
+    f = BDD_Ite(x, f1, f0);
     if(f == -1) { 
       e = 1; 
       break; 
@@ -524,17 +604,17 @@ BDDV BDDV_Import(FILE *strm)
   BDDV v = BDDV();
   for(int i=0; i<m; i++)
   {
-    if(fscanf(strm, "%s", s) == EOF)
+    if(!tk.Next())
     {
       delete[] hash2;
       delete[] hash1;
       BDDerr("BDDV_Import: Unexpected end of file during vector processing.", ExceptionType::FileFormat);
     }
-    bddword nd = B_STRTOI(s, NULL, 10);
-    if(strcmp(s, "F") == 0) v = v || BDD(0);
-    else if(strcmp(s, "T") == 0) v = v || BDD(1);
+    if(tk.Is("F")) v = v || BDD(0);
+    else if(tk.Is("T")) v = v || BDD(1);
     else
     {
+      bddword nd = tk.Int();
       if(nd & 1) { inv = 1; nd ^= 1; }
       else inv = 0;
   
@@ -555,48 +635,47 @@ BDDV BDDV_Import(FILE *strm)
   return v;
 }
 
-BDDV BDDV_ImportPla(FILE *strm, int sopf)
+static BDDV bddv_importpla(BDD_Tokenizer &tk, int sopf)
 {
-  char s[256];
   int n = 0;
   int m = 0;
   int mode = 1; // 0:f 1:fd 2:fr 3:fdr
 
-  do if(fscanf(strm, "%s", s) == EOF) 
+  do if(!tk.Next()) 
       BDDerr("BDDV_ImportPla: Unexpected end of file.", ExceptionType::FileFormat);
-  while(s[0] == '#');
+  while(tk.Data()[0] == '#');
 
   // declaration part 
-  while(s[0] == '.')
+  while(tk.Data()[0] == '.')
   {
-    if(strcmp(s, ".i") == 0)
+    if(tk.Is(".i"))
     {
-      if(fscanf(strm, "%s", s) == EOF)
+      if(!tk.Next())
         BDDerr("BDDV_ImportPla: Unexpected end of file.", ExceptionType::FileFormat);
-      n = strtol(s, NULL, 10);
+      n = tk.Int();
     }
-    else if(strcmp(s, ".o") == 0)
+    else if(tk.Is(".o"))
     {
-      if(fscanf(strm, "%s", s) == EOF)
+      if(!tk.Next())
         BDDerr("BDDV_ImportPla: Unexpected end of file.", ExceptionType::FileFormat);
-      m = strtol(s, NULL, 10);
+      m = tk.Int();
     }
-    else if(strcmp(s, ".type") == 0)
+    else if(tk.Is(".type"))
     {
-      if(fscanf(strm, "%s", s) == EOF)
+      if(!tk.Next())
         BDDerr("BDDV_ImportPla: Unexpected end of file.", ExceptionType::FileFormat);
-      if(strcmp(s, "f") == 0) mode = 0;
-      else if(strcmp(s, "fd") == 0) mode = 1;
-      else if(strcmp(s, "fr") == 0) mode = 2;
-      else if(strcmp(s, "fdr") == 0) mode = 3;
+      if(tk.Is("f")) mode = 0;
+      else if(tk.Is("fd")) mode = 1;
+      else if(tk.Is("fr")) mode = 2;
+      else if(tk.Is("fdr")) mode = 3;
       else { } // nop
     }
     else 
     {
-      if(fscanf(strm, "%s", s) == EOF)
+      if(!tk.Next())
         BDDerr("BDDV_ImportPla: Unexpected end of file.", ExceptionType::FileFormat);
     }
-    if(fscanf(strm, "%s", s) == EOF)
+    if(!tk.Next())
       BDDerr("BDDV_ImportPla: Unexpected end of file.", ExceptionType::FileFormat);
   }
   
@@ -611,14 +690,14 @@ BDDV BDDV_ImportPla(FILE *strm, int sopf)
   BDD term;
 
   // logic description part
-  while(s[0] != '.')
+  while(tk.Data()[0] != '.')
   {
-    if((int)strlen(s) != n)
+    if((int)tk.Size() != n)
       BDDerr("BDDV_ImportPla: Error at product term.", ExceptionType::FileFormat);
     term = 1;
     for(int i=0; i<n; i++)
     {
-      switch(s[i])
+      switch(tk.Data()[i])
       {
       case '0':
         term &= ~BDDvar(BDD_VarOfLev(sopf? 2*i+2: i+1));
@@ -632,14 +711,14 @@ BDDV BDDV_ImportPla(FILE *strm, int sopf)
         BDDerr("BDDV_ImportPla: Error at product term.", ExceptionType::FileFormat);
       }
     }
-    if(fscanf(strm, "%s", s) == EOF)
+    if(!tk.Next())
       BDDerr("BDDV_ImportPla: Unexpected end of file.", ExceptionType::FileFormat);
-    if((int)strlen(s) != m) 
+    if((int)tk.Size() != m) 
       BDDerr("BDDV_ImportPla: Error at output symbol.", ExceptionType::FileFormat);
     for(int i=0; i<m; i++)
     {
       BDDV tv = BDDV(term, m) & BDDV_Mask1(i, m);
-      switch(s[i])
+      switch(tk.Data()[i])
       {
       case '0':
         offset |= tv;
@@ -656,7 +735,7 @@ BDDV BDDV_ImportPla(FILE *strm, int sopf)
         BDDerr("BDDV_ImportPla: Error at output symbol.", ExceptionType::FileFormat);
       }
     }
-    if(fscanf(strm, "%s", s) == EOF)
+    if(!tk.Next())
       BDDerr("BDDV_ImportPla: Unexpected end of file.", ExceptionType::FileFormat);
   }
 
@@ -690,4 +769,28 @@ BDDV BDDV_ImportPla(FILE *strm, int sopf)
   return (onset || dcset);
 }
 
+BDDV BDDV_Import(FILE *strm)
+{
+  BDD_Tokenizer tk(strm);
+  return bddv_import(tk);
+}
+
+BDDV BDDV_Import(std::istream &is)
+{
+  BDD_Tokenizer tk(is);
+  return bddv_import(tk);
+}
+
+BDDV BDDV_ImportPla(FILE *strm, int sopf)
+{
+  BDD_Tokenizer tk(strm);
+  return bddv_importpla(tk, sopf);
+}
+
+BDDV BDDV_ImportPla(std::istream &is, int sopf)
+{
+  BDD_Tokenizer tk(is);
+  return bddv_importpla(tk, sopf);
+}
+
 } // namespace sapporobdd
@@ -0,0 +1,166 @@
+/*********************************************
+ * BDDImage Class (SAPPOROBDD++)             *
+ * (Main part)                               *
+ *********************************************/
+
+#include "BDDImage.h"
+
+namespace sapporobdd {
+
+//----------- Internal functions for BDDImage -----------
+
+static void SupportVars(const BDD& f, std::vector<int>& vars)
+{
+  BDD s = f.Support();
+  for(int v = s.Top(); v != 0; v = s.Top())
+  {
+    vars.push_back(v);
+    s = s.At0(v);
+  }
+}
+
+// The cube of the variables for BDD::Exist and BDD_AndExist
+static BDD Cube(const std::vector<int>& vars)
+{
+  BDD c = 0;
+  for(size_t i=0; i<vars.size(); i++) c |= BDDvar(vars[i]);
+  return c;
+}
+
+//----------- Class methods of BDDImage -----------
+
+BDDImage::BDDImage(const std::vector<BDD>& parts, const std::vector<int>& cur,
+                   const std::vector<int>& next, bddword limit)
+{
+  int n = BDD_VarUsed();
+  if(cur.size() != next.size())
+    BDDerr("BDDImage: Different number of variables.", cur.size(), ExceptionType::OutOfRange);
+  _cur = cur;
+  _next = next;
+  _isCur.assign(n + 1, 0);
+  _isNext.assign(n + 1, 0);
+  for(size_t i=0; i<cur.size(); i++)
+  {
+    if(cur[i] <= 0 || cur[i] > n || _isCur[cur[i]] || _isNext[cur[i]])
+      BDDerr("BDDImage: Invalid VarID.", cur[i], ExceptionType::OutOfRange);
+    _isCur[cur[i]] = 1;
+    if(next[i] <= 0 || next[i] > n || _isCur[next[i]] || _isNext[next[i]])
+      BDDerr("BDDImage: Invalid VarID.", next[i], ExceptionType::OutOfRange);
+    _isNext[next[i]] = 1;
+  }
+
+  _perm.assign(n + 1, 0);
+  for(size_t i=0; i<cur.size(); i++)
+  {
+    _perm[cur[i]] = next[i];
+    _perm[next[i]] = cur[i];
+  }
+
+  // Order the parts: a part whose variables to quantify appear in no
+  // other part comes first, so that they are quantified early.
+  std::vector<std::vector<int> > supp(parts.size());
+  std::vector<int> count(n + 1, 0);
+  for(size_t i=0; i<parts.size(); i++)
+  {
+    SupportVars(parts[i], supp[i]);
+    for(size_t j=0; j<supp[i].size(); j++) count[supp[i][j]]++;
+  }
+  std::vector<char> used(parts.size(), 0);
+  std::vector<size_t> order;
+  while(order.size() < parts.size())
+  {
+    size_t best = 0;
+    int bestScore = -1;
+    for(size_t i=0; i<parts.size(); i++)
+    {
+      if(used[i]) continue;
+      int score = 0;
+      for(size_t j=0; j<supp[i].size(); j++)
+        if(!_isNext[supp[i][j]] && count[supp[i][j]] == 1) score++;
+      if(score > bestScore ||
+         (score == bestScore && supp[i].size() < supp[best].size()))
+      {
+        best = i;
+        bestScore = score;
+      }
+    }
+    used[best] = 1;
+    order.push_back(best);
+    for(size_t j=0; j<supp[best].size(); j++) count[supp[best][j]]--;
+  }
+
+  // Conjoin the parts in the order while the cluster is small
+  for(size_t i=0; i<order.size(); i++)
+  {
+    BDD p = parts[order[i]];
+    if(!_cluster.empty())
+    {
+      BDD c = _cluster.back() & p;
+      if(c.Size() <= limit) { _cluster.back() = c; continue; }
+    }
+    _cluster.push_back(p);
+  }
+
+  // Schedule each variable to be quantified at its last cluster
+  _last.assign(n + 1, -1);
+  for(size_t i=0; i<_cluster.size(); i++)
+  {
+    std::vector<int> vars;
+    SupportVars(_cluster[i], vars);
+    for(size_t j=0; j<vars.size(); j++) _last[vars[j]] = (int)i;
+  }
+  std::vector<std::vector<int> > img(_cluster.size()), pre(_cluster.size());
+  for(int v=1; v<=n; v++)
+  {
+    if(_last[v] < 0) continue;
+    if(!_isNext[v]) img[_last[v]].push_back(v);
+    if(!_isCur[v]) pre[_last[v]].push_back(v);
+  }
+  for(size_t i=0; i<_cluster.size(); i++)
+  {
+    _imgCube.push_back(Cube(img[i]));
+    _preCube.push_back(Cube(pre[i]));
+  }
+}
+
+BDD BDDImage::Product(const BDD& s, const std::vector<BDD>& cube,
+                      const std::vector<char>& keep) const
+{
+  // Variables of s used by no cluster are quantified first
+  std::vector<int> vars, first;
+  SupportVars(s, vars);
+  for(size_t i=0; i<vars.size(); i++)
+    if(!keep[vars[i]] && (vars[i] >= (int)_last.size() || _last[vars[i]] < 0))
+      first.push_back(vars[i]);
+  BDD r = s.Exist(Cube(first));
+  for(size_t i=0; i<_cluster.size() && r != 0; i++)
+    r = BDD_AndExist(r, _cluster[i], cube[i]);
+  return r;
+}
+
+BDD BDDImage::Rename(const BDD& f) const
+{
+  // Exchanges each pair in one pass
+  return f.Permute(_perm);
+}
+
+BDD BDDImage::Image(const BDD& s) const
+{
+  // Exist x, w. s(x) & T(x, w, y), renamed to the current-state variables
+  return Rename(Product(s, _imgCube, _isNext));
+}
+
+BDD BDDImage::PreImage(const BDD& s) const
+{
+  // Exist y, w. s(y) & T(x, w, y)
+  return Product(Rename(s), _preCube, _isCur);
+}
+
+BDD BDDImage::Cluster(int i) const
+{
+  if(i < 0 || i >= (int)_cluster.size())
+    BDDerr("BDDImage::Cluster: Invalid index.", i, ExceptionType::OutOfRange);
+  return _cluster[i];
+}
+
+} // namespace sapporobdd
@@ -361,26 +361,31 @@ int CtoI::StrNum16(char* s) const
   return 0;
 }
 
-static int Depth;
-static int* S_Var;
-static int PFflag;
-static int PF(CtoI);
-static int PF(CtoI a)
+// State of PutForm, passed down the recursion
+struct CtoI_PFState
+{
+  int Depth;
+  int* S_Var;
+  int PFflag;
+};
+
+static int PF(CtoI, CtoI_PFState&);
+static int PF(CtoI a, CtoI_PFState& st)
 {
   if(a.IsConst())
   {
     if(a.TopDigit() & 1) { cout << " -"; a = -a; }
-    else if(PFflag == 1) cout << " +";
+    else if(st.PFflag == 1) cout << " +";
 
-    PFflag = 1;
+    st.PFflag = 1;
     int c1 = (a != 1);
-    if(c1 || Depth == 0)
+    if(c1 || st.Depth == 0)
     {
       char s[80];
       a.StrNum10(s);
       cout << " " << s;
     }
-    for(int i=0; i<Depth; i++) cout << " v" << S_Var[i];
+    for(int i=0; i<st.Depth; i++) cout << " v" << st.S_Var[i];
     cout.flush();
     return 0;
   }
@@ -388,15 +393,15 @@ static int PF(CtoI a)
   int v = a.TopItem();
   CtoI b = a.Factor1(v);
   if(b == CtoI_Null()) return 1;
-  S_Var[Depth] = v;
-  Depth++;
-  if(PF(b) == 1) return 1;
+  st.S_Var[st.Depth] = v;
+  st.Depth++;
+  if(PF(b, st) == 1) return 1;
 
-  Depth--;
+  st.Depth--;
   b = a.Factor0(v);
   if(b == 0) return 0;
   if(b == CtoI_Null()) return 1;
-  return PF(b);
+  return PF(b, st);
 }
 
 int CtoI::PutForm() const
@@ -407,11 +412,12 @@ int CtoI::PutForm() const
   else
   {
     int v = TopItem();
-    Depth = 0;
-    S_Var = new int[v];
-    PFflag = 0;
-    int err = PF(*this);
-    delete[] S_Var;
+    CtoI_PFState st;
+    st.Depth = 0;
+    st.S_Var = new int[v];
+    st.PFflag = 0;
+    int err = PF(*this, st);
+    delete[] st.S_Var;
     if(err == 1)
     {
       cout << "...\n";
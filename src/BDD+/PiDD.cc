@@ -31,44 +31,92 @@ static const char BC_PiDD_ODD = 84;
     return h; }
 
 //----------- External functions for PiDD ----------
-int PiDD_TopVar = 0;
-int PiDD_VarTableSize = 16;
-int PiDD_LevOfX[PiDD_MaxVar];
-int *PiDD_XOfLev;
+static void PiDD_FreeVars(void *p)
+{
+  PiDD_VarTable *t = (PiDD_VarTable *)p;
+  delete[] t->XOfLev;
+  delete t;
+}
+
+// The levels of the variables are one group moved as a unit by
+// reordering, so they are shifted all together as TopBDDVar is
+static void PiDD_Relevel(PiDD_VarTable *t)
+{
+  int d = (int)bddlevofvar(t->TopBDDVar) - t->LevOfX[t->TopVar];
+  for(int x=2; x<=t->TopVar; x++) t->LevOfX[x] += d;
+  int toplev = t->LevOfX[t->TopVar];
+  if(t->VarTableSize <= toplev)
+  {
+    while(t->VarTableSize <= toplev) t->VarTableSize <<= 2;
+    delete[] t->XOfLev;
+    t->XOfLev = new int[t->VarTableSize];
+  }
+  for(int i=0; i<t->VarTableSize; i++) t->XOfLev[i] = 0;
+  for(int x=2; x<=t->TopVar; x++)
+    for(int y=1; y<x; y++) t->XOfLev[t->LevOfX[x] - y + 1] = x;
+}
+
+// The table is kept in the slot BDD_PKG_PIDD of each manager
+PiDD_VarTable *PiDD_Vars()
+{
+  PiDD_VarTable *t = (PiDD_VarTable *)bddmgrpkg(BDD_PKG_PIDD);
+  if(t)
+  {
+    if(t->TopVar > 1 &&
+       (int)bddlevofvar(t->TopBDDVar) != t->LevOfX[t->TopVar])
+      PiDD_Relevel(t);
+    return t;
+  }
+  t = new PiDD_VarTable;
+  t->TopVar = 0;
+  t->VarTableSize = 16;
+  t->XOfLev = 0;
+  t->TopBDDVar = 0;
+  bddmgrsetpkg(BDD_PKG_PIDD, t, PiDD_FreeVars);
+  return t;
+}
 
 int PiDD_NewVar()
 {
-   if(PiDD_TopVar == PiDD_MaxVar) 
-     BDDerr("PiDD_NewVar: Too large var ", (bddword) PiDD_TopVar, ExceptionType::OutOfRange);
+   PiDD_VarTable *t = PiDD_Vars();
+   if(t->TopVar == PiDD_MaxVar)
+     BDDerr("PiDD_NewVar: Too large var ", (bddword) t->TopVar, ExceptionType::OutOfRange);
 
-   if(PiDD_TopVar == 0)
+   if(t->TopVar == 0)
    {
-     PiDD_XOfLev = new int[PiDD_VarTableSize];
-     PiDD_XOfLev[0] = 0;
-     PiDD_LevOfX[0] = 0;
-     PiDD_LevOfX[1] = 0;
+     t->XOfLev = new int[t->VarTableSize];
+     t->XOfLev[0] = 0;
+     t->LevOfX[0] = 0;
+     t->LevOfX[1] = 0;
    }
 
-   for(int i=0; i<PiDD_TopVar; i++) BDD_NewVar();
-   PiDD_TopVar++;  
+   for(int i=0; i<t->TopVar; i++) BDD_NewVar();
+   t->TopVar++;
 
    int toplev = BDD_TopLev();
-   if(PiDD_TopVar > 1) PiDD_LevOfX[PiDD_TopVar] = toplev;
+   if(t->TopVar > 1)
+   {
+     t->LevOfX[t->TopVar] = toplev;
+     t->TopBDDVar = BDD_VarOfLev(toplev);
+     /* The algorithms assume the order of the levels, which is kept by
+      * reordering the levels from x = 2 as one group */
+     BDD_VarGroup(t->LevOfX[2], toplev - t->LevOfX[2] + 1, BDD_GROUP_MOVE);
+   }
 
-   if(PiDD_VarTableSize <= toplev)
+   if(t->VarTableSize <= toplev)
    {
-     int size = PiDD_VarTableSize;
-     int *table = PiDD_XOfLev;
-     PiDD_VarTableSize <<= 2;
-     PiDD_XOfLev = new int[PiDD_VarTableSize];
-     for(int i=0; i<size; i++) PiDD_XOfLev[i] = table[i];
+     int size = t->VarTableSize;
+     int *table = t->XOfLev;
+     t->VarTableSize <<= 2;
+     t->XOfLev = new int[t->VarTableSize];
+     for(int i=0; i<size; i++) t->XOfLev[i] = table[i];
      delete[] table;
    }
 
-   for(int i=0; i<(PiDD_TopVar-1); i++)
-     PiDD_XOfLev[toplev - i] = PiDD_TopVar;
+   for(int i=0; i<(t->TopVar-1); i++)
+     t->XOfLev[toplev - i] = t->TopVar;
 
-   return PiDD_TopVar;
+   return t->TopVar;
 }
 
 int PiDD_VarUsed() { return PiDD_TopVar; }
@@ -38,44 +38,92 @@ static const char BC_RotPiDD_REMOVEMAX = 110;
     return h; }
 
 //----------- External functions for RotPiDD ----------
-int RotPiDD_TopVar = 0;
-int RotPiDD_VarTableSize = 16;
-int RotPiDD_LevOfX[RotPiDD_MaxVar];
-int *RotPiDD_XOfLev;
+static void RotPiDD_FreeVars(void *p)
+{
+  RotPiDD_VarTable *t = (RotPiDD_VarTable *)p;
+  delete[] t->XOfLev;
+  delete t;
+}
+
+// The levels of the variables are one group moved as a unit by
+// reordering, so they are shifted all together as TopBDDVar is
+static void RotPiDD_Relevel(RotPiDD_VarTable *t)
+{
+  int d = (int)bddlevofvar(t->TopBDDVar) - t->LevOfX[t->TopVar];
+  for(int x=2; x<=t->TopVar; x++) t->LevOfX[x] += d;
+  int toplev = t->LevOfX[t->TopVar];
+  if(t->VarTableSize <= toplev)
+  {
+    while(t->VarTableSize <= toplev) t->VarTableSize <<= 2;
+    delete[] t->XOfLev;
+    t->XOfLev = new int[t->VarTableSize];
+  }
+  for(int i=0; i<t->VarTableSize; i++) t->XOfLev[i] = 0;
+  for(int x=2; x<=t->TopVar; x++)
+    for(int y=1; y<x; y++) t->XOfLev[t->LevOfX[x] - y + 1] = x;
+}
+
+// The table is kept in the slot BDD_PKG_ROTPIDD of each manager
+RotPiDD_VarTable *RotPiDD_Vars()
+{
+  RotPiDD_VarTable *t = (RotPiDD_VarTable *)bddmgrpkg(BDD_PKG_ROTPIDD);
+  if(t)
+  {
+    if(t->TopVar > 1 &&
+       (int)bddlevofvar(t->TopBDDVar) != t->LevOfX[t->TopVar])
+      RotPiDD_Relevel(t);
+    return t;
+  }
+  t = new RotPiDD_VarTable;
+  t->TopVar = 0;
+  t->VarTableSize = 16;
+  t->XOfLev = 0;
+  t->TopBDDVar = 0;
+  bddmgrsetpkg(BDD_PKG_ROTPIDD, t, RotPiDD_FreeVars);
+  return t;
+}
 
 int RotPiDD_NewVar()
 {
-   if(RotPiDD_TopVar == RotPiDD_MaxVar)
-     BDDerr("PiDD_NewVar: Too large var ", (bddword) RotPiDD_TopVar, ExceptionType::OutOfRange);
+   RotPiDD_VarTable *t = RotPiDD_Vars();
+   if(t->TopVar == RotPiDD_MaxVar)
+     BDDerr("PiDD_NewVar: Too large var ", (bddword) t->TopVar, ExceptionType::OutOfRange);
 
-   if(RotPiDD_TopVar == 0)
+   if(t->TopVar == 0)
    {
-     RotPiDD_XOfLev = new int[RotPiDD_VarTableSize];
-     RotPiDD_XOfLev[0] = 0;
-     RotPiDD_LevOfX[0] = 0;
-     RotPiDD_LevOfX[1] = 0;
+     t->XOfLev = new int[t->VarTableSize];
+     t->XOfLev[0] = 0;
+     t->LevOfX[0] = 0;
+     t->LevOfX[1] = 0;
    }
 
-   for(int i=0; i<RotPiDD_TopVar; i++) BDD_NewVar();
-   RotPiDD_TopVar++;
+   for(int i=0; i<t->TopVar; i++) BDD_NewVar();
+   t->TopVar++;
 
    int toplev = BDD_TopLev();
-   if(RotPiDD_TopVar > 1) RotPiDD_LevOfX[RotPiDD_TopVar] = toplev;
+   if(t->TopVar > 1)
+   {
+     t->LevOfX[t->TopVar] = toplev;
+     t->TopBDDVar = BDD_VarOfLev(toplev);
+     /* The algorithms assume the order of the levels, which is kept by
+      * reordering the levels from x = 2 as one group */
+     BDD_VarGroup(t->LevOfX[2], toplev - t->LevOfX[2] + 1, BDD_GROUP_MOVE);
+   }
 
-   if(RotPiDD_VarTableSize <= toplev)
+   if(t->VarTableSize <= toplev)
    {
-     int size = RotPiDD_VarTableSize;
-     int *table = RotPiDD_XOfLev;
-     RotPiDD_VarTableSize <<= 2;
-     RotPiDD_XOfLev = new int[RotPiDD_VarTableSize];
-     for(int i=0; i<size; i++) RotPiDD_XOfLev[i] = table[i];
+     int size = t->VarTableSize;
+     int *table = t->XOfLev;
+     t->VarTableSize <<= 2;
+     t->XOfLev = new int[t->VarTableSize];
+     for(int i=0; i<size; i++) t->XOfLev[i] = table[i];
      delete[] table;
    }
 
-   for(int i=0; i<(RotPiDD_TopVar-1); i++)
-     RotPiDD_XOfLev[toplev - i] = RotPiDD_TopVar;
+   for(int i=0; i<(t->TopVar-1); i++)
+     t->XOfLev[toplev - i] = t->TopVar;
 
-   return RotPiDD_TopVar;
+   return t->TopVar;
 }
 
 int RotPiDD_VarUsed() { return RotPiDD_TopVar; }
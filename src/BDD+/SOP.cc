@@ -43,13 +43,21 @@ static const char BC_SOP_IMPL = 36;
 
 //----------- External functions for SOP ----------
 
-int SOP_NewVar() { BDD_NewVar(); return BDD_NewVar(); }
+int SOP_NewVar()
+{
+  BDD_NewVar();
+  int v = BDD_NewVar();
+  BDD_VarGroup(BDD_TopLev() - 1, 2, BDD_GROUP_MOVE);
+  return v;
+}
 
 int SOP_NewVarOfLev(int lev)
 {
   if(lev & 1) BDDerr("SOP_NewVarOfLev: Invalid lev.", lev, ExceptionType::OutOfRange);
   BDD_NewVarOfLev(lev - 1);
-  return BDD_NewVarOfLev(lev);
+  int v = BDD_NewVarOfLev(lev);
+  BDD_VarGroup(lev - 1, 2, BDD_GROUP_MOVE);
+  return v;
 }
 
 SOP operator*(const SOP& pc, const SOP& qc)
@@ -215,7 +223,7 @@ BDD SOP::GetBDD() const
   SOP p1 = Factor1(top);
   SOP p0 = Factor0(top);
   SOP pD = FactorD(top);
-  BDD f = (x & p1.GetBDD()) | (~x & p0.GetBDD()) | pD.GetBDD();
+  BDD f = BDD_Ite(x, p1.GetBDD(), p0.GetBDD()) | pD.GetBDD();
 
   BDD_CACHE_ENT_RETURN(BC_SOP_BDD, sx, 0, f);
 }
@@ -328,12 +336,20 @@ SOP SOP::Implicants(BDD f) const
 
 //----------- External functions for SOP ----------
 
-int SOPV_NewVar() { BDD_NewVar(); return BDD_NewVar(); }
+int SOPV_NewVar()
+{
+  BDD_NewVar();
+  int v = BDD_NewVar();
+  BDD_VarGroup(BDD_TopLev() - 1, 2, BDD_GROUP_MOVE);
+  return v;
+}
 
 int SOPV_NewVarOfLev(int lev)
 {
   BDD_NewVarOfLev(lev - 1);
-  return BDD_NewVarOfLev(lev);
+  int v = BDD_NewVarOfLev(lev);
+  BDD_VarGroup(lev - 1, 2, BDD_GROUP_MOVE);
+  return v;
 }
 
 //-------------- Class methods of SOPV -----------------
@@ -541,7 +557,7 @@ BCpair ISOP(BDD s, BDD r)
   SOP cD = bcD._cs;
 
   BDD x = BDDvar(top);
-  f = (~x & bc0._f)|(x & bc1._f)| bcD._f;
+  f = BDD_Ite(x, bc1._f, bc0._f) | bcD._f;
   SOP cs = c1 + c0 + cD;
 
   BDD_RECUR_DEC;
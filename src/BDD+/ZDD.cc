@@ -9,13 +9,13 @@
 #define BDD_CPP
 #include "bddc.h"
 #include "BDDException.h"
+#include "BDDTokenizer.h"
 
 using std::cout;
 
 namespace sapporobdd {
 
-static const char BC_ZDD_MULT = 20;
-static const char BC_ZDD_DIV = 21;
+/* 20 (operator*), 21 (operator/) and 29 (ZDD_Meet) are run in bddc */
 static const char BC_ZDD_RSTR = 22;
 static const char BC_ZDD_PERMIT = 23;
 static const char BC_ZDD_PERMITSYM = 24;
@@ -23,7 +23,6 @@ static const char BC_ZDD_SYMCHK = 25;
 static const char BC_ZDD_ALWAYS = 26;
 static const char BC_ZDD_SYMSET = 27;
 static const char BC_ZDD_COIMPSET = 28;
-static const char BC_ZDD_MEET = 29;
 
 static const char BC_ZDD_ZSkip = 65;
 static const char BC_ZDD_INTERSEC = 66;
@@ -37,10 +36,16 @@ extern "C"
 
 void ZDD::Export(FILE *strm) const
 {
-  bddword p = _zdd;
+  bddword p = GetID();
   bddexport(strm, &p, 1);
 }
 
+void ZDD::ExportBin(FILE *strm) const
+{
+  bddword p = GetID();
+  bddexportbin(strm, &p, 1);
+}
+
 void ZDD::Print() const
 {
   cout << "[ " << GetID();
@@ -71,6 +76,12 @@ ZDD ZDD::Swap(int v1, int v2) const
   return h.Change(v1).Change(v2) + f00 + f11;
 }
 
+ZDD ZDD::Permute(const std::vector<int>& perm) const
+{
+  std::vector<bddvar> p(perm.begin(), perm.end());
+  return ZDD_ID(bddpermute(GetID(), p.data(), (int)p.size()));
+}
+
 ZDD ZDD::Restrict(const ZDD& g) const
 {
   if(*this == -1) return -1;
@@ -418,121 +429,20 @@ ZDD ZDD::Divisor() const
 
 //--------- External functions for ZDD ------------
 
-ZDD operator*(const ZDD& fc, const ZDD& gc)
+ZDD operator*(const ZDD& f, const ZDD& g)
 {
-  if(fc == -1) return -1;
-  if(gc == -1) return -1;
-  if(fc == 0) return 0;
-  if(gc == 0) return 0;
-  if(fc == 1) return gc;
-  if(gc == 1) return fc;
-
-  ZDD f = fc; ZDD g = gc;
-  int ftop = f.Top(); int gtop = g.Top();
-  if(BDD_LevOfVar(ftop) < BDD_LevOfVar(gtop))
-  {
-    f = gc; g = fc;
-    ftop = f.Top(); gtop = g.Top();
-  }
-
-  bddword fx = f.GetID();
-  bddword gx = g.GetID();
-  if(ftop == gtop && fx < gx)
-  {
-    f = gc; g = fc;
-    fx = f.GetID(); gx = g.GetID();
-  }
-
-  ZDD_CACHE_CHK_RETURN(BC_ZDD_MULT, fx, gx);
-
-  ZDD f1 = f.OnSet0(ftop);
-  ZDD f0 = f.OffSet(ftop);
-  ZDD h;
-  if(ftop != gtop)
-  {
-    h = f1 * g;
-    h = h.Change(ftop) + (f0 * g);
-  }
-  else
-  {
-    ZDD g1 = g.OnSet0(ftop);
-    ZDD g0 = g.OffSet(ftop);
-    h = (f1 * g1)+(f1 * g0)+(f0 * g1);
-    h = h.Change(ftop) + (f0 * g0);
-  }
-
-  ZDD_CACHE_ENT_RETURN(BC_ZDD_MULT, fx, gx, h);
+  return ZDD_ID(bddmult(f.GetID(), g.GetID()));
 }
 
 ZDD operator/(const ZDD& f, const ZDD& p)
 {
-  if(f == -1) return -1;
-  if(p == -1) return -1;
-  if(p == 1) return f;
-  if(f == p) return 1;
   if(p == 0) BDDerr("operator /(): Divided by zero.", ExceptionType::InvalidBDDValue);
-  int top = p.Top();
-  if(BDD_LevOfVar(f.Top()) < BDD_LevOfVar(top)) return 0;
-
-  bddword fx = f.GetID();
-  bddword px = p.GetID();
-  ZDD_CACHE_CHK_RETURN(BC_ZDD_DIV, fx, px);
-  
-  ZDD q = f.OnSet0(top) / p.OnSet0(top);
-  if(q != 0)
-  {
-    ZDD p0 = p.OffSet(top);
-    if(p0 != 0) q &= f.OffSet(top) / p0;
-  }
-
-  ZDD_CACHE_ENT_RETURN(BC_ZDD_DIV, fx, px, q);
+  return ZDD_ID(bdddiv(f.GetID(), p.GetID()));
 }
 
-ZDD ZDD_Meet(const ZDD& fc, const ZDD& gc)
+ZDD ZDD_Meet(const ZDD& f, const ZDD& g)
 {
-  if(fc == -1) return -1;
-  if(gc == -1) return -1;
-  if(fc == 0) return 0;
-  if(gc == 0) return 0;
-  if(fc == 1) return 1;
-  if(gc == 1) return 1;
-
-  ZDD f = fc; ZDD g = gc;
-  int ftop = f.Top();
-  int gtop = g.Top();
-  if(BDD_LevOfVar(ftop) < BDD_LevOfVar(gtop))
-  {
-    f = gc; g = fc;
-    ftop = f.Top(); gtop = g.Top();
-  }
-
-  bddword fx = f.GetID();
-  bddword gx = g.GetID();
-  if(ftop == gtop && fx < gx)
-  {
-    f = gc; g = fc;
-    fx = f.GetID(); gx = g.GetID();
-  }
-
-  ZDD_CACHE_CHK_RETURN(BC_ZDD_MEET, fx, gx);
-
-  ZDD f1 = f.OnSet0(ftop);
-  ZDD f0 = f.OffSet(ftop);
-  ZDD h;
-  if(ftop != gtop)
-  {
-    h = ZDD_Meet(f0, g) + ZDD_Meet(f1, g);
-  }
-  else
-  {
-    ZDD g1 = g.OnSet0(ftop);
-    ZDD g0 = g.OffSet(ftop);
-    h = ZDD_Meet(f1, g1);
-    h = h.Change(ftop) + ZDD_Meet(f0, g0)
-      + ZDD_Meet(f1, g0) + ZDD_Meet(f0, g1);
-  }
-
-  ZDD_CACHE_ENT_RETURN(BC_ZDD_MEET, fx, gx, h);
+  return ZDD_ID(bddmeet(f.GetID(), g.GetID()));
 }
 
 ZDD ZDD_Random(int lev, int density)
@@ -553,6 +463,22 @@ ZDD ZDD_Import(FILE *strm)
   return ZDD_ID(zdd);
 }
 
+ZDD ZDD_Import(std::istream &is)
+{
+  bddword zdd;
+  // bddimportz throws an exception on failure
+  bddimportz(is, &zdd, 1);
+  return ZDD_ID(zdd);
+}
+
+ZDD ZDD_ImportBin(const char *path)
+{
+  bddword zdd;
+  // bddimportbin throws an exception on failure
+  bddimportbin(path, &zdd, 1);
+  return ZDD_ID(zdd);
+}
+
 
 // class ZDDV ---------------------------------------------
 
@@ -791,36 +717,29 @@ int ZDDV::PrintPla() const
 
 #define IMPORTHASH(x) ((((x)>>1)^((x)<<8)^((x)<<16)) & (hashsize-1))
 
-#ifdef B_32
-#  define B_STRTOI strtol
-#else
-#  define B_STRTOI strtoll
-#endif
-
-ZDDV ZDDV_Import(FILE *strm)
+static ZDDV zddv_import(BDD_Tokenizer &tk)
 {
   int inv, e;
   bddword hashsize;
   ZDD f, f0, f1;
-  char s[256];
   bddword *hash1 = 0;
   ZDD *hash2 = 0;
 
-  if(fscanf(strm, "%s", s) == EOF) BDDerr("ZDDV_Import(): Unexpected end of file reading _i tag", ExceptionType::FileFormat);
-  if(strcmp(s, "_i") != 0) BDDerr("ZDDV_Import(): File format error, expected _i tag", ExceptionType::FileFormat);
-  if(fscanf(strm, "%s", s) == EOF) BDDerr("ZDDV_Import(): Unexpected end of file reading variable count", ExceptionType::FileFormat);
-  int n = strtol(s, NULL, 10);
+  if(!tk.Next()) BDDerr("ZDDV_Import(): Unexpected end of file reading _i tag", ExceptionType::FileFormat);
+  if(!tk.Is("_i")) BDDerr("ZDDV_Import(): File format error, expected _i tag", ExceptionType::FileFormat);
+  if(!tk.Next()) BDDerr("ZDDV_Import(): Unexpected end of file reading variable count", ExceptionType::FileFormat);
+  int n = tk.Int();
   while(n > BDD_TopLev()) BDD_NewVar();
 
-  if(fscanf(strm, "%s", s) == EOF) BDDerr("ZDDV_Import(): Unexpected end of file reading _o tag", ExceptionType::FileFormat);
-  if(strcmp(s, "_o") != 0) BDDerr("ZDDV_Import(): File format error, expected _o tag", ExceptionType::FileFormat);
-  if(fscanf(strm, "%s", s) == EOF) BDDerr("ZDDV_Import(): Unexpected end of file reading output count", ExceptionType::FileFormat);
-  int m = strtol(s, NULL, 10);
+  if(!tk.Next()) BDDerr("ZDDV_Import(): Unexpected end of file reading _o tag", ExceptionType::FileFormat);
+  if(!tk.Is("_o")) BDDerr("ZDDV_Import(): File format error, expected _o tag", ExceptionType::FileFormat);
+  if(!tk.Next()) BDDerr("ZDDV_Import(): Unexpected end of file reading output count", ExceptionType::FileFormat);
+  int m = tk.Int();
 
-  if(fscanf(strm, "%s", s) == EOF) BDDerr("ZDDV_Import(): Unexpected end of file reading _n tag", ExceptionType::FileFormat);
-  if(strcmp(s, "_n") != 0) BDDerr("ZDDV_Import(): File format error, expected _n tag", ExceptionType::FileFormat);
-  if(fscanf(strm, "%s", s) == EOF) BDDerr("ZDDV_Import(): Unexpected end of file reading node count", ExceptionType::FileFormat);
-  bddword n_nd = B_STRTOI(s, NULL, 10);
+  if(!tk.Next()) BDDerr("ZDDV_Import(): Unexpected end of file reading _n tag", ExceptionType::FileFormat);
+  if(!tk.Is("_n")) BDDerr("ZDDV_Import(): File format error, expected _n tag", ExceptionType::FileFormat);
+  if(!tk.Next()) BDDerr("ZDDV_Import(): Unexpected end of file reading node count", ExceptionType::FileFormat);
+  bddword n_nd = tk.Int();
 
   for(hashsize = 1; hashsize < (n_nd<<1); hashsize <<= 1)
     ; /* empty */
@@ -837,19 +756,19 @@ ZDDV ZDDV_Import(FILE *strm)
   e = 0;
   for(bddword ix=0; ix<n_nd; ix++)
   {
-    if(fscanf(strm, "%s", s) == EOF) { e = 1; break; }
-    bddword nd = B_STRTOI(s, NULL, 10);
+    if(!tk.Next()) { e = 1; break; }
+    bddword nd = tk.Int();
     
-    if(fscanf(strm, "%s", s) == EOF) { e = 1; break; }
-    int lev = strtol(s, NULL, 10);
+    if(!tk.Next()) { e = 1; break; }
+    int lev = tk.Int();
     int var = bddvaroflev(lev);
 
-    if(fscanf(strm, "%s", s) == EOF) { e = 1; break; }
-    if(strcmp(s, "F") == 0) f0 = 0;
-    else if(strcmp(s, "T") == 0) f0 = 1;
+    if(!tk.Next()) { e = 1; break; }
+    if(tk.Is("F")) f0 = 0;
+    else if(tk.Is("T")) f0 = 1;
     else
     {
-      bddword nd0 = B_STRTOI(s, NULL, 10);
+      bddword nd0 = tk.Int();
 
       bddword ixx = IMPORTHASH(nd0);
       while(hash1[ixx] != nd0)
@@ -862,12 +781,12 @@ ZDDV ZDDV_Import(FILE *strm)
       f0 = hash2[ixx];
     }
 
-    if(fscanf(strm, "%s", s) == EOF) { e = 1; break; }
-    if(strcmp(s, "F") == 0) f1 = 0;
-    else if(strcmp(s, "T") == 0) f1 = 1;
+    if(!tk.Next()) { e = 1; break; }
+    if(tk.Is("F")) f1 = 0;
+    else if(tk.Is("T")) f1 = 1;
     else
     {
-      bddword nd1 = B_STRTOI(s, NULL, 10);
+      bddword nd1 = tk.Int();
       if(nd1 & 1) { inv = 1; nd1 ^= 1; }
       else inv = 0;
   
@@ -907,17 +826,17 @@ ZDDV ZDDV_Import(FILE *strm)
   ZDDV v = ZDDV();
   for(int i=0; i<m; i++)
   {
-    if(fscanf(strm, "%s", s) == EOF)
+    if(!tk.Next())
     {
       delete[] hash2;
       delete[] hash1;
       BDDerr("ZDDV_Import(): Unexpected end of file reading output values", ExceptionType::FileFormat);
     }
-    bddword nd = B_STRTOI(s, NULL, 10);
-    if(strcmp(s, "F") == 0) v += ZDDV(0, i);
-    else if(strcmp(s, "T") == 0) v += ZDDV(1, i);
+    if(tk.Is("F")) v += ZDDV(0, i);
+    else if(tk.Is("T")) v += ZDDV(1, i);
     else
     {
+      bddword nd = tk.Int();
       if(nd & 1) { inv = 1; nd ^= 1; }
       else inv = 0;
   
@@ -938,6 +857,18 @@ ZDDV ZDDV_Import(FILE *strm)
   return v;
 }
 
+ZDDV ZDDV_Import(FILE *strm)
+{
+  BDD_Tokenizer tk(strm);
+  return zddv_import(tk);
+}
+
+ZDDV ZDDV_Import(std::istream &is)
+{
+  BDD_Tokenizer tk(is);
+  return zddv_import(tk);
+}
+
 #define ZLevNum(n) \
   (n-((n&2)?(n&1)? (n<512)?(n<64)?(n<16)?4:8:(n<128)?32:(n<256)?64:128:(n<4096)?(n<1024)?256:(n<2048)?512:1024:(n<8192)?2048:(n<32768)?4096:8192 \
   : (n<512)?(n<64)?4:(n<256)?16:32:(n<4096)?(n<1024)?64:128:(n<32768)?512:1024 \
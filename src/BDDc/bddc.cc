@@ -9,8 +9,29 @@
 #include <math.h>
 #include <assert.h>
 #include <stdarg.h>
+#include <stdint.h>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include <chrono>
+#include <exception>
+#include <deque>
+#include <memory>
+#include <functional>
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#define B_MMAP
+#endif
 #include "bddc.h"
 #include "BDDException.h"
+#include "BDDTokenizer.h"
 
 namespace sapporobdd {
 
@@ -35,7 +56,11 @@ namespace sapporobdd {
 #define BC_CARD       16
 #define BC_LIT        17
 #define BC_LEN        18
-#define BC_CARD2      19
+#define BC_ZDD_MULT   20  /* ZDD operator* */
+#define BC_ZDD_DIV    21  /* ZDD operator/ */
+#define BC_ZDD_MEET   29  /* ZDD_Meet */
+#define BC_ITE        90  /* In the three-operand cache */
+#define BC_ANDEXIST   91  /* In the three-operand cache */
 
 /* Macros for malloc, realloc */
 #define B_MALLOC(type, size) \
@@ -52,19 +77,14 @@ namespace sapporobdd {
 #  define B_BDDP_FX "0x%llX"
 #endif
 
-/* strtol or strtoll */
-#ifdef B_32
-#  define B_STRTOI strtol
-#else
-#  define B_STRTOI strtoll
-#endif
-
 /* Table spaces */
 #define B_NODE_MAX (B_VAL_MASK>>1U) /* Max number of BDD nodes */
+#define B_HUGEPAGE (2U<<20U) /* Size of a huge page for BDD_NT_HUGEPAGE */
 #define B_NODE_SPC0 256 /* Default initial node size */
 #define B_VAR_SPC0   16 /* Initial var table size */
 #define B_HASH_SPC0   4 /* Initial hash size */
 #define B_RFCT_SPC0   4 /* Initial RFCT size */
+#define B_SIFT_GROWTH 5 /* Sifting turns back at growth by 1/B_SIFT_GROWTH */
 
 /* Negative edge manipulation */
 #define B_NEG(f)  ((f) & B_INV_MASK)
@@ -114,14 +134,114 @@ namespace sapporobdd {
    (B_RFC_ZERO_NP(p))? \
     err("B_RFC_DEC_NP: rfc under flow", p-Node, ExceptionType::InternalError): \
     ((p)->varrfc -= B_RFC_UNIT, 0))
+/* In the functions instantiated for the parallel apply (template
+ * parameter P = 1), the counters are changed atomically. P is a
+ * constant, so the sequential instances have no test of it. */
+#define B_RFC_INC_P(p) (P? rfc_inc_par(p): B_RFC_INC_NP(p))
+#define B_RFC_DEC_P(p) (P? rfc_dec_par(p): B_RFC_DEC_NP(p))
 
 /* ----------- Stack overflow limitter ------------ */
+/* Used by the recursive operations of the C++ classes. The operations
+ * of this file run on explicit stacks and have no depth limit. */
 const int BDD_RecurLimit = 8192;
-int BDD_RecurCount = 0;
-#define BDD_RECUR_INC \
-  {if(++BDD_RecurCount >= BDD_RecurLimit) \
-    err("BDD_RECUR_INC: Recursion Limit", BDD_RecurCount, ExceptionType::InternalError);}
-#define BDD_RECUR_DEC BDD_RecurCount--
+thread_local int BDD_RecurCount = 0;
+
+/* Explicit stack of the traversals (gc1, count, dump, ...) */
+static thread_local std::vector<bddp> B_Stack;
+
+/* Drops the entries pushed in the scope, also on an exception */
+template<class T> struct B_StackScope
+{
+  std::vector<T> &st;
+  size_t base;
+  B_StackScope(std::vector<T> &s) : st(s), base(s.size()) {}
+  ~B_StackScope(void) { st.resize(base); }
+};
+
+/* Visited nodes of the read-only traversals (count, export, dump): a
+ * bitmap per thread over the node indices. Only the words touched in the
+ * scope are cleared at its end, so the nodes themselves are never
+ * written and the traversals can run concurrently. */
+struct B_Visited
+{
+  std::vector<unsigned long long> bit;
+  std::vector<size_t> used; /* Words having a bit set */
+};
+static thread_local B_Visited B_Visit;
+
+struct B_VisitScope
+{
+  B_VisitScope(void) {}
+  ~B_VisitScope(void)
+  {
+    for(size_t w: B_Visit.used) B_Visit.bit[w] = 0;
+    B_Visit.used.clear();
+  }
+};
+
+/* Set by bddbfsapply() for the operation it calls (see apply2) */
+static thread_local int B_BFSForce = 0;
+
+/* Byte-order word of a snapshot, whose bytes differ from each other */
+#define B_SNAP_ORDER 0x0102030405060708ULL
+
+/* A snapshot file mapped read-only for bddimportbin (or read into
+ * memory where mmap is not available) */
+struct B_SnapFile
+{
+  const void *data;
+  size_t size;
+  std::vector<char> buf;
+  B_SnapFile(const char *path) : data(0), size(0)
+  {
+#ifdef B_MMAP
+    struct stat st;
+    void *a;
+    int fd;
+
+    fd = open(path, O_RDONLY);
+    if(fd < 0) throw BDDFileFormatException("Import error: Cannot open file", 0);
+    if(fstat(fd, &st) < 0)
+    {
+      close(fd);
+      throw BDDFileFormatException("Import error: Cannot open file", 0);
+    }
+    size = st.st_size;
+    if(size > 0)
+    {
+      a = mmap(0, size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if(a == MAP_FAILED)
+      {
+        close(fd);
+        throw BDDFileFormatException("Import error: Cannot map file", 0);
+      }
+      madvise(a, size, MADV_SEQUENTIAL);
+      data = a;
+    }
+    close(fd);
+#else
+    FILE *fp;
+    size_t r;
+
+    fp = fopen(path, "rb");
+    if(fp == NULL) throw BDDFileFormatException("Import error: Cannot open file", 0);
+    buf.resize(1 << 20);
+    while((r = fread(buf.data() + size, 1, buf.size() - size, fp)) > 0)
+    {
+      size += r;
+      if(size == buf.size()) buf.resize(size * 2);
+    }
+    fclose(fp);
+    data = buf.data();
+#endif
+  }
+  ~B_SnapFile(void)
+  {
+#ifdef B_MMAP
+    if(data) munmap((void *)data, size);
+#endif
+  }
+};
 
 /* Conversion of ZDD node flag */
 #define B_Z_NP(p) ((p)->f0_32 & (bddp_32)B_INV_MASK)
@@ -133,6 +253,15 @@ int BDD_RecurCount = 0;
    ^((B_CST(f1)? (f1): ((f1)+2U))) \
    ^((B_NEG(f1)? ~((f1)>>1U):((f1)>>1U))<<4U))\
   & (hashSpc-1U))
+
+/* Sets p to the bucket of (f0, f1) in the chained hash-table of varp.
+ * While rehashing, the buckets not moved yet are in the old table. */
+#define B_REHASH_STEP 64 /* Buckets moved per lookup while rehashing */
+#define B_UT_BUCKET(varp, f0, f1) \
+  (((varp)->oldSpc != 0 && \
+    (key = B_HASHKEY(f0, f1, (varp)->oldSpc)) >= (varp)->moved)? \
+   B_SET_NXP(p, (varp)->old, key): \
+   (key = B_HASHKEY(f0, f1, (varp)->hashSpc), B_SET_NXP(p, (varp)->hash, key)))
 #define B_CACHEKEY(op, f, g) \
   ((((bddp)(op)<<4U)\
    ^((B_CST(f)? (f):((f)+2U)))\
@@ -140,16 +269,33 @@ int BDD_RecurCount = 0;
    ^((B_CST(g)? (g):((g)+2U))) \
    ^((B_NEG(g)? ~((g)>>1U):((g)>>1U))*4369U) )\
    & (CacheSpc-1U))
-
-/* Multi-Precision Count */
-#define B_MP_LWID 4U
-#define B_MP_LPOS (B_MSB_POS - B_MP_LWID)
-#define B_MP_LMAX (1U<<B_MP_LWID)
-#define B_MP_NULL (B_CST_MASK + B_VAL_MASK)
-#define B_MP_LEN(f) (B_CST(f)? (B_VAL(f)>>B_MP_LPOS)+1: 0)
-#define B_MP_VAL(f) ((f) & (B_VAL_MASK>>B_MP_LWID))
+#define B_CACHESET(op, f, g) \
+  (Cache + (B_CACHEKEY(op, f, g) & ~(bddp)(CacheWays-1)))
+#define B_CACHE3KEY(op, f, g, k) \
+  ((((bddp)(op)<<4U) ^ ((f)*12582917U) ^ ((g)*4256249U) ^ ((k)*741457U)) \
+   & (Cache3Spc-1U))
+#define B_CACHE3_SHIFT 2 /* Cache3 has 1/4 entries of Cache */
+
+/* Entries of open-addressing unique tables.
+ * An entry holds (node index + 1) in the low 40 bits and a 24-bit
+ * fingerprint of (f0, f1) in the high bits, so that most mismatches are
+ * rejected without touching the node table. 0 is an empty slot. */
+#define B_OA_NDX_MASK  ((1ULL<<40U)-1U)
+#define B_OA_TAG_MASK  (~B_OA_NDX_MASK)
+#define B_OA_NDX(e)    ((bddp)((e) & B_OA_NDX_MASK) - 1U)
+#define B_OA_ENTRY(h, ndx) (((h) & B_OA_TAG_MASK) | ((B_OAEntry)(ndx) + 1U))
+#define B_OA_FULL(used, spc) ((used) > (spc) - ((spc)>>2U)) /* Load > 3/4 */
 
 #define CACHE_RATIO_MAX  1024
+#define B_CACHE_ALIGN    64 /* Alignment of cache (size of a cache line) */
+
+/* GC epochs: NodeEpoch[ix] is the epoch in which Node[ix] was collected
+ * last, and CacheEpoch[k] is the epoch in which Cache[k] was checked
+ * last (kept with BDD_GC_EPOCH only). An entry is valid if none of its
+ * nodes died since then. */
+#define B_EPOCH_MAX 255
+#define B_DIED(f, epoch) \
+  (!B_CST(f) && B_NDX(f) < NodeSpc && NodeEpoch[B_NDX(f)] >= (epoch))
 
 /* ------- Declaration of static (internal) data ------- */
 /* typedef of bddp field in the tables */
@@ -159,6 +305,20 @@ typedef unsigned int bddp_32;
 #endif
 
 /* Declaration of Node table */
+#if defined(B_NODE24) && !defined(B_32)
+/* 24-byte layout (-DB_NODE24): an edge and its extension share an
+ * aligned 64-bit word, so that an edge is read by one load */
+struct B_NodeTable
+{
+  unsigned long long f0_32 : 32; /* 0-edge */
+  unsigned long long f0_h8 : 8;  /* Extention of 0-edge */
+  unsigned long long nx_h8 : 8;  /* Extention of node index */
+  unsigned long long f1_32 : 32; /* 1-edge */
+  unsigned long long f1_h8 : 8;  /* Extention of 1-edge */
+  bddp_32      nx_32;  /* Node index */
+  unsigned int varrfc; /* VarID & Reference counter */
+};
+#else
 struct B_NodeTable
 {
   bddp_32      f0_32;  /* 0-edge */
@@ -171,11 +331,10 @@ struct B_NodeTable
   bddp_h8      nx_h8;  /* Extention of node index */
 #endif /* B_32 */
 };
-static struct B_NodeTable *Node = 0; /* Node Table */
-static bddp NodeLimit = 0;    /* Final limit size */
-static bddp NodeUsed = 0;     /* Number of used node */
-static bddp Avail = bddnull;  /* Head of available node */
-static bddp NodeSpc = 0;      /* Current Node-Table size */
+#endif /* B_NODE24 */
+
+/* Entry of open-addressing unique table */
+typedef unsigned long long B_OAEntry;
 
 /* Declaration of Hash-table per Var */
 struct B_VarTable
@@ -183,15 +342,20 @@ struct B_VarTable
   bddp    hashSpc;  /* Current hash-table size */
   bddp    hashUsed;  /* Current used entries */
   bddvar  lev;      /* Level of the variable */
-  bddp_32 *hash_32; /* Hash-table */
+  bddp_32 *hash_32; /* Hash-table (BDD_UT_CHAIN) */
 #ifndef B_32
   bddp_h8 *hash_h8; /* Extension of hash-table */
 #endif /* B_32 */
+  B_OAEntry *oa;    /* Hash-table (BDD_UT_OPEN) */
+  bddp_32 *old_32;  /* Hash-table being rehashed (BDD_UT_CHAIN) */
+#ifndef B_32
+  bddp_h8 *old_h8;  /* Extension of old hash-table */
+#endif /* B_32 */
+  bddp    oldSpc;   /* Size of old hash-table (0 if not rehashing) */
+  bddp    moved;    /* Buckets of old hash-table moved to new one */
+  bddvar  gsize;    /* Size of the group starting at this level (0: inner) */
+  char    gfix;     /* Nonzero if the group is not moved by reordering */
 };
-static struct B_VarTable *Var = 0; /* Var-tables */
-static bddvar *VarID = 0;     /* VarID reverse table */
-static bddvar VarUsed = 0;    /* Number of used Var */
-static bddvar VarSpc = 0;     /* Current Var-table size */
 
 /* Declaration of Operation Cache */
 struct B_CacheTable
@@ -206,10 +370,23 @@ struct B_CacheTable
   bddp_h8       h_h8; /* Extention of result BDD */
 #endif /* B_32 */
 };
-static struct B_CacheTable *Cache = 0; /* Opeartion cache */
-static bddp CacheSpc = 0;           /* Current cache size */
-static double CacheRatio = 0.5;    /* Cache size ratio to node table size */
-static bddp GCThreshold = 0;       /* GC threshold - minimum freed nodes for successful GC */
+
+/* Declaration of Three-Operand Cache (direct mapped) */
+struct B_Cache3Table
+{
+  bddp_32       f_32; /* an operand BDD */
+  bddp_32       g_32; /* an operand BDD */
+  bddp_32       k_32; /* an operand BDD */
+  bddp_32       h_32; /* Result BDD */
+  unsigned char op;   /* Operation code */
+  unsigned char epoch; /* GC epoch of last check */
+#ifndef B_32
+  bddp_h8       f_h8; /* Extention of an operand BDD */
+  bddp_h8       g_h8; /* Extention of an operand BDD */
+  bddp_h8       k_h8; /* Extention of an operand BDD */
+  bddp_h8       h_h8; /* Extention of result BDD */
+#endif /* B_32 */
+};
 
 /* Declaration of RFC-table */
 struct B_RFC_Table
@@ -221,60 +398,365 @@ struct B_RFC_Table
   bddp_h8 rfc_h8;  /* Extension of RFC */
 #endif /* B_32 */
 };
-static struct B_RFC_Table *RFCT = 0; /* RFC-Table */
-static bddp RFCT_Spc;   /* Current RFC-table size */
-static bddp RFCT_Used;  /* Current RFC-table used entries */
 
-/* Declaration of MP-Count */
-struct B_MPTable
+/* Exact counts of ZDD nodes for bddcard64, bddcard128 and bddcardmp.
+ * pos[ix] is the position in word of the count of the positive edge to
+ * Node[ix], stored as the number of limbs and then the 64-bit limbs from
+ * the lowest. The entries are kept across GC and only those of the
+ * collected nodes are removed (count_sweep). */
+struct B_CountMemo
+{
+  std::unordered_map<bddp, size_t> pos;
+  std::vector<unsigned long long> word;
+  size_t dead;  /* Words of the removed entries */
+};
+
+/* New indices of the nodes moved by a bddcompact with BDD_COMPACT_MOVE,
+ * for the BDD and ZDD objects of earlier epochs (see bddmfwd). fwd[ix]
+ * is the new index of Node[ix] and refs is the number of references
+ * left to renumber; fwd is released when it reaches 0. */
+struct B_FwdTable
+{
+  unsigned epoch;           /* Value of BDD_FwdEpoch set by the compaction */
+  bddp refs;
+  std::vector<bddp> fwd;
+};
+
+/* Declaration of BDD manager.
+ * A manager owns all the tables of one BDD universe. Each thread works
+ * on its current manager (BDD_CurMgr), which is the default manager unless
+ * it is switched by bddmgrswitch(). */
+struct BDDManager
+{
+  /* Node table */
+  struct B_NodeTable *Node; /* Node Table */
+  bddp NodeLimit;           /* Final limit size */
+  bddp NodeUsed;            /* Number of used node */
+  bddp Avail;               /* Head of available node */
+  bddp NodeSpc;             /* Current Node-Table size */
+  unsigned char *NodeEpoch; /* GC epoch of collection per node */
+  int NTType;               /* Node-table allocation in use */
+  int NTNext;               /* Node-table allocation for next bddinit */
+  void *NodeMap;            /* Address space reserved for Node (or 0) */
+  size_t NodeMapSize;       /* Size of NodeMap */
+  size_t NodeCommit;        /* Accessible bytes from Node */
+
+  /* Var tables */
+  struct B_VarTable *Var;   /* Var-tables */
+  bddvar *VarID;            /* VarID reverse table */
+  bddvar VarUsed;           /* Number of used Var */
+  bddvar VarSpc;            /* Current Var-table size */
+  int UTType;               /* Unique-table engine in use */
+  int UTNext;               /* Unique-table engine for next bddinit */
+
+  /* Operation cache */
+  struct B_CacheTable *Cache; /* Opeartion cache */
+  bddp CacheSpc;            /* Current cache size */
+  double CacheRatio;        /* Cache size ratio to node table size */
+  bddp GCThreshold;         /* GC threshold - minimum freed nodes for successful GC */
+  void *CacheMem;           /* Allocated block holding the aligned Cache */
+  int CacheWays;            /* Associativity of cache (1, 2 or 4) */
+  unsigned char *CacheEpoch; /* GC epoch of last check per cache entry */
+  unsigned char GCEpoch;    /* Current GC epoch */
+  int GCMode;               /* BDD_GC_FULL or BDD_GC_EPOCH */
+  int GCThreads;            /* Number of threads used by bddgc() */
+
+  /* RFC table */
+  struct B_RFC_Table *RFCT; /* RFC-Table */
+  bddp RFCT_Spc;            /* Current RFC-table size */
+  bddp RFCT_Used;           /* Current RFC-table used entries */
+
+  /* Exact counts (allocated on the first use) */
+  struct B_CountMemo *CountMemo;
+
+  /* Cache statistics per operation code */
+  struct bddcachestat CacheStat[BDD_CACHE_OPMAX];
+
+  /* Statistics of garbage collection */
+  struct bddgcstat GCStat;
+
+  /* Automatic reordering */
+  bddp ReorderLimit;        /* Number of nodes to start reordering (0: off) */
+  bddp ReorderNext;         /* Number of nodes for next reordering */
+  int ReorderCost;          /* Nodes counted by reordering (BDD_REORDER_*) */
+
+  /* Three-operand cache */
+  struct B_Cache3Table *Cache3; /* Cache of operations with three operands */
+  bddp Cache3Spc;           /* Current Cache3 size */
+
+  /* Variables rewritten by bddcompact (allocated on the first use) */
+  std::vector<bddp *> *Roots;
+
+  /* Forwarding of BDD and ZDD objects after compactions (or 0) */
+  std::vector<struct B_FwdTable> *FwdTables;
+
+  /* Operand nodes to switch to the level-by-level apply (0: off) */
+  bddp BFSThreshold;
+
+  /* Parallel apply */
+  int ApplyThreads;         /* Number of threads used by the binary operations */
+  struct B_ParPool *ParPool; /* Worker threads (created on the first use) */
+  int ParActive;            /* Nonzero while the workers share the tables */
+
+  /* Data of the C++ packages (see bddmgrpkg) */
+  void *PkgData[BDD_PKG_MAX];
+  void (*PkgFree[BDD_PKG_MAX])(void *);
+};
+
+#define B_MGR_INIT \
+  { 0, 0, 0, bddnull, 0, 0, BDD_NT_MALLOC, BDD_NT_MALLOC, 0, 0, 0, \
+    0, 0, 0, 0, BDD_UT_CHAIN, BDD_UT_CHAIN, \
+    0, 0, 0.5, 0, 0, 1, 0, 1, BDD_GC_FULL, 1,  0, 0, 0,  0, \
+    {{0, 0, 0}},  {0, 0, 0, 0},  0, 0, BDD_REORDER_ALL,  0, 0,  0,  0,  0, \
+    1, 0, 0,  {0}, {0} }
+static struct BDDManager B_DefaultMgr = B_MGR_INIT;
+thread_local struct BDDManager *BDD_CurMgr = &B_DefaultMgr; /* Current manager */
+std::atomic<unsigned> BDD_FwdEpoch(0); /* Count of moving compactions */
+
+/* The body of the package refers to the tables of the current manager
+ * by these names. */
+#define Node        (BDD_CurMgr->Node)
+#define NodeLimit   (BDD_CurMgr->NodeLimit)
+#define NodeUsed    (BDD_CurMgr->NodeUsed)
+#define Avail       (BDD_CurMgr->Avail)
+#define NodeSpc     (BDD_CurMgr->NodeSpc)
+#define NodeEpoch   (BDD_CurMgr->NodeEpoch)
+#define NTType      (BDD_CurMgr->NTType)
+#define NTNext      (BDD_CurMgr->NTNext)
+#define NodeMap     (BDD_CurMgr->NodeMap)
+#define NodeMapSize (BDD_CurMgr->NodeMapSize)
+#define NodeCommit  (BDD_CurMgr->NodeCommit)
+#define Var         (BDD_CurMgr->Var)
+#define VarID       (BDD_CurMgr->VarID)
+#define VarUsed     (BDD_CurMgr->VarUsed)
+#define VarSpc      (BDD_CurMgr->VarSpc)
+#define UTType      (BDD_CurMgr->UTType)
+#define UTNext      (BDD_CurMgr->UTNext)
+#define Cache       (BDD_CurMgr->Cache)
+#define CacheSpc    (BDD_CurMgr->CacheSpc)
+#define CacheRatio  (BDD_CurMgr->CacheRatio)
+#define GCThreshold (BDD_CurMgr->GCThreshold)
+#define CacheMem    (BDD_CurMgr->CacheMem)
+#define CacheWays   (BDD_CurMgr->CacheWays)
+#define CacheStat   (BDD_CurMgr->CacheStat)
+#define CacheEpoch  (BDD_CurMgr->CacheEpoch)
+#define GCEpoch     (BDD_CurMgr->GCEpoch)
+#define GCMode      (BDD_CurMgr->GCMode)
+#define GCThreads   (BDD_CurMgr->GCThreads)
+#define GCStat      (BDD_CurMgr->GCStat)
+#define RFCT        (BDD_CurMgr->RFCT)
+#define RFCT_Spc    (BDD_CurMgr->RFCT_Spc)
+#define RFCT_Used   (BDD_CurMgr->RFCT_Used)
+#define CountMemo   (BDD_CurMgr->CountMemo)
+#define ReorderLimit (BDD_CurMgr->ReorderLimit)
+#define ReorderNext (BDD_CurMgr->ReorderNext)
+#define ReorderCost (BDD_CurMgr->ReorderCost)
+#define Cache3      (BDD_CurMgr->Cache3)
+#define Cache3Spc   (BDD_CurMgr->Cache3Spc)
+#define Roots       (BDD_CurMgr->Roots)
+#define FwdTables   (BDD_CurMgr->FwdTables)
+#define BFSThreshold (BDD_CurMgr->BFSThreshold)
+#define ApplyThreads (BDD_CurMgr->ApplyThreads)
+#define ParPool     (BDD_CurMgr->ParPool)
+#define ParActive   (BDD_CurMgr->ParActive)
+#define PkgData     (BDD_CurMgr->PkgData)
+#define PkgFree     (BDD_CurMgr->PkgFree)
+
+/* Switches the current manager of this thread while in scope */
+struct B_MgrScope
+{
+  struct BDDManager *old;
+  B_MgrScope(struct BDDManager *m) { old = BDD_CurMgr; BDD_CurMgr = m; }
+  ~B_MgrScope(void) { BDD_CurMgr = old; }
+};
+
+/* ----------------- Parallel apply ---------------------- */
+#define B_PAR_BATCH  256  /* Free nodes taken by a thread at a time */
+#define B_PAR_LOCKS  4096 /* Locks over the sets of the operation cache */
+#define B_PAR_SPIN   4096 /* Yields of an idle worker before sleeping */
+
+/* Operation forked by the parallel apply */
+struct B_ParTask
+{
+  bddp f, g;
+  unsigned char op;
+  int depth;
+  bddp h;                /* Result */
+  std::atomic<int> done; /* Nonzero when h is set by another thread */
+};
+
+/* Tasks of a thread. The owner pushes and pops at the back, and the
+ * other threads steal the oldest one from the front. */
+struct B_ParQueue
+{
+  std::mutex m;
+  std::deque<struct B_ParTask *> q;
+  std::atomic<size_t> n;
+};
+
+/* Free nodes taken from the free list by a thread, padded to a cache
+ * line */
+struct B_ParBatch
+{
+  bddp head;
+  bddp n;
+  char pad[64 - 2 * sizeof(bddp)];
+};
+
+/* Worker threads of a manager and the locks over its tables */
+struct B_ParPool
 {
-  bddp size;  /* Table size */
-  bddp used;  /* Used entries */
-  bddp* word; /* Table head */
+  int nt;                   /* Number of threads including the caller */
+  int depth;                /* Levels of the recursion forking tasks */
+  struct BDDManager *mgr;
+  std::vector<std::thread> th;              /* Threads 1, ..., nt-1 */
+  std::unique_ptr<struct B_ParQueue[]> queue; /* Tasks per thread */
+  std::unique_ptr<struct B_ParBatch[]> batch; /* Free nodes per thread */
+  std::mutex m;             /* Sleeping workers wait on cv under m */
+  std::condition_variable cv;
+  std::atomic<unsigned> gen; /* Incremented when the workers are called */
+  std::atomic<int> active;  /* The workers steal tasks while nonzero */
+  std::atomic<int> busy;    /* Workers not yet left the operation */
+  std::atomic<int> stop;    /* The workers quit if nonzero */
+  int woken;                /* The workers are called in this operation */
+  std::mutex ovf;           /* Guards RFC-table */
+  std::mutex alloc;         /* Guards the free list and the node table */
+  std::unique_ptr<std::mutex[]> varlock;    /* Guards the unique tables */
+  bddvar nvarlock;
+  std::unique_ptr<std::atomic<int>[]> cachelock; /* Spin locks of Cache */
+  std::vector<unsigned char *> oldepoch; /* NodeEpoch replaced meanwhile */
+  int full;                 /* The node table could not be enlarged */
+  int enlarged;             /* The node table is enlarged meanwhile */
+  std::mutex exm;
+  std::exception_ptr ex;    /* The first exception of the threads */
 };
-static struct B_MPTable mptable[B_MP_LMAX] = {{0, 0, NULL}}; /* MP-Count Table */
 
-struct B_MP
+/* Index of this thread in the pool of the running parallel apply */
+static thread_local int B_ParSelf = 0;
+
+/* Spin lock over a set of the operation cache, taken only by the
+ * parallel apply (par != 0) */
+struct B_ParCacheLock
 {
-  int len;
-  bddp word[B_MP_LMAX];
+  std::atomic<int> *l;
+  B_ParCacheLock(int par, struct B_CacheTable *setp)
+  {
+    l = 0;
+    if(!par) return;
+    l = &ParPool->cachelock[(size_t)(setp - Cache) / CacheWays &
+                            (B_PAR_LOCKS - 1U)];
+    while(l->exchange(1, std::memory_order_acquire))
+      while(l->load(std::memory_order_relaxed)) ;
+  }
+  ~B_ParCacheLock(void) { if(l) l->store(0, std::memory_order_release); }
 };
 
+/* Counts a cache statistic, atomically in the parallel apply (P = 1) */
+#define B_STAT_INC(x) \
+  (P? __atomic_fetch_add(&(x), 1ULL, __ATOMIC_RELAXED): (x)++)
+
 /* ----- Declaration of static (internal) functions ------ */
 /* Private procedure */
 static int  err(const char *msg, bddp num, ExceptionType exType);
 static int  rfc_inc_ovf(struct B_NodeTable *np);
 static int  rfc_dec_ovf(struct B_NodeTable *np);
+static void releasetables(void);
 static void var_enlarge(void);
 static int  node_enlarge(void);
+static struct B_NodeTable *node_alloc(void);
+static void node_release(void);
+static int  node_commit(bddp spc);
 static int  hash_enlarge(bddvar v);
-static bddp getnode(bddvar v, bddp f0, bddp f1);
-static bddp getbddp(bddvar v, bddp f0, bddp f1);
-static bddp getzddp(bddvar v, bddp f0, bddp f1);
-static bddp apply(bddp f, bddp g, unsigned char op, unsigned char skip);
+static void hash_create(struct B_VarTable *varp);
+static void hash_reserve(bddvar v);
+static bddp ut_lookup(struct B_VarTable *varp, bddp f0, bddp f1);
+static void ut_insert(struct B_VarTable *varp, bddp ix, bddp f0, bddp f1);
+static void ut_remove(struct B_VarTable *varp, bddp ix, bddp f0, bddp f1);
+static B_OAEntry oa_hash(bddp f0, bddp f1);
+static int  oa_rehash(struct B_VarTable *varp, bddp newSpc);
+/* The functions with "template<int P>" are instantiated for the
+ * sequential operations (P = 0, the default) and for the threads of
+ * the parallel apply (P = 1). */
+template<int P = 0> static bddp getnode(bddvar v, bddp f0, bddp f1);
+template<int P = 0> static bddp getbddp(bddvar v, bddp f0, bddp f1);
+template<int P = 0> static bddp getzddp(bddvar v, bddp f0, bddp f1);
+template<int P = 0> static void rfc_free(bddp f);
+template<int P = 0>
+static bddp apply(bddp f, bddp g, unsigned char op, unsigned char skip,
+                  bddp k = bddfalse);
+static int  bfs_term(unsigned char op, bddp *f, bddp *g, bddp *h, char *neg);
+static int  bfs_large(bddp f, bddp g);
+static bddp apply_bfs(bddp f, bddp g, unsigned char op);
+static bddp apply2(bddp f, bddp g, unsigned char op);
 static void gc1(struct B_NodeTable *np);
+static int  gc_collect(void);
+static void gc_parallel(void);
+static int  rfc_dec_atomic(struct B_NodeTable *np, std::mutex &ovf);
+static int  rfc_inc_par(struct B_NodeTable *np);
+static int  rfc_dec_par(struct B_NodeTable *np);
+static bddp getnode_par(bddvar v, bddp f0, bddp f1);
+static bddp par_node(void);
+static bddp apply_par(bddp f, bddp g, unsigned char op);
+static void par_release(void);
+static void ut_sweep(struct B_VarTable *varp);
+static void ut_migrate(struct B_VarTable *varp, bddp n);
+static void oa_delete(struct B_VarTable *varp, bddp i);
+static void cache_sweep(void);
+static int  cache_alive(struct B_CacheTable *cachep, unsigned char epoch);
+static int  cache3_alive(struct B_Cache3Table *cache3p, unsigned char epoch);
+static void cache_newcycle(void);
+static int  visit(bddp f);
 static bddp count(bddp f);
 static void dump(bddp f);
-static void reset(bddp f);
 static void export_static(FILE *strm, bddp f);
-static int import(FILE *strm, bddp *p, int lim, int z);
+static int import(BDD_Tokenizer &tk, bddp *p, int lim, int z);
 static int andfalse(bddp f, bddp g);
+static bddp compose(bddp f, const std::vector<bddp> &sub, char z);
+static bddp nary(std::vector<bddp> &fs, unsigned char op);
+static void naryoperands(const char *name, const bddp *fs, int n);
+static size_t count_node(bddp f);
+static void cardmp(bddp f, std::vector<unsigned long long> &w, const char *name);
+static void count_sweep(void);
+static bddp nodelist(bddp f, std::vector<struct bddnode> &list);
+static void ut_nodes(struct B_VarTable *varp, std::vector<bddp> &nodes);
+static void swap_split(bddp f, bddvar v, char z, bddp *f0, bddp *f1);
+static void swap_free(bddp f);
+static long long swaplev(bddvar lev);
+static bddvar group_bottom(bddvar lev);
+static long long swap_groups(bddvar lev, bddvar s, bddvar t);
+static bddp sift_cost(long long zused);
+static void sift(bddvar v, long long *zused);
+static void cache_clear(void);
 
-static int mp_add(struct B_MP *p, bddp ix);
 
 static void setcacheratiovalue(double cacheRatio);
 static bool allocatecache();
+template<int P = 0>
+static struct B_CacheTable *cache_find(unsigned char op, bddp f, bddp g);
+template<int P = 0>
+static int  cache_get(unsigned char op, bddp f, bddp g, bddp *h);
+static int  cache_peek(unsigned char op, bddp f, bddp g);
+template<int P = 0>
+static void cache_store(unsigned char op, bddp f, bddp g, bddp h);
+template<int P = 0>
+static struct B_Cache3Table *cache3_find(unsigned char op, bddp f, bddp g, bddp k);
+template<int P = 0>
+static void cache3_store(unsigned char op, bddp f, bddp g, bddp k, bddp h);
 static void fprintf_check(FILE *strm, const char *format, ...);
 
 /* ------------------ Body of program -------------------- */
 /* ----------------- External functions ------------------ */
-int bddinit(bddp initsize, bddp limitsize, double cacheRatio)
-/* Returns 1 if not enough memory (usually 0) */
+int bddinit(bddp initsize, bddp limitsize, double cacheRatio, int threads)
+/* Returns 1 if not enough memory (usually 0). The binary operations
+ * are run by the given number of threads. */
 {
   bddp   ix;
   bddvar i;
   bool cacheallocated = false;
 
+  if(threads < 1)
+    err("bddinit: Illegal number of threads", threads, ExceptionType::OutOfRange);
+
   /* Set cache ratio if specified */
   if(cacheRatio > 0.0) {
     /* throw an exeption if cacheRatio is illegal */
@@ -284,20 +766,12 @@ int bddinit(bddp initsize, bddp limitsize, double cacheRatio)
   }
 
   /* Check dupulicate initialization */
-  if(Node){ free(Node); Node = 0; }
-  if(Var)
-  {
-    for(i=0; i<VarSpc; i++)
-    {
-      if(Var[i].hash_32) free(Var[i].hash_32);
-#ifndef B_32
-      if(Var[i].hash_h8) free(Var[i].hash_h8);
-#endif
-    }
-    free(Var); Var = 0;
-  }
-  if(VarID){ free(VarID); VarID = 0; }
-  if(Cache){ free(Cache); Cache = 0; }
+  releasetables();
+  UTType = UTNext;
+  NTType = NTNext;
+  ApplyThreads = threads;
+  /* The node table of the parallel apply is enlarged in place */
+  if(threads > 1 && NTType == BDD_NT_MALLOC) NTType = BDD_NT_MMAP;
 
   /* Set NodeLimit */
   if(limitsize < B_NODE_SPC0) NodeLimit = B_NODE_SPC0;
@@ -313,19 +787,23 @@ int bddinit(bddp initsize, bddp limitsize, double cacheRatio)
   VarSpc = B_VAR_SPC0;
 
   /* Memory allocation */
-  Node = B_MALLOC(struct B_NodeTable, NodeSpc);
+  Node = node_alloc();
+  NodeEpoch = (unsigned char *)calloc(NodeSpc, 1);
   Var = B_MALLOC(struct B_VarTable, VarSpc);
   VarID = B_MALLOC(bddvar, VarSpc);
   CacheSpc = 0;
   cacheallocated = allocatecache();
 
   /* Check overflow */
-  if(Node == 0 || Var == 0 || VarID == 0 || !cacheallocated)
+  if(Node == 0 || NodeEpoch == 0 || Var == 0 || VarID == 0 || !cacheallocated)
   {
-    if(Cache){ free(Cache); Cache = 0; CacheSpc = 0; }
+    if(CacheMem){ free(CacheMem); CacheMem = 0; Cache = 0; CacheSpc = 0; }
+    if(CacheEpoch){ free(CacheEpoch); CacheEpoch = 0; }
+    if(Cache3){ free(Cache3); Cache3 = 0; Cache3Spc = 0; }
+    if(NodeEpoch){ free(NodeEpoch); NodeEpoch = 0; }
     if(VarID){ free(VarID); VarID = 0; }
     if(Var){ free(Var); Var = 0; }
-    if(Node){ free(Node); Node = 0; }
+    node_release();
     NodeLimit = 0;
     err("bddinit: Memory allocation failed", 0, ExceptionType::OutOfMemory);
     return 1;
@@ -341,6 +819,8 @@ int bddinit(bddp initsize, bddp limitsize, double cacheRatio)
     B_SET_BDDP(Node[ix].nx, ix+1U);
   }
   Avail = 0;
+  GCEpoch = 1;
+  ReorderNext = ReorderLimit;
 
   VarUsed = 0;
   for(i=0; i<VarSpc; i++)
@@ -353,21 +833,21 @@ int bddinit(bddp initsize, bddp limitsize, double cacheRatio)
 #ifndef B_32
     Var[i].hash_h8 = 0;
 #endif
+    Var[i].oa = 0;
+    Var[i].old_32 = 0;
+#ifndef B_32
+    Var[i].old_h8 = 0;
+#endif
+    Var[i].oldSpc = 0;
+    Var[i].moved = 0;
+    Var[i].gsize = 1;
+    Var[i].gfix = 0;
   }
 
   /* Init RFC Table */
-  if(RFCT){ free(RFCT); RFCT = 0; }
   RFCT_Spc = 0;
   RFCT_Used = 0;
 
-  /* Init MP-Count Table */
-  for(i=0; i<B_MP_LMAX; i++)
-  {
-    mptable[i].size = 0;
-    mptable[i].used = 0;
-    if(mptable[i].word) { free(mptable[i].word); mptable[i].word = 0; }
-  }
-
   return 0;
 }
 
@@ -384,7 +864,11 @@ bddp bddcopy(bddp f)
   return f;
 }
 
-void bddfree(bddp f)
+void bddfree(bddp f) { rfc_free(f); }
+
+template<int P>
+static inline void rfc_free(bddp f)
+/* bddfree(), also run by the threads of the parallel apply */
 {
   struct B_NodeTable *fp;
 
@@ -393,15 +877,34 @@ void bddfree(bddp f)
   fp = B_NP(f);
   if(fp >= Node+NodeSpc || fp->varrfc == 0)
     err("bddfree: Invalid bddp", f, ExceptionType::InvalidBDDValue);
-  B_RFC_DEC_NP(fp);
+  B_RFC_DEC_P(fp);
 }
 
 int bddgc()
 /* Returns 1 if there are no free node (usually 0) */
 {
-  bddp i, n, f;
+  bddp n;
+  int r;
+  double sec;
+  std::chrono::steady_clock::time_point start;
+
+  start = std::chrono::steady_clock::now();
+  n = NodeUsed;
+  r = gc_collect();
+  sec = std::chrono::duration<double>(
+          std::chrono::steady_clock::now() - start).count();
+  GCStat.count++;
+  GCStat.freed += n - NodeUsed;
+  GCStat.time += sec;
+  GCStat.lasttime = sec;
+  return r;
+}
+
+static int gc_collect()
+/* Body of bddgc() */
+{
+  bddp i, n;
   struct B_NodeTable *fp;
-  struct B_CacheTable *cachep;
   struct B_NodeTable *np;
   struct B_VarTable *varp;
   bddvar v;
@@ -412,102 +915,31 @@ int bddgc()
 #endif
 
   n = NodeUsed; 
-  for(fp=Node; fp<Node+NodeSpc; fp++)
-    if(fp->varrfc != 0 && B_RFC_ZERO_NP(fp))
-      gc1(fp);
+  if(GCThreads > 1) gc_parallel();
+  else
+    for(fp=Node; fp<Node+NodeSpc; fp++)
+      if(fp->varrfc != 0 && B_RFC_ZERO_NP(fp))
+        gc1(fp);
 
   bddp freedNodes = n - NodeUsed;
   if(freedNodes == 0) return 1; /* No free node */
 
+  /* Invalidate cache entries of the collected nodes */
+  if(GCMode == BDD_GC_FULL) cache_sweep();
+  if(CountMemo) count_sweep();
+  if(GCEpoch == B_EPOCH_MAX) cache_newcycle();
+  else GCEpoch++;
+
   /* Check if freed nodes count is below threshold */
   if(GCThreshold > 0 && freedNodes <= GCThreshold) {
     return 1;
   }
 
-  /* Cache clear */
-  for(cachep=Cache; cachep<Cache+CacheSpc; cachep++)
-  {
-    switch(cachep->op)
-    {
-    case BC_NULL:
-      break;
-    case BC_AND:
-    case BC_XOR:
-    case BC_INTERSEC:
-    case BC_UNION:
-    case BC_SUBTRACT:
-    case BC_CHANGE:
-      f = B_GET_BDDP(cachep->f);
-      if(!B_CST(f) && (fp=B_NP(f))<Node+NodeSpc && fp->varrfc == 0)
-      {
-        cachep->op = BC_NULL;
-        break;
-      }
-      f = B_GET_BDDP(cachep->g);
-      if(!B_CST(f) && (fp=B_NP(f))<Node+NodeSpc && fp->varrfc == 0)
-      {
-        cachep->op = BC_NULL;
-        break;
-      }
-      f = B_GET_BDDP(cachep->h);
-      if(!B_CST(f) && (fp=B_NP(f))<Node+NodeSpc && fp->varrfc == 0)
-      {
-        cachep->op = BC_NULL;
-        break;
-      }
-      break;
-    case BC_AT0:
-    case BC_AT1:
-    case BC_OFFSET:
-    case BC_ONSET:
-      f = B_GET_BDDP(cachep->f);
-      if(!B_CST(f) && (fp=B_NP(f))<Node+NodeSpc && fp->varrfc == 0)
-      {
-        cachep->op = BC_NULL;
-        break;
-      }
-      f = B_GET_BDDP(cachep->h);
-      if(!B_CST(f) && (fp=B_NP(f))<Node+NodeSpc && fp->varrfc == 0)
-      {
-        cachep->op = BC_NULL;
-        break;
-      }
-      break;
-    case BC_CARD:
-    case BC_LIT:
-    case BC_LEN:
-      f = B_GET_BDDP(cachep->f);
-      if(!B_CST(f) && (fp=B_NP(f))<Node+NodeSpc && fp->varrfc == 0)
-      {
-        cachep->op = BC_NULL;
-        break;
-      }
-      f = B_GET_BDDP(cachep->h);
-      if(f > bddnull)
-      {
-        cachep->op = BC_NULL;
-        break;
-      }
-      break;
-    default:
-      cachep->op = BC_NULL;
-      break;
-    }
-  }
-
-  /* MP-Count table clear */
-  for(i=0; i<B_MP_LMAX; i++)
-  {
-    mptable[i].size = 0;
-    mptable[i].used = 0;
-    free(mptable[i].word);
-    mptable[i].word = 0;
-  }
-
   /* Hash-table packing */
   for(v=1; v<=VarUsed; v++)
   {
     varp = &Var[v];
+    if(varp->oldSpc != 0) ut_migrate(varp, varp->oldSpc);
 
     /* Get new size */
     oldSpc = varp->hashSpc;
@@ -519,6 +951,12 @@ int bddgc()
     }
     if(newSpc == oldSpc) continue;
 
+    if(UTType == BDD_UT_OPEN)
+    {
+      if(oa_rehash(varp, newSpc)) break; /* Not enough memory */
+      continue;
+    }
+
     /* Reduce space */
 #ifndef B_32
     newhash_32 = 0;
@@ -575,66 +1013,292 @@ int bddgc()
   return 0;
 }
 
-bddp bddused() { return NodeUsed; }
-
-bddp bddsize(bddp f)
-/* Returns 0 for bddnull */
-{
-  bddp num;
-  struct B_NodeTable *fp;
-
-  if(f == bddnull) return 0;
-  if(B_CST(f)) return 0; /* Constant */
-  if((fp=B_NP(f))>=Node+NodeSpc || fp->varrfc == 0)
-    err("bddsize: Invalid bddp", f, ExceptionType::InvalidBDDValue);
-
-  num = count(f);
-  reset(f);
-  return num;
-}
-
-bddp bddvsize(bddp *p, int lim)
-/* Returns 0 for bddnull */
+bddp bddcompact(int order)
+/* Renumbers the live nodes in the given order (BDD_COMPACT_*), so that
+ * the nodes used together are close in Node, and rewrites the registered
+ * variables. With BDD_COMPACT_MOVE, the other references are taken as
+ * BDD and ZDD objects, which follow through bddmfwd. Returns the number
+ * of moved nodes */
 {
-  bddp num;
-  struct B_NodeTable *fp;
-  int n, i;
+  std::vector<bddp> par, fwd, list;
+  std::vector<char> pin;
+  std::vector<struct B_NodeTable> rec;
+  struct B_NodeTable *np;
+  struct B_VarTable *varp;
+  bddp ix, f, slot, moved;
+  bddp_32 *p_32;
+#ifndef B_32
+  bddp_h8 *p_h8;
+#endif
+  bddvar v;
+  size_t i;
+  int move;
+  B_StackScope<bddp> scope(B_Stack);
+
+  move = order & BDD_COMPACT_MOVE;
+  order &= ~BDD_COMPACT_MOVE;
+  if(order != BDD_COMPACT_DFS && order != BDD_COMPACT_LEVEL)
+    err("bddcompact: Illegal order", order, ExceptionType::OutOfRange);
+  bddgc();
+  if(Roots)
+    for(bddp *p: *Roots)
+      if(*p != bddnull && !B_CST(*p) &&
+         (B_NDX(*p) >= NodeSpc || B_NP(*p)->varrfc == 0))
+        err("bddcompact: Invalid bddp", *p, ExceptionType::InvalidBDDValue);
+
+  /* References from the parents and the registered variables. A node
+   * with more references is also held by a bddp unknown here (such as a
+   * BDD object), and it is pinned to its index unless move, as well as a
+   * node whose counter has overflowed to RFCT (which is keyed by the
+   * index). */
+  par.assign(NodeSpc, 0);
+  for(np=Node; np<Node+NodeSpc; np++)
+  {
+    if(np->varrfc == 0) continue;
+    f = B_GET_BDDP(np->f0);
+    if(!B_CST(f)) par[B_NDX(f)]++;
+    f = B_GET_BDDP(np->f1);
+    if(!B_CST(f)) par[B_NDX(f)]++;
+  }
+  if(Roots)
+    for(bddp *p: *Roots)
+      if(*p != bddnull && !B_CST(*p)) par[B_NDX(*p)]++;
+  pin.assign(NodeSpc, 0);
+  for(ix=0; ix<NodeSpc; ix++)
+  {
+    np = Node + ix;
+    if(np->varrfc != 0 && (np->varrfc >= B_RFC_MASK - B_RFC_UNIT ||
+                           (!move && B_RFC_NP(np) > par[ix])))
+      pin[ix] = 1;
+  }
 
-  /* Check operand */
-  n = lim;
-  for(i=0; i<n; i++)
+  /* Depth-first order from the registered variables and the pinned
+   * nodes, the 0-child first. fwd[ix] != bddnull marks a listed node. */
+  fwd.assign(NodeSpc, bddnull);
+  auto dfs = [&](bddp r)
   {
-    if(p[i] == bddnull)
+    if(r == bddnull || B_CST(r) || fwd[B_NDX(r)] != bddnull) return;
+    B_Stack.push_back(B_NDX(r));
+    while(B_Stack.size() > scope.base)
     {
-      n = i;
-      break;
+      ix = B_Stack.back();
+      B_Stack.pop_back();
+      if(fwd[ix] != bddnull) continue;
+      fwd[ix] = ix;
+      list.push_back(ix);
+      f = B_GET_BDDP(Node[ix].f1);
+      if(!B_CST(f) && fwd[B_NDX(f)] == bddnull) B_Stack.push_back(B_NDX(f));
+      f = B_GET_BDDP(Node[ix].f0);
+      if(!B_CST(f) && fwd[B_NDX(f)] == bddnull) B_Stack.push_back(B_NDX(f));
     }
-    if(!B_CST(p[i])&&
-       ((fp=B_NP(p[i]))>=Node+NodeSpc || fp->varrfc==0))
-      err("bddvsize: Invalid bddp", p[i], ExceptionType::InvalidBDDValue);
+  };
+  list.reserve(NodeUsed);
+  if(Roots) for(bddp *p: *Roots) dfs(*p);
+  for(ix=0; ix<NodeSpc; ix++) if(pin[ix]) dfs(ix << 1U);
+  for(ix=0; ix<NodeSpc; ix++) if(Node[ix].varrfc != 0) dfs(ix << 1U);
+  if(order == BDD_COMPACT_LEVEL)
+    std::stable_sort(list.begin(), list.end(), [](bddp a, bddp b)
+      { return Var[B_VAR_NP(Node+a)].lev > Var[B_VAR_NP(Node+b)].lev; });
+
+  /* New indices from 0 in the order, skipping the pinned nodes */
+  slot = 0;
+  moved = 0;
+  for(i=0; i<list.size(); i++)
+  {
+    ix = list[i];
+    if(pin[ix]) continue;
+    while(pin[slot]) slot++;
+    fwd[ix] = slot++;
+    if(fwd[ix] != ix) moved++;
   }
-  num = 0;
-  for(i=0; i<n; i++) num += count(p[i]);
-  for(i=0; i<n; i++) reset(p[i]);
-  return num;
-}
 
-void bddexport(FILE *strm, bddp *p, int lim)
-{
-  struct B_NodeTable *fp;
-  int n, i, lev, lev0;
+  /* Move the nodes with their edges rewritten */
+  auto remap = [&](bddp r)
+  {
+    return B_CST(r)? r: (fwd[B_NDX(r)] << 1U) | B_NEG(r);
+  };
+  rec.resize(list.size());
+  for(i=0; i<list.size(); i++) rec[i] = Node[list[i]];
+  for(ix=0; ix<NodeSpc; ix++) if(!pin[ix]) Node[ix].varrfc = 0;
+  for(i=0; i<list.size(); i++)
+  {
+    np = Node + fwd[list[i]];
+    *np = rec[i];
+    B_SET_BDDP(np->f0, remap(B_GET_BDDP(rec[i].f0)));
+    B_SET_BDDP(np->f1, remap(B_GET_BDDP(rec[i].f1)));
+  }
 
-  /* Check operands */
-  n = lim;
-  lev = 0;
-  for(i=0; i<n; i++)
+  /* Rebuild the unique tables, whose chains are in ascending order */
+  for(v=1; v<=VarUsed; v++)
   {
-    if(p[i] == bddnull)
+    varp = &Var[v];
+    if(varp->hashSpc == 0) continue;
+    if(UTType == BDD_UT_OPEN)
     {
-      n = i;
-      break;
+      memset(varp->oa, 0, sizeof(B_OAEntry) * varp->hashSpc);
+      continue;
     }
-    if(!B_CST(p[i])&&
+    if(varp->oldSpc != 0) ut_migrate(varp, varp->oldSpc);
+    for(ix=0; ix<varp->hashSpc; ix++)
+    {
+      B_SET_NXP(p, varp->hash, ix);
+      B_SET_BDDP(*p, bddnull);
+    }
+  }
+  for(ix=NodeSpc; ix>0; ix--)
+  {
+    np = Node + ix - 1U;
+    if(np->varrfc == 0) continue;
+    ut_insert(&Var[B_VAR_NP(np)], ix - 1U,
+              B_GET_BDDP(np->f0), B_GET_BDDP(np->f1));
+  }
+
+  /* The free nodes are used from the lowest index */
+  Avail = bddnull;
+  for(ix=NodeSpc; ix>0; ix--)
+  {
+    np = Node + ix - 1U;
+    if(np->varrfc != 0) continue;
+    B_SET_BDDP(np->nx, Avail);
+    Avail = ix - 1U;
+  }
+
+  if(Roots)
+    for(bddp *p: *Roots)
+      if(*p != bddnull) *p = remap(*p);
+
+  /* Keep fwd for the objects holding the moved nodes */
+  if(move)
+  {
+    struct B_FwdTable t;
+    t.epoch = ++BDD_FwdEpoch;
+    t.refs = 0;
+    for(i=0; i<list.size(); i++)
+    {
+      ix = list[i];
+      if(fwd[ix] != ix) t.refs += B_RFC_NP(Node + fwd[ix]) - par[ix];
+    }
+    if(t.refs != 0)
+    {
+      t.fwd.swap(fwd);
+      if(!FwdTables) FwdTables = new std::vector<struct B_FwdTable>;
+      FwdTables->push_back(std::move(t));
+    }
+  }
+  if(CountMemo)
+  {
+    CountMemo->pos.clear();
+    CountMemo->word.clear();
+    CountMemo->dead = 0;
+  }
+  cache_clear();
+  return moved;
+}
+
+bddp bddmfwd(struct BDDManager *m, bddp f, unsigned epoch)
+/* Renumbers f by the compactions of m since epoch (see BDD_FwdEpoch).
+ * f is a reference of an object, counted once in each of them. */
+{
+  bddp ix;
+  size_t i;
+
+  B_MgrScope ms(m);
+  if(!FwdTables || f == bddnull || B_CST(f)) return f;
+  for(struct B_FwdTable &t: *FwdTables)
+  {
+    if((int)(t.epoch - epoch) <= 0 || t.refs == 0) continue;
+    ix = B_NDX(f);
+    if(t.fwd[ix] == ix) continue;
+    f = (t.fwd[ix] << 1U) | B_NEG(f);
+    if(--t.refs == 0) std::vector<bddp>().swap(t.fwd);
+  }
+  for(i=0; i<FwdTables->size() && (*FwdTables)[i].refs == 0; i++) ;
+  FwdTables->erase(FwdTables->begin(), FwdTables->begin() + i);
+  return f;
+}
+
+void bddregroot(bddp *p)
+/* Registers the variable *p to be rewritten by bddcompact() */
+{
+  if(!Roots) Roots = new std::vector<bddp *>;
+  Roots->push_back(p);
+}
+
+void bddunregroot(bddp *p)
+/* Unregisters the variable *p registered last */
+{
+  size_t i;
+
+  if(Roots)
+    for(i=Roots->size(); i>0; i--)
+      if((*Roots)[i-1U] == p)
+      {
+        Roots->erase(Roots->begin() + (i-1U));
+        return;
+      }
+  err("bddunregroot: Unregistered variable", 0, ExceptionType::InvalidBDDValue);
+}
+
+bddp bddused() { return NodeUsed; }
+
+bddp bddsize(bddp f)
+/* Returns 0 for bddnull */
+{
+  bddp num;
+  struct B_NodeTable *fp;
+
+  if(f == bddnull) return 0;
+  if(B_CST(f)) return 0; /* Constant */
+  if((fp=B_NP(f))>=Node+NodeSpc || fp->varrfc == 0)
+    err("bddsize: Invalid bddp", f, ExceptionType::InvalidBDDValue);
+
+  B_VisitScope vs;
+  num = count(f);
+  return num;
+}
+
+bddp bddvsize(bddp *p, int lim)
+/* Returns 0 for bddnull */
+{
+  bddp num;
+  struct B_NodeTable *fp;
+  int n, i;
+
+  /* Check operand */
+  n = lim;
+  for(i=0; i<n; i++)
+  {
+    if(p[i] == bddnull)
+    {
+      n = i;
+      break;
+    }
+    if(!B_CST(p[i])&&
+       ((fp=B_NP(p[i]))>=Node+NodeSpc || fp->varrfc==0))
+      err("bddvsize: Invalid bddp", p[i], ExceptionType::InvalidBDDValue);
+  }
+  B_VisitScope vs;
+  num = 0;
+  for(i=0; i<n; i++) num += count(p[i]);
+  return num;
+}
+
+void bddexport(FILE *strm, bddp *p, int lim)
+{
+  struct B_NodeTable *fp;
+  int n, i, lev, lev0;
+
+  /* Check operands */
+  n = lim;
+  lev = 0;
+  for(i=0; i<n; i++)
+  {
+    if(p[i] == bddnull)
+    {
+      n = i;
+      break;
+    }
+    if(!B_CST(p[i])&&
        ((fp=B_NP(p[i]))>=Node+NodeSpc || fp->varrfc==0))
       err("bddvexport: Invalid bddp", p[i], ExceptionType::InvalidBDDValue);
     lev0 = bddlevofvar(bddtop(p[i]));
@@ -646,8 +1310,10 @@ void bddexport(FILE *strm, bddp *p, int lim)
   fprintf_check(strm, "\n");
 
   /* Put internal nodes */
-  for(i=0; i<n; i++) export_static(strm, p[i]);
-  for(i=0; i<n; i++) reset(p[i]);
+  {
+    B_VisitScope vs;
+    for(i=0; i<n; i++) export_static(strm, p[i]);
+  }
 
   /* Put external node */
   for(i=0; i<n; i++)
@@ -670,8 +1336,10 @@ void bdddump(bddp f)
       err("bdddump: Invalid bddp", f, ExceptionType::InvalidBDDValue);
 
   /* Dump nodes */
-  dump(f);
-  reset(f);
+  {
+    B_VisitScope vs;
+    dump(f);
+  }
 
   /* Dump top node */
   printf("RT = ");
@@ -696,8 +1364,10 @@ void bddvdump(bddp *p, int n)
   }
 
   /* Dump nodes */
-  for(i=0; i<n; i++) if(p[i] != bddnull) dump(p[i]);
-  for(i=0; i<n; i++) if(p[i] != bddnull) reset(p[i]);
+  {
+    B_VisitScope vs;
+    for(i=0; i<n; i++) if(p[i] != bddnull) dump(p[i]);
+  }
 
   /* Dump top node */
   for(i=0; i<n; i++)
@@ -719,25 +1389,16 @@ bddp bddrcache(unsigned char op, bddp f, bddp g)
 {
   struct B_CacheTable *cachep;
 
-  cachep = Cache + B_CACHEKEY(op, f, g);
-  if(op == cachep->op &&
-     f == B_GET_BDDP(cachep->f) &&
-     g == B_GET_BDDP(cachep->g))
-    return B_GET_BDDP(cachep->h); /* Hit */
+  cachep = cache_find(op, f, g);
+  if(cachep) return B_GET_BDDP(cachep->h); /* Hit */
   return bddnull;
 }
 
 void bddwcache(unsigned char op, bddp f, bddp g, bddp h)
 {
-  struct B_CacheTable *cachep;
-
   if(op < 20) err("bddwcache: op < 20", op, ExceptionType::OutOfRange);
   if(h == bddnull) return;
-  cachep = Cache + B_CACHEKEY(op, f, g);
-  cachep->op = op;
-  B_SET_BDDP(cachep->f, f);
-  B_SET_BDDP(cachep->g, g);
-  B_SET_BDDP(cachep->h, h);
+  cache_store(op, f, g, h);
 }
 
 bddp bddnot(bddp f)
@@ -778,11 +1439,110 @@ bddvar bddnewvaroflev(bddvar lev)
   if(lev == 0 || lev > ++VarUsed)
     err("bddnewvaroflev: Invalid level", lev, ExceptionType::OutOfRange);
   if(VarUsed == VarSpc) var_enlarge();
+  /* The new variable joins the group it is inserted into */
+  if(lev < VarUsed && Var[VarID[lev]].gsize == 0)
+  {
+    Var[VarID[group_bottom(lev)]].gsize++;
+    Var[VarUsed].gsize = 0;
+  }
   for(i=VarUsed; i>lev; i--) Var[ VarID[i] = VarID[i-1U] ].lev = i;
   Var[ VarID[lev] = VarUsed ].lev = lev;
   return VarUsed;
 }
 
+void bddswaplev(bddvar lev)
+/* Swaps the variables of lev and lev+1 */
+{
+  if(lev == 0 || lev >= VarUsed)
+    err("bddswaplev: Invalid level", lev, ExceptionType::OutOfRange);
+  if(Var[VarID[lev]].gsize != 1 || Var[VarID[lev]].gfix ||
+     Var[VarID[lev+1U]].gsize != 1 || Var[VarID[lev+1U]].gfix)
+    err("bddswaplev: Grouped variable", lev, ExceptionType::OutOfRange);
+
+  /* Dead nodes may be linked to the nodes being swapped */
+  bddgc();
+  swaplev(lev);
+  cache_clear();
+}
+
+bddp bddreorder()
+/* Reorders the variables by sifting. Returns the number of nodes */
+{
+  std::vector<std::pair<bddp, bddvar> > groups;
+  struct B_NodeTable *np;
+  bddvar lev, l;
+  bddp n;
+  long long zused;
+  size_t i;
+
+  if(VarUsed < 2) return NodeUsed;
+  bddgc();
+
+  /* Count the ZDD nodes for the cost */
+  zused = 0;
+  if(ReorderCost != BDD_REORDER_ALL)
+    for(np=Node; np<Node+NodeSpc; np++)
+      if(np->varrfc != 0 && B_Z_NP(np)) zused++;
+
+  /* Sift the groups with more nodes first */
+  for(lev=1; lev<=VarUsed; lev+=Var[VarID[lev]].gsize)
+  {
+    if(Var[VarID[lev]].gfix) continue;
+    n = 0;
+    for(l=lev; l<lev+Var[VarID[lev]].gsize; l++) n += Var[VarID[l]].hashUsed;
+    groups.push_back(std::make_pair(n, VarID[lev]));
+  }
+  std::stable_sort(groups.begin(), groups.end(),
+    [](const std::pair<bddp, bddvar> &a, const std::pair<bddp, bddvar> &b)
+      { return a.first > b.first; });
+  for(i=0; i<groups.size(); i++) sift(groups[i].second, &zused);
+  cache_clear();
+  return NodeUsed;
+}
+
+void bddvargroup(bddvar lev, bddvar n, int type)
+/* Makes a group of n variables from lev, which is kept by reordering */
+{
+  bddvar l, top;
+  char fix;
+
+  if(lev == 0 || n == 0 || lev > VarUsed || n > VarUsed - lev + 1U)
+    err("bddvargroup: Invalid level", lev, ExceptionType::OutOfRange);
+  if(type != BDD_GROUP_MOVE && type != BDD_GROUP_FIX)
+    err("bddvargroup: Invalid type", type, ExceptionType::OutOfRange);
+  top = lev + n;
+  if(Var[VarID[lev]].gsize == 0 ||
+     (top <= VarUsed && Var[VarID[top]].gsize == 0))
+    err("bddvargroup: Crossing another group", lev, ExceptionType::OutOfRange);
+
+  /* The groups in the range are merged */
+  fix = (type == BDD_GROUP_FIX);
+  for(l=lev; l<top; l+=Var[VarID[l]].gsize)
+    if(Var[VarID[l]].gfix) fix = 1;
+  for(l=lev+1U; l<top; l++)
+  {
+    Var[VarID[l]].gsize = 0;
+    Var[VarID[l]].gfix = 0;
+  }
+  Var[VarID[lev]].gsize = n;
+  Var[VarID[lev]].gfix = fix;
+}
+
+void bddsetreordercost(int cost)
+/* Set the nodes counted by reordering (BDD_REORDER_*) */
+{
+  if(cost != BDD_REORDER_ALL && cost != BDD_REORDER_ZDD &&
+     cost != BDD_REORDER_BDD)
+    err("bddsetreordercost: Invalid cost", cost, ExceptionType::OutOfRange);
+  ReorderCost = cost;
+}
+
+int bddgetreordercost(void)
+/* Get the nodes counted by reordering */
+{
+  return ReorderCost;
+}
+
 bddvar bddtop(bddp f)
 {
   struct B_NodeTable *fp;
@@ -831,7 +1591,7 @@ bddp bddand(bddp f, bddp g)
     if(B_Z_NP(fp)) err("bddand: applying ZDD node", g, ExceptionType::InvalidBDDValue);
   }
 
-  return apply(f, g, BC_AND, 0);
+  return apply2(f, g, BC_AND);
 }
 
 bddp bddor(bddp f, bddp g)
@@ -873,7 +1633,7 @@ bddp bddxor(bddp f, bddp g)
     if(B_Z_NP(fp)) err("bddand: applying ZDD node", g, ExceptionType::InvalidBDDValue);
   }
 
-  return apply(f, g, BC_XOR, 0);
+  return apply2(f, g, BC_XOR);
 }
 
 bddp bddnand(bddp f, bddp g)
@@ -901,6 +1661,32 @@ bddp bddxnor(bddp f, bddp g)
   return bddxor(f, B_NOT(g));
 }
 
+bddp bddite(bddp f, bddp g, bddp h)
+/* Returns (f & g) | (~f & h), or bddnull if not enough memory */
+{
+  struct B_NodeTable *fp;
+  bddp op[3];
+  int i;
+
+  /* Check operands */
+  op[0] = f; op[1] = g; op[2] = h;
+  for(i=0; i<3; i++)
+  {
+    if(op[i] == bddnull) return bddnull;
+    if(B_CST(op[i]))
+    { if(B_ABS(op[i]) != bddfalse) err("bddite: Invalid bddp", op[i], ExceptionType::InvalidBDDValue); }
+    else
+    {
+      fp = B_NP(op[i]);
+      if(fp>=Node+NodeSpc || !fp->varrfc)
+        err("bddite: Invalid bddp", op[i], ExceptionType::InvalidBDDValue);
+      if(B_Z_NP(fp)) err("bddite: applying ZDD node", op[i], ExceptionType::InvalidBDDValue);
+    }
+  }
+
+  return apply(f, g, BC_ITE, 0, h);
+}
+
 bddp bddcofactor(bddp f, bddp g)
 /* Returns bddnull if not enough memory */
 {
@@ -973,6 +1759,33 @@ bddp bddexist(bddp f, bddp g)
   return B_NOT(h);
 }
 
+bddp bddandexist(bddp f, bddp g, bddp c)
+/* Returns bddexist(bddand(f, g), c) without building bddand(f, g),
+ * or bddnull if not enough memory */
+{
+  struct B_NodeTable *fp;
+  bddp op[3];
+  int i;
+
+  /* Check operands */
+  op[0] = f; op[1] = g; op[2] = c;
+  for(i=0; i<3; i++)
+  {
+    if(op[i] == bddnull) return bddnull;
+    if(B_CST(op[i]))
+    { if(B_ABS(op[i]) != bddfalse) err("bddandexist: Invalid bddp", op[i], ExceptionType::InvalidBDDValue); }
+    else
+    {
+      fp = B_NP(op[i]);
+      if(fp>=Node+NodeSpc || !fp->varrfc)
+        err("bddandexist: Invalid bddp", op[i], ExceptionType::InvalidBDDValue);
+      if(B_Z_NP(fp)) err("bddandexist: applying ZDD node", op[i], ExceptionType::InvalidBDDValue);
+    }
+  }
+
+  return apply(f, g, BC_ANDEXIST, 0, c);
+}
+
 int bddimply(bddp f, bddp g)
 {
   struct B_NodeTable *fp;
@@ -1083,6 +1896,188 @@ bddp bddrshift(bddp f, bddvar shift)
   return apply(f, (bddp)shift, BC_RSHIFT, 0);
 }
 
+bddp bddvectorcompose(bddp f, const bddp *vec, int lim)
+/* Substitutes vec[v] for each variable v (0 < v < lim) of f at once.
+ * The variables with bddnull or out of vec are kept.
+ * Returns bddnull if not enough memory */
+{
+  struct B_NodeTable *fp;
+  std::vector<bddp> sub;
+  bddvar v;
+  bddp h;
+
+  /* Check operands */
+  if(lim < 0) err("bddvectorcompose: Invalid lim", lim, ExceptionType::OutOfRange);
+  if(f == bddnull) return bddnull;
+  if(B_CST(f)) return f;
+  fp = B_NP(f);
+  if(fp>=Node+NodeSpc || !fp->varrfc)
+    err("bddvectorcompose: Invalid bddp", f, ExceptionType::InvalidBDDValue);
+  if(B_Z_NP(fp)) err("bddvectorcompose: applying ZDD node", f, ExceptionType::InvalidBDDValue);
+  for(v=1; (int)v<lim; v++)
+  {
+    h = vec[v];
+    if(h == bddnull || B_CST(h)) continue;
+    fp = B_NP(h);
+    if(fp>=Node+NodeSpc || !fp->varrfc)
+      err("bddvectorcompose: Invalid bddp", h, ExceptionType::InvalidBDDValue);
+    if(B_Z_NP(fp)) err("bddvectorcompose: applying ZDD node", h, ExceptionType::InvalidBDDValue);
+  }
+
+  /* The kept variables are substituted by themselves */
+  sub.assign(VarUsed + 1, bddnull);
+  for(v=1; v<=VarUsed; v++)
+  {
+    if((int)v < lim && vec[v] != bddnull) { sub[v] = bddcopy(vec[v]); continue; }
+    sub[v] = bddprime(v);
+    if(sub[v] == bddnull) { while(--v) bddfree(sub[v]); return bddnull; }
+  }
+  try { h = compose(f, sub, 0); }
+  catch(...)
+  {
+    for(v=1; v<=VarUsed; v++) bddfree(sub[v]);
+    throw;
+  }
+  for(v=1; v<=VarUsed; v++) bddfree(sub[v]);
+  return h;
+}
+
+bddp bddpermute(bddp f, const bddvar *perm, int lim)
+/* Renames each variable v (0 < v < lim) of f to perm[v], where the
+ * renaming must be one-to-one. The variables with 0 or out of perm are
+ * kept. Both of BDD and ZDD are accepted.
+ * Returns bddnull if not enough memory */
+{
+  struct B_NodeTable *fp;
+  std::vector<bddp> sub;
+  std::vector<char> used;
+  bddvar v, w;
+  bddp h;
+
+  /* Check operands */
+  if(lim < 0) err("bddpermute: Invalid lim", lim, ExceptionType::OutOfRange);
+  sub.assign(VarUsed + 1, 0);
+  used.assign(VarUsed + 1, 0);
+  for(v=1; v<=VarUsed; v++)
+  {
+    w = ((int)v < lim && perm[v] != 0)? perm[v]: v;
+    if(w > VarUsed) err("bddpermute: Invalid VarID", w, ExceptionType::OutOfRange);
+    if(used[w]) err("bddpermute: Not a permutation", w, ExceptionType::OutOfRange);
+    used[w] = 1;
+    sub[v] = w;
+  }
+  if(f == bddnull) return bddnull;
+  if(B_CST(f)) return f;
+  fp = B_NP(f);
+  if(fp>=Node+NodeSpc || !fp->varrfc)
+    err("bddpermute: Invalid bddp", f, ExceptionType::InvalidBDDValue);
+  if(B_Z_NP(fp)) return compose(f, sub, 1);
+
+  /* BDD: substitutes the literals */
+  for(v=1; v<=VarUsed; v++)
+  {
+    w = (bddvar)sub[v];
+    sub[v] = bddprime(w);
+    if(sub[v] == bddnull) { while(--v) bddfree(sub[v]); return bddnull; }
+  }
+  try { h = compose(f, sub, 0); }
+  catch(...)
+  {
+    for(v=1; v<=VarUsed; v++) bddfree(sub[v]);
+    throw;
+  }
+  for(v=1; v<=VarUsed; v++) bddfree(sub[v]);
+  return h;
+}
+
+bddp bddnodelist(bddp f, struct bddnode *list, bddp lim)
+/* Stores the nodes of f into list[0], ..., list[n-1] from the lowest
+ * level, so that the children come before their parents, and returns n
+ * (the same as bddsize). Only lim entries are stored at most. The root
+ * is list[n-1], negated if f is. Returns 0 for bddnull. */
+{
+  struct B_NodeTable *fp;
+  std::vector<struct bddnode> l;
+  bddp i;
+
+  if(f == bddnull) return 0;
+  if(B_CST(f)) return 0;
+  fp = B_NP(f);
+  if(fp>=Node+NodeSpc || !fp->varrfc)
+    err("bddnodelist: Invalid bddp", f, ExceptionType::InvalidBDDValue);
+
+  nodelist(f, l);
+  for(i=0; i<lim && i<l.size(); i++) list[i] = l[i];
+  return l.size();
+}
+
+double bddprob(bddp f, const double *p)
+/* Returns the probability that f is true (BDD), or that the set of the
+ * true variables is in f (ZDD), where each variable v is true with the
+ * probability p[v] independently. A constant is taken as a BDD.
+ * Returns 0 for bddnull. */
+{
+  struct B_NodeTable *fp;
+  std::vector<struct bddnode> l;
+  std::vector<double> val, lz;
+  std::vector<bddvar> nz;
+  bddvar lev, lv, v;
+  bddp i, r, c;
+  double w[2];
+  int k;
+  char z;
+
+  if(f == bddnull) return 0;
+  if(B_CST(f)) return B_NEG(f)? 1: 0;
+  fp = B_NP(f);
+  if(fp>=Node+NodeSpc || !fp->varrfc)
+    err("bddprob: Invalid bddp", f, ExceptionType::InvalidBDDValue);
+  z = B_Z_NP(fp)? 1: 0;
+
+  /* lz[lev]: sum of log(1 - p) over the variables up to lev except those
+   * of p >= 1, which are counted by nz[lev]. The variables of the levels
+   * a < lev <= b are all false with the probability none(a, b), which is
+   * taken without the underflow of the plain products. */
+  lz.assign(VarUsed + 1, 0);
+  nz.assign(VarUsed + 1, 0);
+  for(lev=1; lev<=VarUsed; lev++)
+  {
+    v = VarID[lev];
+    lz[lev] = lz[lev-1] + ((p[v] < 1)? log1p(-p[v]): 0);
+    nz[lev] = nz[lev-1] + ((p[v] < 1)? 0: 1);
+  }
+  auto none = [&](bddvar a, bddvar b)
+    { return (nz[b] != nz[a])? 0: exp(lz[b] - lz[a]); };
+
+  /* val[i]: probability for the positive edge to list[i-1], taken on the
+   * variables up to its level for a ZDD and on all for a BDD */
+  r = nodelist(f, l);
+  val.resize(l.size() + 1);
+  val[0] = 0;
+  for(i=0; i<l.size(); i++)
+  {
+    v = l[i].v;
+    lev = Var[v].lev;
+    for(k=0; k<2; k++)
+    {
+      c = k? l[i].hi: l[i].lo;
+      w[k] = val[c>>1];
+      if(!z) { if(c & 1) w[k] = 1 - w[k]; continue; }
+
+      /* The skipped variables of a ZDD are false */
+      lv = (c>>1)? Var[l[(c>>1)-1].v].lev: 0;
+      if(c & 1) w[k] += none(0, lv);
+      w[k] *= none(lv, lev - 1);
+    }
+    val[i+1] = (1 - p[v]) * w[0] + p[v] * w[1];
+  }
+  w[0] = val[r>>1];
+  if(!z) return (r & 1)? 1 - w[0]: w[0];
+  lev = Var[l.back().v].lev;
+  if(r & 1) w[0] += none(0, lev);
+  return w[0] * none(lev, VarUsed);
+}
+
 bddp    bddoffset(bddp f, bddvar v)
 /* Returns bddnull if not enough memory */
 {
@@ -1174,7 +2169,7 @@ bddp bddintersec(bddp f, bddp g)
     if(!B_Z_NP(fp)) err("bddintersec: applying non-ZDD node", g, ExceptionType::InvalidBDDValue);
   }
 
-  return apply(f, g, BC_INTERSEC, 0);
+  return apply2(f, g, BC_INTERSEC);
 }
 
 bddp bddunion(bddp f, bddp g)
@@ -1204,7 +2199,7 @@ bddp bddunion(bddp f, bddp g)
     if(!B_Z_NP(fp)) err("bddunion: applying non-ZDD node", g, ExceptionType::InvalidBDDValue);
   }
 
-  return apply(f, g, BC_UNION, 0);
+  return apply2(f, g, BC_UNION);
 }
 
 bddp bddsubtract(bddp f, bddp g)
@@ -1234,44 +2229,221 @@ bddp bddsubtract(bddp f, bddp g)
     if(!B_Z_NP(fp)) err("bddsubtarct: applying non-ZDD node", g, ExceptionType::InvalidBDDValue);
   }
 
-  return apply(f, g, BC_SUBTRACT, 0);
+  return apply2(f, g, BC_SUBTRACT);
 }
 
-bddp bddcard(bddp f)
+bddp bddbfsapply(int op, bddp f, bddp g)
+/* Computes the operation (BDD_BFS_*) level by level.
+ * Returns bddnull if not enough memory */
 {
-  struct B_NodeTable *fp;
-
-  if(f == bddnull) return 0;
-  if(B_CST(f)) return (f == bddfalse)? 0: 1;
-  fp = B_NP(f);
-  if(fp>=Node+NodeSpc || !fp->varrfc)
-    err("bddcard: Invalid bddp", f, ExceptionType::InvalidBDDValue);
-  if(!B_Z_NP(fp)) err("bddcard: applying non-ZDD node", f, ExceptionType::InvalidBDDValue);
+  struct B_BFSScope
+  {
+    B_BFSScope(void) { B_BFSForce = 1; }
+    ~B_BFSScope(void) { B_BFSForce = 0; }
+  } scope;
 
-  return apply(f, bddfalse, BC_CARD, 0);
+  switch(op)
+  {
+  case BDD_BFS_AND: return bddand(f, g);
+  case BDD_BFS_OR: return bddor(f, g);
+  case BDD_BFS_XOR: return bddxor(f, g);
+  case BDD_BFS_INTERSEC: return bddintersec(f, g);
+  case BDD_BFS_UNION: return bddunion(f, g);
+  case BDD_BFS_SUBTRACT: return bddsubtract(f, g);
+  default:
+    err("bddbfsapply: Illegal operation", op, ExceptionType::OutOfRange);
+  }
+  return bddnull;
 }
 
-bddp bddlit(bddp f)
+bddp bddmult(bddp f, bddp g)
+/* Returns the set of a | b for a in f and b in g.
+ * Returns bddnull if not enough memory */
 {
   struct B_NodeTable *fp;
+  bddp op[2];
+  int i;
 
-  if(f == bddnull) return 0;
-  if(B_CST(f)) return 0;
-  fp = B_NP(f);
-  if(fp>=Node+NodeSpc || !fp->varrfc)
-    err("bddlit: Invalid bddp", f, ExceptionType::InvalidBDDValue);
-  if(!B_Z_NP(fp)) err("bddlit: applying non-ZDD node", f, ExceptionType::InvalidBDDValue);
+  /* Check operands */
+  op[0] = f; op[1] = g;
+  for(i=0; i<2; i++)
+  {
+    if(op[i] == bddnull) return bddnull;
+    if(B_CST(op[i]))
+    { if(B_ABS(op[i]) != bddfalse) err("bddmult: Invalid bddp", op[i], ExceptionType::InvalidBDDValue); }
+    else
+    {
+      fp = B_NP(op[i]);
+      if(fp>=Node+NodeSpc || !fp->varrfc)
+        err("bddmult: Invalid bddp", op[i], ExceptionType::InvalidBDDValue);
+      if(!B_Z_NP(fp)) err("bddmult: applying non-ZDD node", op[i], ExceptionType::InvalidBDDValue);
+    }
+  }
 
-  return apply(f, bddfalse, BC_LIT, 0);
+  return apply(f, g, BC_ZDD_MULT, 0);
 }
 
-bddp bddlen(bddp f)
+bddp bdddiv(bddp f, bddp p)
+/* Returns the weak division (quotient) of f by p.
+ * Returns bddnull if not enough memory */
 {
   struct B_NodeTable *fp;
+  bddp op[2];
+  int i;
 
-  if(f == bddnull) return 0;
-  if(B_CST(f)) return 0;
-  fp = B_NP(f);
+  /* Check operands */
+  op[0] = f; op[1] = p;
+  for(i=0; i<2; i++)
+  {
+    if(op[i] == bddnull) return bddnull;
+    if(B_CST(op[i]))
+    { if(B_ABS(op[i]) != bddfalse) err("bdddiv: Invalid bddp", op[i], ExceptionType::InvalidBDDValue); }
+    else
+    {
+      fp = B_NP(op[i]);
+      if(fp>=Node+NodeSpc || !fp->varrfc)
+        err("bdddiv: Invalid bddp", op[i], ExceptionType::InvalidBDDValue);
+      if(!B_Z_NP(fp)) err("bdddiv: applying non-ZDD node", op[i], ExceptionType::InvalidBDDValue);
+    }
+  }
+  if(p == bddfalse) err("bdddiv: Divided by zero", f, ExceptionType::InvalidBDDValue);
+
+  return apply(f, p, BC_ZDD_DIV, 0);
+}
+
+bddp bddmeet(bddp f, bddp g)
+/* Returns the set of a & b for a in f and b in g.
+ * Returns bddnull if not enough memory */
+{
+  struct B_NodeTable *fp;
+  bddp op[2];
+  int i;
+
+  /* Check operands */
+  op[0] = f; op[1] = g;
+  for(i=0; i<2; i++)
+  {
+    if(op[i] == bddnull) return bddnull;
+    if(B_CST(op[i]))
+    { if(B_ABS(op[i]) != bddfalse) err("bddmeet: Invalid bddp", op[i], ExceptionType::InvalidBDDValue); }
+    else
+    {
+      fp = B_NP(op[i]);
+      if(fp>=Node+NodeSpc || !fp->varrfc)
+        err("bddmeet: Invalid bddp", op[i], ExceptionType::InvalidBDDValue);
+      if(!B_Z_NP(fp)) err("bddmeet: applying non-ZDD node", op[i], ExceptionType::InvalidBDDValue);
+    }
+  }
+
+  if(ApplyThreads > 1 && !B_CST(f) && !B_CST(g))
+    return apply_par(f, g, BC_ZDD_MEET);
+  return apply(f, g, BC_ZDD_MEET, 0);
+}
+
+static void naryoperands(const char *name, const bddp *fs, int n)
+/* Checks the operands of bddunionN and bddintersecN */
+{
+  struct B_NodeTable *fp;
+  char msg[64];
+  int i;
+
+  if(n < 0)
+  {
+    snprintf(msg, sizeof(msg), "%s: Invalid n", name);
+    err(msg, n, ExceptionType::OutOfRange);
+  }
+  for(i=0; i<n; i++)
+  {
+    if(fs[i] == bddnull) continue;
+    if(B_CST(fs[i]))
+    {
+      if(B_ABS(fs[i]) == bddfalse) continue;
+      snprintf(msg, sizeof(msg), "%s: Invalid bddp", name);
+      err(msg, fs[i], ExceptionType::InvalidBDDValue);
+    }
+    fp = B_NP(fs[i]);
+    if(fp>=Node+NodeSpc || !fp->varrfc)
+    {
+      snprintf(msg, sizeof(msg), "%s: Invalid bddp", name);
+      err(msg, fs[i], ExceptionType::InvalidBDDValue);
+    }
+    if(!B_Z_NP(fp))
+    {
+      snprintf(msg, sizeof(msg), "%s: applying non-ZDD node", name);
+      err(msg, fs[i], ExceptionType::InvalidBDDValue);
+    }
+  }
+}
+
+bddp bddunionN(const bddp *fs, int n)
+/* Returns the union of fs[0], ..., fs[n-1] in one pass over all the
+ * operands, instead of n-1 calls of bddunion. It is bddempty for n == 0.
+ * Returns bddnull if not enough memory */
+{
+  std::vector<bddp> ops;
+  int i;
+
+  /* Check operands */
+  naryoperands("bddunionN", fs, n);
+  for(i=0; i<n; i++) if(fs[i] == bddnull) return bddnull;
+
+  if(n == 0) return bddempty;
+  ops.assign(fs, fs + n);
+  return nary(ops, BC_UNION);
+}
+
+bddp bddintersecN(const bddp *fs, int n)
+/* Returns the intersection of fs[0], ..., fs[n-1] in one pass over all
+ * the operands, where n must be positive.
+ * Returns bddnull if not enough memory */
+{
+  std::vector<bddp> ops;
+  int i;
+
+  /* Check operands */
+  naryoperands("bddintersecN", fs, n);
+  if(n == 0) err("bddintersecN: No operand", n, ExceptionType::OutOfRange);
+  for(i=0; i<n; i++) if(fs[i] == bddnull) return bddnull;
+
+  ops.assign(fs, fs + n);
+  return nary(ops, BC_INTERSEC);
+}
+
+bddp bddcard(bddp f)
+{
+  struct B_NodeTable *fp;
+
+  if(f == bddnull) return 0;
+  if(B_CST(f)) return (f == bddfalse)? 0: 1;
+  fp = B_NP(f);
+  if(fp>=Node+NodeSpc || !fp->varrfc)
+    err("bddcard: Invalid bddp", f, ExceptionType::InvalidBDDValue);
+  if(!B_Z_NP(fp)) err("bddcard: applying non-ZDD node", f, ExceptionType::InvalidBDDValue);
+
+  return apply(f, bddfalse, BC_CARD, 0);
+}
+
+bddp bddlit(bddp f)
+{
+  struct B_NodeTable *fp;
+
+  if(f == bddnull) return 0;
+  if(B_CST(f)) return 0;
+  fp = B_NP(f);
+  if(fp>=Node+NodeSpc || !fp->varrfc)
+    err("bddlit: Invalid bddp", f, ExceptionType::InvalidBDDValue);
+  if(!B_Z_NP(fp)) err("bddlit: applying non-ZDD node", f, ExceptionType::InvalidBDDValue);
+
+  return apply(f, bddfalse, BC_LIT, 0);
+}
+
+bddp bddlen(bddp f)
+{
+  struct B_NodeTable *fp;
+
+  if(f == bddnull) return 0;
+  if(B_CST(f)) return 0;
+  fp = B_NP(f);
   if(fp>=Node+NodeSpc || !fp->varrfc)
     err("bddlen: Invalid bddp", f, ExceptionType::InvalidBDDValue);
   if(!B_Z_NP(fp)) err("bddlen: applying non-ZDD node", f, ExceptionType::InvalidBDDValue);
@@ -1279,66 +2451,361 @@ bddp bddlen(bddp f)
   return apply(f, bddfalse, BC_LEN, 0);
 }
 
-char *bddcardmp16(bddp f, char *s)
+unsigned long long bddcard64(bddp f)
+/* Returns the number of sets in f, or 2^64-1 if it does not fit */
 {
-  struct B_NodeTable *fp;
-  int i, j, k, nz;
-  struct B_MP mp;
-  bddp h, d;
+  std::vector<unsigned long long> w;
 
-  mp.len = 1;
-  if(f == bddnull) mp.word[0] = 0; 
-  else if(B_CST(f)) mp.word[0] = (f == bddtrue)? 1: 0;
-  else
+  cardmp(f, w, "bddcard64");
+  if(w.size() > 1) return ~0ULL;
+  return w.empty()? 0: w[0];
+}
+
+#ifdef __SIZEOF_INT128__
+unsigned __int128 bddcard128(bddp f)
+/* Returns the number of sets in f, or 2^128-1 if it does not fit */
+{
+  std::vector<unsigned long long> w;
+
+  cardmp(f, w, "bddcard128");
+  if(w.size() > 2) return ~(unsigned __int128)0;
+  w.resize(2, 0);
+  return ((unsigned __int128)w[1] << 64) | w[0];
+}
+#endif
+
+int bddcardmp(bddp f, unsigned long long *w, int lim)
+/* Stores the number of sets in f into w[0], ..., w[lim-1] by 64-bit
+ * limbs from the lowest, and returns the number of the limbs of the
+ * number (0 for the empty set), which may be more than lim */
+{
+  std::vector<unsigned long long> c;
+  int i;
+
+  if(lim < 0) err("bddcardmp: Invalid lim", lim, ExceptionType::OutOfRange);
+  cardmp(f, c, "bddcardmp");
+  for(i=0; i<lim && i<(int)c.size(); i++) w[i] = c[i];
+  return (int)c.size();
+}
+
+char *bddcardmp10(bddp f, char *s)
+/* Writes the number of sets in f in decimal into s, which is allocated
+ * by malloc if s is 0 */
+{
+  std::vector<unsigned long long> w;
+  std::vector<char> d;
+  unsigned long long r, hi, lo;
+  int i, j;
+
+  cardmp(f, w, "bddcardmp10");
+
+  /* Divides by 10^9 repeatedly, by 32-bit halves of the limbs */
+  while(!w.empty())
   {
-    fp = B_NP(f);
-    if(fp>=Node+NodeSpc || !fp->varrfc)
-      err("bddcardmp16: Invalid bddp", f, ExceptionType::InvalidBDDValue);
-    if(!B_Z_NP(fp)) err("bddcardmp16: applying non-ZDD node", f, ExceptionType::InvalidBDDValue);
-    h = apply(B_ABS(f), bddfalse, BC_CARD2, 0);
-    if(h == B_MP_NULL) mp.len = 0;
-    else
+    r = 0;
+    for(i=(int)w.size()-1; i>=0; i--)
     {
-      mp.word[0] = B_NEG(f)? 1: 0;
-      mp_add(&mp, h);
+      r = (r << 32) | (w[i] >> 32);
+      hi = r / 1000000000ULL;
+      r %= 1000000000ULL;
+      r = (r << 32) | (w[i] & 0xFFFFFFFFULL);
+      lo = r / 1000000000ULL;
+      r %= 1000000000ULL;
+      w[i] = (hi << 32) | lo;
     }
+    while(!w.empty() && w.back() == 0) w.pop_back();
+    for(j=0; j<9 && (r || !w.empty()); j++) { d.push_back('0' + r % 10); r /= 10; }
   }
-  if(!s) s = B_MALLOC(char, mp.len*sizeof(bddp)*2+1);
+  if(d.empty()) d.push_back('0');
+
+  if(!s) s = B_MALLOC(char, d.size()+1);
+  if(!s)
+    err("bddcardmp10: memory allocation failed", d.size()+1,
+        ExceptionType::OutOfMemory);
+  for(i=0; i<(int)d.size(); i++) s[i] = d[d.size()-1-i];
+  s[d.size()] = 0;
+  return s;
+}
+
+char *bddcardmp16(bddp f, char *s)
+{
+  std::vector<unsigned long long> w;
+  int i, j, k, nz, d;
+
+  cardmp(f, w, "bddcardmp16");
+  if(!s) s = B_MALLOC(char, w.size()*16+2);
   if(!s)
-    err("bddcardmp16: memory allocation failed", mp.len*sizeof(bddp)*2+1,
+    err("bddcardmp16: memory allocation failed", w.size()*16+2,
         ExceptionType::OutOfMemory);
   k = 0;
   nz = 0;
-  for(i=mp.len-1; i>=0; i--)
-    for(j=sizeof(bddp)*2-1; j>=0; j--)
+  for(i=(int)w.size()-1; i>=0; i--)
+    for(j=15; j>=0; j--)
     {
-      d = (mp.word[i] >> (j*4) ) & 15;
+      d = (w[i] >> (j*4)) & 15;
       if(d) nz = 1;
       if(nz) s[k++] = "0123456789ABCDEF"[d];
     }
-  if(!nz && mp.len) s[k++] = '0';
+  if(!nz) s[k++] = '0';
   s[k++] = 0;
-
-#ifdef DEBUG
-  for(i=0; i<B_MP_LMAX; i++)
-  {
-    printf("%d: ", i);
-    printf(B_BDDP_FD, mptable[i].size);
-    printf("\n");
-  }
-#endif 
-
   return s;
 }
 
 int bddimport(FILE *strm, bddp *p, int lim)
 {
-  return import(strm, p, lim, 0);
+  BDD_Tokenizer tk(strm);
+  return import(tk, p, lim, 0);
 }
 
 int bddimportz(FILE *strm, bddp *p, int lim)
 {
-  return import(strm, p, lim, 1);
+  BDD_Tokenizer tk(strm);
+  return import(tk, p, lim, 1);
+}
+
+int bddimport(std::istream &is, bddp *p, int lim)
+{
+  BDD_Tokenizer tk(is);
+  return import(tk, p, lim, 0);
+}
+
+int bddimportz(std::istream &is, bddp *p, int lim)
+{
+  BDD_Tokenizer tk(is);
+  return import(tk, p, lim, 1);
+}
+
+int bddimportmem(const char *buf, size_t size, bddp *p, int lim)
+{
+  BDD_Tokenizer tk(buf, size);
+  return import(tk, p, lim, 0);
+}
+
+int bddimportzmem(const char *buf, size_t size, bddp *p, int lim)
+{
+  BDD_Tokenizer tk(buf, size);
+  return import(tk, p, lim, 1);
+}
+
+void bddexportbin(FILE *strm, bddp *p, int lim)
+/* Writes a binary snapshot of p[0], ..., p[n-1] (up to bddnull or lim).
+ * All fields are 64-bit words in the host byte order, which is given by
+ * B_SNAP_ORDER read back as a word:
+ *   "BDDSNAP2", B_SNAP_ORDER, nlev, n, nnode,
+ *   VarID of levels 1..nlev, number of nodes of levels 1..nlev,
+ *   n roots, and nnode records of two children from the lowest level.
+ * A root or a child is 0 for bddfalse, 1 for bddtrue, or 2 * (i + 1)
+ * for the i-th record, plus 1 if negated (the 0-child of a ZDD node is
+ * always so). */
+{
+  struct B_NodeTable *fp;
+  std::vector<unsigned long long> key, head, rec;
+  unsigned long long k;
+  bddp f, f0, f1;
+  bddvar lev;
+  size_t i, j;
+  int n;
+  B_StackScope<bddp> scope(B_Stack);
+
+  if(strm == NULL) throw BDDFileFormatException("Output stream is null", 0);
+
+  /* Check operands */
+  for(n=0; n<lim; n++)
+  {
+    if(p[n] == bddnull) break;
+    if(!B_CST(p[n])&&
+       ((fp=B_NP(p[n]))>=Node+NodeSpc || fp->varrfc==0))
+      err("bddexportbin: Invalid bddp", p[n], ExceptionType::InvalidBDDValue);
+  }
+
+  /* Collects the nodes keyed by (level, index) */
+  {
+    B_VisitScope vs;
+    for(i=0; i<(size_t)n; i++) if(!B_CST(p[i])) B_Stack.push_back(p[i]);
+    while(B_Stack.size() > scope.base)
+    {
+      f = B_Stack.back();
+      B_Stack.pop_back();
+      if(!visit(f)) continue;
+      fp = B_NP(f);
+      key.push_back(((unsigned long long)Var[B_VAR_NP(fp)].lev << 40) | B_NDX(f));
+      f0 = B_GET_BDDP(fp->f0);
+      f1 = B_GET_BDDP(fp->f1);
+      if(!B_CST(f0)) B_Stack.push_back(f0);
+      if(!B_CST(f1)) B_Stack.push_back(f1);
+    }
+  }
+  std::sort(key.begin(), key.end());
+
+  /* Reference to a node, a constant is kept as it is */
+  auto ref = [&](bddp x) -> unsigned long long
+  {
+    if(B_CST(x)) return B_NEG(x)? 1: 0;
+    k = ((unsigned long long)Var[B_VAR_NP(B_NP(x))].lev << 40) | B_NDX(x);
+    j = std::lower_bound(key.begin(), key.end(), k) - key.begin();
+    return ((j + 1) << 1) | (B_NEG(x)? 1: 0);
+  };
+
+  head.push_back(0);
+  memcpy(&head[0], "BDDSNAP2", 8);
+  head.push_back(B_SNAP_ORDER);
+  head.push_back(VarUsed);
+  head.push_back(n);
+  head.push_back(key.size());
+  for(lev=1; lev<=VarUsed; lev++) head.push_back(VarID[lev]);
+  head.resize(head.size() + VarUsed, 0);
+  for(i=0; i<key.size(); i++) head[4 + VarUsed + (key[i] >> 40)]++;
+  for(i=0; i<(size_t)n; i++) head.push_back(ref(p[i]));
+  if(fwrite(head.data(), 8, head.size(), strm) != head.size())
+    throw BDDFileFormatException("Error writing to file", 0);
+
+  /* Records are written in blocks */
+  for(i=0; i<key.size(); i++)
+  {
+    fp = Node + (key[i] & ((1ULL << 40) - 1));
+    rec.push_back(ref(B_GET_BDDP(fp->f0)));
+    rec.push_back(ref(B_GET_BDDP(fp->f1)));
+    if(rec.size() >= 65536 || i + 1 == key.size())
+    {
+      if(fwrite(rec.data(), 8, rec.size(), strm) != rec.size())
+        throw BDDFileFormatException("Error writing to file", 0);
+      rec.clear();
+    }
+  }
+}
+
+int bddimportbin(const char *path, bddp *p, int lim)
+/* Loads a snapshot written by bddexportbin into p[0], ..., p[lim-1]
+ * (p[n] = bddnull if n < lim). The file is mapped into memory, and the
+ * nodes are inserted into the unique tables level by level. The
+ * variables are created as needed and reordered to the order of the
+ * snapshot if they are not in it (other variables go above them). */
+{
+  B_SnapFile sf(path);
+  const unsigned long long *w, *cnt, *rec;
+  unsigned long long nlev, n, nnode, r, total;
+  std::vector<bddp> nd;
+  std::vector<bddvar> rank;
+  bddvar lev, v, s, t, next;
+  bddp base, i, f0, f1;
+  int k, moved, z;
+
+  w = (const unsigned long long *)sf.data;
+  if(sf.size < 40 || memcmp(w, "BDDSNAP2", 8) != 0)
+    throw BDDFileFormatException("Import error: Not a snapshot", 0);
+  if(w[1] != B_SNAP_ORDER)
+    throw BDDFileFormatException("Import error: Snapshot of another byte order", 0);
+  w++; /* The counts from w[1] */
+  nlev = w[1];
+  n = w[2];
+  nnode = w[3];
+  if(nlev > bddvarmax || n > sf.size / 8 || nnode > sf.size / 16 ||
+     sf.size != 8 * (5 + 2 * nlev + n + 2 * nnode))
+    throw BDDFileFormatException("Import error: Invalid snapshot size", 0);
+  cnt = w + 4 + nlev;
+  rec = cnt + nlev + n;
+  total = 0;
+  for(lev=0; lev<nlev; lev++) total += cnt[lev];
+  if(total != nnode)
+    throw BDDFileFormatException("Import error: Invalid snapshot size", 0);
+
+  /* Variable order */
+  while(bddvarused() < nlev) bddnewvar();
+  rank.assign(VarUsed + 1, 0);
+  for(lev=1; lev<=nlev; lev++)
+  {
+    v = (bddvar)w[3 + lev];
+    if(v == 0 || v > nlev || rank[v])
+      throw BDDFileFormatException("Import error: Invalid variable order", v);
+    rank[v] = lev;
+  }
+  for(lev=nlev+1, v=1; v<=VarUsed; v++) if(!rank[v]) rank[v] = lev++;
+
+  /* The groups are moved as a whole (as in sifting) by their lowest
+   * variable in the snapshot, and a fixed group is never passed */
+  auto grank = [&](bddvar l) -> bddvar
+  {
+    bddvar m = rank[VarID[l]];
+    for(bddvar u=l+1U; u<l+Var[VarID[l]].gsize; u++)
+      if(rank[VarID[u]] < m) m = rank[VarID[u]];
+    return m;
+  };
+  moved = 0;
+  for(k=1; k; )
+  {
+    k = 0;
+    for(lev=1; lev+Var[VarID[lev]].gsize<=VarUsed; lev=next)
+    {
+      s = Var[VarID[lev]].gsize;
+      next = lev + s;
+      if(Var[VarID[lev]].gfix || Var[VarID[next]].gfix ||
+         grank(lev) < grank(next)) continue;
+      /* Dead nodes may be linked to the nodes being swapped */
+      if(!moved) { bddgc(); moved = 1; }
+      t = Var[VarID[next]].gsize;
+      swap_groups(lev, s, t);
+      next = lev + t;
+      k = 1;
+    }
+  }
+  if(moved) cache_clear();
+  for(lev=1; lev<nlev; lev++)
+    if(Var[w[3 + lev]].lev > Var[w[4 + lev]].lev)
+      throw BDDFileFormatException("Import error: "
+        "Variable order conflicts with a group", (bddvar)w[3 + lev]);
+
+  /* Builds the nodes from the lowest level */
+  nd.reserve(nnode);
+  for(i=0; i<n && i<(bddp)lim; i++) p[i] = bddnull;
+  auto child = [&](unsigned long long c) -> bddp
+  {
+    if(c < 2) return c? bddtrue: bddfalse;
+    if((c >> 1) > base)
+      throw BDDFileFormatException("Import error: Invalid child", c);
+    bddp x = nd[(c >> 1) - 1];
+    B_RFC_INC_NP(B_NP(x));
+    return (c & 1)? B_NOT(x): x;
+  };
+  try
+  {
+    for(lev=1; lev<=nlev; lev++)
+    {
+      v = (bddvar)w[3 + lev];
+      base = nd.size();
+      for(i=0; i<cnt[lev-1]; i++)
+      {
+        r = 2 * (base + i);
+        f0 = child(rec[r]);
+        f1 = bddnull;
+        try { f1 = child(rec[r+1]); }
+        catch(...) { bddfree(f0); throw; }
+        /* A negated 0-edge marks a ZDD node. Records that getbddp or
+         * getzddp would not make are rejected */
+        z = B_NEG(f0)? 1: 0;
+        if((z? f1 == bddfalse: f0 == f1) ||
+           (!B_CST(f0) && (B_Z_NP(B_NP(f0))? 1: 0) != z) ||
+           (!B_CST(f1) && (B_Z_NP(B_NP(f1))? 1: 0) != z))
+        {
+          bddfree(f0);
+          bddfree(f1);
+          throw BDDFileFormatException("Import error: Non-canonical node",
+                                       base + i);
+        }
+        nd.push_back(getnode(v, f0, f1));
+      }
+    }
+    base = nd.size();
+    for(i=0; i<n && i<(bddp)lim; i++) p[i] = child(w[4 + 2 * nlev + i]);
+  }
+  catch(...)
+  {
+    for(i=0; i<n && i<(bddp)lim; i++) bddfree(p[i]);
+    for(bddp x: nd) bddfree(x);
+    throw;
+  }
+  if(n < (unsigned long long)lim) p[n] = bddnull;
+  for(bddp x: nd) bddfree(x);
+  return 0;
 }
 
 int bddisbdd(bddp f)
@@ -1380,6 +2847,8 @@ bddp    bddpush(bddp f, bddvar v)
   if(v > VarUsed || v == 0) err("bddpush: Invalid VarID", v, ExceptionType::OutOfRange);
   if(f == bddnull) return bddnull;
 
+  /* Sequences may break the order, so that v is not reordered */
+  Var[VarID[group_bottom(Var[v].lev)]].gfix = 1;
   if(!B_CST(f)) { fp = B_NP(f); B_RFC_INC_NP(fp); }
   return getzddp(v, bddfalse, f);
 }
@@ -1412,604 +2881,2805 @@ bddp bddgetgcthreshold(void)
   return GCThreshold;
 }
 
-/* ----------------- Internal functions ------------------ */
-static void var_enlarge()
+void bddsetgcmode(int mode)
+/* Set how bddgc() invalidates the cache */
 {
-  bddvar i, newSpc;
-  struct B_VarTable *newVar;
-  unsigned int *newVarID;
-  
-  /* Get new size */
-  if(VarSpc == bddvarmax+1U)
-    err("var_enlarge: var index range full", VarSpc, ExceptionType::OutOfRange);
-  newSpc = VarSpc << 2U;
-  if(newSpc > bddvarmax+1) newSpc = bddvarmax+1U;
+  if(mode != BDD_GC_FULL && mode != BDD_GC_EPOCH)
+    err("bddsetgcmode: Illegal mode", mode, ExceptionType::OutOfRange);
+  /* CacheEpoch is not kept with BDD_GC_FULL, where all the entries
+   * are valid */
+  if(mode == BDD_GC_EPOCH && GCMode == BDD_GC_FULL && CacheEpoch)
+    memset(CacheEpoch, GCEpoch, CacheSpc);
+  GCMode = mode;
+}
 
-  /* Enlarge space */
-  newVar = 0;
-  newVarID = 0;
-  newVar = B_MALLOC(struct B_VarTable, newSpc);
-  newVarID = B_MALLOC(unsigned int, newSpc);
-  if(newVar && newVarID)
-  {
-    for(i=0; i<VarSpc; i++)
-    {
-      newVar[i].hashSpc = Var[i].hashSpc;
-      newVar[i].hashUsed = Var[i].hashUsed;
-      newVar[i].lev = Var[i].lev;
-      newVar[i].hash_32 = Var[i].hash_32;
-      newVarID[i] = VarID[i];
-#ifndef B_32
-      newVar[i].hash_h8 = Var[i].hash_h8;
-#endif
-    }
-    free(Var);
-    free(VarID);
-    Var = newVar;
-    VarID = newVarID;
-  }
-  else
-  {
-    if(newVar) free(newVar);
-    if(newVarID) free(newVarID);
-    err("var_enlarge: memory allocation failed", VarSpc, ExceptionType::OutOfMemory);
-  }
+int bddgetgcmode(void)
+/* Get GC mode */
+{
+  return GCMode;
+}
 
-  /* Initialize new space */
-  for(i=VarSpc; i<newSpc; i++)
-  {
-    Var[i].hashSpc = 0;
-    Var[i].hashUsed = 0;
-    Var[i].lev = i;
-    Var[i].hash_32 = 0;
-    VarID[i] = i;
-#ifndef B_32
-    Var[i].hash_h8 = 0;
-#endif
-  }
-  VarSpc = newSpc;
+void bddsetcacheways(int ways)
+/* Set associativity of cache (1: direct mapped, 2 or 4) */
+{
+  if(ways != 1 && ways != 2 && ways != 4)
+    err("bddsetcacheways: ways must be 1, 2 or 4", ways, ExceptionType::OutOfRange);
+  CacheWays = ways;
 }
 
-static int node_enlarge()
-/* Returns 1 if not enough memory */
+int bddgetcacheways(void)
+/* Get associativity of cache */
 {
-  bddp i, newSpc;
-  struct B_NodeTable *newNode;
-  
-  /* Get new size */
-  if(NodeSpc >= NodeLimit) return 1; /* Cannot enlarge */
-  newSpc = NodeSpc << 1U;
-  if(newSpc > NodeLimit) newSpc = NodeLimit;
+  return CacheWays;
+}
 
-  /* Enlarge space */
-  newNode = 0;
-  newNode = B_MALLOC(struct B_NodeTable, newSpc);
-  if(newNode)
-  {
-    for(i=0; i<NodeSpc; i++)
-    {
-      newNode[i].varrfc = Node[i].varrfc;
-      newNode[i].f0_32 = Node[i].f0_32;
-      newNode[i].f1_32 = Node[i].f1_32;
-      newNode[i].nx_32 = Node[i].nx_32;
+void bddcachestats(struct bddcachestat *stats)
+/* Copy cache statistics of each operation code to stats[BDD_CACHE_OPMAX] */
+{
+  memcpy(stats, CacheStat, sizeof(CacheStat));
+}
+
+void bddclearcachestats(void)
+{
+  memset(CacheStat, 0, sizeof(CacheStat));
+}
+
+void bddsetuniquetable(int type)
+/* Set unique-table engine used from the next bddinit() */
+{
+  if(type != BDD_UT_CHAIN && type != BDD_UT_OPEN)
+    err("bddsetuniquetable: Illegal engine", type, ExceptionType::OutOfRange);
+  UTNext = type;
+}
+
+int bddgetuniquetable(void)
+/* Get unique-table engine in use */
+{
+  return UTType;
+}
+
+void bddsetnodetable(int type)
+/* Set allocation of node table used from the next bddinit() */
+{
+  if(type != BDD_NT_MALLOC && type != BDD_NT_MMAP && type != BDD_NT_HUGEPAGE)
+    err("bddsetnodetable: Illegal allocation", type, ExceptionType::OutOfRange);
+  NTNext = type;
+}
+
+int bddgetnodetable(void)
+/* Get allocation of node table in use */
+{
+  return NTType;
+}
+
+void bddsetgcthreads(int n)
+/* Set number of threads used by bddgc() (1: sequential) */
+{
+  if(n < 1)
+    err("bddsetgcthreads: Illegal number of threads", n, ExceptionType::OutOfRange);
+  GCThreads = n;
+}
+
+int bddgetgcthreads(void)
+/* Get number of threads used by bddgc() */
+{
+  return GCThreads;
+}
+
+void bddgcstats(struct bddgcstat *stats)
+/* Copy statistics of garbage collection */
+{
+  *stats = GCStat;
+}
+
+void bddsetautoreorder(bddp threshold)
+/* Set number of nodes to start reordering automatically (0: off) */
+{
+  ReorderLimit = threshold;
+  ReorderNext = threshold;
+}
+
+bddp bddgetautoreorder(void)
+/* Get number of nodes to start reordering automatically */
+{
+  return ReorderLimit;
+}
+
+void bddsetbfsthreshold(bddp threshold)
+/* Set number of operand nodes to apply level by level (0: off) */
+{
+  BFSThreshold = threshold;
+}
+
+bddp bddgetbfsthreshold(void)
+/* Get number of operand nodes to apply level by level */
+{
+  return BFSThreshold;
+}
+
+void bddsetapplythreads(int n)
+/* Set number of threads used by the binary operations (1: sequential) */
+{
+  if(n < 1)
+    err("bddsetapplythreads: Illegal number of threads", n, ExceptionType::OutOfRange);
+  ApplyThreads = n;
+}
+
+int bddgetapplythreads(void)
+/* Get number of threads used by the binary operations */
+{
+  return ApplyThreads;
+}
+
+struct BDDManager *bddmgrnew(bddp initsize, bddp limitsize, double cacheRatio,
+                             int threads)
+/* Returns a new manager initialized by bddinit() */
+{
+  struct BDDManager *m;
+  const struct BDDManager init = B_MGR_INIT;
+
+  m = 0;
+  m = B_MALLOC(struct BDDManager, 1);
+  if(!m) err("bddmgrnew: Memory allocation failed", sizeof(struct BDDManager),
+             ExceptionType::OutOfMemory);
+  *m = init;
+  try
+  {
+    B_MgrScope ms(m);
+    bddinit(initsize, limitsize, cacheRatio, threads);
+  }
+  catch(...)
+  {
+    free(m);
+    throw;
+  }
+  return m;
+}
+
+void bddmgrdelete(struct BDDManager *m)
+/* Frees all the tables of m. The default manager cannot be deleted. */
+{
+  int i;
+
+  if(!m) return;
+  if(m == &B_DefaultMgr)
+    err("bddmgrdelete: cannot delete the default manager", 0, ExceptionType::InvalidBDDValue);
+  {
+    B_MgrScope ms(m);
+    releasetables();
+    for(i=0; i<BDD_PKG_MAX; i++)
+      if(PkgData[i] && PkgFree[i]) PkgFree[i](PkgData[i]);
+  }
+  if(BDD_CurMgr == m) BDD_CurMgr = &B_DefaultMgr;
+  free(m);
+}
+
+struct BDDManager *bddmgrswitch(struct BDDManager *m)
+/* Sets the current manager of this thread, and returns the previous one.
+   m == 0 means the default manager. */
+{
+  struct BDDManager *old;
+
+  old = BDD_CurMgr;
+  BDD_CurMgr = m? m: &B_DefaultMgr;
+  return old;
+}
+
+struct BDDManager *bddmgrcurrent(void) { return BDD_CurMgr; }
+
+struct BDDManager *bddmgrdefault(void) { return &B_DefaultMgr; }
+
+void *bddmgrpkg(int n)
+/* Returns the data of the package n in the current manager, or 0 */
+{
+  if(n < 0 || n >= BDD_PKG_MAX)
+    err("bddmgrpkg: Invalid slot", n, ExceptionType::OutOfRange);
+  return PkgData[n];
+}
+
+void bddmgrsetpkg(int n, void *data, void (*del)(void *))
+/* Sets the data of the package n in the current manager. The old data
+   is passed to its del. */
+{
+  if(n < 0 || n >= BDD_PKG_MAX)
+    err("bddmgrsetpkg: Invalid slot", n, ExceptionType::OutOfRange);
+  if(PkgData[n] && PkgData[n] != data && PkgFree[n]) PkgFree[n](PkgData[n]);
+  PkgData[n] = data;
+  PkgFree[n] = del;
+}
+
+/* Operations on an explicit manager */
+int bddminit(struct BDDManager *m, bddp initsize, bddp limitsize, double cacheRatio,
+             int threads)
+  { B_MgrScope ms(m); return bddinit(initsize, limitsize, cacheRatio, threads); }
+
+bddvar bddmnewvar(struct BDDManager *m)
+  { B_MgrScope ms(m); return bddnewvar(); }
+
+bddvar bddmnewvaroflev(struct BDDManager *m, bddvar lev)
+  { B_MgrScope ms(m); return bddnewvaroflev(lev); }
+
+bddvar bddmlevofvar(struct BDDManager *m, bddvar v)
+  { B_MgrScope ms(m); return bddlevofvar(v); }
+
+bddvar bddmvaroflev(struct BDDManager *m, bddvar lev)
+  { B_MgrScope ms(m); return bddvaroflev(lev); }
+
+bddvar bddmvarused(struct BDDManager *m)
+  { B_MgrScope ms(m); return bddvarused(); }
+
+bddp bddmprime(struct BDDManager *m, bddvar v)
+  { B_MgrScope ms(m); return bddprime(v); }
+
+bddvar bddmtop(struct BDDManager *m, bddp f)
+  { B_MgrScope ms(m); return bddtop(f); }
+
+bddp bddmcopy(struct BDDManager *m, bddp f)
+  { B_MgrScope ms(m); return bddcopy(f); }
+
+bddp bddmnot(struct BDDManager *m, bddp f)
+  { B_MgrScope ms(m); return bddnot(f); }
+
+bddp bddmand(struct BDDManager *m, bddp f, bddp g)
+  { B_MgrScope ms(m); return bddand(f, g); }
+
+bddp bddmor(struct BDDManager *m, bddp f, bddp g)
+  { B_MgrScope ms(m); return bddor(f, g); }
+
+bddp bddmxor(struct BDDManager *m, bddp f, bddp g)
+  { B_MgrScope ms(m); return bddxor(f, g); }
+
+bddp bddmnand(struct BDDManager *m, bddp f, bddp g)
+  { B_MgrScope ms(m); return bddnand(f, g); }
+
+bddp bddmnor(struct BDDManager *m, bddp f, bddp g)
+  { B_MgrScope ms(m); return bddnor(f, g); }
+
+bddp bddmxnor(struct BDDManager *m, bddp f, bddp g)
+  { B_MgrScope ms(m); return bddxnor(f, g); }
+
+bddp bddmite(struct BDDManager *m, bddp f, bddp g, bddp h)
+  { B_MgrScope ms(m); return bddite(f, g, h); }
+
+bddp bddmandexist(struct BDDManager *m, bddp f, bddp g, bddp c)
+  { B_MgrScope ms(m); return bddandexist(f, g, c); }
+
+bddp bddmvectorcompose(struct BDDManager *m, bddp f, const bddp *vec, int lim)
+  { B_MgrScope ms(m); return bddvectorcompose(f, vec, lim); }
+
+bddp bddmpermute(struct BDDManager *m, bddp f, const bddvar *perm, int lim)
+  { B_MgrScope ms(m); return bddpermute(f, perm, lim); }
+
+bddp bddmnodelist(struct BDDManager *m, bddp f, struct bddnode *list, bddp lim)
+  { B_MgrScope ms(m); return bddnodelist(f, list, lim); }
+
+double bddmprob(struct BDDManager *m, bddp f, const double *p)
+  { B_MgrScope ms(m); return bddprob(f, p); }
+
+bddp bddmat0(struct BDDManager *m, bddp f, bddvar v)
+  { B_MgrScope ms(m); return bddat0(f, v); }
+
+bddp bddmat1(struct BDDManager *m, bddp f, bddvar v)
+  { B_MgrScope ms(m); return bddat1(f, v); }
+
+void bddmfree(struct BDDManager *m, bddp f)
+  { B_MgrScope ms(m); bddfree(f); }
+
+bddp bddmused(struct BDDManager *m)
+  { B_MgrScope ms(m); return bddused(); }
+
+int bddmgc(struct BDDManager *m)
+  { B_MgrScope ms(m); return bddgc(); }
+
+bddp bddmcompact(struct BDDManager *m, int order)
+  { B_MgrScope ms(m); return bddcompact(order); }
+
+void bddmregroot(struct BDDManager *m, bddp *p)
+  { B_MgrScope ms(m); bddregroot(p); }
+
+void bddmunregroot(struct BDDManager *m, bddp *p)
+  { B_MgrScope ms(m); bddunregroot(p); }
+
+bddp bddmsize(struct BDDManager *m, bddp f)
+  { B_MgrScope ms(m); return bddsize(f); }
+
+bddp bddmvsize(struct BDDManager *m, bddp *p, int lim)
+  { B_MgrScope ms(m); return bddvsize(p, lim); }
+
+void bddmexport(struct BDDManager *m, FILE *strm, bddp *p, int lim)
+  { B_MgrScope ms(m); bddexport(strm, p, lim); }
+
+int bddmimport(struct BDDManager *m, FILE *strm, bddp *p, int lim)
+  { B_MgrScope ms(m); return bddimport(strm, p, lim); }
+
+bddp bddmlshift(struct BDDManager *m, bddp f, bddvar shift)
+  { B_MgrScope ms(m); return bddlshift(f, shift); }
+
+bddp bddmrshift(struct BDDManager *m, bddp f, bddvar shift)
+  { B_MgrScope ms(m); return bddrshift(f, shift); }
+
+bddp bddmsupport(struct BDDManager *m, bddp f)
+  { B_MgrScope ms(m); return bddsupport(f); }
+
+bddp bddmuniv(struct BDDManager *m, bddp f, bddp g)
+  { B_MgrScope ms(m); return bdduniv(f, g); }
+
+bddp bddmexist(struct BDDManager *m, bddp f, bddp g)
+  { B_MgrScope ms(m); return bddexist(f, g); }
+
+bddp bddmcofactor(struct BDDManager *m, bddp f, bddp g)
+  { B_MgrScope ms(m); return bddcofactor(f, g); }
+
+int bddmimply(struct BDDManager *m, bddp f, bddp g)
+  { B_MgrScope ms(m); return bddimply(f, g); }
+
+bddp bddmrcache(struct BDDManager *m, unsigned char op, bddp f, bddp g)
+  { B_MgrScope ms(m); return bddrcache(op, f, g); }
+
+void bddmwcache(struct BDDManager *m, unsigned char op, bddp f, bddp g, bddp h)
+  { B_MgrScope ms(m); bddwcache(op, f, g, h); }
+
+bddp bddmoffset(struct BDDManager *m, bddp f, bddvar v)
+  { B_MgrScope ms(m); return bddoffset(f, v); }
+
+bddp bddmonset(struct BDDManager *m, bddp f, bddvar v)
+  { B_MgrScope ms(m); return bddonset(f, v); }
+
+bddp bddmonset0(struct BDDManager *m, bddp f, bddvar v)
+  { B_MgrScope ms(m); return bddonset0(f, v); }
+
+bddp bddmchange(struct BDDManager *m, bddp f, bddvar v)
+  { B_MgrScope ms(m); return bddchange(f, v); }
+
+bddp bddmintersec(struct BDDManager *m, bddp f, bddp g)
+  { B_MgrScope ms(m); return bddintersec(f, g); }
+
+bddp bddmunion(struct BDDManager *m, bddp f, bddp g)
+  { B_MgrScope ms(m); return bddunion(f, g); }
+
+bddp bddmsubtract(struct BDDManager *m, bddp f, bddp g)
+  { B_MgrScope ms(m); return bddsubtract(f, g); }
+
+bddp bddmbfsapply(struct BDDManager *m, int op, bddp f, bddp g)
+  { B_MgrScope ms(m); return bddbfsapply(op, f, g); }
+
+bddp bddmmult(struct BDDManager *m, bddp f, bddp g)
+  { B_MgrScope ms(m); return bddmult(f, g); }
+
+bddp bddmdiv(struct BDDManager *m, bddp f, bddp p)
+  { B_MgrScope ms(m); return bdddiv(f, p); }
+
+bddp bddmmeet(struct BDDManager *m, bddp f, bddp g)
+  { B_MgrScope ms(m); return bddmeet(f, g); }
+
+bddp bddmunionN(struct BDDManager *m, const bddp *fs, int n)
+  { B_MgrScope ms(m); return bddunionN(fs, n); }
+
+bddp bddmintersecN(struct BDDManager *m, const bddp *fs, int n)
+  { B_MgrScope ms(m); return bddintersecN(fs, n); }
+
+bddp bddmcard(struct BDDManager *m, bddp f)
+  { B_MgrScope ms(m); return bddcard(f); }
+
+bddp bddmlit(struct BDDManager *m, bddp f)
+  { B_MgrScope ms(m); return bddlit(f); }
+
+bddp bddmlen(struct BDDManager *m, bddp f)
+  { B_MgrScope ms(m); return bddlen(f); }
+
+int bddmimportz(struct BDDManager *m, FILE *strm, bddp *p, int lim)
+  { B_MgrScope ms(m); return bddimportz(strm, p, lim); }
+
+int bddmimportmem(struct BDDManager *m, const char *buf, size_t size, bddp *p, int lim)
+  { B_MgrScope ms(m); return bddimportmem(buf, size, p, lim); }
+
+int bddmimportzmem(struct BDDManager *m, const char *buf, size_t size, bddp *p, int lim)
+  { B_MgrScope ms(m); return bddimportzmem(buf, size, p, lim); }
+
+void bddmexportbin(struct BDDManager *m, FILE *strm, bddp *p, int lim)
+  { B_MgrScope ms(m); bddexportbin(strm, p, lim); }
+
+int bddmimportbin(struct BDDManager *m, const char *path, bddp *p, int lim)
+  { B_MgrScope ms(m); return bddimportbin(path, p, lim); }
+
+char *bddmcardmp16(struct BDDManager *m, bddp f, char *s)
+  { B_MgrScope ms(m); return bddcardmp16(f, s); }
+
+char *bddmcardmp10(struct BDDManager *m, bddp f, char *s)
+  { B_MgrScope ms(m); return bddcardmp10(f, s); }
+
+unsigned long long bddmcard64(struct BDDManager *m, bddp f)
+  { B_MgrScope ms(m); return bddcard64(f); }
+
+#ifdef __SIZEOF_INT128__
+unsigned __int128 bddmcard128(struct BDDManager *m, bddp f)
+  { B_MgrScope ms(m); return bddcard128(f); }
+#endif
+
+int bddmcardmp(struct BDDManager *m, bddp f, unsigned long long *w, int lim)
+  { B_MgrScope ms(m); return bddcardmp(f, w, lim); }
+
+int bddmisbdd(struct BDDManager *m, bddp f)
+  { B_MgrScope ms(m); return bddisbdd(f); }
+
+int bddmiszdd(struct BDDManager *m, bddp f)
+  { B_MgrScope ms(m); return bddiszdd(f); }
+
+bddp bddmpush(struct BDDManager *m, bddp f, bddvar v)
+  { B_MgrScope ms(m); return bddpush(f, v); }
+
+void bddmsetcacheratio(struct BDDManager *m, double cacheRatio)
+  { B_MgrScope ms(m); bddsetcacheratio(cacheRatio); }
+
+double bddmgetcacheratio(struct BDDManager *m)
+  { B_MgrScope ms(m); return bddgetcacheratio(); }
+
+void bddmsetgcthreshold(struct BDDManager *m, bddp threshold)
+  { B_MgrScope ms(m); bddsetgcthreshold(threshold); }
+
+bddp bddmgetgcthreshold(struct BDDManager *m)
+  { B_MgrScope ms(m); return bddgetgcthreshold(); }
+
+void bddmsetgcmode(struct BDDManager *m, int mode)
+  { B_MgrScope ms(m); bddsetgcmode(mode); }
+
+int bddmgetgcmode(struct BDDManager *m)
+  { B_MgrScope ms(m); return bddgetgcmode(); }
+
+void bddmsetcacheways(struct BDDManager *m, int ways)
+  { B_MgrScope ms(m); bddsetcacheways(ways); }
+
+int bddmgetcacheways(struct BDDManager *m)
+  { B_MgrScope ms(m); return bddgetcacheways(); }
+
+void bddmcachestats(struct BDDManager *m, struct bddcachestat *stats)
+  { B_MgrScope ms(m); bddcachestats(stats); }
+
+void bddmclearcachestats(struct BDDManager *m)
+  { B_MgrScope ms(m); bddclearcachestats(); }
+
+void bddmsetuniquetable(struct BDDManager *m, int type)
+  { B_MgrScope ms(m); bddsetuniquetable(type); }
+
+int bddmgetuniquetable(struct BDDManager *m)
+  { B_MgrScope ms(m); return bddgetuniquetable(); }
+
+void bddmsetnodetable(struct BDDManager *m, int type)
+  { B_MgrScope ms(m); bddsetnodetable(type); }
+
+int bddmgetnodetable(struct BDDManager *m)
+  { B_MgrScope ms(m); return bddgetnodetable(); }
+
+void bddmsetgcthreads(struct BDDManager *m, int n)
+  { B_MgrScope ms(m); bddsetgcthreads(n); }
+
+int bddmgetgcthreads(struct BDDManager *m)
+  { B_MgrScope ms(m); return bddgetgcthreads(); }
+
+void bddmgcstats(struct BDDManager *m, struct bddgcstat *stats)
+  { B_MgrScope ms(m); bddgcstats(stats); }
+
+void bddmswaplev(struct BDDManager *m, bddvar lev)
+  { B_MgrScope ms(m); bddswaplev(lev); }
+
+bddp bddmreorder(struct BDDManager *m)
+  { B_MgrScope ms(m); return bddreorder(); }
+
+void bddmsetautoreorder(struct BDDManager *m, bddp threshold)
+  { B_MgrScope ms(m); bddsetautoreorder(threshold); }
+
+bddp bddmgetautoreorder(struct BDDManager *m)
+  { B_MgrScope ms(m); return bddgetautoreorder(); }
+
+void bddmsetbfsthreshold(struct BDDManager *m, bddp threshold)
+  { B_MgrScope ms(m); bddsetbfsthreshold(threshold); }
+
+bddp bddmgetbfsthreshold(struct BDDManager *m)
+  { B_MgrScope ms(m); return bddgetbfsthreshold(); }
+
+void bddmsetapplythreads(struct BDDManager *m, int n)
+  { B_MgrScope ms(m); bddsetapplythreads(n); }
+
+int bddmgetapplythreads(struct BDDManager *m)
+  { B_MgrScope ms(m); return bddgetapplythreads(); }
+
+void bddmvargroup(struct BDDManager *m, bddvar lev, bddvar n, int type)
+  { B_MgrScope ms(m); bddvargroup(lev, n, type); }
+
+void bddmsetreordercost(struct BDDManager *m, int cost)
+  { B_MgrScope ms(m); bddsetreordercost(cost); }
+
+int bddmgetreordercost(struct BDDManager *m)
+  { B_MgrScope ms(m); return bddgetreordercost(); }
+
+/* ----------------- Internal functions ------------------ */
+static void releasetables()
+/* Frees all the tables of the current manager */
+{
+  bddvar i;
+
+  par_release();
+  node_release();
+  if(NodeEpoch){ free(NodeEpoch); NodeEpoch = 0; }
+  if(Var)
+  {
+    for(i=0; i<VarSpc; i++)
+    {
+      if(Var[i].hash_32) free(Var[i].hash_32);
 #ifndef B_32
-      newNode[i].f0_h8 = Node[i].f0_h8;
-      newNode[i].f1_h8 = Node[i].f1_h8;
-      newNode[i].nx_h8 = Node[i].nx_h8;
-#endif /* B_32 */
+      if(Var[i].hash_h8) free(Var[i].hash_h8);
+#endif
+      if(Var[i].oa) free(Var[i].oa);
+      if(Var[i].old_32) free(Var[i].old_32);
+#ifndef B_32
+      if(Var[i].old_h8) free(Var[i].old_h8);
+#endif
+    }
+    free(Var); Var = 0;
+  }
+  if(VarID){ free(VarID); VarID = 0; }
+  if(CacheMem){ free(CacheMem); CacheMem = 0; Cache = 0; }
+  if(CacheEpoch){ free(CacheEpoch); CacheEpoch = 0; }
+  CacheSpc = 0;
+  if(Cache3){ free(Cache3); Cache3 = 0; }
+  Cache3Spc = 0;
+  memset(CacheStat, 0, sizeof(CacheStat));
+  memset(&GCStat, 0, sizeof(GCStat));
+  if(RFCT){ free(RFCT); RFCT = 0; }
+  RFCT_Spc = 0;
+  RFCT_Used = 0;
+  delete CountMemo;
+  CountMemo = 0;
+  delete Roots;
+  Roots = 0;
+  delete FwdTables;
+  FwdTables = 0;
+  NodeSpc = 0;
+  NodeUsed = 0;
+  NodeLimit = 0;
+  Avail = bddnull;
+  VarSpc = 0;
+  VarUsed = 0;
+}
+
+static void var_enlarge()
+{
+  bddvar i, newSpc;
+  struct B_VarTable *newVar;
+  unsigned int *newVarID;
+  
+  /* Get new size */
+  if(VarSpc == bddvarmax+1U)
+    err("var_enlarge: var index range full", VarSpc, ExceptionType::OutOfRange);
+  newSpc = VarSpc << 2U;
+  if(newSpc > bddvarmax+1) newSpc = bddvarmax+1U;
+
+  /* Enlarge space */
+  newVar = 0;
+  newVarID = 0;
+  newVar = B_MALLOC(struct B_VarTable, newSpc);
+  newVarID = B_MALLOC(unsigned int, newSpc);
+  if(newVar && newVarID)
+  {
+    for(i=0; i<VarSpc; i++)
+    {
+      newVar[i].hashSpc = Var[i].hashSpc;
+      newVar[i].hashUsed = Var[i].hashUsed;
+      newVar[i].lev = Var[i].lev;
+      newVar[i].hash_32 = Var[i].hash_32;
+      newVarID[i] = VarID[i];
+#ifndef B_32
+      newVar[i].hash_h8 = Var[i].hash_h8;
+#endif
+      newVar[i].oa = Var[i].oa;
+      newVar[i].old_32 = Var[i].old_32;
+#ifndef B_32
+      newVar[i].old_h8 = Var[i].old_h8;
+#endif
+      newVar[i].oldSpc = Var[i].oldSpc;
+      newVar[i].moved = Var[i].moved;
+      newVar[i].gsize = Var[i].gsize;
+      newVar[i].gfix = Var[i].gfix;
+    }
+    free(Var);
+    free(VarID);
+    Var = newVar;
+    VarID = newVarID;
+  }
+  else
+  {
+    if(newVar) free(newVar);
+    if(newVarID) free(newVarID);
+    err("var_enlarge: memory allocation failed", VarSpc, ExceptionType::OutOfMemory);
+  }
+
+  /* Initialize new space */
+  for(i=VarSpc; i<newSpc; i++)
+  {
+    Var[i].hashSpc = 0;
+    Var[i].hashUsed = 0;
+    Var[i].lev = i;
+    Var[i].hash_32 = 0;
+    VarID[i] = i;
+#ifndef B_32
+    Var[i].hash_h8 = 0;
+#endif
+    Var[i].oa = 0;
+    Var[i].old_32 = 0;
+#ifndef B_32
+    Var[i].old_h8 = 0;
+#endif
+    Var[i].oldSpc = 0;
+    Var[i].moved = 0;
+    Var[i].gsize = 1;
+    Var[i].gfix = 0;
+  }
+  VarSpc = newSpc;
+}
+
+static int node_enlarge()
+/* Returns 1 if not enough memory */
+{
+  bddp i, newSpc;
+  struct B_NodeTable *newNode;
+  unsigned char *newEpoch;
+  
+  /* Get new size */
+  if(NodeSpc >= NodeLimit) return 1; /* Cannot enlarge */
+  if(ParActive && !NodeMap) return 1; /* Node is read by the other threads */
+  newSpc = NodeSpc << 1U;
+  if(newSpc > NodeLimit) newSpc = NodeLimit;
+
+  /* Enlarge epoch table. The old one may be read by the other threads
+   * of the parallel apply, and is freed after it. */
+  newEpoch = 0;
+  if(ParActive)
+  {
+    newEpoch = B_MALLOC(unsigned char, newSpc);
+    if(!newEpoch) return 1; /* Not enough memory */
+    memcpy(newEpoch, NodeEpoch, NodeSpc);
+    ParPool->oldepoch.push_back(NodeEpoch);
+  }
+  else newEpoch = B_REALLOC(NodeEpoch, unsigned char, newSpc);
+  if(!newEpoch) return 1; /* Not enough memory */
+  NodeEpoch = newEpoch;
+  memset(NodeEpoch + NodeSpc, 0, newSpc - NodeSpc);
+
+  /* Enlarge space */
+  if(NodeMap)
+  {
+    /* Make more pages of the reserved space accessible */
+    if(node_commit(newSpc)) return 1; /* Not enough memory */
+  }
+  else if((newNode = B_MALLOC(struct B_NodeTable, newSpc)) != 0)
+  {
+    for(i=0; i<NodeSpc; i++)
+    {
+      newNode[i].varrfc = Node[i].varrfc;
+      newNode[i].f0_32 = Node[i].f0_32;
+      newNode[i].f1_32 = Node[i].f1_32;
+      newNode[i].nx_32 = Node[i].nx_32;
+#ifndef B_32
+      newNode[i].f0_h8 = Node[i].f0_h8;
+      newNode[i].f1_h8 = Node[i].f1_h8;
+      newNode[i].nx_h8 = Node[i].nx_h8;
+#endif /* B_32 */
+    }
+    free(Node);
+    Node = newNode;
+  }
+  else return 1; /* Not enough memory */
+
+  /* Initialize new space */
+  Node[newSpc-1U].varrfc = 0;
+  B_SET_BDDP(Node[newSpc-1U].nx, Avail);
+  for(i=NodeSpc; i<newSpc-1U; i++)
+  {
+    Node[i].varrfc = 0;
+    B_SET_BDDP(Node[i].nx, i+1U);
+  }
+  Avail = NodeSpc;
+  NodeSpc = newSpc;
+
+  /* Realloc Cache (after the parallel apply, as it is in use) */
+  if(ParActive) { ParPool->enlarged = 1; return 0; }
+  allocatecache();
+  /* if allocatecache returned false, only NodeTable has been enlarged */
+  return 0;
+}
+
+static struct B_NodeTable *node_alloc()
+/* Allocates Node of NodeSpc nodes. Returns 0 if not enough memory */
+{
+#ifdef B_MMAP
+  size_t align;
+  char *p;
+
+  if(NTType != BDD_NT_MALLOC)
+  {
+    /* Reserve address space for NodeLimit nodes with no memory */
+    align = (NTType == BDD_NT_HUGEPAGE)? B_HUGEPAGE: (size_t)sysconf(_SC_PAGESIZE);
+    /* Rounded up, so that node_commit() never passes the end */
+    NodeMapSize = (size_t)NodeLimit * sizeof(struct B_NodeTable);
+    NodeMapSize = (NodeMapSize + align - 1U) / align * align + align;
+    NodeMap = mmap(0, NodeMapSize, PROT_NONE,
+                   MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if(NodeMap != MAP_FAILED)
+    {
+      p = (char *)NodeMap;
+      p += (align - (size_t)p % align) % align;
+      Node = (struct B_NodeTable *)p;
+      NodeCommit = 0;
+      if(node_commit(NodeSpc) == 0) return Node;
+      munmap(NodeMap, NodeMapSize);
+    }
+    /* Fall back to malloc */
+    NodeMap = 0;
+    NTType = BDD_NT_MALLOC;
+  }
+#endif
+  return B_MALLOC(struct B_NodeTable, NodeSpc);
+}
+
+static void node_release()
+{
+#ifdef B_MMAP
+  if(NodeMap)
+  {
+    munmap(NodeMap, NodeMapSize);
+    NodeMap = 0;
+    Node = 0;
+  }
+#endif
+  if(Node){ free(Node); Node = 0; }
+}
+
+static int node_commit(bddp spc)
+/* Makes Node[0..spc-1] accessible in the reserved space.
+ * Returns 1 if not enough memory */
+{
+#ifdef B_MMAP
+  size_t unit, size;
+  char *p;
+
+  unit = (NTType == BDD_NT_HUGEPAGE)? B_HUGEPAGE: (size_t)sysconf(_SC_PAGESIZE);
+  size = (size_t)spc * sizeof(struct B_NodeTable);
+  size = (size + unit - 1U) / unit * unit;
+  if(size <= NodeCommit) return 0;
+  p = (char *)Node + NodeCommit;
+  if(mprotect(p, size - NodeCommit, PROT_READ | PROT_WRITE) != 0) return 1;
+#ifdef MADV_HUGEPAGE
+  if(NTType == BDD_NT_HUGEPAGE) madvise(p, size - NodeCommit, MADV_HUGEPAGE);
+#endif
+  NodeCommit = size;
+  return 0;
+#else
+  (void)spc;
+  return 1;
+#endif
+}
+
+static int hash_enlarge(bddvar v)
+/* Throws an exception if not enough memory */
+{
+  struct B_VarTable *varp;
+  bddp oldSpc, newSpc;
+  bddp_32 *newhash_32;
+#ifndef B_32
+  bddp_h8 *newhash_h8;
+#endif
+  
+  varp = &Var[v];
+  /* Get new size */
+  oldSpc = varp->hashSpc;
+  if(oldSpc == B_NODE_MAX + 1U)
+    return 0; /*  Cancel enlarging */
+  newSpc = oldSpc << 1U;
+
+  if(UTType == BDD_UT_OPEN)
+  {
+    if(oa_rehash(varp, newSpc))
+      throw BDDOutOfMemoryException("hash_enlarge: not enough memory for hash table", sizeof(B_OAEntry) * newSpc);
+    return 0;
+  }
+
+  /* Finish the last rehashing */
+  if(varp->oldSpc != 0) ut_migrate(varp, varp->oldSpc);
+
+  /* Enlarge space */
+#ifndef B_32
+  newhash_32 = 0;
+  newhash_h8 = 0;
+  newhash_32 = B_MALLOC(bddp_32, newSpc);
+  newhash_h8 = B_MALLOC(bddp_h8, newSpc);
+  if(!newhash_32 || !newhash_h8)
+  {
+    bddp memsize = 0;
+    if(newhash_32) {
+      free(newhash_32);
+    } else {
+      memsize += sizeof(bddp_32) * newSpc;
+    }
+    if(newhash_h8) {
+      free(newhash_h8);
+    } else {
+      memsize += sizeof(bddp_h8) * newSpc;
+    }
+    throw BDDOutOfMemoryException("hash_enlarge: not enough memory for hash table", memsize);
+  }
+  varp->old_h8 = varp->hash_h8;
+  varp->hash_h8 = newhash_h8;
+#else
+  newhash_32 = 0;
+  newhash_32 = B_MALLOC(bddp_32, newSpc);
+  if(!newhash_32)
+  {
+    bddp memsize = sizeof(bddp_32) * newSpc;
+    throw BDDOutOfMemoryException("hash_enlarge: not enough memory for hash table", memsize);
+  } /* Not enough memory */
+#endif
+  varp->old_32 = varp->hash_32;
+  varp->hash_32 = newhash_32;
+  varp->hashSpc = newSpc;
+
+  /* The chains are moved to the new table a few buckets at a time by
+   * the following lookups (see ut_migrate), so that no single getnode()
+   * pays for the whole table. Buckets of the new table are written when
+   * their source bucket is moved. */
+  varp->oldSpc = oldSpc;
+  varp->moved = 0;
+  return 0;
+}
+
+static void ut_migrate(struct B_VarTable *varp, bddp n)
+/* Moves n buckets of the old hash-table to the new one in rehashing */
+{
+  struct B_NodeTable *np;
+  bddp i, nx, key, f0, f1;
+  bddp_32 *p_32, *q_32;
+#ifndef B_32
+  bddp_h8 *p_h8, *q_h8;
+#endif
+
+  for(; n>0 && varp->oldSpc!=0; n--)
+  {
+    /* Bucket i of the old table is split into i and i+oldSpc */
+    i = varp->moved;
+    B_SET_NXP(p, varp->hash, i);
+    B_SET_BDDP(*p, bddnull);
+    B_SET_NXP(p, varp->hash, i + varp->oldSpc);
+    B_SET_BDDP(*p, bddnull);
+    B_SET_NXP(q, varp->old, i);
+    nx = B_GET_BDDP(*q);
+    while(nx != bddnull)
+    {
+      np = Node + nx;
+      f0 = B_GET_BDDP(np->f0);
+      f1 = B_GET_BDDP(np->f1);
+      key = B_HASHKEY(f0, f1, varp->hashSpc);
+      B_SET_NXP(p, varp->hash, key);
+      nx = B_GET_BDDP(np->nx);
+      B_CPY_BDDP(np->nx, *p);
+      B_SET_BDDP(*p, np - Node);
+    }
+
+    if(++varp->moved == varp->oldSpc)
+    {
+      free(varp->old_32);
+      varp->old_32 = 0;
+#ifndef B_32
+      free(varp->old_h8);
+      varp->old_h8 = 0;
+#endif
+      varp->oldSpc = 0;
+      varp->moved = 0;
+    }
+  }
+}
+
+static void hash_create(struct B_VarTable *varp)
+/* Throws an exception if not enough memory */
+{
+  bddp ix;
+  bddp_32 *p_32;
+#ifndef B_32
+  bddp_h8 *p_h8;
+#endif
+
+  if(UTType == BDD_UT_OPEN)
+  {
+    varp->oa = 0;
+    varp->oa = (B_OAEntry *)calloc(B_HASH_SPC0, sizeof(B_OAEntry));
+    if(!varp->oa) throw BDDOutOfMemoryException("getnode: not enough memory for hash table", sizeof(B_OAEntry) * B_HASH_SPC0);
+    varp->hashSpc = B_HASH_SPC0;
+    return;
+  }
+
+  varp->hash_32 = 0;
+  varp->hash_32 = B_MALLOC(bddp_32, B_HASH_SPC0);
+  if(!varp->hash_32) throw BDDOutOfMemoryException("getnode: not enough memory for hash table", sizeof(bddp_32) * B_HASH_SPC0);
+#ifndef B_32
+  varp->hash_h8 = 0;
+  varp->hash_h8 = B_MALLOC(bddp_h8, B_HASH_SPC0);
+  if(!varp->hash_h8)
+  {
+    free(varp->hash_32);
+    throw BDDOutOfMemoryException("getnode: not enough memory for hash table", sizeof(bddp_h8) * B_HASH_SPC0);
+  }
+#endif
+  for(ix=0; ix<B_HASH_SPC0; ix++)
+  {
+    B_SET_NXP(p, varp->hash, ix);
+    B_SET_BDDP(*p, bddnull);
+  }
+  varp->hashSpc = B_HASH_SPC0;
+}
+
+static inline void hash_reserve(bddvar v)
+/* Counts a node to be inserted to the hash-table of v.
+ * Throws an exception if not enough memory */
+{
+  struct B_VarTable *varp;
+
+  varp = &Var[v];
+  if(varp->hashSpc == 0) hash_create(varp); /* Create hash-table */
+  ++ varp->hashUsed;
+  if((UTType == BDD_UT_OPEN)? B_OA_FULL(varp->hashUsed, varp->hashSpc):
+     varp->hashUsed >= varp->hashSpc)
+  {
+    if(hash_enlarge(v)) throw BDDOutOfMemoryException("getnode: "
+      "not enough memory for hash table", sizeof(bddp_32) * varp->hashSpc); /* Hash-table overflow */
+  }
+}
+
+static inline bddp ut_lookup(struct B_VarTable *varp, bddp f0, bddp f1)
+/* Returns the index of the node (f0, f1), or bddnull if not found */
+{
+  struct B_NodeTable *np;
+  bddp key, nx;
+  B_OAEntry h, e, *oa;
+  bddp_32 *p_32;
+#ifndef B_32
+  bddp_h8 *p_h8;
+#endif
+
+  if(UTType == BDD_UT_OPEN)
+  {
+    h = oa_hash(f0, f1);
+    oa = varp->oa;
+    key = (bddp)h & (varp->hashSpc-1U);
+    while((e = oa[key]) != 0)
+    {
+      if(((e ^ h) & B_OA_TAG_MASK) == 0)
+      {
+        nx = B_OA_NDX(e);
+        np = Node + nx;
+        if(f0 == B_GET_BDDP(np->f0) && f1 == B_GET_BDDP(np->f1)) return nx;
+      }
+      key = (key+1U) & (varp->hashSpc-1U);
+    }
+    return bddnull;
+  }
+
+  if(varp->oldSpc != 0) ut_migrate(varp, B_REHASH_STEP);
+  B_UT_BUCKET(varp, f0, f1);
+  nx = B_GET_BDDP(*p);
+  while(nx != bddnull)
+  {
+    np = Node + nx;
+    if(f0 == B_GET_BDDP(np->f0) && f1 == B_GET_BDDP(np->f1)) return nx;
+    nx = B_GET_BDDP(np->nx);
+  }
+  return bddnull;
+}
+
+static inline void ut_insert(struct B_VarTable *varp, bddp ix, bddp f0, bddp f1)
+/* Registers the node Node[ix] = (f0, f1), which must not be in the table */
+{
+  bddp key;
+  B_OAEntry h;
+  bddp_32 *p_32;
+#ifndef B_32
+  bddp_h8 *p_h8;
+#endif
+
+  if(UTType == BDD_UT_OPEN)
+  {
+    h = oa_hash(f0, f1);
+    key = (bddp)h & (varp->hashSpc-1U);
+    while(varp->oa[key] != 0) key = (key+1U) & (varp->hashSpc-1U);
+    varp->oa[key] = B_OA_ENTRY(h, ix);
+    return;
+  }
+
+  B_UT_BUCKET(varp, f0, f1);
+  B_CPY_BDDP(Node[ix].nx, *p);
+  B_SET_BDDP(*p, ix);
+}
+
+static void ut_remove(struct B_VarTable *varp, bddp ix, bddp f0, bddp f1)
+/* Unregisters the node Node[ix] = (f0, f1) */
+{
+  struct B_NodeTable *np, *np1, *np2;
+  bddp key, nx1, i, mask;
+  B_OAEntry *oa;
+  bddp_32 *p_32;
+#ifndef B_32
+  bddp_h8 *p_h8;
+#endif
+
+  if(UTType == BDD_UT_OPEN)
+  {
+    oa = varp->oa;
+    mask = varp->hashSpc - 1U;
+    i = (bddp)oa_hash(f0, f1) & mask;
+    while(oa[i] == 0 || B_OA_NDX(oa[i]) != ix)
+    {
+      if(oa[i] == 0)
+        err("gc1: Fail to find the node to be deleted", ix, ExceptionType::InternalError);
+      i = (i+1U) & mask;
+    }
+    oa_delete(varp, i);
+    return;
+  }
+
+  np = Node + ix;
+  B_UT_BUCKET(varp, f0, f1);
+  nx1 = B_GET_BDDP(*p);
+  np1 = Node + nx1;
+
+  if(np1 == np) B_CPY_BDDP(*p, np->nx);
+  else
+  {
+    np2 = 0;
+    while(np1 != np)
+    {
+      if(nx1 == bddnull)
+        err("gc1: Fail to find the node to be deleted", ix, ExceptionType::InternalError);
+      np2 = np1;
+      nx1 = B_GET_BDDP(np2->nx);
+      np1 = Node + nx1;
+    }
+    B_CPY_BDDP(np2->nx, np->nx);
+  }
+}
+
+static void oa_delete(struct B_VarTable *varp, bddp i)
+/* Clears slot i of the open-addressing table */
+{
+  struct B_NodeTable *np;
+  bddp j, k, mask;
+  B_OAEntry e, *oa;
+
+  oa = varp->oa;
+  mask = varp->hashSpc - 1U;
+  /* Backward-shift deletion: pull up the following entries which
+   * may be placed at the freed slot */
+  j = i;
+  for(;;)
+  {
+    j = (j+1U) & mask;
+    e = oa[j];
+    if(e == 0) break;
+    np = Node + B_OA_NDX(e);
+    k = (bddp)oa_hash(B_GET_BDDP(np->f0), B_GET_BDDP(np->f1)) & mask;
+    if(((j-k) & mask) >= ((j-i) & mask))
+    {
+      oa[i] = e;
+      i = j;
+    }
+  }
+  oa[i] = 0;
+}
+
+static void ut_sweep(struct B_VarTable *varp)
+/* Unregisters all the nodes of the variable whose varrfc is cleared */
+{
+  struct B_NodeTable *np, *np1;
+  bddp i, nx;
+  B_OAEntry *oa;
+  bddp_32 *p_32;
+#ifndef B_32
+  bddp_h8 *p_h8;
+#endif
+
+  if(UTType == BDD_UT_OPEN)
+  {
+    /* A deletion only moves entries from the following slots to
+     * slot i, so slot i is checked again until it holds a live node */
+    oa = varp->oa;
+    for(i=0; i<varp->hashSpc; i++)
+      while(oa[i] != 0 && Node[B_OA_NDX(oa[i])].varrfc == 0)
+        oa_delete(varp, i);
+    return;
+  }
+
+  if(varp->oldSpc != 0) ut_migrate(varp, varp->oldSpc);
+  for(i=0; i<varp->hashSpc; i++)
+  {
+    np = 0;
+    B_SET_NXP(p, varp->hash, i);
+    nx = B_GET_BDDP(*p);
+    while(nx != bddnull)
+    {
+      np1 = Node + nx;
+      nx = B_GET_BDDP(np1->nx);
+      if(np1->varrfc != 0) { np = np1; continue; }
+      if(np) B_CPY_BDDP(np->nx, np1->nx);
+      else B_CPY_BDDP(*p, np1->nx);
+    }
+  }
+}
+
+static B_OAEntry oa_hash(bddp f0, bddp f1)
+{
+  B_OAEntry h;
+
+  h = (B_OAEntry)f0 * 0x9E3779B97F4A7C15ULL
+    ^ (B_OAEntry)f1 * 0xC2B2AE3D27D4EB4FULL;
+  h ^= h >> 32U;
+  h *= 0xD6E8FEB86659FD93ULL;
+  h ^= h >> 29U;
+  return h;
+}
+
+static int oa_rehash(struct B_VarTable *varp, bddp newSpc)
+/* Returns 1 if not enough memory */
+{
+  struct B_NodeTable *np;
+  B_OAEntry h, e, *newoa;
+  bddp i, key;
+
+  newoa = 0;
+  newoa = (B_OAEntry *)calloc(newSpc, sizeof(B_OAEntry));
+  if(!newoa) return 1;
+  for(i=0; i<varp->hashSpc; i++)
+  {
+    e = varp->oa[i];
+    if(e == 0) continue;
+    np = Node + B_OA_NDX(e);
+    h = oa_hash(B_GET_BDDP(np->f0), B_GET_BDDP(np->f1));
+    key = (bddp)h & (newSpc-1U);
+    while(newoa[key] != 0) key = (key+1U) & (newSpc-1U);
+    newoa[key] = e;
+  }
+  free(varp->oa);
+  varp->oa = newoa;
+  varp->hashSpc = newSpc;
+  return 0;
+}
+
+template<int P>
+static inline bddp getnode(bddvar v, bddp f0, bddp f1)
+/* Throws an exception if not enough memory */
+{
+  /* After checking elimination rule & negative edge rule */
+  struct B_NodeTable *np, *fp;
+  struct B_VarTable *varp;
+  bddp nx;
+
+  if(P) return getnode_par(v, f0, f1);
+  varp = &Var[v];
+  if(varp->hashSpc == 0) hash_create(varp); /* Create hash-table */
+  else
+  /* Looking for equivalent existing node */
+  {
+    nx = ut_lookup(varp, f0, f1);
+    if(nx != bddnull)
+    {
+      /* Sharing equivalent node */
+      np = Node + nx;
+      if(!B_CST(f0)) { fp = B_NP(f0); B_RFC_DEC_NP(fp); }
+      if(!B_CST(f1)) { fp = B_NP(f1); B_RFC_DEC_NP(fp); }
+      B_RFC_INC_NP(np);
+      return B_BDDP_NP(np);
+    }
+  }
+
+  /* Check hash-table overflow */
+  hash_reserve(v);
+
+  /* Check node-table overflow */
+  if(NodeUsed >= NodeSpc-1U)
+  {
+    if(node_enlarge())
+    {
+      if(bddgc()) throw BDDOutOfMemoryException("getnode: "
+        "not enough memory for node table", 0); /* Node-table overflow */
+    }
+    /* Node-table enlarged or GC succeeded */
+  }
+  NodeUsed++;
+
+  /* Creating a new node */
+  nx = Avail;
+  np = Node + nx;
+  Avail = B_GET_BDDP(np->nx);
+  B_SET_BDDP(np->f0, f0);
+  B_SET_BDDP(np->f1, f1);
+  ut_insert(varp, nx, f0, f1);
+  np->varrfc = v;
+  B_RFC_INC_NP(np);
+  return B_BDDP_NP(np);
+}
+
+template<int P>
+static inline bddp getbddp(bddvar v, bddp f0, bddp f1)
+/* Returns bddnull if not enough memory */
+{
+  struct B_NodeTable *fp;
+
+  /* Check elimination rule */
+  if(f0 == f1)
+  {
+    if(!B_CST(f0)) { fp = B_NP(f0); B_RFC_DEC_P(fp); }
+    return f0;
+  }
+
+  /* Negative edge constraint */
+  if(B_NEG(f0))
+  {
+    bddp h;
+
+    h = getnode<P>(v, B_NOT(f0), B_NOT(f1));
+    if(h == bddnull) return bddnull;
+    return B_NOT(h);
+  }
+  return getnode<P>(v, f0, f1);
+}
+
+/* Frame of apply() waiting for the result of a sub-operation */
+struct B_ApplyFrame
+{
+  bddp f, g, k, key, f0, f1, g0, g1, k0, k1, h0, h1;
+  bddvar v;
+  unsigned char op;
+  char z;
+  unsigned char state; /* Where to resume (B_AP_XXX) */
+};
+
+/* Resume points of apply() */
+#define B_AP_NOT  0  /* Return the negation */
+#define B_AP_INC  1  /* Return the result plus one (BC_CARD) */
+#define B_AP_END  2  /* Return the result */
+#define B_AP_H0   3  /* Got the result for (f0, g0) */
+#define B_AP_H1   4  /* Got the result for (f1, g1) */
+#define B_AP_H2   5  /* Got the result of combining h0 and h1 */
+#define B_AP_H3   6  /* Got the results of the further steps */
+#define B_AP_H4   7  /*   (BC_ZDD_MULT and BC_ZDD_MEET) */
+#define B_AP_H5   8
+
+/* Frames of apply(). apply() is not reentered, so its frames always
+ * start at the bottom. */
+static thread_local std::vector<struct B_ApplyFrame> B_ApplyStack;
+
+#define B_AP_RET(x) do { h = (x); goto ret; } while(0)
+/* Cofactors x0 and x1 of the BDD x by v, which is the top of x or above */
+#define B_AP_SPLIT(x, x0, x1) \
+  do { \
+    if(B_VAR_NP(B_NP(x)) != v) { x0 = (x); x1 = (x); } \
+    else \
+    { \
+      x0 = B_GET_BDDP(B_NP(x)->f0); \
+      x1 = B_GET_BDDP(B_NP(x)->f1); \
+      if(B_NEG(x)) { x0 = B_NOT(x0); x1 = B_NOT(x1); } \
+    } \
+  } while(0)
+#define B_AP_CALL(nf, ng, nop, nskip, st) \
+  B_AP_CALL3(nf, ng, k, nop, nskip, st)
+#define B_AP_CALL3(nf, ng, nk, nop, nskip, st) \
+  do { \
+    bddp nf_ = (nf), ng_ = (ng), nk_ = (nk); \
+    unsigned char nop_ = (nop); \
+    if(sp == splim) \
+    { \
+      size_t n_ = sp - stack.data(); \
+      stack.resize(n_ * 2); \
+      sp = stack.data() + n_; \
+      splim = stack.data() + stack.size(); \
+    } \
+    sp->f = f; sp->g = g; sp->k = k; sp->key = key; \
+    sp->f0 = f0; sp->f1 = f1; sp->g0 = g0; sp->g1 = g1; \
+    sp->k0 = k0; sp->k1 = k1; sp->h0 = h0; sp->h1 = h1; \
+    sp->v = v; sp->op = op; sp->z = z; sp->state = (st); \
+    sp++; \
+    f = nf_; g = ng_; k = nk_; op = nop_; skip = (nskip); \
+    goto call; \
+  } while(0)
+
+template<int P>
+static bddp apply(bddp f, bddp g, unsigned char op, unsigned char skip,
+                  bddp k)
+/* Returns bddnull if not enough memory. k is the third operand of BC_ITE.
+ * The recursion is run on B_ApplyStack: B_AP_CALL saves the caller as
+ * a frame and restarts at "call" with the operands of the callee, and
+ * the result comes back to the caller at "ret" in h. */
+{
+  struct B_NodeTable *fp, *gp;
+  struct B_CacheTable *cachep;
+  struct B_Cache3Table *cache3p;
+  /* Some initial values are not used, but 
+  we set them to suppress compiler warnings */
+  bddp key = 0, f0 = 0, f1 = 0, g0 = 0, g1 = 0, k0 = 0, k1 = 0;
+  bddp h0 = 0, h1 = 0, h;
+  bddvar v = 0, flev, glev;
+  char z = 0; /* flag to check ZDD node */
+  unsigned char state;
+  std::vector<struct B_ApplyFrame> &stack = B_ApplyStack;
+  struct B_ApplyFrame *sp, *splim;
+
+  if(stack.size() < 256) stack.resize(256);
+  sp = stack.data();
+  splim = sp + stack.size();
+
+call:
+  /* Check terminal case */
+  if(!skip) switch(op)
+  {
+  case BC_AND: 
+    /* Check trivial cases */
+    if(f == bddfalse || g == bddfalse || f == B_NOT(g))
+      B_AP_RET(bddfalse);
+    if(f == g)
+    {
+      if(f != bddtrue) { fp = B_NP(f); B_RFC_INC_P(fp); }
+      B_AP_RET(f);
+    }
+    if(f == bddtrue) { fp = B_NP(g); B_RFC_INC_P(fp); B_AP_RET(g); }
+    if(g == bddtrue) { fp = B_NP(f); B_RFC_INC_P(fp); B_AP_RET(f); }
+    /* Check operand swap */
+    if(f < g) { h = f; f = g; g = h; } /* swap (f, g) */
+    break;
+
+  case BC_XOR:
+    /* Check trivial cases */
+    if(f == g) B_AP_RET(bddfalse);
+    if(f == B_NOT(g)) B_AP_RET(bddtrue);
+    if(f == bddfalse) { fp = B_NP(g); B_RFC_INC_P(fp); B_AP_RET(g); }
+    if(g == bddfalse) { fp = B_NP(f); B_RFC_INC_P(fp); B_AP_RET(f); }
+    if(f == bddtrue) {fp=B_NP(g); B_RFC_INC_P(fp); B_AP_RET(B_NOT(g));}
+    if(g == bddtrue) {fp=B_NP(f); B_RFC_INC_P(fp); B_AP_RET(B_NOT(f));}
+    /* Check negation */
+    if(B_NEG(f) && B_NEG(g)) { f = B_NOT(f); g = B_NOT(g); }
+    else if(B_NEG(f) || B_NEG(g))
+    {
+      f = B_ABS(f); g = B_ABS(g);
+      /* Check operand swap */
+      if(f < g) B_AP_CALL(g, f, op, 1, B_AP_NOT);
+      B_AP_CALL(f, g, op, 1, B_AP_NOT);
+    }
+    /* Check operand swap */
+    if(f < g) { h = f; f = g; g = h; } /* swap (f, g) */
+    break;
+
+  case BC_ITE:
+    /* Check trivial cases */
+    if(B_CST(f)) h = (f == bddtrue)? g: k;
+    else
+    {
+      /* Replace the operands equal to f by constants */
+      if(g == f) g = bddtrue;
+      else if(g == B_NOT(f)) g = bddfalse;
+      if(k == f) k = bddfalse;
+      else if(k == B_NOT(f)) k = bddtrue;
+      if(g == k) h = g;
+      else if(g == bddtrue && k == bddfalse) h = f;
+      else if(g == bddfalse && k == bddtrue) h = B_NOT(f);
+      else h = bddnull;
+    }
+    if(h != bddnull)
+    {
+      if(!B_CST(h)) { fp = B_NP(h); B_RFC_INC_P(fp); }
+      B_AP_RET(h);
+    }
+    /* Reduce to a binary operation */
+    if(g == bddtrue) B_AP_CALL(B_NOT(f), B_NOT(k), BC_AND, 0, B_AP_NOT);
+    if(k == bddtrue) B_AP_CALL(f, B_NOT(g), BC_AND, 0, B_AP_NOT);
+    if(g == bddfalse) { f = B_NOT(f); g = k; op = BC_AND; goto call; }
+    if(k == bddfalse) { op = BC_AND; goto call; }
+    if(g == B_NOT(k)) { g = k; op = BC_XOR; goto call; }
+    /* Standard triple: f and g are not negated */
+    if(B_NEG(f)) { f = B_NOT(f); h = g; g = k; k = h; }
+    if(B_NEG(g)) B_AP_CALL3(f, B_NOT(g), B_NOT(k), op, 1, B_AP_NOT);
+    break;
+
+  case BC_ANDEXIST:
+    /* Check trivial cases */
+    if(f == bddfalse || g == bddfalse || f == B_NOT(g))
+      B_AP_RET(bddfalse);
+    if(B_CST(k)) { op = BC_AND; goto call; }
+    if(f == bddtrue || f == g) B_AP_CALL(B_NOT(g), k, BC_UNIV, 0, B_AP_NOT);
+    if(g == bddtrue) B_AP_CALL(B_NOT(f), k, BC_UNIV, 0, B_AP_NOT);
+    /* Skip the variables of the cube above f and g */
+    flev = Var[B_VAR_NP(B_NP(f))].lev;
+    glev = Var[B_VAR_NP(B_NP(g))].lev;
+    if(flev < glev) flev = glev;
+    k = B_ABS(k);
+    while(!B_CST(k) && Var[B_VAR_NP(B_NP(k))].lev > flev)
+      k = B_ABS(B_GET_BDDP(B_NP(k)->f0));
+    if(B_CST(k)) { op = BC_AND; goto call; }
+    /* Check operand swap */
+    if(f < g) { h = f; f = g; g = h; } /* swap (f, g) */
+    break;
+
+  case BC_COFACTOR: 
+    /* Check trivial cases */
+    if(B_CST(f)) B_AP_RET(f);
+    if(g == bddfalse || f == B_NOT(g)) B_AP_RET(bddfalse);
+    if(f == g) B_AP_RET(bddtrue);
+    if(g == bddtrue) { fp = B_NP(f); B_RFC_INC_P(fp); B_AP_RET(f); }
+    break;
+  
+  case BC_UNIV: 
+    /* Check trivial cases */
+    if(B_CST(f)) B_AP_RET(f);
+    if(B_CST(g)) { fp = B_NP(f); B_RFC_INC_P(fp); B_AP_RET(f); }
+    if(B_NEG(g)) g = B_NOT(g);
+    break;
+  
+  case BC_SUPPORT:
+    if(B_CST(f)) B_AP_RET(bddfalse);
+    if(B_NEG(f)) f = B_NOT(f);
+    break;
+
+  case BC_INTERSEC: 
+    /* Check trivial cases */
+    if(f == bddfalse || g == bddfalse) B_AP_RET(bddfalse);
+    if(f == bddtrue) B_AP_RET(B_NEG(g)? bddtrue: bddfalse);
+    if(g == bddtrue) B_AP_RET(B_NEG(f)? bddtrue: bddfalse);
+    if(f == g) { fp = B_NP(f); B_RFC_INC_P(fp); B_AP_RET(f); }
+    if(f == B_NOT(g)) {fp=B_NP(f); B_RFC_INC_P(fp); B_AP_RET(B_ABS(f)); }
+    /* Check operand swap */
+    if(f < g) { h = f; f = g; g = h; } /* swap (f, g) */
+    break;
+
+  case BC_UNION: 
+    /* Check trivial cases */
+    if(f == bddfalse)
+    {
+      if(!B_CST(g)) {fp=B_NP(g); B_RFC_INC_P(fp); }
+      B_AP_RET(g);
+    }
+    if(f == bddtrue)
+    {
+      if(!B_CST(g)) {fp=B_NP(g); B_RFC_INC_P(fp); }
+      B_AP_RET(B_NEG(g)? g: B_NOT(g));
+    }
+    if(g == bddfalse || f == g)
+      { fp=B_NP(f); B_RFC_INC_P(fp); B_AP_RET(f); }
+    if(g == bddtrue || f == B_NOT(g))
+    {
+      fp=B_NP(f); B_RFC_INC_P(fp);
+      B_AP_RET(B_NEG(f)? f: B_NOT(f));
+    }
+    /* Check operand swap */
+    if(f < g) { h = f; f = g; g = h; } /* swap (f, g) */
+    break;
+
+  case BC_SUBTRACT: 
+    /* Check trivial cases */
+    if(f == bddfalse || f == g) B_AP_RET(bddfalse);
+    if(f == bddtrue || f == B_NOT(g))
+      B_AP_RET(B_NEG(g)? bddfalse: bddtrue);
+    if(g == bddfalse) { fp=B_NP(f); B_RFC_INC_P(fp); B_AP_RET(f); }
+    if(g == bddtrue) { fp=B_NP(f); B_RFC_INC_P(fp); B_AP_RET(B_ABS(f)); }
+    break;
+  
+  case BC_ZDD_MULT:
+  case BC_ZDD_MEET:
+    /* Check trivial cases */
+    if(f == bddfalse || g == bddfalse) B_AP_RET(bddfalse);
+    if(op == BC_ZDD_MEET && (f == bddtrue || g == bddtrue))
+      B_AP_RET(bddtrue);
+    if(f == bddtrue)
+    {
+      if(!B_CST(g)) { fp = B_NP(g); B_RFC_INC_P(fp); }
+      B_AP_RET(g);
+    }
+    if(g == bddtrue) { fp = B_NP(f); B_RFC_INC_P(fp); B_AP_RET(f); }
+    /* Check operand swap: f has the top variable */
+    flev = Var[B_VAR_NP(B_NP(f))].lev;
+    glev = Var[B_VAR_NP(B_NP(g))].lev;
+    if(flev < glev || (flev == glev && f < g))
+      { h = f; f = g; g = h; } /* swap (f, g) */
+    break;
+
+  case BC_ZDD_DIV:
+    /* Check trivial cases (g is not empty) */
+    if(g == bddtrue)
+    {
+      if(!B_CST(f)) { fp = B_NP(f); B_RFC_INC_P(fp); }
+      B_AP_RET(f);
+    }
+    if(f == g) B_AP_RET(bddtrue);
+    if(B_CST(f)) B_AP_RET(bddfalse);
+    if(Var[B_VAR_NP(B_NP(f))].lev < Var[B_VAR_NP(B_NP(g))].lev)
+      B_AP_RET(bddfalse);
+    break;
+
+  case BC_AT0: 
+  case BC_AT1: 
+  case BC_OFFSET: 
+    /* Check trivial cases */
+    if(B_CST(f)) B_AP_RET(f);
+    /* special cases */
+    fp = B_NP(f); flev = Var[B_VAR_NP(fp)].lev;
+    glev = Var[(bddvar)g].lev;
+    if(flev < glev) { B_RFC_INC_P(fp); B_AP_RET(f); }
+    if(flev == glev)
+    {
+      if(op != BC_AT1)
+      {
+        h = B_GET_BDDP(fp->f0);
+        if(B_NEG(f)^B_NEG(h)) h = B_NOT(h);
+      }
+      else
+      {
+        h = B_GET_BDDP(fp->f1);
+        if(B_NEG(f)) h = B_NOT(h);
+      }
+      if(!B_CST(h)) { fp = B_NP(h); B_RFC_INC_P(fp); }
+      B_AP_RET(h);
+    }
+    /* Check negation */
+    if(B_NEG(f))
+    {
+      B_AP_CALL(B_NOT(f), g, op, 1, B_AP_NOT);
+    }
+    break;
+
+  case BC_ONSET: 
+    /* Check trivial cases */
+    if(B_CST(f)) B_AP_RET(bddfalse);
+    /* special cases */
+    fp = B_NP(f); flev = Var[B_VAR_NP(fp)].lev;
+    glev = Var[(bddvar)g].lev;
+    if(flev < glev)  B_AP_RET(bddfalse);
+    if(flev == glev)
+    {
+      h = B_GET_BDDP(fp->f1);
+      if(!B_CST(h)) { fp = B_NP(h); B_RFC_INC_P(fp); }
+      B_AP_RET(h);
+    }
+    /* Check negation */
+    if(B_NEG(f)) f = B_NOT(f);
+    break;
+
+  case BC_CHANGE: 
+    /* Check trivial cases */
+    if(f == bddfalse) B_AP_RET(f);
+    if(B_CST(f)) B_AP_RET(getzddp<P>((bddvar)g, bddfalse, f));
+    /* special cases */
+    fp = B_NP(f); flev = Var[B_VAR_NP(fp)].lev;
+    glev = Var[(bddvar)g].lev;
+    if(flev < glev)
+    {
+      B_RFC_INC_P(fp);
+      h = getzddp<P>((bddvar)g, bddfalse, f);
+      if(h == bddnull) rfc_free<P>(f);
+      B_AP_RET(h);
+    }
+    if(flev == glev)
+    {
+      h0 = B_GET_BDDP(fp->f1);
+      h1 = B_GET_BDDP(fp->f0);
+      if(B_NEG(f)^B_NEG(h1)) h1 = B_NOT(h1);
+      if(!B_CST(h0)) { fp = B_NP(h0); B_RFC_INC_P(fp); }
+      if(!B_CST(h1)) { fp = B_NP(h1); B_RFC_INC_P(fp); }
+      h = getzddp<P>((bddvar)g, h0, h1);
+      if(h == bddnull) { rfc_free<P>(h0); rfc_free<P>(h1); }
+      B_AP_RET(h);
+    }
+    break;
+
+  case BC_LSHIFT: 
+  case BC_RSHIFT: 
+    /* Check trivial cases */
+    if(B_CST(f)) B_AP_RET(f);
+
+    /* Check negation */
+    if(B_NEG(f))
+    {
+      B_AP_CALL(B_NOT(f), g, op, 1, B_AP_NOT);
+    }
+    break;
+
+  case BC_CARD:
+    if(B_CST(f)) B_AP_RET((f == bddfalse)? 0: 1);
+    if(B_NEG(f)) 
+    {
+      B_AP_CALL(B_NOT(f), bddfalse, op, 1, B_AP_INC);
+    }
+    break;
+
+  case BC_LIT:
+    if(B_CST(f)) B_AP_RET(0);
+    if(B_NEG(f)) f = B_NOT(f);
+    break;
+
+  case BC_LEN:
+    if(B_CST(f)) B_AP_RET(0);
+    if(B_NEG(f)) f = B_NOT(f);
+    break;
+
+  default:
+    err("apply: unknown opcode", op, ExceptionType::InternalError);
+    break;
+  }
+
+  /* Non-trivial operations */
+  switch(op)
+  {
+  /* binary operation */
+  case BC_AND:
+  case BC_XOR:
+  case BC_COFACTOR:
+  case BC_UNIV:
+  case BC_INTERSEC:
+  case BC_UNION:
+  case BC_SUBTRACT:
+    /* Try cache? */
+    if((B_CST(f) || B_RFC_ONE_NP(B_NP(f))) &&
+       (B_CST(g) || B_RFC_ONE_NP(B_NP(g)))) key = bddnull;
+    else
+    {
+      /* Checking Cache */
+      key = 0;
+      if(cache_get<P>(op, f, g, &h))
+      {
+        /* Hit */
+        if(!B_CST(h) && h != bddnull) { fp = B_NP(h); B_RFC_INC_P(fp); }
+        B_AP_RET(h);
+      }
+    }
+    /* Get (f0, f1) and (g0, g1)*/
+    z = 0;
+    fp = B_NP(f);
+    flev = B_CST(f)? 0: Var[B_VAR_NP(fp)].lev;
+    gp = B_NP(g);
+    glev = B_CST(g)? 0: Var[B_VAR_NP(gp)].lev;
+    f0 = f; f1 = f;
+    g0 = g; g1 = g;
+
+    if(flev <= glev)
+    {
+      v = B_VAR_NP(gp);
+      if(B_Z_NP(gp))
+      {
+        z = 1;
+        if(flev < glev) f1 = bddfalse;
+      }
+      g0 = B_GET_BDDP(gp->f0);
+      g1 = B_GET_BDDP(gp->f1);
+      if(B_NEG(g)^B_NEG(g0)) g0 = B_NOT(g0);
+      if(B_NEG(g) && !z) g1 = B_NOT(g1);
+    }
+
+    if(flev >= glev)
+    {
+      v = B_VAR_NP(fp);
+      if(B_Z_NP(fp))
+      {
+        z = 1;
+        if(flev > glev) g1 = bddfalse;
+      }
+      f0 = B_GET_BDDP(fp->f0);
+      f1 = B_GET_BDDP(fp->f1);
+      if(B_NEG(f)^B_NEG(f0)) f0 = B_NOT(f0);
+      if(B_NEG(f) && !z) f1 = B_NOT(f1);
+    }
+    break;
+
+  /* ZDD operation by the top v of f (f and g are not constant) */
+  case BC_ZDD_MULT:
+  case BC_ZDD_DIV:
+  case BC_ZDD_MEET:
+    /* Try cache? */
+    if(B_RFC_ONE_NP(B_NP(f)) && B_RFC_ONE_NP(B_NP(g))) key = bddnull;
+    else
+    {
+      /* Checking Cache */
+      key = 0;
+      if(cache_get<P>(op, f, g, &h))
+      {
+        /* Hit */
+        if(!B_CST(h) && h != bddnull) { fp = B_NP(h); B_RFC_INC_P(fp); }
+        B_AP_RET(h);
+      }
+    }
+    /* Get (f0, f1), and (g0, g1) if v is also the top of g (z = 1) */
+    fp = B_NP(f);
+    v = B_VAR_NP(fp);
+    f0 = B_GET_BDDP(fp->f0);
+    f1 = B_GET_BDDP(fp->f1);
+    if(B_NEG(f)^B_NEG(f0)) f0 = B_NOT(f0);
+    gp = B_NP(g);
+    z = (B_VAR_NP(gp) == v)? 1: 0;
+    g0 = g; g1 = g;
+    if(z)
+    {
+      g0 = B_GET_BDDP(gp->f0);
+      g1 = B_GET_BDDP(gp->f1);
+      if(B_NEG(g)^B_NEG(g0)) g0 = B_NOT(g0);
+    }
+    break;
+
+  /* ternary operation (f, g and k are not constant) */
+  case BC_ITE:
+    /* Try cache? */
+    if(B_RFC_ONE_NP(B_NP(f)) && B_RFC_ONE_NP(B_NP(g)) &&
+       B_RFC_ONE_NP(B_NP(k))) key = bddnull;
+    else
+    {
+      /* Checking Cache */
+      key = 0;
+      cache3p = cache3_find<P>(op, f, g, k);
+      if(cache3p)
+      {
+        /* Hit */
+        h = B_GET_BDDP(cache3p->h);
+        if(!B_CST(h) && h != bddnull) { fp = B_NP(h); B_RFC_INC_P(fp); }
+        B_AP_RET(h);
+      }
+    }
+    /* Get the top variable v and the cofactors by v */
+    z = 0;
+    fp = B_NP(f);
+    v = B_VAR_NP(fp);
+    flev = Var[v].lev;
+    gp = B_NP(g);
+    glev = Var[B_VAR_NP(gp)].lev;
+    if(glev > flev) { v = B_VAR_NP(gp); flev = glev; }
+    gp = B_NP(k);
+    glev = Var[B_VAR_NP(gp)].lev;
+    if(glev > flev) v = B_VAR_NP(gp);
+    B_AP_SPLIT(f, f0, f1);
+    B_AP_SPLIT(g, g0, g1);
+    B_AP_SPLIT(k, k0, k1);
+    break;
+
+  /* f and g with a cube k (not constant) */
+  case BC_ANDEXIST:
+    /* Try cache? */
+    if(B_RFC_ONE_NP(B_NP(f)) && B_RFC_ONE_NP(B_NP(g))) key = bddnull;
+    else
+    {
+      /* Checking Cache */
+      key = 0;
+      cache3p = cache3_find<P>(op, f, g, k);
+      if(cache3p)
+      {
+        /* Hit */
+        h = B_GET_BDDP(cache3p->h);
+        if(!B_CST(h) && h != bddnull) { fp = B_NP(h); B_RFC_INC_P(fp); }
+        B_AP_RET(h);
+      }
+    }
+    /* Get the top variable v, and quantify v if k0 != k */
+    z = 0;
+    fp = B_NP(f);
+    v = B_VAR_NP(fp);
+    flev = Var[v].lev;
+    gp = B_NP(g);
+    glev = Var[B_VAR_NP(gp)].lev;
+    if(glev > flev) v = B_VAR_NP(gp);
+    B_AP_SPLIT(f, f0, f1);
+    B_AP_SPLIT(g, g0, g1);
+    k0 = k;
+    if(B_VAR_NP(B_NP(k)) == v) k0 = B_ABS(B_GET_BDDP(B_NP(k)->f0));
+    k1 = k0;
+    break;
+
+  /* unary operation */
+  case BC_AT0:
+  case BC_AT1:
+  case BC_LSHIFT:
+  case BC_RSHIFT:
+  case BC_SUPPORT:
+  case BC_OFFSET:
+  case BC_ONSET:
+  case BC_CHANGE:
+    fp = B_NP(f);
+    if(B_RFC_ONE_NP(fp)) key = bddnull;
+    else
+    {
+      /* Checking Cache */
+      key = 0;
+      cachep = cache_find<P>(op, f, g);
+      if(cachep)
+      {
+        /* Hit */
+        h = B_GET_BDDP(cachep->h);
+        if(!B_CST(h) && h != bddnull) { fp = B_NP(h); B_RFC_INC_P(fp); }
+        B_AP_RET(h);
+      }
     }
-    free(Node);
-    Node = newNode;
+    /* Get (f0, f1)*/
+    v = B_VAR_NP(fp);
+    z = B_Z_NP(fp)? 1: 0;
+    f0 = B_GET_BDDP(fp->f0);
+    f1 = B_GET_BDDP(fp->f1);
+    if(B_NEG(f)^B_NEG(f0)) f0 = B_NOT(f0);
+    if(B_NEG(f) && !z) f1 = B_NOT(f1);
+    break;
+
+  case BC_CARD:
+  case BC_LIT:
+  case BC_LEN:
+    fp = B_NP(f);
+    if(B_RFC_ONE_NP(fp)) key = bddnull;
+    else
+    {
+      /* Checking Cache */
+      key = 0;
+      cachep = cache_find<P>(op, f, bddfalse);
+      if(cachep)
+      {
+        /* Hit */
+        B_AP_RET(B_GET_BDDP(cachep->h));
+      }
+    }
+    /* Get (f0, f1)*/
+    f0 = B_GET_BDDP(fp->f0);
+    f1 = B_GET_BDDP(fp->f1);
+    if(B_NEG(f)^B_NEG(f0)) f0 = B_NOT(f0);
+    break;
+
+  default:
+    err("apply: unknown opcode", op, ExceptionType::InternalError);
   }
-  else return 1; /* Not enough memory */
 
-  /* Initialize new space */
-  Node[newSpc-1U].varrfc = 0;
-  B_SET_BDDP(Node[newSpc-1U].nx, Avail);
-  for(i=NodeSpc; i<newSpc-1U; i++)
+  /* Get result node: the first sub-result comes back to B_AP_H0 */
+  switch(op)
   {
-    Node[i].varrfc = 0;
-    B_SET_BDDP(Node[i].nx, i+1U);
-  }
-  Avail = NodeSpc;
-  NodeSpc = newSpc;
+  case BC_AND:
+  case BC_XOR:
+  case BC_INTERSEC:
+  case BC_UNION:
+  case BC_SUBTRACT:
+  case BC_UNIV:
+    B_AP_CALL(f0, g0, op, 0, B_AP_H0);
 
-  /* Realloc Cache */
-  allocatecache();
-  /* if allocatecache returned false, only NodeTable has been enlarged */
-  return 0;
-}
+  case BC_ITE:
+  case BC_ANDEXIST:
+    B_AP_CALL3(f0, g0, k0, op, 0, B_AP_H0);
 
-static int hash_enlarge(bddvar v)
-/* Throws an exception if not enough memory */
-{
-  struct B_NodeTable *np, *np0;
-  struct B_VarTable *varp;
-  bddp i, oldSpc, newSpc, nx, key, f0, f1;
-  bddp_32 *newhash_32, *p_32;
-#ifndef B_32
-  bddp_h8 *newhash_h8, *p_h8;
-#endif
+  case BC_ZDD_DIV:
+    /* f1 / g1 first, as the quotient is empty if it is empty */
+    if(z) B_AP_CALL(f1, g1, op, 0, B_AP_H0);
+    B_AP_CALL(f0, g0, op, 0, B_AP_H0);
+
+  case BC_ZDD_MULT:
+  case BC_ZDD_MEET:
+    B_AP_CALL(f0, g0, op, 0, B_AP_H0);
+
+  case BC_COFACTOR:
+    if(g0 == bddfalse && g1 != bddfalse)
+      B_AP_CALL(f1, g1, op, 0, B_AP_END);
+    if(g1 == bddfalse && g0 != bddfalse)
+      B_AP_CALL(f0, g0, op, 0, B_AP_END);
+    B_AP_CALL(f0, g0, op, 0, B_AP_H0);
+
+  case BC_LSHIFT:
+  case BC_RSHIFT:
+    /* Get VarID of new level */
+    {
+      bddvar newlev; 
   
-  varp = &Var[v];
-  /* Get new size */
-  oldSpc = varp->hashSpc;
-  if(oldSpc == B_NODE_MAX + 1U)
-    return 0; /*  Cancel enlarging */
-  newSpc = oldSpc << 1U;
+      flev = bddlevofvar(v);
+      if(op == BC_LSHIFT)
+      {
+        newlev = flev + (bddvar)g;
+        if(newlev > VarUsed || newlev < flev)
+          err("apply: Invald shift", newlev, ExceptionType::OutOfRange);
+      }
+      else
+      {
+        newlev = flev - (bddvar)g;
+        if(newlev == 0 || newlev > flev)
+          err("apply: Invald shift", newlev, ExceptionType::OutOfRange);
+      }
+      v = bddvaroflev(newlev);
+    }
+    B_AP_CALL(f0, g, op, 0, B_AP_H0);
 
-  /* Enlarge space */
-#ifndef B_32
-  newhash_32 = 0;
-  newhash_h8 = 0;
-  newhash_32 = B_MALLOC(bddp_32, newSpc);
-  newhash_h8 = B_MALLOC(bddp_h8, newSpc);
-  if(newhash_32 && newhash_h8)
+  case BC_AT0:
+  case BC_AT1:
+  case BC_OFFSET:
+  case BC_ONSET:
+  case BC_CHANGE:
+    B_AP_CALL(f0, g, op, 0, B_AP_H0);
+
+  case BC_SUPPORT:
+  case BC_CARD:
+  case BC_LIT:
+  case BC_LEN:
+    B_AP_CALL(f0, bddfalse, op, 0, B_AP_H0);
+
+  default:
+    err("apply: unknown opcode", op, ExceptionType::InternalError);
+    break;
+  }
+
+ret:
+  /* Return h to the caller */
+  if(sp == stack.data())
   {
-    for(i=0; i<varp->hashSpc; i++)
+    /* Reorder at the end of an operation returning a node, but not in
+     * a thread of the parallel apply */
+    if(!P && ReorderNext != 0 && NodeUsed >= ReorderNext &&
+       op != BC_CARD && op != BC_LIT && op != BC_LEN)
     {
-      newhash_32[i] = varp->hash_32[i];
-      newhash_h8[i] = varp->hash_h8[i];
+      bddreorder();
+      ReorderNext = (NodeUsed < ReorderLimit>>1U)? ReorderLimit: NodeUsed<<1U;
     }
-    free(varp->hash_32);
-    free(varp->hash_h8);
-    varp->hash_32 = newhash_32;
-    varp->hash_h8 = newhash_h8;
+    return h;
   }
-  else
+  sp--;
+  f = sp->f; g = sp->g; k = sp->k; key = sp->key;
+  f0 = sp->f0; f1 = sp->f1; g0 = sp->g0; g1 = sp->g1;
+  k0 = sp->k0; k1 = sp->k1; h0 = sp->h0; h1 = sp->h1;
+  v = sp->v; op = sp->op; z = sp->z; state = sp->state;
+
+  switch(state)
   {
-    bddp memsize = 0;
-    if(newhash_32) {
-      free(newhash_32);
-    } else {
-      memsize += sizeof(bddp_32) * newSpc;
+  case B_AP_NOT:
+    if(h != bddnull) h = B_NOT(h);
+    goto ret;
+
+  case B_AP_INC:
+    if(h < bddnull) h++;
+    else h = bddnull;
+    goto ret;
+
+  case B_AP_END:
+    goto finish;
+
+  case B_AP_H0:
+    /* h is the result for (f0, g0) */
+    h0 = h;
+    if(op == BC_LIT || op == BC_LEN)
+      B_AP_CALL(f1, bddfalse, op, 0, B_AP_H1);
+    if(h0 == bddnull) goto finish; /* Overflow */
+    switch(op)
+    {
+    case BC_SUPPORT:
+    case BC_CARD:
+      B_AP_CALL(f1, bddfalse, op, 0, B_AP_H1);
+    case BC_UNIV:
+      B_AP_CALL(f1, g0, op, 0, B_AP_H1);
+    case BC_AT0:
+    case BC_AT1:
+    case BC_OFFSET:
+    case BC_ONSET:
+    case BC_CHANGE:
+    case BC_LSHIFT:
+    case BC_RSHIFT:
+      B_AP_CALL(f1, g, op, 0, B_AP_H1);
+    case BC_ANDEXIST:
+      if(k0 != k && h0 == bddtrue) goto finish; /* The disjunction is true */
+      B_AP_CALL3(f1, g1, k1, op, 0, B_AP_H1);
+    case BC_ZDD_DIV:
+      if(!z) B_AP_CALL(f1, g, op, 0, B_AP_H1);
+      if(h0 == bddfalse || g0 == bddfalse) goto finish; /* h0 is the result */
+      B_AP_CALL(f0, g0, op, 0, B_AP_H1);
+    case BC_ZDD_MULT:
+    case BC_ZDD_MEET:
+      /* f1 * g0, or the meet of f1 and g0 */
+      B_AP_CALL(f1, g0, op, 0, B_AP_H1);
+    case BC_ITE:
+      B_AP_CALL3(f1, g1, k1, op, 0, B_AP_H1);
+    default:
+      B_AP_CALL(f1, g1, op, 0, B_AP_H1);
     }
-    if(newhash_h8) {
-      free(newhash_h8);
-    } else {
-      memsize += sizeof(bddp_h8) * newSpc;
+
+  case B_AP_H1:
+    /* h is the result for (f1, g1) */
+    h1 = h;
+    switch(op)
+    {
+    case BC_CARD:
+      if(h1 == bddnull) break;
+      h = h0 + h1;
+      if(h >= bddnull) h = bddnull;
+      break;
+
+    case BC_LIT:
+      h0 += h1;
+      if(h0 >= bddnull) h0 = bddnull;
+      B_AP_CALL(f1, bddfalse, BC_CARD, 0, B_AP_H2);
+
+    case BC_LEN:
+      h1 = h + 1;
+      h = (h0 < h1)? h1: h0;
+      break;
+
+    case BC_UNIV:
+      if(h1 == bddnull) { rfc_free<P>(h0); break; } /* Overflow */
+      if(g0 != g1) B_AP_CALL(h0, h1, BC_AND, 0, B_AP_H2);
+      h = getbddp<P>(v, h0, h1);
+      if(h == bddnull) { rfc_free<P>(h0); rfc_free<P>(h1); } /* Overflow */
+      break;
+
+    case BC_SUPPORT:
+      if(h1 == bddnull) { rfc_free<P>(h0); break; } /* Overflow */
+      if(z) B_AP_CALL(h0, h1, BC_UNION, 0, B_AP_H2);
+      B_AP_CALL(B_NOT(h0), B_NOT(h1), BC_AND, 0, B_AP_H2);
+
+    case BC_ANDEXIST:
+      if(h1 == bddnull) { rfc_free<P>(h0); break; } /* Overflow */
+      if(k0 != k) B_AP_CALL(B_NOT(h0), B_NOT(h1), BC_AND, 0, B_AP_H2);
+      h = getbddp<P>(v, h0, h1);
+      if(h == bddnull) { rfc_free<P>(h0); rfc_free<P>(h1); } /* Overflow */
+      break;
+
+    case BC_ZDD_MULT:
+      /* h0 = f0 * g0 without v, h1 = f1 * g0 with v so far */
+      if(h1 == bddnull) { rfc_free<P>(h0); break; } /* Overflow */
+      if(z) B_AP_CALL(f1, g1, op, 0, B_AP_H2);
+      h = getzddp<P>(v, h0, h1);
+      if(h == bddnull) { rfc_free<P>(h0); rfc_free<P>(h1); } /* Overflow */
+      break;
+
+    case BC_ZDD_DIV:
+      /* The quotient has no v if z */
+      if(h1 == bddnull) { rfc_free<P>(h0); break; } /* Overflow */
+      if(z) B_AP_CALL(h0, h1, BC_INTERSEC, 0, B_AP_H2);
+      h = getzddp<P>(v, h0, h1);
+      if(h == bddnull) { rfc_free<P>(h0); rfc_free<P>(h1); } /* Overflow */
+      break;
+
+    case BC_ZDD_MEET:
+      /* The meets without v are joined into h0 */
+      if(h1 == bddnull) { rfc_free<P>(h0); break; } /* Overflow */
+      B_AP_CALL(h0, h1, BC_UNION, 0, B_AP_H2);
+
+    default:
+      if(h1 == bddnull) { rfc_free<P>(h0); break; } /* Overflow */
+      h = z? getzddp<P>(v, h0, h1): getbddp<P>(v, h0, h1);
+      if(h == bddnull) { rfc_free<P>(h0); rfc_free<P>(h1); } /* Overflow */
+      break;
     }
-    throw BDDOutOfMemoryException("hash_enlarge: not enough memory for hash table", memsize);
+    goto finish;
+
+  case B_AP_H2:
+    /* h is the result of the operation on (h0, h1) */
+    switch(op)
+    {
+    case BC_LIT:
+      h += h0;
+      if(h >= bddnull) h = bddnull;
+      break;
+
+    case BC_UNIV:
+      rfc_free<P>(h0); rfc_free<P>(h1);
+      break;
+
+    case BC_ANDEXIST:
+      /* h is the negation of the disjunction of h0 and h1 */
+      rfc_free<P>(h0); rfc_free<P>(h1);
+      if(h != bddnull) h = B_NOT(h);
+      break;
+
+    case BC_ZDD_MULT:
+      /* h is f1 * g1 */
+      if(h == bddnull) { rfc_free<P>(h0); rfc_free<P>(h1); break; } /* Overflow */
+      k0 = h;
+      B_AP_CALL(h1, k0, BC_UNION, 0, B_AP_H3);
+
+    case BC_ZDD_DIV:
+      rfc_free<P>(h0); rfc_free<P>(h1);
+      break;
+
+    case BC_ZDD_MEET:
+      rfc_free<P>(h0); rfc_free<P>(h1);
+      if(h == bddnull || !z) break;
+      h0 = h;
+      B_AP_CALL(f0, g1, op, 0, B_AP_H3);
+
+    case BC_SUPPORT:
+      rfc_free<P>(h0); rfc_free<P>(h1);
+      if(h == bddnull) break; /* Overflow */
+      h0 = h;
+      h = z? getzddp<P>(v, h0, bddtrue):
+             getbddp<P>(v, B_NOT(h0), bddtrue);
+      if(h == bddnull) rfc_free<P>(h0); /* Overflow */
+      break;
+
+    default:
+      break;
+    }
+    goto finish;
+
+  case B_AP_H3:
+    if(op == BC_ZDD_MULT)
+    {
+      rfc_free<P>(h1); rfc_free<P>(k0);
+      if(h == bddnull) { rfc_free<P>(h0); goto finish; } /* Overflow */
+      h1 = h;
+      B_AP_CALL(f0, g1, op, 0, B_AP_H4);
+    }
+    /* BC_ZDD_MEET: h is the meet of f0 and g1 */
+    if(h == bddnull) { rfc_free<P>(h0); goto finish; } /* Overflow */
+    k0 = h;
+    B_AP_CALL(h0, k0, BC_UNION, 0, B_AP_H4);
+
+  case B_AP_H4:
+    if(op == BC_ZDD_MULT)
+    {
+      /* h is f0 * g1 */
+      if(h == bddnull) { rfc_free<P>(h0); rfc_free<P>(h1); goto finish; } /* Overflow */
+      k0 = h;
+      B_AP_CALL(h1, k0, BC_UNION, 0, B_AP_H5);
+    }
+    rfc_free<P>(h0); rfc_free<P>(k0);
+    if(h == bddnull) goto finish; /* Overflow */
+    h0 = h;
+    B_AP_CALL(f1, g1, op, 0, B_AP_H5);
+
+  case B_AP_H5:
+    if(op == BC_ZDD_MULT) { rfc_free<P>(h1); rfc_free<P>(k0); }
+    if(h == bddnull) { rfc_free<P>(h0); goto finish; } /* Overflow */
+    h1 = h;
+    h = getzddp<P>(v, h0, h1);
+    if(h == bddnull) { rfc_free<P>(h0); rfc_free<P>(h1); } /* Overflow */
+    goto finish;
+
+  default:
+    err("apply: illegal state", state, ExceptionType::InternalError);
+    break;
   }
-#else
-  newhash_32 = 0;
-  newhash_32 = B_MALLOC(bddp_32, newSpc);
-  if(newhash_32)
+
+finish:
+  /* Saving to Cache */
+  if(key != bddnull && (op == BC_ITE || op == BC_ANDEXIST))
+    cache3_store<P>(op, f, g, k, h);
+  else if(key != bddnull)
   {
-    for(i=0; i<varp->hashSpc; i++) newhash_32[i] = varp->hash_32[i];
-    free(varp->hash_32);
-    varp->hash_32 = newhash_32;
+    cache_store<P>(op, f, g, h);
+    if(h == f) switch(op)
+    {
+    case BC_AT0:
+      cache_store<P>(BC_AT1, f, g, h);
+      break;
+    case BC_AT1:
+      cache_store<P>(BC_AT0, f, g, h);
+      break;
+    case BC_OFFSET:
+      cache_store<P>(BC_ONSET, f, g, bddfalse);
+      break;
+    default:
+      break;
+    }
+    if(h == bddfalse && op == BC_ONSET)
+      cache_store<P>(BC_OFFSET, f, g, f);
   }
-  else {
-    bddp memsize = sizeof(bddp_32) * newSpc;
-    throw BDDOutOfMemoryException("hash_enlarge: not enough memory for hash table", memsize);
-  } /* Not enough memory */
-#endif
-  varp->hashSpc = newSpc;
+  goto ret;
+}
+
+#undef B_AP_RET
+#undef B_AP_SPLIT
+#undef B_AP_CALL
+#undef B_AP_CALL3
+
+static bddp apply2(bddp f, bddp g, unsigned char op)
+/* apply() of a binary operation, or apply_bfs() if bddbfsapply() asks
+ * for it or the operands have BFSThreshold nodes or more, or
+ * apply_par() if ApplyThreads is more than one */
+{
+  bddp a, b, h;
+  char neg;
+
+  if(B_BFSForce) { B_BFSForce = 0; return apply_bfs(f, g, op); }
+  if(ApplyThreads > 1 && !B_CST(f) && !B_CST(g)) return apply_par(f, g, op);
+  if(BFSThreshold != 0 && NodeUsed >= BFSThreshold &&
+     !B_CST(f) && !B_CST(g))
+  {
+    /* Terminal cases and cached results are left to apply(), and the
+     * operands are counted only up to BFSThreshold nodes */
+    a = f; b = g;
+    if(!bfs_term(op, &a, &b, &h, &neg) && !cache_peek(op, a, b) &&
+       bfs_large(a, b)) return apply_bfs(f, g, op);
+  }
+  return apply(f, g, op, 0);
+}
+
+static int bfs_large(bddp f, bddp g)
+/* Returns 1 if f and g have BFSThreshold nodes or more. At most
+ * BFSThreshold nodes are visited. */
+{
+  bddp c;
+  struct B_NodeTable *fp;
+  B_VisitScope vs;
+  B_StackScope<bddp> scope(B_Stack);
+
+  c = 0;
+  B_Stack.push_back(g);
+  B_Stack.push_back(f);
+  while(B_Stack.size() > scope.base)
+  {
+    f = B_Stack.back();
+    B_Stack.pop_back();
+    if(B_CST(f) || !visit(f)) continue;
+    if(++c >= BFSThreshold) return 1;
+    fp = B_NP(f);
+    B_Stack.push_back(B_GET_BDDP(fp->f1));
+    B_Stack.push_back(B_GET_BDDP(fp->f0));
+  }
+  return 0;
+}
+
+/* Request of apply_bfs() for an operation on (f, g) */
+struct B_BfsReq
+{
+  bddp f, g;   /* Operands */
+  bddp c[2];   /* Results for the cofactors, or (request << 1) | negation */
+  bddp h;      /* Result */
+  bddvar v;    /* Top variable */
+  char z;      /* Nonzero for a ZDD node */
+  char req[2]; /* Nonzero if c[i] is a request */
+};
 
-  /* Initialize new hash entry */
-  for(i=oldSpc; i<newSpc; i++)
-  {
-    B_SET_NXP(p, varp->hash, i);
-    B_SET_BDDP(*p, bddnull);
-  }
+/* Pair (f, g) waiting in the queue of its level */
+struct B_BfsPend
+{
+  bddp f, g;
+  size_t parent; /* Request waiting for the result (SIZE_MAX: the root) */
+  char slot;     /* Child of the parent */
+  char neg;      /* Nonzero if the parent takes the negation */
+};
+
+static int bfs_term(unsigned char op, bddp *f, bddp *g, bddp *h, char *neg)
+/* Returns 1 with the result h for a terminal case of apply_bfs(). No
+ * reference of h is taken. Otherwise returns 0 with the operands f and
+ * g normalized as apply() does; neg is set if the result of BC_XOR is
+ * to be negated. */
+{
+  bddp t;
 
-  /* restore hash entry */
-  for(i=0; i<oldSpc; i++)
+  *neg = 0;
+  switch(op)
   {
-    np0 = 0;
-    B_SET_NXP(p, varp->hash, i);
-    nx = B_GET_BDDP(*p);
-    while(nx != bddnull)
+  case BC_AND:
+    if(*f == bddfalse || *g == bddfalse || *f == B_NOT(*g))
+      { *h = bddfalse; return 1; }
+    if(*f == *g || *g == bddtrue) { *h = *f; return 1; }
+    if(*f == bddtrue) { *h = *g; return 1; }
+    break;
+
+  case BC_XOR:
+    if(*f == *g) { *h = bddfalse; return 1; }
+    if(*f == B_NOT(*g)) { *h = bddtrue; return 1; }
+    if(*f == bddfalse) { *h = *g; return 1; }
+    if(*g == bddfalse) { *h = *f; return 1; }
+    if(*f == bddtrue) { *h = B_NOT(*g); return 1; }
+    if(*g == bddtrue) { *h = B_NOT(*f); return 1; }
+    if(B_NEG(*f) && B_NEG(*g)) { *f = B_NOT(*f); *g = B_NOT(*g); }
+    else if(B_NEG(*f) || B_NEG(*g))
     {
-      np = Node + nx;
-      f0 = B_GET_BDDP(np->f0);
-      f1 = B_GET_BDDP(np->f1);
-      key = B_HASHKEY(f0, f1, newSpc);
-      if(key == i) np0 = np;
-      else
-      {
-        if(np0) B_CPY_BDDP(np0->nx, np->nx);
-        else { B_SET_NXP(p, varp->hash, i); B_CPY_BDDP(*p, np->nx); }
-        B_SET_NXP(p, varp->hash, key);
-        B_CPY_BDDP(np->nx, *p);
-        B_SET_BDDP(*p, nx);
-      }
-      if(np0) nx = B_GET_BDDP(np0->nx);
-      else { B_SET_NXP(p, varp->hash, i); nx = B_GET_BDDP(*p); }
+      *f = B_ABS(*f); *g = B_ABS(*g);
+      *neg = 1;
     }
+    break;
+
+  case BC_INTERSEC:
+    if(*f == bddfalse || *g == bddfalse) { *h = bddfalse; return 1; }
+    if(*f == bddtrue) { *h = B_NEG(*g)? bddtrue: bddfalse; return 1; }
+    if(*g == bddtrue) { *h = B_NEG(*f)? bddtrue: bddfalse; return 1; }
+    if(*f == *g) { *h = *f; return 1; }
+    if(*f == B_NOT(*g)) { *h = B_ABS(*f); return 1; }
+    break;
+
+  case BC_UNION:
+    if(*f == bddfalse) { *h = *g; return 1; }
+    if(*f == bddtrue) { *h = B_NEG(*g)? *g: B_NOT(*g); return 1; }
+    if(*g == bddfalse || *f == *g) { *h = *f; return 1; }
+    if(*g == bddtrue || *f == B_NOT(*g))
+      { *h = B_NEG(*f)? *f: B_NOT(*f); return 1; }
+    break;
+
+  case BC_SUBTRACT:
+    if(*f == bddfalse || *f == *g) { *h = bddfalse; return 1; }
+    if(*f == bddtrue || *f == B_NOT(*g))
+      { *h = B_NEG(*g)? bddfalse: bddtrue; return 1; }
+    if(*g == bddfalse) { *h = *f; return 1; }
+    if(*g == bddtrue) { *h = B_ABS(*f); return 1; }
+    return 0; /* Not commutative */
+
+  default:
+    err("apply_bfs: unknown opcode", op, ExceptionType::InternalError);
   }
+  if(*f < *g) { t = *f; *f = *g; *g = t; } /* swap (f, g) */
   return 0;
 }
 
-static bddp getnode(bddvar v, bddp f0, bddp f1)
-/* Throws an exception if not enough memory */
+static bddp apply_bfs(bddp f, bddp g, unsigned char op)
+/* apply() of a binary operation (BC_AND, BC_XOR, BC_INTERSEC, BC_UNION
+ * or BC_SUBTRACT) level by level. The pairs of operands are expanded
+ * from the top level to the bottom, where the pairs of a level are
+ * sorted and merged, so that the nodes are read in the order of their
+ * indices. The result nodes are then made from the bottom level to the
+ * top, one level at a time. Returns bddnull if not enough memory. */
 {
-  /* After checking elimination rule & negative edge rule */
-  struct B_NodeTable *np, *fp;
-  struct B_VarTable *varp;
-  bddp ix, nx, key;
-  bddp_32 *p_32;
-#ifndef B_32
-  bddp_h8 *p_h8;
-#endif
+  std::vector<std::vector<struct B_BfsPend> > pend;
+  std::vector<struct B_BfsReq> req;
+  std::vector<size_t> begin;
+  struct B_BfsReq *rp;
+  struct B_NodeTable *fp, *gp;
+  struct B_CacheTable *cachep;
+  bddp h, a, b, x[2], f0, f1, g0, g1, root;
+  bddvar lev, flev, glev;
+  size_t i, id, n;
+  char neg, s, rootneg;
 
-  varp = &Var[v];
-  if(varp->hashSpc == 0)
-  /* Create hash-table */
+  if(bfs_term(op, &f, &g, &h, &neg))
   {
-    varp->hash_32 = 0;
-    varp->hash_32 = B_MALLOC(bddp_32, B_HASH_SPC0);
-    if(!varp->hash_32) throw BDDOutOfMemoryException("getnode: not enough memory for hash table", sizeof(bddp_32) * B_HASH_SPC0);
-#ifndef B_32
-    varp->hash_h8 = 0;
-    varp->hash_h8 = B_MALLOC(bddp_h8, B_HASH_SPC0);
-    if(!varp->hash_h8)
+    if(!B_CST(h)) { fp = B_NP(h); B_RFC_INC_NP(fp); }
+    return h;
+  }
+
+  /* Releases the results held by the requests */
+  auto release = [&](void)
+  {
+    for(i=0; i<req.size(); i++)
     {
-      free(varp->hash_32);
-      throw BDDOutOfMemoryException("getnode: not enough memory for hash table", sizeof(bddp_h8) * B_HASH_SPC0);
+      bddfree(req[i].h);
+      for(s=0; s<2; s++) if(!req[i].req[(int)s]) bddfree(req[i].c[(int)s]);
     }
-#endif
-    for(ix=0; ix<B_HASH_SPC0; ix++)
+  };
+
+  try
+  {
+    pend.resize(VarUsed + 1U);
+    begin.assign(VarUsed + 1U, 0);
+    flev = Var[B_VAR_NP(B_NP(f))].lev;
+    glev = Var[B_VAR_NP(B_NP(g))].lev;
+    pend[(flev > glev)? flev: glev].push_back({f, g, SIZE_MAX, 0, neg});
+    root = 0;
+    rootneg = 0;
+
+    /* Expand the requests from the top level */
+    for(lev=VarUsed; lev>0; lev--)
     {
-      B_SET_NXP(p, varp->hash, ix);
-      B_SET_BDDP(*p, bddnull);
+      std::vector<struct B_BfsPend> &q = pend[lev];
+      begin[lev] = req.size();
+      std::sort(q.begin(), q.end(),
+        [](const struct B_BfsPend &p, const struct B_BfsPend &r)
+          { return p.f != r.f? p.f < r.f: p.g < r.g; });
+      for(i=0; i<q.size(); i++)
+      {
+        if(i == 0 || q[i].f != q[i-1].f || q[i].g != q[i-1].g)
+        {
+          req.push_back(B_BfsReq());
+          rp = &req.back();
+          rp->f = q[i].f; rp->g = q[i].g;
+          rp->h = bddnull;
+          rp->c[0] = rp->c[1] = bddnull;
+          rp->req[0] = rp->req[1] = 0;
+        }
+        id = req.size() - 1U;
+        if(q[i].parent == SIZE_MAX) { root = id; rootneg = q[i].neg; continue; }
+        rp = &req[q[i].parent];
+        rp->c[(int)q[i].slot] = (id << 1U) | (bddp)q[i].neg;
+        rp->req[(int)q[i].slot] = 1;
+      }
+      std::vector<struct B_BfsPend>().swap(q);
+
+      for(id=begin[lev]; id<req.size(); id++)
+      {
+        rp = &req[id];
+        f = rp->f; g = rp->g;
+
+        /* Get (f0, f1) and (g0, g1) as apply() */
+        rp->z = 0;
+        fp = B_NP(f);
+        flev = Var[B_VAR_NP(fp)].lev;
+        gp = B_NP(g);
+        glev = Var[B_VAR_NP(gp)].lev;
+        f0 = f; f1 = f;
+        g0 = g; g1 = g;
+        if(flev <= glev)
+        {
+          rp->v = B_VAR_NP(gp);
+          if(B_Z_NP(gp))
+          {
+            rp->z = 1;
+            if(flev < glev) f1 = bddfalse;
+          }
+          g0 = B_GET_BDDP(gp->f0);
+          g1 = B_GET_BDDP(gp->f1);
+          if(B_NEG(g)^B_NEG(g0)) g0 = B_NOT(g0);
+          if(B_NEG(g) && !rp->z) g1 = B_NOT(g1);
+        }
+        if(flev >= glev)
+        {
+          rp->v = B_VAR_NP(fp);
+          if(B_Z_NP(fp))
+          {
+            rp->z = 1;
+            if(flev > glev) g1 = bddfalse;
+          }
+          f0 = B_GET_BDDP(fp->f0);
+          f1 = B_GET_BDDP(fp->f1);
+          if(B_NEG(f)^B_NEG(f0)) f0 = B_NOT(f0);
+          if(B_NEG(f) && !rp->z) f1 = B_NOT(f1);
+        }
+
+        /* A child is a result, or a request of a lower level */
+        for(s=0; s<2; s++)
+        {
+          a = s? f1: f0;
+          b = s? g1: g0;
+          if(!bfs_term(op, &a, &b, &h, &neg))
+          {
+            cachep = cache_find(op, a, b);
+            if(!cachep || (h = B_GET_BDDP(cachep->h)) == bddnull)
+            {
+              flev = Var[B_VAR_NP(B_NP(a))].lev;
+              glev = Var[B_VAR_NP(B_NP(b))].lev;
+              pend[(flev > glev)? flev: glev].push_back({a, b, id, s, neg});
+              continue;
+            }
+            if(neg) h = B_NOT(h);
+          }
+          if(!B_CST(h)) { fp = B_NP(h); B_RFC_INC_NP(fp); }
+          rp->c[(int)s] = h;
+        }
+      }
     }
-    varp->hashSpc = B_HASH_SPC0;
-    key = B_HASHKEY(f0, f1, varp->hashSpc);
-  }
-  else
-  /* Looking for equivalent existing node */
-  {
-    key = B_HASHKEY(f0, f1, varp->hashSpc);
-    B_SET_NXP(p, varp->hash, key);
-    nx = B_GET_BDDP(*p);
-    while(nx != bddnull)
+
+    /* Make the nodes from the bottom level. The requests of lev are
+     * from begin[lev] to begin[lev-1]. */
+    for(lev=1; lev<=VarUsed; lev++)
     {
-      np = Node + nx;
-      if(f0 == B_GET_BDDP(np->f0) &&
-         f1 == B_GET_BDDP(np->f1) )
+      n = (lev == 1)? req.size(): begin[lev-1U];
+      for(id=begin[lev]; id<n; id++)
       {
-        /* Sharing equivalent node */
-        if(!B_CST(f0)) { fp = B_NP(f0); B_RFC_DEC_NP(fp); }
-        if(!B_CST(f1)) { fp = B_NP(f1); B_RFC_DEC_NP(fp); }
-        B_RFC_INC_NP(np);
-        return B_BDDP_NP(np);
+        rp = &req[id];
+        for(s=0; s<2; s++)
+        {
+          x[(int)s] = rp->c[(int)s];
+          if(rp->req[(int)s])
+            x[(int)s] = req[x[(int)s]>>1U].h ^ (x[(int)s] & B_INV_MASK);
+          if(!B_CST(x[(int)s])) { fp = B_NP(x[(int)s]); B_RFC_INC_NP(fp); }
+        }
+        h = rp->z? getzddp(rp->v, x[0], x[1]): getbddp(rp->v, x[0], x[1]);
+        if(h == bddnull)
+        {
+          bddfree(x[0]); bddfree(x[1]);
+          release();
+          return bddnull;
+        }
+        rp->h = h;
       }
-      nx = B_GET_BDDP(np->nx);
     }
   }
+  catch(...)
+  {
+    release();
+    throw;
+  }
 
-  /* Check hash-table overflow */
-  if(++ varp->hashUsed >= varp->hashSpc)
+  /* Save the results to the cache */
+  for(id=0; id<req.size(); id++) cache_store(op, req[id].f, req[id].g, req[id].h);
+  h = req[root].h;
+  if(rootneg) h = B_NOT(h);
+  if(!B_CST(h)) { fp = B_NP(h); B_RFC_INC_NP(fp); }
+  release();
+
+  /* Reorder at the end of an operation as apply() */
+  if(ReorderNext != 0 && NodeUsed >= ReorderNext)
   {
-    if(hash_enlarge(v)) throw BDDOutOfMemoryException("getnode: "
-      "not enough memory for hash table", sizeof(bddp_32) * varp->hashSpc); /* Hash-table overflow */
-    key = B_HASHKEY(f0, f1, varp->hashSpc); /* Enlarge success */
+    bddreorder();
+    ReorderNext = (NodeUsed < ReorderLimit>>1U)? ReorderLimit: NodeUsed<<1U;
   }
+  return h;
+}
 
-  /* Check node-table overflow */
-  if(NodeUsed >= NodeSpc-1U)
+static int rfc_inc_par(struct B_NodeTable *np)
+/* B_RFC_INC_NP for the parallel apply. A counter near the limit, or
+ * held in RFC-table, is changed under the lock of RFC-table. */
+{
+  unsigned int rfc;
+
+  rfc = __atomic_load_n(&np->varrfc, __ATOMIC_RELAXED);
+  for(;;)
   {
-    if(node_enlarge())
+    if(rfc >= B_RFC_MASK - B_RFC_UNIT)
     {
-      if(bddgc()) throw BDDOutOfMemoryException("getnode: "
-        "not enough memory for node table", 0); /* Node-table overflow */
-      key = B_HASHKEY(f0, f1, varp->hashSpc);
+      std::lock_guard<std::mutex> lock(ParPool->ovf);
+      rfc = __atomic_load_n(&np->varrfc, __ATOMIC_RELAXED);
+      if(rfc >= B_RFC_MASK - B_RFC_UNIT) return rfc_inc_ovf(np);
+      continue;
     }
-    /* Node-table enlarged or GC succeeded */
+    if(__atomic_compare_exchange_n(&np->varrfc, &rfc, rfc + B_RFC_UNIT, 1,
+                                   __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+      return 0;
   }
-  NodeUsed++;
-
-  /* Creating a new node */
-  nx = Avail;
-  np = Node + nx;
-  Avail = B_GET_BDDP(np->nx);
-  B_SET_NXP(p, varp->hash, key);
-  B_CPY_BDDP(np->nx, *p);
-  B_SET_BDDP(*p, nx);
-  B_SET_BDDP(np->f0, f0);
-  B_SET_BDDP(np->f1, f1);
-  np->varrfc = v;
-  B_RFC_INC_NP(np);
-  return B_BDDP_NP(np);
 }
 
-static bddp getbddp(bddvar v, bddp f0, bddp f1)
-/* Returns bddnull if not enough memory */
+static int rfc_dec_par(struct B_NodeTable *np)
+/* B_RFC_DEC_NP for the parallel apply */
 {
-  struct B_NodeTable *fp;
+  unsigned int rfc;
 
-  /* Check elimination rule */
-  if(f0 == f1)
+  rfc = __atomic_load_n(&np->varrfc, __ATOMIC_RELAXED);
+  for(;;)
   {
-    if(!B_CST(f0)) { fp = B_NP(f0); B_RFC_DEC_NP(fp); }
-    return f0;
+    if(rfc >= B_RFC_MASK - B_RFC_UNIT)
+    {
+      std::lock_guard<std::mutex> lock(ParPool->ovf);
+      rfc = __atomic_load_n(&np->varrfc, __ATOMIC_RELAXED);
+      if(rfc >= B_RFC_MASK) return rfc_dec_ovf(np);
+      if(rfc >= B_RFC_MASK - B_RFC_UNIT)
+      {
+        __atomic_store_n(&np->varrfc, rfc - B_RFC_UNIT, __ATOMIC_RELAXED);
+        return 0;
+      }
+      continue;
+    }
+    if(rfc < B_RFC_UNIT)
+      err("B_RFC_DEC_NP: rfc under flow", np-Node, ExceptionType::InternalError);
+    if(__atomic_compare_exchange_n(&np->varrfc, &rfc, rfc - B_RFC_UNIT, 1,
+                                   __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+      return 0;
   }
+}
 
-  /* Negative edge constraint */
-  if(B_NEG(f0))
-  {
-    bddp h;
+static bddp par_node(void)
+/* Returns the index of a free node for this thread, which takes
+ * B_PAR_BATCH nodes from the free list at a time. Returns bddnull if
+ * the node table is full. */
+{
+  struct B_ParBatch *bp;
+  bddp ix, n, i;
 
-    h = getnode(v, B_NOT(f0), B_NOT(f1));
-    if(h == bddnull) return bddnull;
-    return B_NOT(h);
+  bp = &ParPool->batch[B_ParSelf];
+  if(bp->n == 0)
+  {
+    std::lock_guard<std::mutex> lock(ParPool->alloc);
+    if(NodeUsed >= NodeSpc-1U && (ParPool->full || node_enlarge()))
+    {
+      /* GC is left to the caller of the parallel apply */
+      ParPool->full = 1;
+      return bddnull;
+    }
+    n = NodeSpc - 1U - NodeUsed;
+    if(n > B_PAR_BATCH) n = B_PAR_BATCH;
+    bp->head = Avail;
+    ix = Avail;
+    for(i=1; i<n; i++) ix = B_GET_BDDP(Node[ix].nx);
+    Avail = B_GET_BDDP(Node[ix].nx);
+    bp->n = n;
+    NodeUsed += n;
   }
-  return getnode(v, f0, f1);
+  ix = bp->head;
+  bp->head = B_GET_BDDP(Node[ix].nx);
+  bp->n--;
+  return ix;
 }
 
-static bddp apply(bddp f, bddp g, unsigned char op, unsigned char skip)
-/* Returns bddnull if not enough memory */
+static bddp getnode_par(bddvar v, bddp f0, bddp f1)
+/* getnode() for the parallel apply. The unique table of v is locked
+ * while it is looked up and the node is added. Returns bddnull if the
+ * node table is full, where f0 and f1 are not released. */
 {
-  struct B_NodeTable *fp, *gp;
-  struct B_CacheTable *cachep;
-  /* Some initial values are not used, but 
-  we set them to suppress compiler warnings */
-  bddp key, f0, f1, g0 = 0, g1 = 0, h0, h1, h;
-  bddvar v = 0, flev, glev;
-  char z = 0; /* flag to check ZDD node */
+  struct B_NodeTable *np, *fp;
+  struct B_VarTable *varp;
+  bddp nx;
 
-  /* Check terminal case */
-  if(!skip) switch(op)
+  std::lock_guard<std::mutex> lock(ParPool->varlock[v]);
+  varp = &Var[v];
+  if(varp->hashSpc == 0) hash_create(varp); /* Create hash-table */
+  else
+  /* Looking for equivalent existing node */
   {
-  case BC_AND: 
-    /* Check trivial cases */
-    if(f == bddfalse || g == bddfalse || f == B_NOT(g))
-      return bddfalse;
-    if(f == g)
+    nx = ut_lookup(varp, f0, f1);
+    if(nx != bddnull)
     {
-      if(f != bddtrue) { fp = B_NP(f); B_RFC_INC_NP(fp); }
-      return f;
+      /* Sharing equivalent node */
+      np = Node + nx;
+      if(!B_CST(f0)) { fp = B_NP(f0); rfc_dec_par(fp); }
+      if(!B_CST(f1)) { fp = B_NP(f1); rfc_dec_par(fp); }
+      rfc_inc_par(np);
+      return B_BDDP_NP(np);
     }
-    if(f == bddtrue) { fp = B_NP(g); B_RFC_INC_NP(fp); return g; }
-    if(g == bddtrue) { fp = B_NP(f); B_RFC_INC_NP(fp); return f; }
-    /* Check operand swap */
-    if(f < g) { h = f; f = g; g = h; } /* swap (f, g) */
-    break;
+  }
 
-  case BC_XOR:
-    /* Check trivial cases */
-    if(f == g) return bddfalse;
-    if(f == B_NOT(g)) return bddtrue;
-    if(f == bddfalse) { fp = B_NP(g); B_RFC_INC_NP(fp); return g; }
-    if(g == bddfalse) { fp = B_NP(f); B_RFC_INC_NP(fp); return f; }
-    if(f == bddtrue) {fp=B_NP(g); B_RFC_INC_NP(fp); return B_NOT(g);}
-    if(g == bddtrue) {fp=B_NP(f); B_RFC_INC_NP(fp); return B_NOT(f);}
-    /* Check negation */
-    if(B_NEG(f) && B_NEG(g)) { f = B_NOT(f); g = B_NOT(g); }
-    else if(B_NEG(f) || B_NEG(g))
-    {
-      f = B_ABS(f); g = B_ABS(g);
-      /* Check operand swap */
-      h = (f < g)? apply(g, f, op, 1): apply(f, g, op, 1);
-      if(h == bddnull) return bddnull;
-      return B_NOT(h);
-    }
-    /* Check operand swap */
-    if(f < g) { h = f; f = g; g = h; } /* swap (f, g) */
-    break;
+  /* Check hash-table overflow */
+  hash_reserve(v);
 
-  case BC_COFACTOR: 
-    /* Check trivial cases */
-    if(B_CST(f)) return f;
-    if(g == bddfalse || f == B_NOT(g)) return bddfalse;
-    if(f == g) return bddtrue;
-    if(g == bddtrue) { fp = B_NP(f); B_RFC_INC_NP(fp); return f; }
-    break;
-  
-  case BC_UNIV: 
-    /* Check trivial cases */
-    if(B_CST(f)) return f;
-    if(B_CST(g)) { fp = B_NP(f); B_RFC_INC_NP(fp); return f; }
-    if(B_NEG(g)) g = B_NOT(g);
-    break;
-  
-  case BC_SUPPORT:
-    if(B_CST(f)) return bddfalse;
-    if(B_NEG(f)) f = B_NOT(f);
-    break;
+  /* Creating a new node, which the other threads cannot see until the
+   * unique table is unlocked */
+  nx = par_node();
+  if(nx == bddnull) { varp->hashUsed--; return bddnull; }
+  np = Node + nx;
+  B_SET_BDDP(np->f0, f0);
+  B_SET_BDDP(np->f1, f1);
+  ut_insert(varp, nx, f0, f1);
+  np->varrfc = v + B_RFC_UNIT;
+  return B_BDDP_NP(np);
+}
 
-  case BC_INTERSEC: 
-    /* Check trivial cases */
-    if(f == bddfalse || g == bddfalse) return bddfalse;
-    if(f == bddtrue) return B_NEG(g)? bddtrue: bddfalse;
-    if(g == bddtrue) return B_NEG(f)? bddtrue: bddfalse;
-    if(f == g) { fp = B_NP(f); B_RFC_INC_NP(fp); return f; }
-    if(f == B_NOT(g)) {fp=B_NP(f); B_RFC_INC_NP(fp); return B_ABS(f); }
-    /* Check operand swap */
-    if(f < g) { h = f; f = g; g = h; } /* swap (f, g) */
-    break;
+static bddp par_apply(bddp f, bddp g, unsigned char op, int depth);
 
-  case BC_UNION: 
-    /* Check trivial cases */
-    if(f == bddfalse)
-    {
-      if(!B_CST(g)) {fp=B_NP(g); B_RFC_INC_NP(fp); }
-      return g;
-    }
-    if(f == bddtrue)
-    {
-      if(!B_CST(g)) {fp=B_NP(g); B_RFC_INC_NP(fp); }
-      return B_NEG(g)? g: B_NOT(g);
-    }
-    if(g == bddfalse || f == g)
-      { fp=B_NP(f); B_RFC_INC_NP(fp); return f; }
-    if(g == bddtrue || f == B_NOT(g))
-    {
-      fp=B_NP(f); B_RFC_INC_NP(fp);
-      return B_NEG(f)? f: B_NOT(f);
-    }
-    /* Check operand swap */
-    if(f < g) { h = f; f = g; g = h; } /* swap (f, g) */
-    break;
+static void par_run(struct B_ParTask *t)
+/* Runs the task t and marks it done. An exception is kept in the pool
+ * and the result is then bddnull. */
+{
+  try { t->h = par_apply(t->f, t->g, t->op, t->depth); }
+  catch(...)
+  {
+    std::lock_guard<std::mutex> lock(ParPool->exm);
+    if(!ParPool->ex) ParPool->ex = std::current_exception();
+    t->h = bddnull;
+  }
+  t->done.store(1, std::memory_order_release);
+}
 
-  case BC_SUBTRACT: 
-    /* Check trivial cases */
-    if(f == bddfalse || f == g) return bddfalse;
-    if(f == bddtrue || f == B_NOT(g))
-      return B_NEG(g)? bddfalse: bddtrue;
-    if(g == bddfalse) { fp=B_NP(f); B_RFC_INC_NP(fp); return f; }
-    if(g == bddtrue) { fp=B_NP(f); B_RFC_INC_NP(fp); return B_ABS(f); }
-    break;
-  
-  case BC_AT0: 
-  case BC_AT1: 
-  case BC_OFFSET: 
-    /* Check trivial cases */
-    if(B_CST(f)) return f;
-    /* special cases */
-    fp = B_NP(f); flev = Var[B_VAR_NP(fp)].lev;
-    glev = Var[(bddvar)g].lev;
-    if(flev < glev) { B_RFC_INC_NP(fp); return f; }
-    if(flev == glev)
-    {
-      if(op != BC_AT1)
-      {
-        h = B_GET_BDDP(fp->f0);
-        if(B_NEG(f)^B_NEG(h)) h = B_NOT(h);
-      }
-      else
-      {
-        h = B_GET_BDDP(fp->f1);
-        if(B_NEG(f)) h = B_NOT(h);
-      }
-      if(!B_CST(h)) { fp = B_NP(h); B_RFC_INC_NP(fp); }
-      return h;
-    }
-    /* Check negation */
-    if(B_NEG(f))
-    {
-      h = apply(B_NOT(f), g, op, 1);
-      if(h == bddnull) return bddnull;
-      return B_NOT(h);
-    }
-    break;
+static bddp par_here(bddp f, bddp g, unsigned char op, int depth)
+/* par_apply() run by this thread, where an exception is kept in the
+ * pool as par_run() does */
+{
+  struct B_ParTask t;
 
-  case BC_ONSET: 
-    /* Check trivial cases */
-    if(B_CST(f)) return bddfalse;
-    /* special cases */
-    fp = B_NP(f); flev = Var[B_VAR_NP(fp)].lev;
-    glev = Var[(bddvar)g].lev;
-    if(flev < glev)  return bddfalse;
-    if(flev == glev)
-    {
-      h = B_GET_BDDP(fp->f1);
-      if(!B_CST(h)) { fp = B_NP(h); B_RFC_INC_NP(fp); }
-      return h;
-    }
-    /* Check negation */
-    if(B_NEG(f)) f = B_NOT(f);
-    break;
+  t.f = f; t.g = g; t.op = op; t.depth = depth;
+  t.h = bddnull;
+  t.done.store(0, std::memory_order_relaxed);
+  par_run(&t);
+  return t.h;
+}
+
+static int par_steal(void)
+/* Runs a task stolen from another thread. Returns 0 if none found. */
+{
+  struct B_ParPool *pp;
+  struct B_ParQueue *qp;
+  struct B_ParTask *t;
+  int k, w;
 
-  case BC_CHANGE: 
-    /* Check trivial cases */
-    if(f == bddfalse) return f;
-    if(B_CST(f)) return getzddp((bddvar)g, bddfalse, f);
-    /* special cases */
-    fp = B_NP(f); flev = Var[B_VAR_NP(fp)].lev;
-    glev = Var[(bddvar)g].lev;
-    if(flev < glev)
-    {
-      B_RFC_INC_NP(fp);
-      h = getzddp((bddvar)g, bddfalse, f);
-      if(h == bddnull) bddfree(f);
-      return h;
-    }
-    if(flev == glev)
+  pp = ParPool;
+  for(k=1; k<pp->nt; k++)
+  {
+    w = (B_ParSelf + k) % pp->nt;
+    qp = &pp->queue[w];
+    if(qp->n.load(std::memory_order_relaxed) == 0) continue;
     {
-      h0 = B_GET_BDDP(fp->f1);
-      h1 = B_GET_BDDP(fp->f0);
-      if(B_NEG(f)^B_NEG(h1)) h1 = B_NOT(h1);
-      if(!B_CST(h0)) { fp = B_NP(h0); B_RFC_INC_NP(fp); }
-      if(!B_CST(h1)) { fp = B_NP(h1); B_RFC_INC_NP(fp); }
-      h = getzddp((bddvar)g, h0, h1);
-      if(h == bddnull) { bddfree(h0); bddfree(h1); }
-      return h;
+      std::lock_guard<std::mutex> lock(qp->m);
+      if(qp->q.empty()) continue;
+      t = qp->q.front();
+      qp->q.pop_front();
+      qp->n.store(qp->q.size(), std::memory_order_relaxed);
     }
-    break;
-
-  case BC_LSHIFT: 
-  case BC_RSHIFT: 
-    /* Check trivial cases */
-    if(B_CST(f)) return f;
+    par_run(t);
+    return 1;
+  }
+  return 0;
+}
 
-    /* Check negation */
-    if(B_NEG(f))
+static void par_spawn(struct B_ParTask *t, bddp f, bddp g, unsigned char op,
+                      int depth)
+/* Pushes the task of (f, g) to the queue of this thread, calling the
+ * workers on the first task of the operation */
+{
+  struct B_ParPool *pp;
+  struct B_ParQueue *qp;
+
+  pp = ParPool;
+  t->f = f; t->g = g; t->op = op; t->depth = depth;
+  t->h = bddnull;
+  t->done.store(0, std::memory_order_relaxed);
+  qp = &pp->queue[B_ParSelf];
+  {
+    std::lock_guard<std::mutex> lock(qp->m);
+    qp->q.push_back(t);
+    qp->n.store(qp->q.size(), std::memory_order_relaxed);
+  }
+  if(!pp->woken)
+  {
+    /* Only the caller pushes a task before the workers are called */
+    pp->woken = 1;
+    pp->busy.store(pp->nt - 1, std::memory_order_relaxed);
+    pp->active.store(1, std::memory_order_relaxed);
     {
-      h = apply(B_NOT(f), g, op, 1);
-      if(h == bddnull) return bddnull;
-      return B_NOT(h);
+      std::lock_guard<std::mutex> lock(pp->m);
+      pp->gen.fetch_add(1, std::memory_order_release);
     }
-    break;
+    pp->cv.notify_all();
+  }
+}
 
-  case BC_CARD:
-    if(B_CST(f)) return (f == bddfalse)? 0: 1;
-    if(B_NEG(f)) 
+static bddp par_sync(struct B_ParTask *t)
+/* Returns the result of the task t spawned by this thread. The task is
+ * run here unless stolen, and the other tasks are run while waiting
+ * for a stolen one. */
+{
+  struct B_ParQueue *qp;
+  int own;
+
+  qp = &ParPool->queue[B_ParSelf];
+  {
+    std::lock_guard<std::mutex> lock(qp->m);
+    own = (!qp->q.empty() && qp->q.back() == t);
+    if(own)
     {
-      h = apply(B_NOT(f), bddfalse, op, 1);
-      return (h >= bddnull)? bddnull: h+1;
+      qp->q.pop_back();
+      qp->n.store(qp->q.size(), std::memory_order_relaxed);
     }
-    break;
-
-  case BC_CARD2:
-    if(B_CST(f)) return (f == bddfalse)? 0: 1;
-    break;
+  }
+  if(own) par_run(t);
+  else
+    while(!t->done.load(std::memory_order_acquire))
+      if(!par_steal()) std::this_thread::yield();
+  return t->h;
+}
 
-  case BC_LIT:
-    if(B_CST(f)) return 0;
-    if(B_NEG(f)) f = B_NOT(f);
-    break;
+static bddp par_apply(bddp f, bddp g, unsigned char op, int depth)
+/* apply<1>() of a binary operation or BC_ZDD_MEET, forking one cofactor
+ * as a task in the top ParPool->depth levels. Below them the sequential
+ * apply<1>() is run by each thread. Returns bddnull if the node table is
+ * full. The tasks are always synchronized before an exception. */
+{
+  struct B_NodeTable *fp, *gp;
+  struct B_ParTask t[3];
+  bddp h, h0, h1, f0, f1, g0, g1;
+  bddvar v = 0, flev, glev;
+  char neg, z;
+  int i;
 
-  case BC_LEN:
-    if(B_CST(f)) return 0;
-    if(B_NEG(f)) f = B_NOT(f);
-    break;
+  /* Check terminal case */
+  neg = 0;
+  if(op == BC_ZDD_MEET)
+  {
+    if(B_CST(f) || B_CST(g)) return apply<1>(f, g, op, 0);
+    /* Check operand swap: f has the top variable */
+    flev = Var[B_VAR_NP(B_NP(f))].lev;
+    glev = Var[B_VAR_NP(B_NP(g))].lev;
+    if(flev < glev || (flev == glev && f < g)) { h = f; f = g; g = h; }
+  }
+  else if(bfs_term(op, &f, &g, &h, &neg))
+  {
+    if(!B_CST(h)) { fp = B_NP(h); rfc_inc_par(fp); }
+    return h;
+  }
+  if(depth >= ParPool->depth)
+  {
+    h = apply<1>(f, g, op, 0);
+    return (neg && h != bddnull)? B_NOT(h): h;
+  }
 
-  default:
-    err("apply: unknown opcode", op, ExceptionType::InternalError);
-    break;
+  /* Checking Cache */
+  if(cache_get<1>(op, f, g, &h) && h != bddnull)
+  {
+    if(!B_CST(h)) { fp = B_NP(h); rfc_inc_par(fp); }
+    return neg? B_NOT(h): h;
   }
 
-  /* Non-trivial operations */
-  switch(op)
+  /* Get (f0, f1) and (g0, g1) as apply() */
+  z = 0;
+  fp = B_NP(f);
+  gp = B_NP(g);
+  if(op == BC_ZDD_MEET)
   {
-  /* binary operation */
-  case BC_AND:
-  case BC_XOR:
-  case BC_COFACTOR:
-  case BC_UNIV:
-  case BC_INTERSEC:
-  case BC_UNION:
-  case BC_SUBTRACT:
-    /* Try cache? */
-    if((B_CST(f) || B_RFC_ONE_NP(B_NP(f))) &&
-       (B_CST(g) || B_RFC_ONE_NP(B_NP(g)))) key = bddnull;
-    else
+    v = B_VAR_NP(fp);
+    f0 = B_GET_BDDP(fp->f0);
+    f1 = B_GET_BDDP(fp->f1);
+    if(B_NEG(f)^B_NEG(f0)) f0 = B_NOT(f0);
+    z = (B_VAR_NP(gp) == v)? 1: 0;
+    g0 = g; g1 = g;
+    if(z)
     {
-      /* Checking Cache */
-      key = B_CACHEKEY(op, f, g);
-      cachep = Cache + key;
-      if(cachep->op == op &&
-         f == B_GET_BDDP(cachep->f) &&
-         g == B_GET_BDDP(cachep->g))
-      {
-        /* Hit */
-        h = B_GET_BDDP(cachep->h);
-        if(!B_CST(h) && h != bddnull) { fp = B_NP(h); B_RFC_INC_NP(fp); }
-        return h;
-      }
+      g0 = B_GET_BDDP(gp->f0);
+      g1 = B_GET_BDDP(gp->f1);
+      if(B_NEG(g)^B_NEG(g0)) g0 = B_NOT(g0);
     }
-    /* Get (f0, f1) and (g0, g1)*/
-    z = 0;
-    fp = B_NP(f);
-    flev = B_CST(f)? 0: Var[B_VAR_NP(fp)].lev;
-    gp = B_NP(g);
-    glev = B_CST(g)? 0: Var[B_VAR_NP(gp)].lev;
+  }
+  else
+  {
+    flev = Var[B_VAR_NP(fp)].lev;
+    glev = Var[B_VAR_NP(gp)].lev;
     f0 = f; f1 = f;
     g0 = g; g1 = g;
-
     if(flev <= glev)
     {
       v = B_VAR_NP(gp);
@@ -2023,7 +5693,6 @@ static bddp apply(bddp f, bddp g, unsigned char op, unsigned char skip)
       if(B_NEG(g)^B_NEG(g0)) g0 = B_NOT(g0);
       if(B_NEG(g) && !z) g1 = B_NOT(g1);
     }
-
     if(flev >= glev)
     {
       v = B_VAR_NP(fp);
@@ -2037,635 +5706,1446 @@ static bddp apply(bddp f, bddp g, unsigned char op, unsigned char skip)
       if(B_NEG(f)^B_NEG(f0)) f0 = B_NOT(f0);
       if(B_NEG(f) && !z) f1 = B_NOT(f1);
     }
-    break;
+  }
 
-  /* unary operation */
-  case BC_AT0:
-  case BC_AT1:
-  case BC_LSHIFT:
-  case BC_RSHIFT:
-  case BC_SUPPORT:
-  case BC_OFFSET:
-  case BC_ONSET:
-  case BC_CHANGE:
-    fp = B_NP(f);
-    if(B_RFC_ONE_NP(fp)) key = bddnull;
-    else
+  if(op == BC_ZDD_MEET)
+  {
+    /* The meets of (f1, g0), (f0, g1) and (f1, g1) are forked. Those
+     * without v are joined into h0, and h1 is the meet of (f1, g1). */
+    par_spawn(&t[0], f1, g0, op, depth + 1);
+    if(z)
     {
-      /* Checking Cache */
-      key = B_CACHEKEY(op, f, g);
-      cachep = Cache + key;
-      if(cachep->op == op &&
-         f == B_GET_BDDP(cachep->f) &&
-         g == B_GET_BDDP(cachep->g))
+      par_spawn(&t[1], f0, g1, op, depth + 1);
+      par_spawn(&t[2], f1, g1, op, depth + 1);
+    }
+    h0 = par_here(f0, g0, op, depth + 1);
+    for(i=z? 2: 0; i>=0; i--) par_sync(&t[i]);
+    if(h0 == bddnull || t[0].h == bddnull ||
+       (z && (t[1].h == bddnull || t[2].h == bddnull)))
+    {
+      rfc_free<1>(h0);
+      for(i=0; i<(z? 3: 1); i++) rfc_free<1>(t[i].h);
+      return bddnull; /* Overflow */
+    }
+    for(i=0; i<(z? 2: 1); i++)
+    {
+      h = (h0 == bddnull)? bddnull:
+          par_apply(h0, t[i].h, BC_UNION, depth + 1);
+      rfc_free<1>(h0); rfc_free<1>(t[i].h);
+      h0 = h;
+    }
+    h1 = z? t[2].h: bddfalse;
+    if(h0 == bddnull) { rfc_free<1>(h1); return bddnull; } /* Overflow */
+  }
+  else
+  {
+    /* The cofactor (f1, g1) is forked and (f0, g0) is run here */
+    par_spawn(&t[0], f1, g1, op, depth + 1);
+    h0 = par_here(f0, g0, op, depth + 1);
+    h1 = par_sync(&t[0]);
+    if(h0 == bddnull || h1 == bddnull)
+    {
+      rfc_free<1>(h0); rfc_free<1>(h1);
+      return bddnull; /* Overflow */
+    }
+  }
+  if(op == BC_ZDD_MEET && !z) h = h0;
+  else
+  {
+    h = z? getzddp<1>(v, h0, h1): getbddp<1>(v, h0, h1);
+    if(h == bddnull) { rfc_free<1>(h0); rfc_free<1>(h1); return bddnull; } /* Overflow */
+  }
+  cache_store<1>(op, f, g, h);
+  return neg? B_NOT(h): h;
+}
+
+static void par_worker(struct B_ParPool *pp, int self)
+/* Body of the worker thread self. It steals the tasks while an
+ * operation is active, and sleeps after spinning a while without one. */
+{
+  unsigned seen;
+  int k;
+
+  B_MgrScope ms(pp->mgr);
+  B_ParSelf = self;
+  seen = 0; /* gen when the pool is created */
+  for(;;)
+  {
+    for(k=0; k<B_PAR_SPIN && !pp->stop.load(std::memory_order_relaxed) &&
+             pp->gen.load(std::memory_order_acquire) == seen; k++)
+      std::this_thread::yield();
+    {
+      std::unique_lock<std::mutex> lock(pp->m);
+      pp->cv.wait(lock, [&]() {
+        return pp->stop.load(std::memory_order_relaxed) ||
+               pp->gen.load(std::memory_order_acquire) != seen; });
+      if(pp->stop.load(std::memory_order_relaxed)) return;
+      seen = pp->gen.load(std::memory_order_acquire);
+    }
+    while(pp->active.load(std::memory_order_acquire))
+      if(!par_steal()) std::this_thread::yield();
+    pp->busy.fetch_sub(1, std::memory_order_release);
+  }
+}
+
+static struct B_ParPool *par_create(int nt)
+/* Returns a pool of nt threads including the caller */
+{
+  struct B_ParPool *pp;
+  int t;
+
+  pp = new B_ParPool();
+  pp->nt = nt;
+  /* Enough tasks per thread for the balance of the load */
+  for(pp->depth=6, t=1; t<nt; t<<=1) pp->depth++;
+  pp->mgr = BDD_CurMgr;
+  pp->queue.reset(new struct B_ParQueue[nt]);
+  pp->batch.reset(new struct B_ParBatch[nt]);
+  for(t=0; t<nt; t++)
+  {
+    pp->queue[t].n.store(0, std::memory_order_relaxed);
+    pp->batch[t].head = bddnull;
+    pp->batch[t].n = 0;
+  }
+  pp->gen.store(0, std::memory_order_relaxed);
+  pp->active.store(0, std::memory_order_relaxed);
+  pp->busy.store(0, std::memory_order_relaxed);
+  pp->stop.store(0, std::memory_order_relaxed);
+  pp->woken = 0;
+  pp->nvarlock = 0;
+  pp->cachelock.reset(new std::atomic<int>[B_PAR_LOCKS]());
+  pp->full = 0;
+  pp->enlarged = 0;
+  try
+  {
+    for(t=1; t<nt; t++) pp->th.push_back(std::thread(par_worker, pp, t));
+  }
+  catch(...)
+  {
+    ParPool = pp;
+    par_release();
+    throw;
+  }
+  return pp;
+}
+
+static void par_release(void)
+/* Stops the workers and frees the pool of the current manager */
+{
+  struct B_ParPool *pp;
+  size_t t;
+
+  pp = ParPool;
+  if(!pp) return;
+  {
+    std::lock_guard<std::mutex> lock(pp->m);
+    pp->stop.store(1, std::memory_order_relaxed);
+  }
+  pp->cv.notify_all();
+  for(t=0; t<pp->th.size(); t++) pp->th[t].join();
+  delete pp;
+  ParPool = 0;
+}
+
+static bddp apply_par(bddp f, bddp g, unsigned char op)
+/* apply() of a binary operation or BC_ZDD_MEET by ApplyThreads threads.
+ * While it runs, the unique table of each variable is locked by its
+ * getnode(), a set of the operation cache by a spin lock, and the
+ * reference counters are changed atomically. The node table may be
+ * enlarged in place (BDD_NT_MMAP), but GC and reordering wait until
+ * the threads have finished: if the node table is full, the operation
+ * is run again by apply() after bddgc(). */
+{
+  struct B_ParPool *pp;
+  bddp h, ix;
+  int self, t;
+  size_t i;
+
+  if(ParPool && ParPool->nt != ApplyThreads) par_release();
+  if(!ParPool) ParPool = par_create(ApplyThreads);
+  pp = ParPool;
+  if(pp->nvarlock <= VarUsed)
+  {
+    pp->varlock.reset(new std::mutex[VarUsed + 1U]);
+    pp->nvarlock = VarUsed + 1U;
+  }
+  pp->full = 0;
+  pp->enlarged = 0;
+  pp->ex = nullptr;
+
+  self = B_ParSelf;
+  B_ParSelf = 0;
+  ParActive = 1;
+  h = par_here(f, g, op, 0);
+  if(pp->woken)
+  {
+    /* Wait until the workers leave the operation */
+    pp->active.store(0, std::memory_order_release);
+    while(pp->busy.load(std::memory_order_acquire) != 0)
+      std::this_thread::yield();
+    pp->woken = 0;
+  }
+  ParActive = 0;
+  B_ParSelf = self;
+
+  /* Return the free nodes left to the threads */
+  for(t=0; t<pp->nt; t++)
+  {
+    while(pp->batch[t].n > 0)
+    {
+      ix = pp->batch[t].head;
+      pp->batch[t].head = B_GET_BDDP(Node[ix].nx);
+      pp->batch[t].n--;
+      B_SET_BDDP(Node[ix].nx, Avail);
+      Avail = ix;
+      NodeUsed--;
+    }
+  }
+  for(i=0; i<pp->oldepoch.size(); i++) free(pp->oldepoch[i]);
+  pp->oldepoch.clear();
+  if(pp->enlarged) allocatecache();
+  if(pp->ex) std::rethrow_exception(pp->ex);
+
+  if(h == bddnull && pp->full)
+  {
+    /* Run again with GC */
+    bddgc();
+    return apply(f, g, op, 0);
+  }
+
+  /* Reorder at the end of an operation as apply() */
+  if(ReorderNext != 0 && NodeUsed >= ReorderNext)
+  {
+    bddreorder();
+    ReorderNext = (NodeUsed < ReorderLimit>>1U)? ReorderLimit: NodeUsed<<1U;
+  }
+  return h;
+}
+
+static void cache_sweep()
+/* Removes cache entries referring to collected nodes (BDD_GC_FULL) */
+{
+  bddp f;
+  struct B_NodeTable *fp;
+  struct B_CacheTable *cachep;
+  struct B_Cache3Table *cache3p;
+
+  for(cachep=Cache; cachep<Cache+CacheSpc; cachep++)
+  {
+    switch(cachep->op)
+    {
+    case BC_NULL:
+      break;
+    case BC_AND:
+    case BC_XOR:
+    case BC_INTERSEC:
+    case BC_UNION:
+    case BC_SUBTRACT:
+    case BC_CHANGE:
+    case BC_ZDD_MULT:
+    case BC_ZDD_DIV:
+    case BC_ZDD_MEET:
+      f = B_GET_BDDP(cachep->f);
+      if(!B_CST(f) && (fp=B_NP(f))<Node+NodeSpc && fp->varrfc == 0)
       {
-        /* Hit */
-        h = B_GET_BDDP(cachep->h);
-        if(!B_CST(h) && h != bddnull) { fp = B_NP(h); B_RFC_INC_NP(fp); }
-        return h;
+        cachep->op = BC_NULL;
+        break;
       }
-    }
-    /* Get (f0, f1)*/
-    v = B_VAR_NP(fp);
-    z = B_Z_NP(fp)? 1: 0;
-    f0 = B_GET_BDDP(fp->f0);
-    f1 = B_GET_BDDP(fp->f1);
-    if(B_NEG(f)^B_NEG(f0)) f0 = B_NOT(f0);
-    if(B_NEG(f) && !z) f1 = B_NOT(f1);
-    break;
+      f = B_GET_BDDP(cachep->g);
+      if(!B_CST(f) && (fp=B_NP(f))<Node+NodeSpc && fp->varrfc == 0)
+      {
+        cachep->op = BC_NULL;
+        break;
+      }
+      f = B_GET_BDDP(cachep->h);
+      if(!B_CST(f) && (fp=B_NP(f))<Node+NodeSpc && fp->varrfc == 0)
+      {
+        cachep->op = BC_NULL;
+        break;
+      }
+      break;
+    case BC_AT0:
+    case BC_AT1:
+    case BC_OFFSET:
+    case BC_ONSET:
+      f = B_GET_BDDP(cachep->f);
+      if(!B_CST(f) && (fp=B_NP(f))<Node+NodeSpc && fp->varrfc == 0)
+      {
+        cachep->op = BC_NULL;
+        break;
+      }
+      f = B_GET_BDDP(cachep->h);
+      if(!B_CST(f) && (fp=B_NP(f))<Node+NodeSpc && fp->varrfc == 0)
+      {
+        cachep->op = BC_NULL;
+        break;
+      }
+      break;
+    case BC_CARD:
+    case BC_LIT:
+    case BC_LEN:
+      f = B_GET_BDDP(cachep->f);
+      if(!B_CST(f) && (fp=B_NP(f))<Node+NodeSpc && fp->varrfc == 0)
+      {
+        cachep->op = BC_NULL;
+        break;
+      }
+      f = B_GET_BDDP(cachep->h);
+      if(f > bddnull)
+      {
+        cachep->op = BC_NULL;
+        break;
+      }
+      break;
+    default:
+      cachep->op = BC_NULL;
+      break;
+    }
+  }
+  for(cache3p=Cache3; cache3p<Cache3+Cache3Spc; cache3p++)
+  {
+    if(cache3p->op == BC_NULL) continue;
+    if(!cache3_alive(cache3p, 0)) cache3p->op = BC_NULL;
+  }
+}
 
+static int cache_alive(struct B_CacheTable *cachep, unsigned char epoch)
+/* Returns 1 if no node of the entry has been collected since epoch */
+{
+  switch(cachep->op)
+  {
   case BC_CARD:
   case BC_LIT:
   case BC_LEN:
-    fp = B_NP(f);
-    if(B_RFC_ONE_NP(fp)) key = bddnull;
-    else
+    /* The result is a number */
+    return !B_DIED(B_GET_BDDP(cachep->f), epoch);
+  case BC_AT0:
+  case BC_AT1:
+  case BC_LSHIFT:
+  case BC_RSHIFT:
+  case BC_OFFSET:
+  case BC_ONSET:
+  case BC_CHANGE:
+    /* The second operand is a variable or a shift */
+    return !B_DIED(B_GET_BDDP(cachep->f), epoch) &&
+           !B_DIED(B_GET_BDDP(cachep->h), epoch);
+  default:
+    /* The words of user operations are taken as bddp as well,
+     * as a number can only cause a false miss */
+    return !B_DIED(B_GET_BDDP(cachep->f), epoch) &&
+           !B_DIED(B_GET_BDDP(cachep->g), epoch) &&
+           !B_DIED(B_GET_BDDP(cachep->h), epoch);
+  }
+}
+
+static int cache3_alive(struct B_Cache3Table *cache3p, unsigned char epoch)
+/* Returns 1 if no node of the entry has been collected since epoch
+ * (since the last GC if epoch is 0) */
+{
+  bddp f;
+  int i;
+
+  for(i=0; i<4; i++)
+  {
+    switch(i)
     {
-      /* Checking Cache */
-      key = B_CACHEKEY(op, f, bddfalse);
-      cachep = Cache + key;
-      if(cachep->op == op &&
-         f == B_GET_BDDP(cachep->f) &&
-         bddfalse == B_GET_BDDP(cachep->g))
-      {
-        /* Hit */
-        return B_GET_BDDP(cachep->h);
-      }
+    case 0: f = B_GET_BDDP(cache3p->f); break;
+    case 1: f = B_GET_BDDP(cache3p->g); break;
+    case 2: f = B_GET_BDDP(cache3p->k); break;
+    default: f = B_GET_BDDP(cache3p->h); break;
     }
-    /* Get (f0, f1)*/
-    f0 = B_GET_BDDP(fp->f0);
-    f1 = B_GET_BDDP(fp->f1);
-    if(B_NEG(f)^B_NEG(f0)) f0 = B_NOT(f0);
-    break;
-
-  case BC_CARD2:
-    fp = B_NP(f);
-    if(B_RFC_ONE_NP(fp)) key = bddnull;
-    else
+    if(epoch == 0)
     {
-      /* Checking Cache */
-      key = B_CACHEKEY(BC_CARD, f, bddfalse);
-      cachep = Cache + key;
-      if(cachep->op == BC_CARD &&
-         f == B_GET_BDDP(cachep->f) &&
-         bddfalse == B_GET_BDDP(cachep->g))
-      {
-        /* Hit */
-        h = B_GET_BDDP(cachep->h);
-	if(h != bddnull) return h;
-      }
+      if(!B_CST(f) && B_NDX(f) < NodeSpc && Node[B_NDX(f)].varrfc == 0)
+        return 0;
     }
-    /* Get (f0, f1)*/
-    f0 = B_GET_BDDP(fp->f0);
-    f1 = B_GET_BDDP(fp->f1);
-    if(B_NEG(f)^B_NEG(f0)) f0 = B_NOT(f0);
-    break;
+    else if(B_DIED(f, epoch)) return 0;
+  }
+  return 1;
+}
 
-  default:
-    err("apply: unknown opcode", op, ExceptionType::InternalError);
+static void cache_newcycle()
+/* Starts a new cycle of GC epochs when the epoch counter wraps */
+{
+  bddp i;
+  struct B_CacheTable *cachep;
+  struct B_Cache3Table *cache3p;
+
+  /* Epochs are reset, so check the entries eagerly */
+  for(i=0; i<CacheSpc; i++)
+  {
+    cachep = Cache + i;
+    if(cachep->op == BC_NULL) continue;
+    if(!cache_alive(cachep, CacheEpoch[i]) ||
+       (cachep->op == BC_CARD && B_GET_BDDP(cachep->h) > bddnull))
+      cachep->op = BC_NULL;
+    CacheEpoch[i] = 1;
   }
+  for(cache3p=Cache3; cache3p<Cache3+Cache3Spc; cache3p++)
+  {
+    if(cache3p->op == BC_NULL) continue;
+    if(!cache3_alive(cache3p, cache3p->epoch)) cache3p->op = BC_NULL;
+    cache3p->epoch = 1;
+  }
+  for(i=0; i<NodeSpc; i++) NodeEpoch[i] = 0;
+  GCEpoch = 1;
+}
 
-  /* Stack overflow limitter */
-  BDD_RECUR_INC;
+static void gc1(struct B_NodeTable *np)
+{
+  /* np is a node ptr to be collected. (refc == 0) */
+  bddp f0, f1;
+  struct B_VarTable *varp;
+  struct B_NodeTable *np1;
+  B_StackScope<bddp> scope(B_Stack);
 
-  /* Get result node */
-  switch(op)
+  for(;;)
   {
-  case BC_AND:
-  case BC_XOR:
-  case BC_INTERSEC:
-  case BC_UNION:
-  case BC_SUBTRACT:
-    h0 = apply(f0, g0, op, 0);
-    if(h0 == bddnull) { h = h0; break; } /* Overflow */
-    h1 = apply(f1, g1, op, 0);
-    if(h1 == bddnull) { bddfree(h0); h = h1; break; } /* Overflow */
-    h = z? getzddp(v, h0, h1): getbddp(v, h0, h1);
-    if(h == bddnull) { bddfree(h0); bddfree(h1); } /* Overflow */
-    break;
-  
-  case BC_COFACTOR:
-    if(g0 == bddfalse && g1 != bddfalse)
+    /* remove the node from hash list */
+    varp = Var + B_VAR_NP(np);
+    f0 = B_GET_BDDP(np->f0);
+    f1 = B_GET_BDDP(np->f1);
+    ut_remove(varp, np - Node, f0, f1);
+    varp->hashUsed--;
+    NodeEpoch[np - Node] = GCEpoch;
+
+    /* append the node to avail list */
+    B_SET_BDDP(np->nx, Avail);
+    Avail = np - Node;
+
+    NodeUsed--;
+    np->varrfc = 0;
+
+    /* Check sub-graphs: f0 first, and f1 when f0 is done */
+    B_Stack.push_back(np - Node);
+    if(!B_CST(f0))
     {
-      h = apply(f1, g1, op, 0);
+      np1 = B_NP(f0);
+      B_RFC_DEC_NP(np1);
+      if(B_RFC_ZERO_NP(np1)) { np = np1; continue; }
     }
-    else if(g1 == bddfalse && g0 != bddfalse)
+    for(;;)
     {
-      h = apply(f0, g0, op, 0);
+      if(B_Stack.size() == scope.base) return;
+      np1 = Node + B_Stack.back();
+      B_Stack.pop_back();
+      f1 = B_GET_BDDP(np1->f1);
+      if(B_CST(f1)) continue;
+      np1 = B_NP(f1);
+      B_RFC_DEC_NP(np1);
+      if(B_RFC_ZERO_NP(np1)) break;
     }
-    else
+    np = np1;
+  }
+}
+
+static int rfc_dec_atomic(struct B_NodeTable *np, std::mutex &ovf)
+/* B_RFC_DEC_NP for the parallel GC.
+ * Returns 1 if the reference counter becomes zero */
+{
+  unsigned int rfc;
+
+  rfc = __atomic_load_n(&np->varrfc, __ATOMIC_RELAXED);
+  for(;;)
+  {
+    if(rfc >= B_RFC_MASK)
     {
-      h0 = apply(f0, g0, op, 0);
-      if(h0 == bddnull) { h = h0; break; } /* Overflow */
-      h1 = apply(f1, g1, op, 0);
-      if(h1 == bddnull) { bddfree(h0); h = h1; break; } /* Overflow */
-      h = getbddp(v, h0, h1);
-      if(h == bddnull) { bddfree(h0); bddfree(h1); } /* Overflow */
+      /* The counter is held in RFC-table */
+      std::lock_guard<std::mutex> lock(ovf);
+      rfc = __atomic_load_n(&np->varrfc, __ATOMIC_RELAXED);
+      if(rfc >= B_RFC_MASK) { rfc_dec_ovf(np); return 0; }
+      continue;
     }
-    break;
+    if(rfc < B_RFC_UNIT)
+      err("B_RFC_DEC_NP: rfc under flow", np-Node, ExceptionType::InternalError);
+    /* Acquire-release, so that the thread making it zero may read
+     * the node as a plain one */
+    if(__atomic_compare_exchange_n(&np->varrfc, &rfc, rfc - B_RFC_UNIT, 1,
+                                   __ATOMIC_ACQ_REL, __ATOMIC_RELAXED))
+      return (rfc - B_RFC_UNIT) < B_RFC_UNIT;
+  }
+}
 
-  case BC_UNIV:
-    if(g0 != g1)
+static void gc_run(int nt, const std::vector<std::function<void(int)> > &phase)
+/* Calls phase[i](0), ..., phase[i](nt-1) in nt threads working on the
+ * current manager for i = 0, 1, .... The threads are made once, and each
+ * phase starts after all the threads have finished the previous one. */
+{
+  int t;
+  struct BDDManager *mgr = BDD_CurMgr;
+  std::vector<std::thread> th;
+  std::vector<std::exception_ptr> ex(nt);
+  std::mutex m;
+  std::condition_variable cv;
+  int arrived = 0, failed = 0;
+  unsigned gen = 0;
+
+  auto work = [&](int k)
+  {
+    size_t i;
+    unsigned g;
+
+    for(i=0; i<phase.size(); i++)
     {
-      h0 = apply(f0, g0, op, 0);
-      if(h0 == bddnull) { h = h0; break; } /* Overflow */
-      h1 = apply(f1, g0, op, 0);
-      if(h1 == bddnull) { bddfree(h0); h = h1; break; } /* Overflow */
-      h = apply(h0, h1, BC_AND, 0);
-      bddfree(h0); bddfree(h1);
+      try { phase[i](k); } catch(...) { ex[k] = std::current_exception(); }
+      std::unique_lock<std::mutex> lock(m);
+      if(ex[k]) failed = 1;
+      if(++arrived == nt) { arrived = 0; gen++; cv.notify_all(); }
+      else { g = gen; cv.wait(lock, [&]() { return gen != g; }); }
+      if(failed) return;
     }
-    else
+  };
+  for(t=1; t<nt; t++)
+    th.push_back(std::thread([&, t]() { B_MgrScope ms(mgr); work(t); }));
+  work(0);
+  for(t=0; t<(int)th.size(); t++) th[t].join();
+  for(t=0; t<nt; t++) if(ex[t]) std::rethrow_exception(ex[t]);
+}
+
+static void gc_parallel()
+/* Same as calling gc1() for all unreferenced nodes, using GCThreads threads
+ * made once for the following phases.
+ * 1. The node table is partitioned and each thread picks up the
+ *    unreferenced nodes of its part.
+ * 2. Each thread frees the nodes from its own ones, decrementing the
+ *    children atomically. The thread which makes a counter zero takes
+ *    the child.
+ * 3. The unique tables are rebuilt per variable in parallel.
+ * 4. Each thread links its freed nodes to make a part of the free list. */
+{
+  int nt, t;
+  bddp i, j, freed;
+  bddvar nv;
+  std::mutex ovf;
+  std::atomic<bddvar> next(1);
+  std::vector<std::function<void(int)> > phase;
+
+  nt = GCThreads;
+  if((bddp)nt > NodeSpc) nt = (int)NodeSpc;
+  nv = VarUsed;
+  std::vector<std::vector<bddp> > dead(nt);
+  std::vector<std::vector<bddp> > died(nt, std::vector<bddp>(nv + 1, 0));
+
+  /* Pick up unreferenced nodes */
+  phase.push_back([&](int k) {
+    bddp ix;
+    for(ix=NodeSpc*k/nt; ix<NodeSpc*(k+1)/nt; ix++)
+      if(Node[ix].varrfc != 0 && B_RFC_ZERO_NP(Node + ix))
+        dead[k].push_back(ix);
+  });
+
+  /* Free the nodes and their sub-graphs */
+  phase.push_back([&](int k) {
+    std::vector<bddp> stack(dead[k]);
+    struct B_NodeTable *np;
+    bddp ix, f0, f1;
+    dead[k].clear();
+    while(!stack.empty())
     {
-      h0 = apply(f0, g0, op, 0);
-      if(h0 == bddnull) { h = h0; break; } /* Overflow */
-      h1 = apply(f1, g0, op, 0);
-      if(h1 == bddnull) { bddfree(h0); h = h1; break; } /* Overflow */
-      h = getbddp(v, h0, h1);
-      if(h == bddnull) { bddfree(h0); bddfree(h1); } /* Overflow */
+      ix = stack.back();
+      stack.pop_back();
+      np = Node + ix;
+      f0 = B_GET_BDDP(np->f0);
+      f1 = B_GET_BDDP(np->f1);
+      if(!B_CST(f0) && rfc_dec_atomic(B_NP(f0), ovf)) stack.push_back(B_NDX(f0));
+      if(!B_CST(f1) && rfc_dec_atomic(B_NP(f1), ovf)) stack.push_back(B_NDX(f1));
+      died[k][B_VAR_NP(np)]++;
+      NodeEpoch[ix] = GCEpoch;
+      dead[k].push_back(ix);
+      __atomic_store_n(&np->varrfc, 0U, __ATOMIC_RELAXED);
     }
-    break;
-
-  case BC_AT0:
-  case BC_AT1:
-  case BC_OFFSET:
-  case BC_ONSET:
-  case BC_CHANGE:
-    h0 = apply(f0, g, op, 0);
-    if(h0 == bddnull) { h = h0; break; } /* Overflow */
-    h1 = apply(f1, g, op, 0);
-    if(h1 == bddnull) { bddfree(h0); h = h1; break; } /* Overflow */
-    h = z? getzddp(v, h0, h1): getbddp(v, h0, h1);
-    if(h == bddnull) { bddfree(h0); bddfree(h1); } /* Overflow */
-    break;
-
-  case BC_SUPPORT:
-    h0 = apply(f0, bddfalse, op, 0);
-    if(h0 == bddnull) { h = h0; break; } /* Overflow */
-    h1 = apply(f1, bddfalse, op, 0);
-    if(h1 == bddnull) { bddfree(h0); h = h1; break; } /* Overflow */
-    h = z? apply(h0, h1, BC_UNION, 0):
-           apply(B_NOT(h0), B_NOT(h1), BC_AND, 0);
-    bddfree(h0); bddfree(h1);
-    if(h == bddnull) break; /* Overflow */
-    h0 = h;
-    h = z? getzddp(v, h0, bddtrue):
-           getbddp(v, B_NOT(h0), bddtrue);
-    if(h == bddnull) bddfree(h0); /* Overflow */
-    break;
-
-  case BC_LSHIFT:
-  case BC_RSHIFT:
-    /* Get VarID of new level */
+  });
+
+  /* Remove the freed nodes from the unique tables */
+  phase.push_back([&](int) {
+    bddvar v;
+    bddp n;
+    int k;
+    while((v = next++) <= nv)
     {
-      bddvar newlev; 
-  
-      flev = bddlevofvar(v);
-      if(op == BC_LSHIFT)
-      {
-        newlev = flev + (bddvar)g;
-        if(newlev > VarUsed || newlev < flev)
-          err("apply: Invald shift", newlev, ExceptionType::OutOfRange);
-      }
-      else
-      {
-        newlev = flev - (bddvar)g;
-        if(newlev == 0 || newlev > flev)
-          err("apply: Invald shift", newlev, ExceptionType::OutOfRange);
-      }
-      v = bddvaroflev(newlev);
+      n = 0;
+      for(k=0; k<nt; k++) n += died[k][v];
+      if(n == 0) continue;
+      ut_sweep(&Var[v]);
+      Var[v].hashUsed -= n;
     }
-    h0 = apply(f0, g, op, 0);
-    if(h0 == bddnull) { h = h0; break; } /* Overflow */
-    h1 = apply(f1, g, op, 0);
-    if(h1 == bddnull) { bddfree(h0); h = h1; break; } /* Overflow */
-    h = z? getzddp(v, h0, h1): getbddp(v, h0, h1);
-    if(h == bddnull) { bddfree(h0); bddfree(h1); } /* Overflow */
-    break;
-    
-  case BC_CARD:
-    h0 = apply(f0, bddfalse, op, 0);
-    if(h0 == bddnull) { h = h0; break; }
-    h1 = apply(f1, bddfalse, op, 0);
-    if(h1 == bddnull) { h = h1; break; }
-    h = h0 + h1;
-    if(h >= bddnull) h = bddnull;
-    break;
+  });
+
+  /* Make the free list */
+  phase.push_back([&](int k) {
+    bddp m;
+    for(m=1; m<dead[k].size(); m++)
+      B_SET_BDDP(Node[dead[k][m-1]].nx, dead[k][m]);
+  });
+  gc_run(nt, phase);
+
+  freed = 0;
+  for(t=nt-1; t>=0; t--)
+  {
+    j = dead[t].size();
+    if(j == 0) continue;
+    i = dead[t][j-1];
+    B_SET_BDDP(Node[i].nx, Avail);
+    Avail = dead[t][0];
+    freed += j;
+  }
+  NodeUsed -= freed;
+}
 
-  case BC_CARD2:
-    h0 = apply(B_ABS(f0), bddfalse, op, 0);
-    if(h0 == B_MP_NULL) { h = h0; break; }
-    h1 = apply(B_ABS(f1), bddfalse, op, 0);
-    if(h1 == B_MP_NULL) { h = h1; break; }
-    {
-      struct B_MP mp;
-      struct B_MPTable *mpt;
-      bddp i, size2;
-      bddp *wp;
-
-      mp.len = 1;
-      mp.word[0] = 0;
-      if(B_NEG(f0)) mp.word[0]++;
-      if(B_NEG(f1)) mp.word[0]++;
-      mp_add(&mp, h0);
-      mp_add(&mp, h1);
-      if(mp.len == 1 && mp.word[0] <= bddnull)
-        { h = mp.word[0]; break; }
-      mpt = mptable + mp.len-1;
-      if(mpt->word == 0)
-      {
-        mpt->size = 16;
-        mpt->used = 0;
-        mpt->word = B_MALLOC(bddp, mp.len * mpt->size);
-        if (!mpt->word) {
-          err("apply: not enough memory for mp table", sizeof(bddp) * mp.len * mpt->size,
-          ExceptionType::OutOfMemory);
-        }
-      }
-      if(mpt->size == mpt->used)
-      {
-        size2 = mpt->size << 1;
-	if(size2 > (B_CST_MASK>>B_MP_LWID)) { h = B_MP_NULL; break; }
-	wp = 0;
-        wp = B_MALLOC(bddp, mp.len * size2);
-	if(!wp) {
-	  err("apply: not enough memory for mp table", sizeof(bddp) * mp.len * size2,
-	  ExceptionType::OutOfMemory);
-	}
-	for(i=0; i<mp.len*(mpt->size); i++) wp[i] = mpt->word[i];
-        mpt->size = size2;
-	free(mpt->word);
-	mpt->word = wp;
-      }
-      wp = mpt->word;
-        
-      for(i=0; i<(bddp)mp.len; i++) wp[mp.len*(mpt->used)+i] = mp.word[i];
-      h = (((bddp)mp.len-1)<<B_MP_LPOS) + B_CST_MASK + (mpt->used++);
-      break;
-    }
-  case BC_LIT:
-    h = apply(f0, bddfalse, op, 0)
-      + apply(f1, bddfalse, op, 0);
-    if(h >= bddnull) h = bddnull;
-    h += apply(f1, bddfalse, BC_CARD, 0);
-    if(h >= bddnull) h = bddnull;
-    break;
+static int visit(bddp f)
+/* Marks the node of f visited in the current B_VisitScope, and returns
+ * 0 if it has already been visited */
+{
+  bddp i;
+  size_t w;
+  unsigned long long b;
+
+  i = B_NDX(f);
+  w = (size_t)(i >> 6);
+  b = 1ULL << (i & 63);
+  if(w >= B_Visit.bit.size())
+    B_Visit.bit.resize((w > NodeSpc >> 6)? w + 1: (NodeSpc >> 6) + 1, 0);
+  if(B_Visit.bit[w] & b) return 0;
+  if(!B_Visit.bit[w]) B_Visit.used.push_back(w);
+  B_Visit.bit[w] |= b;
+  return 1;
+}
 
-  case BC_LEN:
-    h0 = apply(f0, bddfalse, op, 0);
-    h1 = apply(f1, bddfalse, op, 0) + 1;
-    h = (h0 < h1)? h1: h0;
-    break;
+static bddp count(bddp f)
+{
+  bddp c;
+  struct B_NodeTable *fp;
+  B_StackScope<bddp> scope(B_Stack);
 
-  default:
-    err("apply: unknown opcode", op, ExceptionType::InternalError);
-    break;
+  c = 0;
+  B_Stack.push_back(f);
+  while(B_Stack.size() > scope.base)
+  {
+    f = B_Stack.back();
+    B_Stack.pop_back();
+    if(B_CST(f)) continue; /* Constant */
+    fp = B_NP(f);
+
+    /* Check and set visit flag */
+    if(!visit(f)) continue;
+    c++;
+
+    B_Stack.push_back(B_GET_BDDP(fp->f1));
+    B_Stack.push_back(B_GET_BDDP(fp->f0));
   }
+  return c;
+}
 
-  /* Stack overflow limitter */
-  BDD_RECUR_DEC;
+static void export_static(FILE *strm, bddp f)
+{
+  bddp f0, f1;
+  bddvar v;
+  struct B_NodeTable *fp;
+  B_StackScope<bddp> scope(B_Stack);
 
-  /* Saving to Cache */
-  if(key != bddnull)
-  {
-    cachep = Cache + key;
-    cachep->op = op;
-    if(op == BC_CARD2) cachep->op = BC_CARD;
-    B_SET_BDDP(cachep->f, f);
-    B_SET_BDDP(cachep->g, g);
-    B_SET_BDDP(cachep->h, h);
-    if(h == f) switch(op)
+  /* Nodes are written after their subgraphs. An entry with B_CST_MASK
+   * is a node whose subgraphs are done (constants are never pushed). */
+  if(B_CST(f)) return; /* Constant */
+  B_Stack.push_back(f);
+  while(B_Stack.size() > scope.base)
+  {
+    f = B_Stack.back();
+    B_Stack.pop_back();
+    if(f & B_CST_MASK)
     {
-    case BC_AT0:
-      key = B_CACHEKEY(BC_AT1, f, g);
-      cachep = Cache + key;
-      cachep->op = BC_AT1;
-      B_SET_BDDP(cachep->f, f);
-      B_SET_BDDP(cachep->g, g);
-      B_SET_BDDP(cachep->h, h);
-      break;
-    case BC_AT1:
-      key = B_CACHEKEY(BC_AT0, f, g);
-      cachep = Cache + key;
-      cachep->op = BC_AT0;
-      B_SET_BDDP(cachep->f, f);
-      B_SET_BDDP(cachep->g, g);
-      B_SET_BDDP(cachep->h, h);
-      break;
-    case BC_OFFSET:
-      key = B_CACHEKEY(BC_ONSET, f, g);
-      cachep = Cache + key;
-      cachep->op = BC_ONSET;
-      B_SET_BDDP(cachep->f, f);
-      B_SET_BDDP(cachep->g, g);
-      B_SET_BDDP(cachep->h, bddfalse);
-      break;
-    default:
-      break;
+      /* Dump this node */
+      f &= ~B_CST_MASK;
+      fp = B_NP(f);
+      v = B_VAR_NP(fp);
+      f0 = B_GET_BDDP(fp->f0);
+      f0 = B_ABS(f0);
+      f1 = B_GET_BDDP(fp->f1);
+      fprintf_check(strm, B_BDDP_FD, B_ABS(f));
+      fprintf_check(strm, " %d ", Var[v].lev);
+      if(f0 == bddfalse) fprintf_check(strm, "F");
+      else if(f0 == bddtrue) fprintf_check(strm, "T");
+      else fprintf_check(strm, B_BDDP_FD, f0); 
+      fprintf_check(strm, " ");
+      if(f1 == bddfalse) fprintf_check(strm, "F");
+      else if(f1 == bddtrue) fprintf_check(strm, "T");
+      else fprintf_check(strm, B_BDDP_FD, f1);
+      fprintf_check(strm, "\n");
+      continue;
     }
-    if(h == bddfalse && op == BC_ONSET)
+    fp = B_NP(f);
+
+    /* Check and set visit flag */
+    if(!visit(f)) continue;
+
+    /* Dump its subgraphs, f0 first */
+    B_Stack.push_back(f | B_CST_MASK);
+    f1 = B_GET_BDDP(fp->f1);
+    if(!B_CST(f1)) B_Stack.push_back(f1);
+    f0 = B_GET_BDDP(fp->f0);
+    if(!B_CST(f0)) B_Stack.push_back(B_ABS(f0));
+  }
+}
+
+static void dump(bddp f)
+{
+  bddp f0, f1;
+  bddvar v;
+  struct B_NodeTable *fp;
+  B_StackScope<bddp> scope(B_Stack);
+
+  /* Same order as export_static() */
+  if(B_CST(f)) return; /* Constant */
+  B_Stack.push_back(f);
+  while(B_Stack.size() > scope.base)
+  {
+    f = B_Stack.back();
+    B_Stack.pop_back();
+    if(f & B_CST_MASK)
     {
-      key = B_CACHEKEY(BC_OFFSET, f, g);
-      cachep = Cache + key;
-      cachep->op = BC_OFFSET;
-      B_SET_BDDP(cachep->f, f);
-      B_SET_BDDP(cachep->g, g);
-      B_SET_BDDP(cachep->h, f);
+      /* Dump this node */
+      f &= ~B_CST_MASK;
+      fp = B_NP(f);
+      v = B_VAR_NP(fp);
+      f0 = B_GET_BDDP(fp->f0);
+      f0 = B_ABS(f0);
+      f1 = B_GET_BDDP(fp->f1);
+      printf("N");
+      printf(B_BDDP_FD, B_NDX(f));
+      printf(" = [V%d(%d), ", v, Var[v].lev);
+      if(B_CST(f0)) printf(B_BDDP_FD, B_VAL(f0));
+      else { printf("N"); printf(B_BDDP_FD, B_NDX(f0)); }
+      printf(", ");
+      if(B_NEG(f1)) putchar('~'); 
+      if(B_CST(f1)) printf(B_BDDP_FD, B_ABS(B_VAL(f1)));
+      else { printf("N"); printf(B_BDDP_FD, B_NDX(f1)); }
+      printf("]");
+      if(B_Z_NP(fp)) printf(" #Z");
+      printf("\n");
+      continue;
     }
+    fp = B_NP(f);
+
+    /* Check and set visit flag */
+    if(!visit(f)) continue;
+
+    /* Dump its subgraphs, f0 first */
+    B_Stack.push_back(f | B_CST_MASK);
+    f1 = B_GET_BDDP(fp->f1);
+    if(!B_CST(f1)) B_Stack.push_back(f1);
+    f0 = B_GET_BDDP(fp->f0);
+    if(!B_CST(f0)) B_Stack.push_back(B_ABS(f0));
   }
-  return h;
 }
 
-static void gc1(struct B_NodeTable *np)
+template<int P>
+static bddp getzddp(bddvar v, bddp f0, bddp f1)
+/* Returns bddnull if not enough memory */
 {
-  /* np is a node ptr to be collected. (refc == 0) */
-  bddp key, nx1, f0, f1;
-  struct B_VarTable *varp;
-  struct B_NodeTable *np1, *np2;
+  /* Check elimination rule */
+  if(f1 == bddfalse) return f0;
+
+  /* Negative edge constraint */
+  if(B_NEG(f0))
+  {
+    bddp h;
+
+    h = getnode<P>(v, f0, f1);
+    if(h == bddnull) return bddnull;
+    return B_NOT(h);
+  }
+  return getnode<P>(v, B_NOT(f0), f1);
+}
+
+static void ut_nodes(struct B_VarTable *varp, std::vector<bddp> &nodes)
+/* Appends the indices of the nodes in the hash-table of varp */
+{
+  bddp i, nx;
   bddp_32 *p_32;
 #ifndef B_32
   bddp_h8 *p_h8;
 #endif
 
-  /* remove the node from hash list */
-  varp = Var + B_VAR_NP(np);
-  f0 = B_GET_BDDP(np->f0);
-  f1 = B_GET_BDDP(np->f1);
-  key = B_HASHKEY(f0, f1, varp->hashSpc);
-  B_SET_NXP(p, varp->hash, key);
-  nx1 = B_GET_BDDP(*p);
-  np1 = Node + nx1;
+  if(varp->hashSpc == 0) return;
+  if(UTType == BDD_UT_OPEN)
+  {
+    for(i=0; i<varp->hashSpc; i++)
+      if(varp->oa[i] != 0) nodes.push_back(B_OA_NDX(varp->oa[i]));
+    return;
+  }
 
-  if(np1 == np) B_CPY_BDDP(*p, np->nx);
+  if(varp->oldSpc != 0) ut_migrate(varp, varp->oldSpc);
+  for(i=0; i<varp->hashSpc; i++)
+  {
+    B_SET_NXP(p, varp->hash, i);
+    for(nx = B_GET_BDDP(*p); nx != bddnull; nx = B_GET_BDDP(Node[nx].nx))
+      nodes.push_back(nx);
+  }
+}
+
+static void swap_split(bddp f, bddvar v, char z, bddp *f0, bddp *f1)
+/* Gets the cofactors of f by v with their refs, where v is the top of
+ * f or lower */
+{
+  struct B_NodeTable *fp;
+
+  if(B_CST(f) || B_VAR_NP(fp = B_NP(f)) != v)
+  {
+    *f0 = f;
+    *f1 = z? bddfalse: f;
+  }
   else
   {
-    while(np1 != np)
-    {
-      if(nx1 == bddnull)
-        err("gc1: Fail to find the node to be deleted", np-Node, ExceptionType::InternalError);
-      np2 = np1;
-      nx1 = B_GET_BDDP(np2->nx);
-      np1 = Node + nx1;
-    }
-    B_CPY_BDDP(np2->nx, np->nx);
+    *f0 = B_GET_BDDP(fp->f0);
+    *f1 = B_GET_BDDP(fp->f1);
+    if(B_NEG(f)^B_NEG(*f0)) *f0 = B_NOT(*f0);
+    if(B_NEG(f) && !z) *f1 = B_NOT(*f1);
   }
-  varp->hashUsed--;
+  if(!B_CST(*f0)) { fp = B_NP(*f0); B_RFC_INC_NP(fp); }
+  if(!B_CST(*f1)) { fp = B_NP(*f1); B_RFC_INC_NP(fp); }
+}
 
-  /* append the node to avail list */
-  B_SET_BDDP(np->nx, Avail);
-  Avail = np - Node;
+static void swap_free(bddp f)
+/* Releases f, which is collected at once if it is no longer used */
+{
+  struct B_NodeTable *fp;
 
-  NodeUsed--;
-  np->varrfc = 0;
+  if(B_CST(f)) return;
+  fp = B_NP(f);
+  B_RFC_DEC_NP(fp);
+  if(B_RFC_ZERO_NP(fp)) gc1(fp);
+}
 
-  /* Check sub-graphs recursively */
-  if(!B_CST(f0))
+static long long swaplev(bddvar lev)
+/* Swaps the variables x of lev+1 and y of lev in place. A node of x
+ * with a child of y is rewritten to a node of y with new children of
+ * x, so that every bddp keeps its function. There must be no dead
+ * node, and the dead nodes made here are collected at once.
+ * Returns the increase of the ZDD nodes. */
+{
+  bddvar x, y;
+  struct B_NodeTable *np;
+  bddp ix, f0, f1, f00, f01, f10, f11, g0, g1, used;
+  char z;
+  size_t i;
+  long long dz;
+  B_StackScope<bddp> scope(B_Stack);
+
+  /* The nodes collected here may be reused before the next GC */
+  if(CountMemo)
   {
-    np1 = B_NP(f0);
-    B_RFC_DEC_NP(np1);
-    if(B_RFC_ZERO_NP(np1))
-    {  BDD_RECUR_INC; gc1(np1); BDD_RECUR_DEC; }
+    CountMemo->pos.clear();
+    CountMemo->word.clear();
+    CountMemo->dead = 0;
   }
-  if(!B_CST(f1))
+
+  dz = 0;
+  x = VarID[lev+1U];
+  y = VarID[lev];
+  ut_nodes(&Var[x], B_Stack);
+  for(i=scope.base; i<B_Stack.size(); i++)
   {
-    np1 = B_NP(f1);
-    B_RFC_DEC_NP(np1);
-    if(B_RFC_ZERO_NP(np1))
-    {  BDD_RECUR_INC; gc1(np1); BDD_RECUR_DEC; }
+    ix = B_Stack[i];
+    np = Node + ix;
+    z = B_Z_NP(np)? 1: 0;
+    f0 = B_GET_BDDP(np->f0);
+    f1 = B_GET_BDDP(np->f1);
+    if((B_CST(f0) || B_VAR_NP(B_NP(f0)) != y) &&
+       (B_CST(f1) || B_VAR_NP(B_NP(f1)) != y)) continue;
+    ut_remove(&Var[x], ix, f0, f1);
+    Var[x].hashUsed--;
+    if(z) f0 = B_NOT(f0);
+    used = NodeUsed;
+
+    /* The new children of x */
+    swap_split(f0, y, z, &f00, &f01);
+    swap_split(f1, y, z, &f10, &f11);
+    g0 = z? getzddp(x, f00, f10): getbddp(x, f00, f10);
+    g1 = z? getzddp(x, f01, f11): getbddp(x, f01, f11);
+
+    /* Rewrite the node (g0 is not negated as well as f0) */
+    B_SET_BDDP(np->f0, z? B_NOT(g0): g0);
+    B_SET_BDDP(np->f1, g1);
+    np->varrfc = (np->varrfc & B_RFC_MASK) | y;
+    hash_reserve(y);
+    ut_insert(&Var[y], ix, B_GET_BDDP(np->f0), g1);
+
+    swap_free(f0);
+    swap_free(f1);
+    /* The nodes below a ZDD node are all ZDD nodes */
+    if(z) dz += (long long)NodeUsed - (long long)used;
   }
+
+  Var[x].lev = lev;
+  Var[y].lev = lev + 1U;
+  VarID[lev] = x;
+  VarID[lev+1U] = y;
+  return dz;
 }
 
-static bddp count(bddp f)
+static bddvar group_bottom(bddvar lev)
+/* Returns the lowest level of the group including lev */
 {
-  bddp nx;
-  bddp c;
-  struct B_NodeTable *fp;
+  while(Var[VarID[lev]].gsize == 0) lev--;
+  return lev;
+}
 
-  /* Check consistensy
-  if(f == bddnull)
-    err("count: bddnull found", bddnull, ExceptionType::InternalError);
-  */
+static long long swap_groups(bddvar lev, bddvar s, bddvar t)
+/* Moves the group of t levels on lev+s below the group of s levels
+ * on lev, keeping the order in each group */
+{
+  bddvar i, l;
+  long long dz;
 
-  if(B_CST(f)) return 0; /* Constant */
-  fp = B_NP(f);
+  dz = 0;
+  for(i=0; i<t; i++)
+    for(l=lev+s+i; l>lev+i; l--) dz += swaplev(l - 1U);
+  return dz;
+}
 
-  /* Check visit flag */
-  nx = B_GET_BDDP(fp->nx);
-  if(nx & B_CST_MASK) return 0;
+static bddp sift_cost(long long zused)
+/* Returns the number of nodes to be minimized by reordering */
+{
+  if(ReorderCost == BDD_REORDER_ZDD) return (bddp)zused;
+  if(ReorderCost == BDD_REORDER_BDD) return NodeUsed - (bddp)zused;
+  return NodeUsed;
+}
 
-  /* Check consistensy
-  flev = Var[B_VAR_NP(fp)].lev;
-  g = B_GET_BDDP(fp->f0);
-  if(!B_CST(g))
+static void sift(bddvar v, long long *zused)
+/* Moves the group of v, which is the lowest variable of the group,
+ * to the level where the cost is the smallest. Each step exchanges it
+ * with the adjacent group, and a fixed group is never passed. */
+{
+  bddp best, cost;
+  bddvar s, lev, bestlev, b;
+  int d, up;
+
+  s = Var[v].gsize;
+  best = sift_cost(*zused);
+  bestlev = Var[v].lev;
+  up = (Var[v].lev - 1U >= VarUsed - (Var[v].lev + s - 1U));
+  for(d=0; d<2; d++, up=!up)
   {
-    gp = B_NP(g); glev = Var[B_VAR_NP(gp)].lev;
-    if(flev <= glev) 
-        err("count: inconsistensy found at f0", fp-Node, ExceptionType::InternalError);
+    for(;;)
+    {
+      lev = Var[v].lev;
+      if(up)
+      {
+        if(lev + s > VarUsed || Var[VarID[lev+s]].gfix) break;
+        *zused += swap_groups(lev, s, Var[VarID[lev+s]].gsize);
+      }
+      else
+      {
+        if(lev == 1) break;
+        b = group_bottom(lev - 1U);
+        if(Var[VarID[b]].gfix) break;
+        *zused += swap_groups(b, lev - b, s);
+      }
+      cost = sift_cost(*zused);
+      if(cost < best) { best = cost; bestlev = Var[v].lev; }
+      if(cost > best + best / B_SIFT_GROWTH) break;
+    }
   }
-  g = B_GET_BDDP(fp->f1);
-  if(!B_CST(g))
+  while((lev = Var[v].lev) < bestlev)
+    *zused += swap_groups(lev, s, Var[VarID[lev+s]].gsize);
+  while((lev = Var[v].lev) > bestlev)
   {
-    gp = B_NP(g); glev = Var[B_VAR_NP(gp)].lev;
-    if(flev <= glev) 
-        err("count: inconsistensy found at f1", fp-Node, ExceptionType::InternalError);
+    b = group_bottom(lev - 1U);
+    *zused += swap_groups(b, lev - b, s);
   }
-  */
-
-  BDD_RECUR_INC;
-  c = count(B_GET_BDDP(fp->f0)) + count(B_GET_BDDP(fp->f1)) + 1U ;
-  BDD_RECUR_DEC;
+}
 
-  /* Set visit flag */
-  B_SET_BDDP(fp->nx, nx | B_CST_MASK);
+static void cache_clear()
+/* Clears all the entries of the cache */
+{
+  bddp i;
 
-  return c;
+  for(i=0; i<CacheSpc; i++) Cache[i].op = BC_NULL;
+  for(i=0; i<Cache3Spc; i++) Cache3[i].op = BC_NULL;
 }
 
-static void export_static(FILE *strm, bddp f)
+/* Frame of andfalse() waiting for the result for (f0, g0) */
+struct B_AndFrame
 {
-  bddp nx, f0, f1;
-  bddvar v;
-  struct B_NodeTable *fp;
+  bddp f, g, key, f1, g1;
+};
 
-  if(B_CST(f)) return; /* Constant */
-  fp = B_NP(f);
+static thread_local std::vector<struct B_AndFrame> B_AndStack;
 
-  /* Check visit flag */
-  nx = B_GET_BDDP(fp->nx);
-  if(nx & B_CST_MASK) return;
-
-  /* Set visit flag */
-  B_SET_BDDP(fp->nx, nx | B_CST_MASK);
-
-  /* Dump its subgraphs recursively */
-  v = B_VAR_NP(fp);
-  f0 = B_GET_BDDP(fp->f0);
-  f0 = B_ABS(f0);
-  f1 = B_GET_BDDP(fp->f1);
-  BDD_RECUR_INC;
-  export_static(strm, f0);
-  export_static(strm, f1);
-  BDD_RECUR_DEC;
-
-  /* Dump this node */
-  fprintf_check(strm, B_BDDP_FD, B_ABS(f));
-  fprintf_check(strm, " %d ", Var[v].lev);
-  if(f0 == bddfalse) fprintf_check(strm, "F");
-  else if(f0 == bddtrue) fprintf_check(strm, "T");
-  else fprintf_check(strm, B_BDDP_FD, f0); 
-  fprintf_check(strm, " ");
-  if(f1 == bddfalse) fprintf_check(strm, "F");
-  else if(f1 == bddtrue) fprintf_check(strm, "T");
-  else fprintf_check(strm, B_BDDP_FD, f1);
-  fprintf_check(strm, "\n");
+static int andfalse(bddp f, bddp g)
+/* Returns 0 if (f & g) is false. The frames on B_AndStack have found
+ * false for (f0, g0) so far; a result 1 returns at once. */
+{
+  struct B_NodeTable *fp, *gp;
+  struct B_CacheTable *cachep;
+  bddp key, f0, f1, g0, g1, h;
+  bddvar flev, glev;
+  int r;
+  B_StackScope<struct B_AndFrame> scope(B_AndStack);
+
+  for(;;)
+  {
+    /* Check trivial cases */
+    if(f == bddfalse || g == bddfalse || f == B_NOT(g)) r = 0;
+    else if(f == bddtrue || g == bddtrue || f == g) r = 1;
+    else
+    {
+      /* Check operand swap */
+      if(f > g) { h = f; f = g; g = h; } /* swap (f, g) */
+
+      /* Non-trivial operations */
+      /* Try cache? */
+      cachep = 0;
+      if((B_CST(f) || B_RFC_ONE_NP(B_NP(f))) &&
+         (B_CST(g) || B_RFC_ONE_NP(B_NP(g)))) key = bddnull;
+      else
+      {
+        /* Checking Cache */
+        key = 0;
+        cachep = cache_find(BC_AND, f, g);
+      }
+      if(cachep)
+      {
+        /* Hit */
+        h = B_GET_BDDP(cachep->h);
+        r = (h==bddfalse)? 0: 1;
+      }
+      else
+      {
+        /* Get (f0, f1) and (g0, g1)*/
+        fp = B_NP(f);
+        flev = B_CST(f)? 0: Var[B_VAR_NP(fp)].lev;
+        gp = B_NP(g);
+        glev = B_CST(g)? 0: Var[B_VAR_NP(gp)].lev;
+        f0 = f; f1 = f;
+        g0 = g; g1 = g;
+
+        if(flev <= glev)
+        {
+          g0 = B_GET_BDDP(gp->f0);
+          g1 = B_GET_BDDP(gp->f1);
+          if(B_NEG(g)) { g0 = B_NOT(g0); g1 = B_NOT(g1); }
+        }
+
+        if(flev >= glev)
+        {
+          f0 = B_GET_BDDP(fp->f0);
+          f1 = B_GET_BDDP(fp->f1);
+          if(B_NEG(f)) { f0 = B_NOT(f0); f1 = B_NOT(f1); }
+        }
+
+        /* Get result for (f0, g0) first */
+        struct B_AndFrame fr = { f, g, key, f1, g1 };
+        B_AndStack.push_back(fr);
+        f = f0; g = g0;
+        continue;
+      }
+    }
+
+    /* Return r to the waiting frames */
+    if(r == 1) return 1;
+    for(;;)
+    {
+      if(B_AndStack.size() == scope.base) return 0;
+      struct B_AndFrame &fr = B_AndStack.back();
+      if(fr.f1 != bddnull)
+      {
+        /* Then (f1, g1) */
+        f = fr.f1; g = fr.g1;
+        fr.f1 = bddnull;
+        break;
+      }
+      /* Saving to Cache */
+      if(fr.key != bddnull) cache_store(BC_AND, fr.f, fr.g, bddfalse);
+      B_AndStack.pop_back();
+    }
+  }
 }
 
-static void dump(bddp f)
+/* Results of compose() for the nodes of the operand. They are freed and
+ * the automatic reordering is resumed at the end, also on an exception. */
+struct B_ComposeMemo
+{
+  std::unordered_map<bddp, bddp> m;
+  bddp reorderNext;
+  B_ComposeMemo(void) : reorderNext(ReorderNext) { ReorderNext = 0; }
+  ~B_ComposeMemo(void)
+  {
+    for(auto &e : m) bddfree(e.second);
+    ReorderNext = reorderNext;
+  }
+  int get(bddp f, bddp *h)
+  {
+    if(B_CST(f)) { *h = f; return 1; }
+    auto it = m.find(B_ABS(f));
+    if(it == m.end()) return 0;
+    *h = B_NEG(f)? B_NOT(it->second): it->second;
+    return 1;
+  }
+};
+
+static bddp compose(bddp f, const std::vector<bddp> &sub, char z)
+/* Substitutes sub[v] for every variable v of f in one pass, where f is
+ * not constant. sub[v] is a BDD for a BDD f, and the new VarID for a
+ * ZDD f. The negation of f is kept in both cases. The results are
+ * memoized only in this call, as they depend on sub.
+ * Returns bddnull if not enough memory */
 {
-  bddp nx, f0, f1;
+  bddp x, x0, x1, r0, r1, t, h;
   bddvar v;
   struct B_NodeTable *fp;
+  B_StackScope<bddp> scope(B_Stack);
+  B_ComposeMemo memo;
 
-  if(B_CST(f)) return; /* Constant */
-  fp = B_NP(f);
+  B_Stack.push_back(B_ABS(f));
+  while(B_Stack.size() > scope.base)
+  {
+    x = B_Stack.back();
+    if(memo.m.count(x)) { B_Stack.pop_back(); continue; }
+    fp = B_NP(x);
+    v = B_VAR_NP(fp);
+    x0 = B_ABS(B_GET_BDDP(fp->f0));
+    x1 = B_GET_BDDP(fp->f1);
+    if(!memo.get(x0, &r0)) { B_Stack.push_back(x0); continue; }
+    if(!memo.get(x1, &r1)) { B_Stack.push_back(B_ABS(x1)); continue; }
+    B_Stack.pop_back();
 
-  /* Check visit flag */
-  nx = B_GET_BDDP(fp->nx);
-  if(nx & B_CST_MASK) return;
-
-  /* Set visit flag */
-  B_SET_BDDP(fp->nx, nx | B_CST_MASK);
-
-  /* Dump its subgraphs recursively */
-  v = B_VAR_NP(fp);
-  f0 = B_GET_BDDP(fp->f0);
-  f0 = B_ABS(f0);
-  f1 = B_GET_BDDP(fp->f1);
-  BDD_RECUR_INC;
-  dump(f0);
-  dump(f1);
-  BDD_RECUR_DEC;
-
-  /* Dump this node */
-  printf("N");
-  printf(B_BDDP_FD, B_NDX(f));
-  printf(" = [V%d(%d), ", v, Var[v].lev);
-  if(B_CST(f0)) printf(B_BDDP_FD, B_VAL(f0));
-  else { printf("N"); printf(B_BDDP_FD, B_NDX(f0)); }
-  printf(", ");
-  if(B_NEG(f1)) putchar('~'); 
-  if(B_CST(f1)) printf(B_BDDP_FD, B_ABS(B_VAL(f1)));
-  else { printf("N"); printf(B_BDDP_FD, B_NDX(f1)); }
-  printf("]");
-  if(B_Z_NP(fp)) printf(" #Z");
-  printf("\n");
+    if(z)
+    {
+      /* r0 + r1.Change(w) */
+      t = apply(r1, sub[v], BC_CHANGE, 0);
+      if(t == bddnull) return bddnull;
+      h = apply(r0, t, BC_UNION, 0);
+      bddfree(t);
+    }
+    else h = apply(sub[v], r1, BC_ITE, 0, r0);
+    if(h == bddnull) return bddnull;
+    memo.m[x] = h;
+  }
+  h = bddnull;
+  memo.get(f, &h);
+  return bddcopy(h);
 }
 
-static void reset(bddp f)
+/* Hash of an operand list of nary() */
+struct B_NaryHash
 {
-  bddp nx;
-  struct B_NodeTable *fp;
+  size_t operator()(const std::vector<bddp> &fs) const
+  {
+    size_t h = fs.size();
+    for(bddp f : fs) h = h * 1234567 + (size_t)f;
+    return h;
+  }
+};
 
-  if(B_CST(f)) return; /* Constant */
-  fp = B_NP(f);
+/* A pending step of nary(). ops is the sorted operand list, and h0 is the
+ * result for the 0-cofactors after state 1 */
+struct B_NaryFrame
+{
+  std::vector<bddp> ops;
+  bddvar v;
+  bddp h0;
+  char state;
+};
 
-  /* Check visit flag */
-  nx = B_GET_BDDP(fp->nx);
-  if(nx & B_CST_MASK)
+/* Results of nary() for the operand lists and the pending steps. They are
+ * freed and the automatic reordering is resumed at the end, also on an
+ * exception. */
+struct B_NaryMemo
+{
+  std::unordered_map<std::vector<bddp>, bddp, B_NaryHash> m;
+  std::vector<B_NaryFrame> st;
+  bddp reorderNext;
+  B_NaryMemo(void) : reorderNext(ReorderNext) { ReorderNext = 0; }
+  ~B_NaryMemo(void)
   {
-    /* Reset visit flag */
-    B_SET_BDDP(fp->nx, nx & ~B_CST_MASK);
-    BDD_RECUR_INC;
-    reset(B_GET_BDDP(fp->f0));
-    reset(B_GET_BDDP(fp->f1));
-    BDD_RECUR_DEC;
+    for(auto &e : m) bddfree(e.second);
+    for(auto &fr : st) bddfree(fr.h0);
+    ReorderNext = reorderNext;
   }
-}
+};
 
-static bddp getzddp(bddvar v, bddp f0, bddp f1)
-/* Returns bddnull if not enough memory */
+static bddp nary(std::vector<bddp> &fs, unsigned char op)
+/* Returns the union (op == BC_UNION) or the intersection
+ * (op == BC_INTERSEC) of the ZDDs in fs. All the operands are split by
+ * the same top variable at once, and the lists of the cofactors are
+ * memoized only in this call. Lists of two operands are passed to apply()
+ * to share the operation cache. fs is destroyed.
+ * Returns bddnull if not enough memory */
 {
-  /* Check elimination rule */
-  if(f1 == bddfalse) return f0;
-
-  /* Negative edge constraint */
-  if(B_NEG(f0))
+  B_NaryMemo memo;
+  struct B_NodeTable *fp;
+  bddvar lev, flev;
+  bddp f, f0, h, h1;
+  size_t i;
+
+  memo.st.emplace_back();
+  memo.st.back().ops.swap(fs);
+  memo.st.back().h0 = bddfalse;
+  memo.st.back().state = 0;
+  for(;;)
   {
-    bddp h;
+    B_NaryFrame &fr = memo.st.back();
+    std::vector<bddp> &ops = fr.ops;
+    switch(fr.state)
+    {
+    case 0:
+      /* Normalize the operand list */
+      std::sort(ops.begin(), ops.end());
+      ops.erase(std::unique(ops.begin(), ops.end()), ops.end());
+      {
+        auto it = std::find(ops.begin(), ops.end(), bddfalse);
+        if(it != ops.end())
+        {
+          if(op == BC_INTERSEC) { h = bddfalse; break; }
+          ops.erase(it);
+        }
+      }
+      if(ops.size() == 0) { h = bddfalse; break; }
+      if(ops.size() == 1) { h = bddcopy(ops[0]); break; }
+      if(ops.size() == 2)
+      {
+        h = apply(ops[0], ops[1], op, 0);
+        if(h == bddnull) return bddnull;
+        break;
+      }
+      {
+        auto it = memo.m.find(ops);
+        if(it != memo.m.end()) { h = bddcopy(it->second); break; }
+      }
 
-    h = getnode(v, f0, f1);
-    if(h == bddnull) return bddnull;
-    return B_NOT(h);
+      /* Top variable of all the operands */
+      lev = 0;
+      for(i=0; i<ops.size(); i++)
+      {
+        if(B_CST(ops[i])) continue;
+        flev = Var[B_VAR_NP(B_NP(ops[i]))].lev;
+        if(lev < flev) lev = flev;
+      }
+      fr.v = VarID[lev];
+
+      /* 0-cofactors */
+      fs.clear();
+      for(i=0; i<ops.size(); i++)
+      {
+        f = ops[i];
+        if(!B_CST(f) && B_VAR_NP(fp = B_NP(f)) == fr.v)
+        {
+          f0 = B_GET_BDDP(fp->f0);
+          f = B_NEG(f)^B_NEG(f0)? B_NOT(f0): f0;
+        }
+        fs.push_back(f);
+      }
+      fr.state = 1;
+      memo.st.emplace_back();
+      memo.st.back().ops.swap(fs);
+      memo.st.back().h0 = bddfalse;
+      memo.st.back().state = 0;
+      continue;
+
+    case 1:
+      /* 1-cofactors, which are empty for the operands without v */
+      fs.clear();
+      for(i=0; i<ops.size(); i++)
+      {
+        f = ops[i];
+        if(!B_CST(f) && B_VAR_NP(fp = B_NP(f)) == fr.v)
+          fs.push_back(B_GET_BDDP(fp->f1));
+        else if(op == BC_INTERSEC) { fs.clear(); break; }
+      }
+      fr.state = 2;
+      if(fs.empty()) { h = bddfalse; continue; }
+      memo.st.emplace_back();
+      memo.st.back().ops.swap(fs);
+      memo.st.back().h0 = bddfalse;
+      memo.st.back().state = 0;
+      continue;
+
+    case 2:
+      h1 = h;
+      h = getzddp(fr.v, fr.h0, h1);
+      if(h == bddnull) { bddfree(h1); return bddnull; }
+      fr.h0 = bddfalse;
+      memo.m.emplace(std::move(ops), h);
+      h = bddcopy(h);
+      break;
+    }
+
+    /* Return h to the caller step */
+    memo.st.pop_back();
+    if(memo.st.empty()) return h;
+    if(memo.st.back().state == 1) memo.st.back().h0 = h;
   }
-  return getnode(v, B_NOT(f0), f1);
 }
 
-static int andfalse(bddp f, bddp g)
+static size_t count_node(bddp f)
+/* Returns the position in CountMemo->word of the count of the positive
+ * non-constant ZDD node f. The counts of the descendants are memoized
+ * in post-order, where a positive node has no empty set and a negative
+ * edge adds it. */
 {
-  struct B_NodeTable *fp, *gp;
-  struct B_CacheTable *cachep;
-  bddp key, f0, f1, g0, g1, h;
-  bddvar flev, glev;
-
-  /* Check trivial cases */
-  if(f == bddfalse || g == bddfalse || f == B_NOT(g)) return 0;
-  if(f == bddtrue || g == bddtrue || f == g) return 1;
-  /* Check operand swap */
-  if(f > g) { h = f; f = g; g = h; } /* swap (f, g) */
+  struct B_CountMemo *cm;
+  struct B_NodeTable *fp;
+  bddp x, x0, x1;
+  size_t a, b, la, lb, n, i, p;
+  unsigned long long c, s;
+  B_StackScope<bddp> scope(B_Stack);
 
-  /* Non-trivial operations */
-  /* Try cache? */
-  if((B_CST(f) || B_RFC_ONE_NP(B_NP(f))) &&
-     (B_CST(g) || B_RFC_ONE_NP(B_NP(g)))) key = bddnull;
-  else
+  if(!CountMemo)
   {
-    /* Checking Cache */
-    key = B_CACHEKEY(BC_AND, f, g);
-    cachep = Cache + key;
-    if(cachep->op == BC_AND &&
-       f == B_GET_BDDP(cachep->f) &&
-       g == B_GET_BDDP(cachep->g))
+    CountMemo = new B_CountMemo;
+    CountMemo->dead = 0;
+  }
+  cm = CountMemo;
+  B_Stack.push_back(f);
+  while(B_Stack.size() > scope.base)
+  {
+    x = B_Stack.back();
+    if(cm->pos.count(x)) { B_Stack.pop_back(); continue; }
+    fp = B_NP(x);
+    x0 = B_ABS(B_GET_BDDP(fp->f0));
+    x1 = B_GET_BDDP(fp->f1);
+    if(!B_CST(x0) && !cm->pos.count(x0)) { B_Stack.push_back(x0); continue; }
+    if(!B_CST(x1) && !cm->pos.count(B_ABS(x1)))
+      { B_Stack.push_back(B_ABS(x1)); continue; }
+    B_Stack.pop_back();
+
+    /* count(x0) + count(abs(x1)) + (1 if x1 is negative) */
+    a = B_CST(x0)? 0: cm->pos[x0];
+    b = B_CST(x1)? 0: cm->pos[B_ABS(x1)];
+    la = B_CST(x0)? 0: (size_t)cm->word[a];
+    lb = B_CST(x1)? 0: (size_t)cm->word[b];
+    n = (la > lb)? la: lb;
+    p = cm->word.size();
+    cm->word.resize(p + n + 2);
+    c = B_NEG(x1)? 1: 0;
+    for(i=0; i<n; i++)
     {
-      /* Hit */
-      h = B_GET_BDDP(cachep->h);
-      return (h==bddfalse)? 0: 1;
+      s = c;
+      c = 0;
+      if(i < la) { s += cm->word[a+1+i]; if(s < cm->word[a+1+i]) c = 1; }
+      if(i < lb) { s += cm->word[b+1+i]; if(s < cm->word[b+1+i]) c++; }
+      cm->word[p+1+i] = s;
     }
+    cm->word[p+1+n] = c;
+    if(c) n++;
+    cm->word.resize(p + n + 1);
+    cm->word[p] = n;
+    cm->pos[x] = p;
   }
-  /* Get (f0, f1) and (g0, g1)*/
+  return cm->pos[f];
+}
+
+static void cardmp(bddp f, std::vector<unsigned long long> &w, const char *name)
+/* Sets the number of sets in the ZDD f to w by 64-bit limbs from the
+ * lowest, without the leading zeros. It is 0 for bddnull. */
+{
+  struct B_NodeTable *fp;
+  char msg[64];
+  size_t p, i;
+
+  w.clear();
+  if(f == bddnull || f == bddfalse) return;
+  if(f == bddtrue) { w.push_back(1); return; }
   fp = B_NP(f);
-  flev = B_CST(f)? 0: Var[B_VAR_NP(fp)].lev;
-  gp = B_NP(g);
-  glev = B_CST(g)? 0: Var[B_VAR_NP(gp)].lev;
-  f0 = f; f1 = f;
-  g0 = g; g1 = g;
+  if(B_CST(f) || fp>=Node+NodeSpc || !fp->varrfc)
+  {
+    snprintf(msg, sizeof(msg), "%s: Invalid bddp", name);
+    err(msg, f, ExceptionType::InvalidBDDValue);
+  }
+  if(!B_Z_NP(fp))
+  {
+    snprintf(msg, sizeof(msg), "%s: applying non-ZDD node", name);
+    err(msg, f, ExceptionType::InvalidBDDValue);
+  }
 
-  if(flev <= glev)
+  p = count_node(B_ABS(f));
+  w.assign(CountMemo->word.begin() + p + 1,
+           CountMemo->word.begin() + p + 1 + CountMemo->word[p]);
+  if(B_NEG(f))
   {
-    g0 = B_GET_BDDP(gp->f0);
-    g1 = B_GET_BDDP(gp->f1);
-    if(B_NEG(g)) { g0 = B_NOT(g0); g1 = B_NOT(g1); }
+    /* Adds the empty set */
+    for(i=0; i<w.size() && ++w[i] == 0; i++) ;
+    if(i == w.size()) w.push_back(1);
   }
+}
+
+static bddp nodelist(bddp f, std::vector<struct bddnode> &list)
+/* Sets the nodes of f to list from the lowest level, and returns the
+ * reference to the root (see bddnodelist). f must be valid. */
+{
+  std::unordered_map<bddp, bddp> pos;
+  std::vector<bddp> nodes;
+  struct B_NodeTable *fp;
+  bddp x, x0, x1, i;
+  char z;
+  B_StackScope<bddp> scope(B_Stack);
 
-  if(flev >= glev)
+  list.clear();
+  if(B_CST(f)) return B_NEG(f)? 1: 0;
+
+  /* Collects the nodes */
+  B_Stack.push_back(B_ABS(f));
+  while(B_Stack.size() > scope.base)
   {
-    f0 = B_GET_BDDP(fp->f0);
-    f1 = B_GET_BDDP(fp->f1);
-    if(B_NEG(f)) { f0 = B_NOT(f0); f1 = B_NOT(f1); }
+    x = B_Stack.back();
+    B_Stack.pop_back();
+    if(!pos.emplace(x, 0).second) continue;
+    nodes.push_back(x);
+    fp = B_NP(x);
+    x0 = B_ABS(B_GET_BDDP(fp->f0));
+    x1 = B_ABS(B_GET_BDDP(fp->f1));
+    if(!B_CST(x0)) B_Stack.push_back(x0);
+    if(!B_CST(x1)) B_Stack.push_back(x1);
+  }
+  std::sort(nodes.begin(), nodes.end(), [](bddp a, bddp b)
+  {
+    bddvar la = Var[B_VAR_NP(B_NP(a))].lev, lb = Var[B_VAR_NP(B_NP(b))].lev;
+    return (la != lb)? la < lb: a < b;
+  });
+
+  /* The children are listed before their parents */
+  for(i=0; i<nodes.size(); i++) pos[nodes[i]] = (i + 1) << 1;
+  list.resize(nodes.size());
+  for(i=0; i<nodes.size(); i++)
+  {
+    fp = B_NP(nodes[i]);
+    z = B_Z_NP(fp)? 1: 0;
+    x0 = B_GET_BDDP(fp->f0);
+    x1 = B_GET_BDDP(fp->f1);
+    if(z) x0 = B_ABS(x0);
+    list[i].v = B_VAR_NP(fp);
+    list[i].lo = (B_CST(x0)? 0: pos[B_ABS(x0)]) | (B_NEG(x0)? 1: 0);
+    list[i].hi = (B_CST(x1)? 0: pos[B_ABS(x1)]) | (B_NEG(x1)? 1: 0);
   }
+  return pos[B_ABS(f)] | (B_NEG(f)? 1: 0);
+}
 
-  /* Get result */
-  if(andfalse(f0, g0) == 1) return 1;
-  if(andfalse(f1, g1) == 1) return 1;
+static void count_sweep(void)
+/* Removes the counts of the collected nodes from CountMemo, and packs
+ * the words if more than half of them are removed */
+{
+  struct B_CountMemo *cm;
+  std::vector<unsigned long long> word;
+  size_t n;
 
-  /* Saving to Cache */
-  if(key != bddnull)
+  cm = CountMemo;
+  for(auto it = cm->pos.begin(); it != cm->pos.end(); )
   {
-    cachep = Cache + key;
-    cachep->op = BC_AND;
-    B_SET_BDDP(cachep->f, f);
-    B_SET_BDDP(cachep->g, g);
-    B_SET_BDDP(cachep->h, bddfalse);
+    if(B_NP(it->first)->varrfc != 0) { ++it; continue; }
+    cm->dead += cm->word[it->second] + 1;
+    it = cm->pos.erase(it);
   }
-  return 0;
+  if(cm->dead <= cm->word.size() / 2) return;
+  word.reserve(cm->word.size() - cm->dead);
+  for(auto &e : cm->pos)
+  {
+    n = (size_t)cm->word[e.second] + 1;
+    word.insert(word.end(), cm->word.begin() + e.second,
+                cm->word.begin() + e.second + n);
+    e.second = word.size() - n;
+  }
+  cm->word.swap(word);
+  cm->dead = 0;
 }
 
 static int err(const char *msg, bddp num, ExceptionType exType)
@@ -2811,7 +7291,8 @@ static int rfc_dec_ovf(struct B_NodeTable *np)
       rfc = B_GET_BDDP((RFCT+key)->rfc);
       if(rfc == 0)
       {
-        np->varrfc -= B_RFC_UNIT;
+        /* Atomic as the parallel GC may update other nodes meanwhile */
+        __atomic_fetch_sub(&np->varrfc, B_RFC_UNIT, __ATOMIC_ACQ_REL);
         return 0;
       }
       B_SET_BDDP((RFCT+key)->rfc, rfc-1);
@@ -2825,35 +7306,29 @@ static int rfc_dec_ovf(struct B_NodeTable *np)
 
 #define IMPORTHASH(x) ((((x)>>1)^((x)<<8)^((x)<<16)) & (hashsize-1))
 
-int import(FILE *strm, bddp *p, int lim, int z)
+static int import(BDD_Tokenizer &tk, bddp *p, int lim, int z)
 {
-  int n, m, v, i, lev, var, inv, e;
+  int n, m, i, lev, var, inv, e;
+  long long v;
   bddp n_nd, ix, f, f0, f1, nd, nd0, nd1, hashsize, ixx;
-  char s[256];
   bddp *hash1;
   bddp *hash2;
 
-  v = fscanf(strm, "%s", s);
-  if(v == EOF) throw BDDFileFormatException("Import error: Unexpected end of file", 0);
-  if(strcmp(s, "_i") != 0) throw BDDFileFormatException("Import error: Expected '_i' marker", 0);
-  v = fscanf(strm, "%s", s);
-  if(v == EOF) throw BDDFileFormatException("Import error: Unexpected end of file", 0);
-  n = strtol(s, 0, 10);
+  if(!tk.Next()) throw BDDFileFormatException("Import error: Unexpected end of file", 0);
+  if(!tk.Is("_i")) throw BDDFileFormatException("Import error: Expected '_i' marker", 0);
+  if(!tk.Next()) throw BDDFileFormatException("Import error: Unexpected end of file", 0);
+  n = tk.Int();
   while(n > (int)bddvarused()) bddnewvar();
 
-  v = fscanf(strm, "%s", s);
-  if(v == EOF) throw BDDFileFormatException("Import error: Unexpected end of file", 0);
-  if(strcmp(s, "_o") != 0) throw BDDFileFormatException("Import error: Expected '_o' marker", 0);
-  v = fscanf(strm, "%s", s);
-  if(v == EOF) throw BDDFileFormatException("Import error: Unexpected end of file", 0);
-  m = strtol(s, 0, 10);
+  if(!tk.Next()) throw BDDFileFormatException("Import error: Unexpected end of file", 0);
+  if(!tk.Is("_o")) throw BDDFileFormatException("Import error: Expected '_o' marker", 0);
+  if(!tk.Next()) throw BDDFileFormatException("Import error: Unexpected end of file", 0);
+  m = tk.Int();
 
-  v = fscanf(strm, "%s", s);
-  if(v == EOF) throw BDDFileFormatException("Import error: Unexpected end of file", 0);
-  if(strcmp(s, "_n") != 0) throw BDDFileFormatException("Import error: Expected '_n' marker", 0);
-  v = fscanf(strm, "%s", s);
-  if(v == EOF) throw BDDFileFormatException("Import error: Unexpected end of file", 0);
-  n_nd = B_STRTOI(s, 0, 10);
+  if(!tk.Next()) throw BDDFileFormatException("Import error: Unexpected end of file", 0);
+  if(!tk.Is("_n")) throw BDDFileFormatException("Import error: Expected '_n' marker", 0);
+  if(!tk.Next()) throw BDDFileFormatException("Import error: Unexpected end of file", 0);
+  n_nd = tk.Int();
 
   for(hashsize = 1; hashsize < (n_nd<<1); hashsize <<= 1)
     ; /* empty */
@@ -2872,22 +7347,20 @@ int import(FILE *strm, bddp *p, int lim, int z)
   e = 0;
   for(ix=0; ix<n_nd; ix++)
   {
-    v = fscanf(strm, "%s", s);
-    if(v == EOF) { e = 1; break; }
-    nd = B_STRTOI(s, 0, 10);
+    if(!tk.Next() || !tk.Int(v)) { e = 1; break; }
+    nd = v;
     
-    v = fscanf(strm, "%s", s);
-    if(v == EOF) { e = 1; break; }
-    lev = strtol(s, 0, 10);
+    if(!tk.Next() || !tk.Int(v)) { e = 1; break; }
+    lev = v;
     var = bddvaroflev(lev);
 
-    v = fscanf(strm, "%s", s);
-    if(v == EOF) { e = 1; break; }
-    if(strcmp(s, "F") == 0) f0 = bddfalse;
-    else if(strcmp(s, "T") == 0) f0 = bddtrue;
+    if(!tk.Next()) { e = 1; break; }
+    if(tk.Is("F")) f0 = bddfalse;
+    else if(tk.Is("T")) f0 = bddtrue;
     else
     {
-      nd0 = B_STRTOI(s, 0, 10);
+      if(!tk.Int(v)) { e = 1; break; }
+      nd0 = v;
 
       ixx = IMPORTHASH(nd0);
       while(hash1[ixx] != nd0)
@@ -2907,13 +7380,13 @@ int import(FILE *strm, bddp *p, int lim, int z)
       f0 = bddcopy(hash2[ixx]);
     }
 
-    v = fscanf(strm, "%s", s);
-    if(v == EOF) { e = 1; bddfree(f0); break; }
-    if(strcmp(s, "F") == 0) f1 = bddfalse;
-    else if(strcmp(s, "T") == 0) f1 = bddtrue;
+    if(!tk.Next()) { e = 1; bddfree(f0); break; }
+    if(tk.Is("F")) f1 = bddfalse;
+    else if(tk.Is("T")) f1 = bddtrue;
     else
     {
-      nd1 = B_STRTOI(s, 0, 10);
+      if(!tk.Int(v)) { e = 1; bddfree(f0); break; }
+      nd1 = v;
       if(nd1 & 1) { inv = 1; nd1 ^= 1; }
       else inv = 0;
   
@@ -2978,8 +7451,7 @@ int import(FILE *strm, bddp *p, int lim, int z)
   for(i=0; i<m; i++)
   {
     if(i >= lim) break;
-    v = fscanf(strm, "%s", s);
-    if(v == EOF)
+    if(!tk.Next() || !(tk.Is("F") || tk.Is("T") || tk.Int(v)))
     {
       // Cleanup on error
       for(i--; i>=0; i--) bddfree(p[i]);
@@ -2987,13 +7459,13 @@ int import(FILE *strm, bddp *p, int lim, int z)
         if(hash1[ix] != bddnull) bddfree(hash2[ix]);
       free(hash2);
       free(hash1);
-      throw BDDFileFormatException("Import error: Unexpected end of file", 0);
+      throw BDDFileFormatException("Import error: Unexpected end of file or format error", 0);
     }
-    if(strcmp(s, "F") == 0) p[i] = bddfalse;
-    else if(strcmp(s, "T") == 0) p[i] = bddtrue;
+    if(tk.Is("F")) p[i] = bddfalse;
+    else if(tk.Is("T")) p[i] = bddtrue;
     else
     {
-      nd = B_STRTOI(s, 0, 10);
+      nd = v;
       if(nd & 1) { inv = 1; nd ^= 1; }
       else inv = 0;
   
@@ -3027,40 +7499,6 @@ int import(FILE *strm, bddp *p, int lim, int z)
   return 0;
 }
 
-int mp_add(struct B_MP *p, bddp ix)
-{
-  int len, i;
-  bddp c, *wp;
-
-  if(ix == B_MP_NULL) return 1;
-  len = B_MP_LEN(ix);
-  if(len) wp = mptable[len-1].word+(B_MP_VAL(ix)*len);
-  else { wp = &ix; len = 1; }
-  while(p->len < len) p->word[p->len++] = 0;
-
-  c = 0;
-  for(i=0; i<p->len; i++)
-  {
-    p->word[i] += c;
-    c = (p->word[i] >= c)? 0: 1;
-    if(i < len)
-    {
-      p->word[i] += wp[i];
-      c = (p->word[i] >= wp[i])? c: 1;
-    }
-  }
-  if(c)
-  {
-    if(p->len == B_MP_LMAX)
-    {
-      for(i=0; i<p->len; i++) p->word[i] = ~((bddp)0);
-      return 1;
-    }
-    p->word[p->len++] = c;
-  }
-  return 0;
-}
-
 static void setcacheratiovalue(double ratio)
 {
   const double epsilon = 1e-9;
@@ -3099,8 +7537,11 @@ static bool allocatecache()
   bddp oldCacheSpc = 0;
   bddp newCacheSpc;
   struct B_CacheTable *newCache;
+  void *newCacheMem;
+  unsigned char *newEpoch;
   bddp ix;
   struct B_CacheTable *cp, *cp1;
+  struct B_Cache3Table *newCache3;
 
   if (Cache != NULL) {
     oldCacheSpc = CacheSpc;
@@ -3127,11 +7568,16 @@ static bool allocatecache()
 
   /* If size is different, reallocate cache */
   if (newCacheSpc != oldCacheSpc || Cache == NULL) {
-    /* Allocate new cache */
-    newCache = B_MALLOC(struct B_CacheTable, newCacheSpc);
-    if (newCache == NULL) {
+    /* Allocate new cache (aligned so that a set fits in a cache line) */
+    newCacheMem = malloc(sizeof(struct B_CacheTable) * newCacheSpc + B_CACHE_ALIGN);
+    newEpoch = (unsigned char *)malloc(newCacheSpc);
+    if (newCacheMem == NULL || newEpoch == NULL) {
+      if (newCacheMem) free(newCacheMem);
+      if (newEpoch) free(newEpoch);
       return false;
     }
+    newCache = (struct B_CacheTable *)
+      (((size_t)newCacheMem + B_CACHE_ALIGN - 1U) & ~(size_t)(B_CACHE_ALIGN - 1U));
 
     if (Cache != NULL) { /* reallocate cache */
       /* Copy old cache to new cache */
@@ -3142,6 +7588,7 @@ static bool allocatecache()
         B_CPY_BDDP(cp->f, cp1->f);
         B_CPY_BDDP(cp->g, cp1->g);
         B_CPY_BDDP(cp->h, cp1->h);
+        newEpoch[ix] = CacheEpoch[ix];
       }
       if (newCacheSpc > oldCacheSpc) {
         /* assume that oldCacheSpc is the power of 2 */
@@ -3153,21 +7600,232 @@ static bool allocatecache()
           B_CPY_BDDP(cp->f, cp1->f);
           B_CPY_BDDP(cp->g, cp1->g);
           B_CPY_BDDP(cp->h, cp1->h);
+          newEpoch[ix] = newEpoch[ix - oldCacheSpc];
         }
       }
-      free(Cache);
+      free(CacheMem);
+      free(CacheEpoch);
     } else {
       /* Initialize new cache */
-      for(ix=0; ix<newCacheSpc; ix++) newCache[ix].op = BC_NULL;
+      for(ix=0; ix<newCacheSpc; ix++)
+      {
+        newCache[ix].op = BC_NULL;
+        newEpoch[ix] = 0;
+      }
     }
 
     /* Update pointers */
+    CacheMem = newCacheMem;
+    CacheEpoch = newEpoch;
     Cache = newCache;
     CacheSpc = newCacheSpc;
   }
+
+  /* The three-operand cache is cleared when resized */
+  if (Cache3Spc != (CacheSpc >> B_CACHE3_SHIFT)) {
+    newCache3 = (struct B_Cache3Table *)
+      calloc(CacheSpc >> B_CACHE3_SHIFT, sizeof(struct B_Cache3Table));
+    if (newCache3 == NULL) return false;
+    if (Cache3) free(Cache3);
+    Cache3 = newCache3;
+    Cache3Spc = CacheSpc >> B_CACHE3_SHIFT;
+  }
   return true;
 }
 
+template<int P>
+static inline struct B_CacheTable *cache_find(unsigned char op, bddp f, bddp g)
+/* Returns the entry of (op, f, g), or 0 if not found */
+{
+  struct B_CacheTable *setp, *cachep, e;
+  unsigned char *epochp;
+  int i;
+
+  setp = B_CACHESET(op, f, g);
+  if(CacheWays == 1 && GCMode == BDD_GC_FULL)
+  {
+    /* Direct mapped (the default): no LRU order and no epoch */
+    if(setp->op == op && f == B_GET_BDDP(setp->f) &&
+       g == B_GET_BDDP(setp->g))
+    {
+      B_STAT_INC(CacheStat[op].hit);
+      return setp;
+    }
+    B_STAT_INC(CacheStat[op].miss);
+    return 0;
+  }
+  epochp = CacheEpoch + (setp - Cache);
+  for(i=0; i<CacheWays; i++)
+  {
+    cachep = setp + i;
+    if(cachep->op == op &&
+       f == B_GET_BDDP(cachep->f) &&
+       g == B_GET_BDDP(cachep->g))
+    {
+      /* Check the nodes if GC has run since the last check. With
+       * BDD_GC_FULL, the entries of dead nodes are removed by GC, and
+       * CacheEpoch is not used. */
+      if(GCMode == BDD_GC_EPOCH && epochp[i] != GCEpoch)
+      {
+        if(!cache_alive(cachep, epochp[i]))
+        {
+          cachep->op = BC_NULL;
+          break;
+        }
+        epochp[i] = GCEpoch;
+      }
+      B_STAT_INC(CacheStat[op].hit);
+      if(i == 0) return cachep;
+      /* Move to the front of the set (LRU order) */
+      e = *cachep;
+      memmove(setp + 1, setp, sizeof(struct B_CacheTable) * i);
+      *setp = e;
+      if(GCMode == BDD_GC_EPOCH)
+      {
+        memmove(epochp + 1, epochp, i);
+        *epochp = GCEpoch;
+      }
+      return setp;
+    }
+  }
+  B_STAT_INC(CacheStat[op].miss);
+  return 0;
+}
+
+template<int P>
+static inline int cache_get(unsigned char op, bddp f, bddp g, bddp *h)
+/* Returns 1 with the result h of (op, f, g) if found in the cache.
+ * The set of the entry is locked while the parallel apply runs. */
+{
+  struct B_CacheTable *cachep;
+  B_ParCacheLock lock(P, B_CACHESET(op, f, g));
+
+  cachep = cache_find<P>(op, f, g);
+  if(!cachep) return 0;
+  *h = B_GET_BDDP(cachep->h);
+  return 1;
+}
+
+static int cache_peek(unsigned char op, bddp f, bddp g)
+/* Returns 1 if (op, f, g) has an entry in the cache. The entry is not
+ * counted in the statistics, moved, or checked for dead nodes. */
+{
+  struct B_CacheTable *setp;
+  int i;
+
+  setp = B_CACHESET(op, f, g);
+  for(i=0; i<CacheWays; i++)
+    if(setp[i].op == op && f == B_GET_BDDP(setp[i].f) &&
+       g == B_GET_BDDP(setp[i].g)) return 1;
+  return 0;
+}
+
+template<int P>
+static inline void cache_store(unsigned char op, bddp f, bddp g, bddp h)
+{
+  struct B_CacheTable *setp, *cachep;
+  unsigned char *epochp;
+  int i;
+
+  /* An overflow of the parallel apply is not a result */
+  if(P && h == bddnull) return;
+
+  /* Find the same key, an empty way or the least recently used way */
+  setp = B_CACHESET(op, f, g);
+  B_ParCacheLock lock(P, setp);
+  if(CacheWays == 1 && GCMode == BDD_GC_FULL)
+  {
+    /* Direct mapped (the default): overwrite the only way */
+    if(setp->op != BC_NULL &&
+       (setp->op != op ||
+        f != B_GET_BDDP(setp->f) ||
+        g != B_GET_BDDP(setp->g)))
+      B_STAT_INC(CacheStat[setp->op].evict);
+    setp->op = op;
+    B_SET_BDDP(setp->f, f);
+    B_SET_BDDP(setp->g, g);
+    B_SET_BDDP(setp->h, h);
+    return;
+  }
+  for(i=0; i<CacheWays-1; i++)
+  {
+    cachep = setp + i;
+    if(cachep->op == BC_NULL) break;
+    if(cachep->op == op &&
+       f == B_GET_BDDP(cachep->f) &&
+       g == B_GET_BDDP(cachep->g)) break;
+  }
+  cachep = setp + i;
+  if(cachep->op != BC_NULL &&
+     (cachep->op != op ||
+      f != B_GET_BDDP(cachep->f) ||
+      g != B_GET_BDDP(cachep->g)))
+    B_STAT_INC(CacheStat[cachep->op].evict);
+
+  /* Store it at the front of the set */
+  if(i > 0) memmove(setp + 1, setp, sizeof(struct B_CacheTable) * i);
+  if(GCMode == BDD_GC_EPOCH)
+  {
+    epochp = CacheEpoch + (setp - Cache);
+    if(i > 0) memmove(epochp + 1, epochp, i);
+    *epochp = GCEpoch;
+  }
+  setp->op = op;
+  B_SET_BDDP(setp->f, f);
+  B_SET_BDDP(setp->g, g);
+  B_SET_BDDP(setp->h, h);
+}
+
+template<int P>
+static struct B_Cache3Table *cache3_find(unsigned char op, bddp f, bddp g, bddp k)
+/* Returns the entry of (op, f, g, k), or 0 if not found */
+{
+  struct B_Cache3Table *cache3p;
+
+  cache3p = Cache3 + B_CACHE3KEY(op, f, g, k);
+  if(cache3p->op == op &&
+     f == B_GET_BDDP(cache3p->f) &&
+     g == B_GET_BDDP(cache3p->g) &&
+     k == B_GET_BDDP(cache3p->k))
+  {
+    /* Check the nodes if GC has run since the last check */
+    if(cache3p->epoch != GCEpoch)
+    {
+      if(!cache3_alive(cache3p, cache3p->epoch))
+      {
+        cache3p->op = BC_NULL;
+        B_STAT_INC(CacheStat[op].miss);
+        return 0;
+      }
+      cache3p->epoch = GCEpoch;
+    }
+    B_STAT_INC(CacheStat[op].hit);
+    return cache3p;
+  }
+  B_STAT_INC(CacheStat[op].miss);
+  return 0;
+}
+
+template<int P>
+static void cache3_store(unsigned char op, bddp f, bddp g, bddp k, bddp h)
+{
+  struct B_Cache3Table *cache3p;
+
+  cache3p = Cache3 + B_CACHE3KEY(op, f, g, k);
+  if(cache3p->op != BC_NULL &&
+     (cache3p->op != op ||
+      f != B_GET_BDDP(cache3p->f) ||
+      g != B_GET_BDDP(cache3p->g) ||
+      k != B_GET_BDDP(cache3p->k)))
+    B_STAT_INC(CacheStat[cache3p->op].evict);
+  cache3p->op = op;
+  cache3p->epoch = GCEpoch;
+  B_SET_BDDP(cache3p->f, f);
+  B_SET_BDDP(cache3p->g, g);
+  B_SET_BDDP(cache3p->k, k);
+  B_SET_BDDP(cache3p->h, h);
+}
+
 static void fprintf_check(FILE *strm, const char *format, ...)
 {
   if (strm == NULL) {
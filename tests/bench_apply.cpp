@@ -0,0 +1,86 @@
+/*********************************************
+ * Apply-engine Benchmark                    *
+ * N-Queens (app/BDDQueen) and a deep chain  *
+ * of variables beyond the old recursion     *
+ * limit (BDD_RecurLimit). N-Queens is also  *
+ * run with the level-by-level apply         *
+ * (bddsetbfsthreshold)                      *
+ *********************************************/
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <cstdlib>
+#include "../include/bddc.h"
+#include "bench_common.h"
+
+using namespace std;
+using namespace sapporobdd;
+
+// Builds the parity function of n variables and a deep ZDD chain,
+// runs the traversals on them and returns the total size
+bddp deep_chain(int n)
+{
+    vector<bddvar> v(n);
+    for (int i = 0; i < n; i++) v[i] = bddnewvar();
+
+    bddp f = bddfalse;
+    for (int i = 0; i < n; i++) {
+        bddp x = bddprime(v[i]);
+        bddp g = bddxor(f, x);
+        bddfree(f); bddfree(x);
+        f = g;
+    }
+    bddp z = bddsingle;
+    for (int i = 0; i < n; i++) {
+        bddp g = bddchange(z, v[i]);
+        bddp h = bddunion(z, g);
+        bddfree(z); bddfree(g);
+        z = h;
+    }
+    bddp nf = bddnot(f);
+    bddp g = bddand(f, nf);
+    bddfree(nf);
+    bddp s = bddsupport(f);
+    bddp size = bddsize(f) + bddsize(z) + bddsize(s);
+    bddfree(g); bddfree(s);
+    bddfree(f); bddfree(z);
+    return size;
+}
+
+int main(int argc, char* argv[])
+{
+    int q = 11;
+    int n = 50000;
+    bddp bfs = 10000;
+    if (argc >= 2) q = atoi(argv[1]);
+    if (argc >= 3) n = atoi(argv[2]);
+    if (argc >= 4) bfs = atoll(argv[3]);
+
+    cout << "=== Apply-engine Benchmark ===" << endl;
+    cout << "usage: bench_apply [queens] [chain vars] [bfs threshold]" << endl;
+
+    for (int t = 0; t < 3; t++) {
+        bddinit(256, bddnull);
+        bddsetbfsthreshold(t == 2 ? bfs : 0);
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        bddp r = 0;
+        string name;
+        if (t != 1) {
+            r = queens(q);
+            name = "queens " + to_string(q) + (t == 2 ? " bfs" : "");
+        } else {
+            r = deep_chain(n);
+            name = "chain " + to_string(n);
+        }
+        double sec = chrono::duration<double>(
+            chrono::steady_clock::now() - start).count();
+        cout << left << setw(16) << name
+             << " result: " << setw(10) << r
+             << " used: " << setw(10) << bddused()
+             << " time: " << fixed << setprecision(3) << sec << "s" << endl;
+    }
+    return 0;
+}
@@ -0,0 +1,79 @@
+/*********************************************
+ * Common Code of the Benchmarks             *
+ * N-Queens built as app/BDDQueen does       *
+ *********************************************/
+
+#ifndef BENCH_COMMON_H
+#define BENCH_COMMON_H
+
+#include <vector>
+#include "../include/bddc.h"
+
+// Returns a BDD of "exactly one of xs", or "at most one" if at_most
+inline sapporobdd::bddp exactly_one(const std::vector<sapporobdd::bddp>& xs,
+                                    bool at_most)
+{
+    using namespace sapporobdd;
+    bddp f0 = bddtrue, f1 = bddfalse;
+    for (size_t j = 0; j < xs.size(); j++) {
+        bddp x0 = bddnot(xs[j]);
+        bddp g0 = bddand(f0, x0);
+        bddp g01 = bddand(f0, xs[j]);
+        bddp g11 = bddand(f1, x0);
+        bddfree(x0); bddfree(f0); bddfree(f1);
+        f0 = g0;
+        f1 = bddor(g01, g11);
+        bddfree(g01); bddfree(g11);
+    }
+    if (!at_most) {
+        bddfree(f0);
+        return f1;
+    }
+    bddp h = bddor(f0, f1);
+    bddfree(f0); bddfree(f1);
+    return h;
+}
+
+// Builds the N-Queens BDD on q*q new variables and returns its size
+inline sapporobdd::bddp queens(int q)
+{
+    using namespace sapporobdd;
+    std::vector<std::vector<bddp> > x(q, std::vector<bddp>(q));
+    for (int i = 0; i < q; i++)
+        for (int j = 0; j < q; j++) x[i][j] = bddprime(bddnewvar());
+
+    // Exactly one queen on each row and column
+    bddp f = bddtrue;
+    for (int i = 0; i < q; i++) {
+        for (int s = 0; s < 2; s++) {
+            std::vector<bddp> line;
+            for (int j = 0; j < q; j++) line.push_back(s ? x[j][i] : x[i][j]);
+            bddp h = exactly_one(line, false);
+            bddp g = bddand(f, h);
+            bddfree(f); bddfree(h);
+            f = g;
+        }
+    }
+
+    // At most one queen on each diagonal
+    for (int d = -(q - 1); d <= q - 1; d++) {
+        for (int s = 0; s < 2; s++) {
+            std::vector<bddp> cells;
+            for (int i = 0; i < q; i++) {
+                int j = (s == 0) ? i + d : q - 1 - i - d;
+                if (j >= 0 && j < q) cells.push_back(x[i][j]);
+            }
+            bddp h = exactly_one(cells, true);
+            bddp g = bddand(f, h);
+            bddfree(f); bddfree(h);
+            f = g;
+        }
+    }
+    bddp size = bddsize(f);
+    bddfree(f);
+    for (int i = 0; i < q; i++)
+        for (int j = 0; j < q; j++) bddfree(x[i][j]);
+    return size;
+}
+
+#endif // BENCH_COMMON_H
@@ -0,0 +1,114 @@
+/*********************************************
+ * Node-layout Benchmark                     *
+ * Throughput of bddand and bddunion with    *
+ * the layout chosen at compile time         *
+ * (make bench builds it with and without    *
+ * -DB_NODE24)                               *
+ *********************************************/
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <cstdlib>
+
+// Includes bddc.cc so that the layout follows the flags of this program
+#include "../src/BDDc/bddc.cc"
+
+using namespace std;
+using namespace sapporobdd;
+
+static double elapsed(chrono::steady_clock::time_point start)
+{
+    return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+// Random BDDs of n variables combined by bddand, with the cache cleared
+// so that every round walks the nodes again
+static double and_rounds(int n, int rounds, bddp &ops)
+{
+    vector<bddp> fs;
+    srand(1);
+    for (int i = 1; i <= n; i++) fs.push_back(bddprime(i));
+    for (int i = 0; i < 4 * n; i++) {
+        bddp a = fs[rand() % fs.size()], b = fs[rand() % fs.size()];
+        fs.push_back((i % 2) ? bddxor(a, b) : bddor(a, b));
+    }
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    ops = 0;
+    for (int r = 0; r < rounds; r++) {
+        for (size_t i = n; i + 1 < fs.size(); i++) {
+            bddp g = bddand(fs[i], fs[i + 1]);
+            ops += bddsize(g);
+            bddfree(g);
+        }
+        cache_clear();
+    }
+    double sec = elapsed(start);
+    for (size_t i = 0; i < fs.size(); i++) bddfree(fs[i]);
+    return sec;
+}
+
+// Families of random sets merged by bddunion
+static double union_rounds(int n, int rounds, bddp &ops)
+{
+    vector<bddp> zs;
+    srand(2);
+    for (int i = 0; i < 64; i++) {
+        bddp z = bddempty;
+        for (int j = 0; j < 200; j++) {
+            bddp s = bddsingle;
+            for (int v = 1; v <= n; v++)
+                if (rand() % 4 == 0) { bddp t = bddchange(s, v); bddfree(s); s = t; }
+            bddp t = bddunion(z, s);
+            bddfree(z); bddfree(s);
+            z = t;
+        }
+        zs.push_back(z);
+    }
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    ops = 0;
+    for (int r = 0; r < rounds; r++) {
+        bddp u = bddcopy(zs[0]);
+        for (size_t i = 1; i < zs.size(); i++) {
+            bddp t = bddunion(u, zs[i]);
+            bddfree(u);
+            u = t;
+        }
+        ops += bddsize(u);
+        bddfree(u);
+        cache_clear();
+    }
+    double sec = elapsed(start);
+    for (size_t i = 0; i < zs.size(); i++) bddfree(zs[i]);
+    return sec;
+}
+
+int main(int argc, char* argv[])
+{
+    int n = 24;
+    int rounds = 20;
+    if (argc >= 2) n = atoi(argv[1]);
+    if (argc >= 3) rounds = atoi(argv[2]);
+
+    cout << "=== Node-layout Benchmark ===" << endl;
+    cout << "usage: bench_node [vars] [rounds]" << endl;
+#if defined(B_NODE24) && !defined(B_32)
+    cout << "layout: B_NODE24";
+#else
+    cout << "layout: default";
+#endif
+    cout << " (" << sizeof(struct B_NodeTable) << " bytes per node)" << endl;
+
+    for (int t = 0; t < 2; t++) {
+        bddinit(1 << 20, bddnull);
+        for (int i = 0; i < 64; i++) bddnewvar();
+        bddp ops = 0;
+        double sec = (t == 0) ? and_rounds(n, rounds, ops) : union_rounds(64, rounds, ops);
+        cout << left << setw(10) << (t == 0 ? "bddand" : "bddunion")
+             << " nodes: " << setw(12) << ops
+             << " time: " << fixed << setprecision(3) << sec << "s" << endl;
+    }
+    return 0;
+}
@@ -0,0 +1,91 @@
+/*********************************************
+ * Parallel-apply Benchmark                  *
+ * N-Queens (app/BDDQueen) and ZDD_Meet of   *
+ * random families, run with 1, 2, 4, ...    *
+ * threads given to bddinit                  *
+ *********************************************/
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <cstdlib>
+#include <thread>
+#include "../include/bddc.h"
+#include "bench_common.h"
+
+using namespace std;
+using namespace sapporobdd;
+
+// Returns a family of m random sets of about a quarter of n variables
+bddp family(int n, int m)
+{
+    bddp z = bddempty;
+    for (int j = 0; j < m; j++) {
+        bddp s = bddsingle;
+        for (int v = 1; v <= n; v++)
+            if (rand() % 4 == 0) { bddp t = bddchange(s, v); bddfree(s); s = t; }
+        bddp t = bddunion(z, s);
+        bddfree(z); bddfree(s);
+        z = t;
+    }
+    return z;
+}
+
+// Meet of two random families (ZDD_Meet), timed without building them
+bddp meet(int m, double &sec)
+{
+    const int n = 48;
+    for (int i = 0; i < n; i++) bddnewvar();
+    srand(3);
+    bddp f = family(n, m), g = family(n, m);
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    bddp h = bddmeet(f, g);
+    sec = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    bddp size = bddsize(h);
+    bddfree(f); bddfree(g); bddfree(h);
+    return size;
+}
+
+int main(int argc, char* argv[])
+{
+    int q = 11;
+    int m = 3000;
+    int maxth = 32;
+    if (argc >= 2) q = atoi(argv[1]);
+    if (argc >= 3) m = atoi(argv[2]);
+    if (argc >= 4) maxth = atoi(argv[3]);
+
+    cout << "=== Parallel-apply Benchmark ===" << endl;
+    cout << "usage: bench_parallel [queens] [sets of meet] [max threads]" << endl;
+    cout << "hardware threads: " << thread::hardware_concurrency() << endl;
+
+    for (int w = 0; w < 2; w++) {
+        double base = 0;
+        for (int th = 1; th <= maxth; th <<= 1) {
+            bddinit(256, bddnull, 0.5, th);
+            double sec = 0;
+            bddp r;
+            string name;
+            if (w == 0) {
+                chrono::steady_clock::time_point start = chrono::steady_clock::now();
+                r = queens(q);
+                sec = chrono::duration<double>(
+                    chrono::steady_clock::now() - start).count();
+                name = "queens " + to_string(q);
+            } else {
+                r = meet(m, sec);
+                name = "meet " + to_string(m);
+            }
+            if (th == 1) base = sec;
+            cout << left << setw(12) << name
+                 << " threads: " << setw(4) << th
+                 << " result: " << setw(10) << r
+                 << " time: " << fixed << setprecision(3) << sec << "s"
+                 << " speedup: " << setprecision(2) << (sec > 0 ? base / sec : 0)
+                 << endl;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,88 @@
+/*********************************************
+ * Unique-table Benchmark                    *
+ * Compares BDD_UT_CHAIN and BDD_UT_OPEN on  *
+ * N-Queens (app/BDDQueen) and GPM grids     *
+ *********************************************/
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include "../include/bddc.h"
+#include "bench_common.h"
+#include "../include/BDD.h"
+#include "../include/ZDD.h"
+#include "../include/GBase.h"
+
+using namespace std;
+using namespace sapporobdd;
+
+// Enumerates the simple paths between the corners of a GPM grid
+// (as app/GPM does) and returns the ZDD size
+bddword grid_paths(const char* file)
+{
+    FILE* fp = fopen(file, "r");
+    if (fp == NULL) {
+        cerr << "cannot open " << file << endl;
+        exit(1);
+    }
+    sapporobdd::GBase g;
+    g.Import(fp);
+    fclose(fp);
+    ZDD cond = 1;
+    for (int i = 0; i < g._m; i++) {
+        BDD_NewVar();
+        cond += cond.Change(BDD_VarOfLev(i + 1));
+    }
+    g.SetCond(cond);
+    ZDD f = g.SimPaths(1, g._n);
+    return f.Size();
+}
+
+const char* engine_name(int type)
+{
+    return (type == BDD_UT_CHAIN) ? "chain" : "open";
+}
+
+int main(int argc, char* argv[])
+{
+    int q = 11;
+    vector<string> grids;
+    if (argc >= 2) q = atoi(argv[1]);
+    for (int i = 2; i < argc; i++) grids.push_back(argv[i]);
+    if (argc < 3) {
+        grids.push_back("../app/GPM/grid08");
+        grids.push_back("../app/GPM/grid10");
+    }
+
+    const int engines[2] = {BDD_UT_CHAIN, BDD_UT_OPEN};
+    cout << "=== Unique-table Benchmark ===" << endl;
+    cout << "usage: bench_unique_table [queens] [grid files...]" << endl;
+
+    for (int t = 0; t <= (int)grids.size(); t++) {
+        for (int e = 0; e < 2; e++) {
+            BDD_SetUniqueTable(engines[e]);
+            BDD_Init(256, BDD_MaxNode);
+            chrono::steady_clock::time_point start = chrono::steady_clock::now();
+            bddword size;
+            string name;
+            if (t == 0) {
+                size = queens(q);
+                name = "queens " + to_string(q);
+            } else {
+                size = grid_paths(grids[t - 1].c_str());
+                name = grids[t - 1];
+            }
+            double sec = chrono::duration<double>(
+                chrono::steady_clock::now() - start).count();
+            cout << left << setw(24) << name << setw(6) << engine_name(engines[e])
+                 << " size: " << setw(10) << size
+                 << " used: " << setw(10) << BDD_Used()
+                 << " time: " << fixed << setprecision(3) << sec << "s" << endl;
+        }
+    }
+    return 0;
+}
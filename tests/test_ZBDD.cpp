@@ -5,6 +5,9 @@
 
 #include <iostream>
 #include <fstream>
+#include <sstream>
+#include <iterator>
+#include <cctype>
 #include <cstring>
 #include <cstdlib>
 #include <ctime>
@@ -16,6 +19,7 @@
 #define BDD_CPP
 #include "../include/bddc.h"
 #include "../include/BDD.h"
+#include "../include/BDDImage.h"
 
 // This macro is defined in bddc.h
 #ifdef SAPPOROBDD_PLUS_PLUS
@@ -698,6 +702,13 @@ void test_query_functions() {
     }
     resultCardMP16 = powerSet.CardMP16(buffer);
     test_result("CardMP16() for large power set returns correct string", std::string(resultCardMP16) == "400000000000000000");
+    test_result("CardMP10() for large power set returns correct string",
+                std::string(powerSet.CardMP10(buffer)) == "1180591620717411303424");
+    test_result("Card64() saturates for large power set", powerSet.Card64() == ~0ULL);
+    test_result("Card64() for zdd1 returns 4", zdd1.Card64() == 4 && null.Card64() == 0);
+#ifdef __SIZEOF_INT128__
+    test_result("Card128() for large power set", powerSet.Card128() == ((unsigned __int128)1 << 70));
+#endif
     
     // Lit() - returns literal count (total number of items in all sets)
     test_result("Lit() for zdd1 returns correct literal count", zdd1.Lit() == 8);
@@ -1016,6 +1027,106 @@ void test_io_operations() {
             test_result("Export/Import file write", false);
         }
     }
+
+    // Binary snapshot
+    for (size_t i = 0; i < zs.size(); ++i) {
+        FILE* fp = fopen("./test_zdd_export.bin", "wb");
+        if (fp) {
+            zs[i].ExportBin(fp);
+            fclose(fp);
+            ZDD z = ZDD_ImportBin("./test_zdd_export.bin");
+            test_result("ExportBin/ImportBin round trip", zs[i] == z);
+        } else {
+            test_result("ExportBin file write", false);
+        }
+    }
+    remove("./test_zdd_export.bin");
+
+    // Imports from a stream, and two exports in one file
+    {
+        FILE* fp = fopen("./test_zdd_export.dat", "w");
+        zs[3].Export(fp);
+        zs[2].Export(fp);
+        fclose(fp);
+        fp = fopen("./test_zdd_export.dat", "r");
+        ZDD a = ZDD_Import(fp), b = ZDD_Import(fp);
+        fclose(fp);
+        test_result("Two imports from one file", a == zs[3] && b == zs[2]);
+
+        std::ifstream is("./test_zdd_export.dat");
+        ZDD c = ZDD_Import(is), d = ZDD_Import(is);
+        test_result("Two imports from one istream", c == zs[3] && d == zs[2]);
+
+        ZDDV zv = ZDDV(zs[3], 0) + ZDDV(zs[2], 1);
+        fp = fopen("./test_zdd_export.dat", "w");
+        zv.Export(fp);
+        fclose(fp);
+        std::ifstream vs("./test_zdd_export.dat");
+        test_result("ZDDV_Import from an istream", ZDDV_Import(vs) == zv);
+
+        // The end of an istream sets eofbit, and failbit once no token is left
+        fp = fopen("./test_zdd_export.dat", "w");
+        zs[3].Export(fp);
+        fclose(fp);
+        std::ifstream ts("./test_zdd_export.dat");
+        std::string text((std::istreambuf_iterator<char>(ts)), std::istreambuf_iterator<char>());
+        while (!text.empty() && isspace((unsigned char)text[text.size() - 1]))
+            text.erase(text.size() - 1);
+        std::istringstream es(text);
+        bool state = ZDD_Import(es) == zs[3] && es.eof() && !es.fail();
+        bool thrown = false;
+        try { ZDD_Import(es); } catch (const BDDException&) { thrown = true; }
+        test_result("ZDD_Import sets eof and fail on an istream", state && thrown && es.fail());
+
+        std::istringstream pla(".i 2\n.o 1\n11 1\n10 1\n.e\n");
+        BDDV pv = BDDV_ImportPla(pla);
+        test_result("BDDV_ImportPla from an istream", pv.GetBDD(0) == BDDvar(BDD_VarOfLev(1)));
+    }
+
+    // Compaction keeps the families of the live objects
+    {
+        std::vector<bddword> cards;
+        std::vector<bddword> sizes;
+        for (size_t i = 0; i < zs.size(); ++i) {
+            cards.push_back(zs[i].Card());
+            sizes.push_back(zs[i].Size());
+        }
+        BDD_Compact();
+        bool kept = true;
+        for (size_t i = 0; i < zs.size(); ++i)
+            if (zs[i].Card() != cards[i] || zs[i].Size() != sizes[i]) kept = false;
+        test_result("BDD_Compact keeps live ZDD objects", kept && (zs[0] + zs[1]) - zs[1] == zs[0] - zs[1]);
+    }
+
+    // Compaction moves the nodes of the live objects to the low indices
+    {
+        std::vector<ZDD> garbage;
+        for (int i = 0; i < 200; ++i) {
+            ZDD g = ZDD(1);
+            for (int v = 1; v <= 8; ++v)
+                if ((i >> (v % 8)) & 1) g = g + g.Change(v);
+            garbage.push_back(g.Change(9 + i % 4));
+        }
+        std::vector<ZDD> live;
+        for (int i = 0; i < 8; ++i)
+            live.push_back(garbage[i * 25].Change(13) + ZDD(1).Change(14 + i));
+        std::vector<bddword> cards;
+        for (size_t i = 0; i < live.size(); ++i) cards.push_back(live[i].Card());
+        ZDD copy = live[3];
+        garbage.clear();
+        BDD_GC();
+        bddword high = 0, after = 0;
+        for (size_t i = 0; i < live.size(); ++i)
+            high = std::max(high, live[i].GetID() >> 1);
+        BDD_Compact();
+        bool kept = (copy == live[3]);
+        for (size_t i = 0; i < live.size(); ++i) {
+            after = std::max(after, live[i].GetID() >> 1);
+            if (live[i].Card() != cards[i]) kept = false;
+        }
+        test_result("BDD_Compact lowers the high-water mark of live ZDD objects",
+                    kept && after < high && after < BDD_Used());
+    }
     
     // Print functions (just test they don't crash)
     bool print_ok = true;
@@ -1089,6 +1200,300 @@ void test_map() {
     test_result("Unordered map with ZDD key works", zddUnorderedMap[ZDD(1).Change(2)] == 200);
 }
 
+// Test BDD_Ite and the BDD methods built on it
+void test_bdd_ite() {
+    std::cout << "=== Testing BDD_Ite ===" << endl;
+    BDD_Init(256, 1024 * 1024);
+    const int n = 6;
+    for (int i = 0; i < n; i++) BDD_NewVar();
+    srand(11);
+    vector<BDD> fs;
+    fs.push_back(BDD(0));
+    fs.push_back(BDD(1));
+    for (int i = 0; i < 10; i++) {
+        BDD f = BDD_Random(n, 40 + 2 * i);
+        fs.push_back(f);
+        fs.push_back(~f);
+    }
+    fs.push_back(BDDvar(1));
+    fs.push_back(~BDDvar(1));
+
+    bool ok = true;
+    for (size_t i = 0; i < fs.size(); i++)
+        for (size_t j = 0; j < fs.size(); j++)
+            for (size_t k = 0; k < fs.size(); k++)
+                if (BDD_Ite(fs[i], fs[j], fs[k]) != ((fs[i] & fs[j]) | (~fs[i] & fs[k])))
+                    ok = false;
+    test_result("BDD_Ite equals (f & g) | (~f & h)", ok);
+
+    bool swap_ok = true, smooth_ok = true, spread_ok = true;
+    for (size_t i = 2; i < fs.size(); i++) {
+        BDD f = fs[i];
+        BDD x = BDDvar(2), y = BDDvar(5);
+        BDD expect = (x & ((~y & f.At0(2).At1(5)) | (y & f.At1(2).At1(5)))) |
+                     (~x & ((~y & f.At0(2).At0(5)) | (y & f.At1(2).At0(5))));
+        if (f.Swap(2, 5) != expect) swap_ok = false;
+
+        BDD s = f;
+        for (int v = 1; v <= 3; v++) s = s.At0(v) | s.At1(v);
+        if (f.Smooth(3) != (s == 0 ? BDD(0) : s)) smooth_ok = false;
+
+        BDD sp = f;
+        for (int v = 1; v <= n; v++) {
+            BDD xv = BDDvar(v);
+            sp |= (xv & f.At0(v)) | (~xv & f.At1(v));
+        }
+        if (f.Spread(1) != sp) spread_ok = false;
+    }
+    test_result("Swap built on BDD_Ite", swap_ok);
+    test_result("Smooth built on BDD_Ite", smooth_ok);
+    test_result("Spread built on BDD_Ite", spread_ok);
+
+    fs.clear();
+    BDDV_Init(256, 1024 * 1024);
+    for (int i = 0; i < n; i++) BDD_NewVar();
+    BDD f0 = BDD_Random(n), f1 = BDD_Random(n), f2 = BDD_Random(n);
+    BDDV fv = BDDV(f0) || BDDV(f1) || BDDV(f2);
+    test_result("BDDV concatenation built on BDD_Ite",
+                fv.Len() == 3 && fv.GetBDD(0) == f0 &&
+                fv.GetBDD(1) == f1 && fv.GetBDD(2) == f2);
+    std::cout << endl;
+}
+
+void test_bdd_image() {
+    std::cout << "=== Testing BDDImage ===" << endl;
+    BDD_Init(256, 1024 * 1024);
+    const int n = 4;
+    vector<int> cur, next;
+    for (int i = 0; i < n; i++) cur.push_back(BDD_NewVar());
+    for (int i = 0; i < n; i++) next.push_back(BDD_NewVar());
+    int w = BDD_NewVar();
+
+    // Counter with an enable input w: y = x + w (mod 2^n)
+    vector<BDD> parts;
+    BDD carry = BDDvar(w);
+    for (int i = 0; i < n; i++) {
+        parts.push_back(~(BDDvar(next[i]) ^ BDDvar(cur[i]) ^ carry));
+        carry &= BDDvar(cur[i]);
+    }
+    BDD T = 1, xcube = 0, ycube = 0;
+    for (int i = 0; i < n; i++) {
+        T &= parts[i];
+        xcube |= BDDvar(cur[i]);
+        ycube |= BDDvar(next[i]);
+    }
+    BDD zero = 1;
+    for (int i = 0; i < n; i++) zero &= ~BDDvar(cur[i]);
+
+    bool cnt_ok = true;
+    for (int limit = 0; limit <= 1; limit++) {
+        BDDImage img(parts, cur, next, limit ? 100000 : 0);
+        if (img.Clusters() != (limit ? 1 : n)) cnt_ok = false;
+        BDD r = zero, prev = 0;
+        int steps = 0;
+        bool img_ok = true, pre_ok = true;
+        while (r != prev) {
+            prev = r;
+            BDD mono = (r & T).Exist(xcube | BDDvar(w));
+            for (int i = 0; i < n; i++) mono = mono.Swap(cur[i], next[i]);
+            BDD im = img.Image(r);
+            if (im != mono) img_ok = false;
+            BDD rn = r;
+            for (int i = 0; i < n; i++) rn = rn.Swap(cur[i], next[i]);
+            if (img.PreImage(r) != (rn & T).Exist(ycube | BDDvar(w))) pre_ok = false;
+            r |= im;
+            steps++;
+        }
+        test_result(limit ? "Image with one cluster" : "Image with a cluster per part", img_ok);
+        test_result(limit ? "PreImage with one cluster" : "PreImage with a cluster per part", pre_ok);
+        test_result("Counter reaches all states", r == 1 && steps == (1 << n));
+    }
+    test_result("Number of clusters", cnt_ok);
+
+    bool thrown = false;
+    try { vector<int> bad(next.begin(), next.end() - 1); BDDImage img(parts, cur, bad); }
+    catch (const BDDException&) { thrown = true; }
+    test_result("BDDImage rejects different numbers of variables", thrown);
+    std::cout << endl;
+}
+
+void test_permute() {
+    std::cout << "=== Testing Permute and BDD_VectorCompose ===" << endl;
+    BDD_Init(256, 1024 * 1024);
+    const int n = 6;
+    for (int i = 0; i < n; i++) BDD_NewVar();
+    srand(14);
+    vector<int> perm(n + 1, 0);
+    perm[2] = 5; perm[5] = 2;
+    bool bdd_ok = true, zdd_ok = true, comp_ok = true;
+    for (int i = 0; i < 10; i++) {
+        BDD f = BDD_Random(n, 30 + 4 * i);
+        if (f.Permute(perm) != f.Swap(2, 5)) bdd_ok = false;
+
+        ZDD z = ZDD(0);
+        for (int j = 0; j < 8; j++) {
+            ZDD s = ZDD(1);
+            for (int v = 1; v <= n; v++) if (rand() % 2) s = s.Change(v);
+            z += s;
+        }
+        if (z.Permute(perm) != z.Swap(2, 5)) zdd_ok = false;
+
+        // f(x1 & x2, ..., x3) with the other variables kept
+        vector<BDD> vec(n + 1, BDD(-1));
+        vec[1] = BDDvar(1) & BDDvar(2);
+        vec[4] = BDDvar(3);
+        BDD g = BDD_VectorCompose(f, vec);
+        BDD x12 = BDDvar(1) & BDDvar(2);
+        BDD e = (x12 & f.At1(1)) | (~x12 & f.At0(1));
+        e = (BDDvar(3) & e.At1(4)) | (~BDDvar(3) & e.At0(4));
+        if (g != e) comp_ok = false;
+    }
+    test_result("BDD::Permute equals Swap", bdd_ok);
+    test_result("ZDD::Permute equals Swap", zdd_ok);
+    test_result("BDD_VectorCompose substitutes the functions", comp_ok);
+    std::cout << endl;
+}
+
+// The former recursions of operator*, operator/ and ZDD_Meet at the C++ level
+static ZDD ref_mult(const ZDD& f, const ZDD& g) {
+    if (f == 0 || g == 0) return 0;
+    if (f == 1) return g;
+    if (g == 1) return f;
+    int v = f.Top();
+    if (BDD_LevOfVar(v) < BDD_LevOfVar(g.Top())) v = g.Top();
+    ZDD f0 = f.OffSet(v), f1 = f.OnSet0(v), g0 = g.OffSet(v), g1 = g.OnSet0(v);
+    ZDD h = ref_mult(f1, g1) + ref_mult(f1, g0) + ref_mult(f0, g1);
+    return h.Change(v) + ref_mult(f0, g0);
+}
+
+static ZDD ref_div(const ZDD& f, const ZDD& p) {
+    if (p == 1) return f;
+    if (f == p) return 1;
+    int v = p.Top();
+    if (BDD_LevOfVar(f.Top()) < BDD_LevOfVar(v)) return 0;
+    ZDD q = ref_div(f.OnSet0(v), p.OnSet0(v));
+    if (q != 0 && p.OffSet(v) != 0) q &= ref_div(f.OffSet(v), p.OffSet(v));
+    return q;
+}
+
+static ZDD ref_meet(const ZDD& f, const ZDD& g) {
+    if (f == 0 || g == 0) return 0;
+    if (f == 1 || g == 1) return 1;
+    int v = f.Top();
+    if (BDD_LevOfVar(v) < BDD_LevOfVar(g.Top())) v = g.Top();
+    ZDD f0 = f.OffSet(v), f1 = f.OnSet0(v), g0 = g.OffSet(v), g1 = g.OnSet0(v);
+    return ref_meet(f1, g1).Change(v) + ref_meet(f0, g0) +
+           ref_meet(f1, g0) + ref_meet(f0, g1);
+}
+
+void test_zdd_algebra() {
+    std::cout << "=== Testing ZDD product, division and meet ===" << endl;
+    BDD_Init(256, 1024 * 1024);
+    const int n = 7;
+    for (int i = 0; i < n; i++) BDD_NewVar();
+    srand(15);
+    vector<ZDD> zs;
+    zs.push_back(ZDD(0));
+    zs.push_back(ZDD(1));
+    for (int i = 0; i < 14; i++) {
+        ZDD z = ZDD(0);
+        int m = 1 + rand() % 6;
+        for (int j = 0; j < m; j++) {
+            ZDD s = ZDD(1);
+            for (int v = 1; v <= n; v++) if (rand() % 3 == 0) s = s.Change(v);
+            z += s;
+        }
+        zs.push_back(z);
+    }
+    bool mult_ok = true, div_ok = true, meet_ok = true, rem_ok = true;
+    for (size_t i = 0; i < zs.size(); i++)
+        for (size_t j = 0; j < zs.size(); j++) {
+            if (zs[i] * zs[j] != ref_mult(zs[i], zs[j])) mult_ok = false;
+            if (ZDD_Meet(zs[i], zs[j]) != ref_meet(zs[i], zs[j])) meet_ok = false;
+            if (zs[j] == 0) continue;
+            ZDD f = zs[i] * zs[j] + zs[i];
+            if (f / zs[j] != ref_div(f, zs[j])) div_ok = false;
+            if (zs[i] / zs[j] != ref_div(zs[i], zs[j])) div_ok = false;
+            if ((f / zs[j]) * zs[j] + f % zs[j] != f) rem_ok = false;
+        }
+    test_result("operator* equals the recursive definition", mult_ok);
+    test_result("operator/ equals the recursive definition", div_ok);
+    test_result("ZDD_Meet equals the recursive definition", meet_ok);
+    test_result("Quotient and remainder rebuild the operand", rem_ok);
+    bool thrown = false;
+    try { ZDD q = zs[3] / ZDD(0); } catch (const BDDException&) { thrown = true; }
+    test_result("operator/ by the empty set throws", thrown);
+    std::cout << endl;
+}
+
+void test_move() {
+    std::cout << "=== Testing move semantics ===" << endl;
+    BDD_Init(256, 1024 * 1024);
+    for (int i = 0; i < 4; i++) BDD_NewVar();
+    {
+        ZDD a = ZDD(1).Change(1) + ZDD(1).Change(2);
+        ZDD keep = a;
+        ZDD b(std::move(a));
+        test_result("Moved ZDD keeps the set", b == keep && a == 0);
+        ZDD c;
+        c = std::move(b);
+        test_result("Move-assigned ZDD keeps the set", c == keep && b == 0);
+        c = std::move(c);
+        test_result("Self move-assignment keeps the set", c == keep);
+
+        // Temporary operands
+        ZDD d = ZDD(1).Change(3);
+        test_result("ZDD operators on temporaries", (ZDD(c) + d) == keep + d &&
+                    (ZDD(c) - d) == keep && (ZDD(c) & keep) == keep);
+
+        BDD x = BDDvar(1), y = BDDvar(2);
+        BDD f = x & y, g(std::move(f));
+        test_result("Moved BDD keeps the function", g == (x & y) && f == 0);
+        test_result("BDD operators on temporaries", ((x & y) | x) == x &&
+                    ((x | y) & y) == y && ((x ^ y) ^ y) == x);
+
+        vector<ZDD> vs;
+        for (int i = 0; i < 100; i++) vs.push_back(keep.Change(1 + i % 4));
+        ZDDV zv(vs[0]), zw(std::move(zv));
+        test_result("Moved elements keep the sets", vs[99] == keep.Change(4) &&
+                    zw.GetZDD(0) == keep.Change(1) && zv.GetZDD(0) == 0);
+    }
+    BDD_GC();
+    test_result("Moves leave no node", BDD_Used() == 0);
+    std::cout << endl;
+}
+
+void test_zdd_expr() {
+    std::cout << "=== Testing n-ary ZDD chains ===" << endl;
+    BDD_Init(256, 1024 * 1024);
+    for (int i = 0; i < 6; i++) BDD_NewVar();
+    {
+        vector<ZDD> zs;
+        for (int i = 0; i < 5; i++)
+            zs.push_back(ZDD_Random(6, 30 + 10 * i) + ZDD(1).Change(1 + i));
+        ZDD u = ZDD_Expr<'+'>(zs[0]) + zs[1] + zs[2] + zs[3] + zs[4];
+        ZDD x = ZDD_Expr<'&'>(zs[0] + zs[4]) & (zs[1] + zs[4]) & (zs[2] + zs[4]);
+        test_result("ZDD_Expr union chain",
+                    u == zs[0] + zs[1] + zs[2] + zs[3] + zs[4]);
+        test_result("ZDD_Expr intersection chain",
+                    x == ((zs[0] + zs[4]) & (zs[1] + zs[4]) & (zs[2] + zs[4])) &&
+                    (x & zs[4]) == zs[4]);
+
+        // Chains are joined, appended in a loop and converted where a ZDD is needed
+        ZDD_Expr<'+'> e;
+        for (int i = 0; i < 5; i++) e.Append(zs[i]);
+        ZDD j = (ZDD_Expr<'+'>(zs[0]) + zs[1]) + (ZDD_Expr<'+'>(zs[2]) + zs[3] + zs[4]);
+        test_result("ZDD_Expr joined and appended chains",
+                    ZDD(e) == u && j == u && ZDD(e).Card() == u.Card() &&
+                    ZDD(ZDD_Expr<'+'>()) == 0);
+        test_result("ZDD_Expr chain as an operand",
+                    (ZDD_Expr<'+'>(zs[0]) + zs[1]) - zs[1] == zs[0] - zs[1]);
+    }
+    BDD_GC();
+    test_result("Chains leave no node", BDD_Used() == 0);
+    std::cout << endl;
+}
+
 void test_gc_threshold() {
     BDD_Init(256, 1024);
 
@@ -1239,6 +1644,12 @@ int main() {
     test_edge_cases();
 
     test_map();
+    test_bdd_ite();
+    test_bdd_image();
+    test_permute();
+    test_zdd_algebra();
+    test_move();
+    test_zdd_expr();
 
     test_gc_threshold(); // This should be called finally.
 
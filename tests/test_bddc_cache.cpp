@@ -22,6 +22,7 @@
 
 // Only include the minimal headers we need, avoid BDD.h to prevent macro conflicts
 #include "../include/bddc.h"
+#include "../include/BDDEval.h"
 
 using namespace std;
 
@@ -199,6 +200,1479 @@ void test_allocatecache() {
     }
 }
 
+// Finds n distinct second operands g such that (op, f, g) fall into
+// the same cache set
+std::vector<bddp> same_set_operands(unsigned char op, bddp f, int n) {
+    std::vector<bddp> gs;
+    struct B_CacheTable* setp = 0;
+    for (bddp c = 0; (int)gs.size() < n; c++) {
+        bddp g = bddconst(c);
+        if (setp == 0) setp = B_CACHESET(op, f, g);
+        if (B_CACHESET(op, f, g) == setp) gs.push_back(g);
+    }
+    return gs;
+}
+
+// Test set-associative cache and cache statistics
+void test_cacheways() {
+    std::cout << "\n=== Testing set-associative cache ===" << endl;
+
+    const unsigned char op = CACHE_OP_USER_START;
+    const bddp f = bddconst(1);
+    struct bddcachestat stats[BDD_CACHE_OPMAX];
+
+    bddinit(1000, 10000);
+    test_result("Default cache is direct mapped", bddgetcacheways() == 1);
+
+    // Direct mapped: two keys of the same slot evict each other
+    std::vector<bddp> gs = same_set_operands(op, f, 2);
+    bddclearcachestats();
+    bddwcache(op, f, gs[0], bddconst(10));
+    bddwcache(op, f, gs[1], bddconst(11));
+    bddcachestats(stats);
+    test_result("Direct mapped: conflicting write evicts",
+                bddrcache(op, f, gs[0]) == bddnull && stats[op].evict == 1);
+
+    bddsetcacheways(4);
+    test_result("bddsetcacheways(4)", bddgetcacheways() == 4);
+    test_result("Cache set is aligned to a cache line",
+                ((size_t)Cache % B_CACHE_ALIGN) == 0);
+
+    // 4-way: four keys of the same set live together
+    gs = same_set_operands(op, f, 5);
+    bddinit(1000, 10000);
+    for (int i = 0; i < 4; i++) bddwcache(op, f, gs[i], bddconst(20 + i));
+    bool all_hit = true;
+    for (int i = 0; i < 4; i++)
+        if (bddrcache(op, f, gs[i]) != bddconst(20 + i)) all_hit = false;
+    bddcachestats(stats);
+    test_result("4-way: four conflicting keys are kept", all_hit);
+    test_result("4-way: statistics count hits", stats[op].hit == 4 && stats[op].miss == 0
+                && stats[op].evict == 0);
+
+    // The least recently used key (gs[0]) is replaced by a fifth one
+    bddrcache(op, f, gs[1]);
+    bddrcache(op, f, gs[2]);
+    bddrcache(op, f, gs[3]);
+    bddwcache(op, f, gs[4], bddconst(24));
+    bddcachestats(stats);
+    test_result("4-way: LRU key is evicted",
+                bddrcache(op, f, gs[0]) == bddnull
+                && bddrcache(op, f, gs[4]) == bddconst(24)
+                && bddrcache(op, f, gs[1]) == bddconst(21));
+    test_result("4-way: statistics count evictions and misses",
+                stats[op].evict == 1 && stats[op].miss == 0);
+    bddcachestats(stats);
+    test_result("4-way: statistics count a miss", stats[op].miss == 1);
+
+    // Rewriting a key does not evict other keys
+    bddwcache(op, f, gs[4], bddconst(25));
+    bddcachestats(stats);
+    test_result("4-way: rewriting a key does not evict",
+                stats[op].evict == 1 && bddrcache(op, f, gs[4]) == bddconst(25));
+
+    // Results of operations are the same in both modes
+    bddvar v1 = bddnewvar(), v2 = bddnewvar(), v3 = bddnewvar();
+    bddp a = bddprime(v1), b = bddprime(v2), c = bddprime(v3);
+    bddp ab = bddand(a, b);
+    bddcopy(ab); // operands referred only once are not cached
+    bddp h = bddor(ab, c);
+    bddclearcachestats();
+    bddp h2 = bddor(ab, c);
+    bddcachestats(stats);
+    test_result("4-way: apply uses the cache", h == h2 && stats[1].hit > 0);
+    bddfree(a); bddfree(b); bddfree(c); bddfree(ab); bddfree(ab);
+    bddfree(h); bddfree(h2);
+
+    bool thrown = false;
+    try {
+        bddsetcacheways(3);
+    } catch (const std::exception&) {
+        thrown = true;
+    }
+    test_result("bddsetcacheways(3) throws", thrown);
+    bddsetcacheways(1);
+}
+
+// Test that epoch GC keeps the cache entries of live nodes
+void test_gcmode() {
+    std::cout << "\n=== Testing GC modes ===" << endl;
+
+    struct bddcachestat stats[BDD_CACHE_OPMAX];
+    for (int mode = BDD_GC_FULL; mode <= BDD_GC_EPOCH; mode++) {
+        bddinit(1000, 10000);
+        bddsetgcmode(mode);
+        bddsetcacheways(4);
+        bddvar v1 = bddnewvar(), v2 = bddnewvar(), v3 = bddnewvar();
+        bddp a = bddprime(v1), b = bddprime(v2), c = bddprime(v3);
+        bddp ab = bddand(a, b);
+        bddp bc = bddand(b, c);
+        bddcopy(ab); // operands referred only once are not cached
+        bddp abc = bddor(ab, bc);      // kept
+        bddp t = bddxor(abc, c);       // collected
+        bddwcache(CACHE_OP_USER_START, abc, bddfalse, abc);
+        bddfree(t);
+        bddp old_used = bddused();
+        bddgc();
+        bool collected = bddused() < old_used;
+
+        bddclearcachestats();
+        bddp abc2 = bddor(ab, bc);
+        bddp u = bddrcache(CACHE_OP_USER_START, abc, bddfalse);
+        bddcachestats(stats);
+        if (mode == BDD_GC_EPOCH) {
+            test_result("Epoch GC: collects nodes", collected);
+            test_result("Epoch GC: keeps entries of live nodes",
+                        abc2 == abc && stats[BC_AND].hit > 0 && stats[BC_AND].miss == 0);
+            test_result("Epoch GC: keeps user entries of live nodes", u == abc);
+        } else {
+            test_result("Full GC: drops user entries", u == bddnull);
+        }
+        bddfree(a); bddfree(b); bddfree(c); bddfree(ab); bddfree(ab);
+        bddfree(bc); bddfree(abc); bddfree(abc2);
+    }
+
+    // A result whose node is collected must not be returned
+    bddinit(1000, 10000);
+    bddsetgcmode(BDD_GC_EPOCH);
+    bddvar v1 = bddnewvar(), v2 = bddnewvar();
+    bddp a = bddprime(v1), b = bddprime(v2);
+    bddcopy(a); bddcopy(b);
+    bddp ab = bddand(a, b);
+    bddfree(ab);
+    bddgc();
+    bddclearcachestats();
+    ab = bddand(a, b);
+    bddcachestats(stats);
+    test_result("Epoch GC: drops entries of collected nodes",
+                stats[BC_AND].hit == 0 && stats[BC_AND].miss == 1 && bddsize(ab) == 2);
+    bddsetgcmode(BDD_GC_FULL);
+    bddsetcacheways(1);
+}
+
+// Checks that every node in nodes is found in the unique table of v
+static bool all_found(bddvar v, const vector<bddp>& nodes) {
+    for (size_t i = 0; i < nodes.size(); i++) {
+        struct B_NodeTable* np = B_NP(nodes[i]);
+        if (ut_lookup(&Var[v], B_GET_BDDP(np->f0), B_GET_BDDP(np->f1)) != B_NDX(nodes[i]))
+            return false;
+    }
+    return true;
+}
+
+void test_rehash() {
+    std::cout << "\n=== Testing incremental rehash ===" << endl;
+
+    bddinit(256, 100000);
+    bddvar v = bddnewvar();
+    vector<bddp> nodes;
+    bool bounded = true, found = true, rehashed = false;
+    for (bddp i = 1; i <= 5000; i++) {
+        bddp oldSpc = Var[v].hashSpc;
+        nodes.push_back(getzddp(v, bddconst(i), bddconst(i + 1)));
+        if (Var[v].hashSpc != oldSpc && oldSpc != 0) {
+            // Just enlarged: no bucket is moved yet
+            if (Var[v].oldSpc != oldSpc || Var[v].moved != 0) bounded = false;
+            rehashed = true;
+        }
+        if (Var[v].oldSpc != 0 && i % 97 == 0 && !all_found(v, nodes)) found = false;
+    }
+    test_result("Enlarging a hash table moves no bucket at once", rehashed && bounded);
+    test_result("Nodes are found while rehashing", found);
+
+    // Rehashing one more time, then collect half of the nodes in the middle
+    while (Var[v].oldSpc == 0)
+        nodes.push_back(getzddp(v, bddconst(nodes.size() + 1), bddconst(nodes.size() + 2)));
+    vector<bddp> kept;
+    for (size_t i = 0; i < nodes.size(); i++) {
+        if (i % 2) bddfree(nodes[i]);
+        else kept.push_back(nodes[i]);
+    }
+    bddgc();
+    test_result("GC during rehashing keeps the live nodes",
+                bddused() == kept.size() && Var[v].hashUsed == kept.size() &&
+                Var[v].oldSpc == 0 && all_found(v, kept));
+    for (size_t i = 0; i < kept.size(); i++) bddfree(kept[i]);
+}
+
+void test_deep() {
+    std::cout << "\n=== Testing operations deeper than the recursion limit ===" << endl;
+
+    const int n = 3 * BDD_RecurLimit;
+    bddinit(256, bddnull);
+    vector<bddvar> v(n);
+    for (int i = 0; i < n; i++) v[i] = bddnewvar();
+
+    // Parity function and the ZDD of the prefixes {}, {v1}, {v1,v2}, ...
+    bddp f = bddfalse, z = bddsingle;
+    bool ok = true;
+    try {
+        for (int i = 0; i < n; i++) {
+            bddp x = bddprime(v[i]);
+            bddp g = bddxor(f, x);
+            bddfree(f); bddfree(x);
+            f = g;
+            g = bddchange(z, v[i]);
+            bddfree(z);
+            z = bddunion(g, bddsingle);
+            bddfree(g);
+        }
+    } catch (const std::exception& e) {
+        ok = false;
+    }
+    test_result("Apply runs on a chain of 3 * BDD_RecurLimit nodes", ok);
+    test_result("Size and count of the deep diagrams",
+                bddsize(f) == (bddp)n && bddsize(z) == (bddp)n && bddcard(z) == (bddp)n + 1);
+    test_result("Imply on the deep diagrams",
+                bddimply(f, f) == 1 && bddimply(f, B_NOT(f)) == 0);
+
+    FILE* fp = tmpfile();
+    bddp roots[2] = {f, z};
+    bddexport(fp, roots, 2);
+    long lines = 0;
+    rewind(fp);
+    for (int c; (c = fgetc(fp)) != EOF;) if (c == '\n') lines++;
+    fclose(fp);
+    test_result("Export of the deep diagrams", lines == 2 * n + 5);
+
+    bddfree(f); bddfree(z);
+    bddgc();
+    test_result("GC collects the deep diagrams", bddused() == 0);
+}
+
+// Builds x1 x2 + x3 x4 + ... of the variables v (and-or of pairs)
+static bddp pairs_bdd(const vector<bddvar>& v) {
+    bddp f = bddfalse;
+    for (size_t i = 0; i + 1 < v.size(); i += 2) {
+        bddp a = bddprime(v[i]), b = bddprime(v[i + 1]);
+        bddp t = bddand(a, b);
+        bddp g = bddor(f, t);
+        bddfree(a); bddfree(b); bddfree(t); bddfree(f);
+        f = g;
+    }
+    return f;
+}
+
+// Builds the family {{v1, v2}, {v3, v4}, ...} and its power set
+static bddp pairs_zdd(const vector<bddvar>& v) {
+    bddp f = bddsingle;
+    for (size_t i = 0; i + 1 < v.size(); i += 2) {
+        bddp a = bddchange(f, v[i]);
+        bddp b = bddchange(a, v[i + 1]);
+        bddp g = bddunion(f, b);
+        bddfree(a); bddfree(b); bddfree(f);
+        f = g;
+    }
+    return f;
+}
+
+// Builds a family of nsets pseudo-random sets of the variables 1..nvars,
+// each of which has a variable with probability 1/den
+static bddp make_random_family(int nvars, int nsets, unsigned int seed,
+                               int den = 3) {
+    bddp z = bddempty;
+    for (int j = 0; j < nsets; j++) {
+        bddp s = bddsingle;
+        for (int v = 1; v <= nvars; v++) {
+            seed = seed * 1103515245U + 12345U;
+            if ((seed >> 16) % den == 0) { bddp t = bddchange(s, v); bddfree(s); s = t; }
+        }
+        bddp t = bddunion(z, s);
+        bddfree(z); bddfree(s);
+        z = t;
+    }
+    return z;
+}
+
+// Checks the unique tables and the order of the levels
+static bool tables_consistent() {
+    bddp total = 0;
+    for (bddvar v = 1; v <= VarUsed; v++) {
+        if (VarID[Var[v].lev] != v) return false;
+        vector<bddp> nodes;
+        ut_nodes(&Var[v], nodes);
+        if (nodes.size() != Var[v].hashUsed) return false;
+        for (size_t i = 0; i < nodes.size(); i++) {
+            struct B_NodeTable* np = Node + nodes[i];
+            if (B_VAR_NP(np) != v) return false;
+            bddp f0 = B_GET_BDDP(np->f0), f1 = B_GET_BDDP(np->f1);
+            if (ut_lookup(&Var[v], f0, f1) != nodes[i]) return false;
+            if (!B_CST(f0) && Var[B_VAR_NP(B_NP(f0))].lev >= Var[v].lev) return false;
+            if (!B_CST(f1) && Var[B_VAR_NP(B_NP(f1))].lev >= Var[v].lev) return false;
+        }
+        total += nodes.size();
+    }
+    return total == NodeUsed;
+}
+
+void test_reorder() {
+    std::cout << "\n=== Testing variable reordering ===" << endl;
+
+    for (int t = 0; t < 2; t++) {
+        bddsetuniquetable(t == 0 ? BDD_UT_CHAIN : BDD_UT_OPEN);
+        bddinit(256, 1000000);
+        const int n = 16;
+        vector<bddvar> v(n);
+        for (int i = 0; i < n; i++) v[i] = bddnewvar();
+
+        // Pair the first half with the second half: exponential in this order
+        vector<bddvar> bad;
+        for (int i = 0; i < n / 2; i++) {
+            bad.push_back(v[i]);
+            bad.push_back(v[i + n / 2]);
+        }
+        bddp f = pairs_bdd(bad);
+        bddp z = pairs_zdd(bad);
+        bddp card = bddcard(z);
+        bddp before = bddsize(f);
+
+        // A swap keeps every function
+        bddswaplev(3);
+        bddswaplev(n - 1);
+        bddp f2 = pairs_bdd(bad), z2 = pairs_zdd(bad);
+        test_result(t == 0 ? "Swap keeps the functions (chain)" : "Swap keeps the functions (open)",
+                    f2 == f && z2 == z && bddcard(z) == card && tables_consistent());
+        bddfree(f2); bddfree(z2);
+        bddswaplev(n - 1);
+        bddswaplev(3);
+        bool restored = true;
+        for (int i = 0; i < n; i++) if (bddlevofvar(v[i]) != (bddvar)(i + 1)) restored = false;
+        test_result("Swapping twice restores the order", restored && tables_consistent());
+
+        bddreorder();
+        f2 = pairs_bdd(bad);
+        z2 = pairs_zdd(bad);
+        test_result(t == 0 ? "Sifting keeps the functions (chain)" : "Sifting keeps the functions (open)",
+                    f2 == f && z2 == z && bddcard(z) == card && tables_consistent());
+        test_result("Sifting reduces the BDD", bddsize(f) < before && bddsize(f) <= (bddp)n);
+        bddfree(f2); bddfree(z2);
+        bddfree(f); bddfree(z);
+    }
+    bddsetuniquetable(BDD_UT_CHAIN);
+
+    // Automatic reordering while building
+    bddinit(256, 1000000);
+    bddsetautoreorder(2000);
+    const int n = 24;
+    vector<bddvar> v(n), bad;
+    for (int i = 0; i < n; i++) v[i] = bddnewvar();
+    for (int i = 0; i < n / 2; i++) {
+        bad.push_back(v[i]);
+        bad.push_back(v[i + n / 2]);
+    }
+    bddp f = pairs_bdd(bad);
+    bool moved = false;
+    for (int i = 0; i < n; i++) if (bddlevofvar(v[i]) != (bddvar)(i + 1)) moved = true;
+    test_result("Automatic reordering runs over the threshold",
+                moved && bddgetautoreorder() == 2000 && bddsize(f) < 2000 && tables_consistent());
+    bddsetautoreorder(0);
+    bddp f2 = pairs_bdd(bad);
+    test_result("Functions are kept by automatic reordering", f2 == f);
+    bddfree(f); bddfree(f2);
+
+    bool thrown = false;
+    try { bddswaplev(n); } catch (const BDDException&) { thrown = true; }
+    test_result("Swapping the top level throws", thrown);
+}
+
+// Checks that the variables keep their order on consecutive levels
+static bool contiguous(const vector<bddvar>& v, size_t from, size_t to) {
+    for (size_t i = from + 1; i < to; i++)
+        if (bddlevofvar(v[i]) != bddlevofvar(v[i - 1]) + 1) return false;
+    return true;
+}
+
+void test_group() {
+    std::cout << "\n=== Testing group sifting ===" << endl;
+
+    bddinit(256, 1000000);
+    const int n = 16;
+    vector<bddvar> v(n), bad;
+    for (int i = 0; i < n; i++) v[i] = bddnewvar();
+    for (int i = 0; i < n / 2; i++) {
+        bad.push_back(v[i]);
+        bad.push_back(v[i + n / 2]);
+    }
+    bddvargroup(1, 4, BDD_GROUP_MOVE);
+    bddvargroup(13, 4, BDD_GROUP_FIX);
+    bddp f = pairs_bdd(bad);
+    bddp z = pairs_zdd(bad);
+    bddp before = bddsize(f);
+
+    bddreorder();
+    bddp f2 = pairs_bdd(bad), z2 = pairs_zdd(bad);
+    bool fixed = true;
+    for (int i = 12; i < n; i++) if (bddlevofvar(v[i]) != (bddvar)(i + 1)) fixed = false;
+    test_result("Group sifting keeps the functions",
+                f2 == f && z2 == z && tables_consistent() && bddsize(f) < before);
+    test_result("Moved group stays contiguous", contiguous(v, 0, 4));
+    test_result("Fixed group stays at its levels", fixed);
+    bddfree(f2); bddfree(z2);
+
+    bool thrown1 = false, thrown2 = false, thrown3 = false;
+    try { bddswaplev(bddlevofvar(v[0])); } catch (const BDDException&) { thrown1 = true; }
+    try { bddvargroup(bddlevofvar(v[1]), 4, BDD_GROUP_MOVE); } catch (const BDDException&) { thrown2 = true; }
+    try { bddvargroup(1, n + 1, BDD_GROUP_MOVE); } catch (const BDDException&) { thrown3 = true; }
+    test_result("Swapping or crossing a group throws", thrown1 && thrown2 && thrown3);
+
+    // A variable inserted into a group joins it
+    bddvar lev = bddlevofvar(v[0]);
+    bddvar w = bddnewvaroflev(lev + 2);
+    test_result("Inserted variable joins the group",
+                Var[v[0]].gsize == 5 && Var[w].gsize == 0 && bddlevofvar(w) == lev + 2);
+    bddfree(f); bddfree(z);
+
+    // ZDD cost: only the ZDD nodes are minimized
+    bddinit(256, 1000000);
+    vector<bddvar> good;
+    v.assign(n, 0);
+    for (int i = 0; i < n; i++) v[i] = bddnewvar();
+    for (int i = 0; i < n; i++) good.push_back(v[i]);
+    bddsetreordercost(BDD_REORDER_ZDD);
+    f = pairs_bdd(good);
+    z = pairs_zdd(bad);
+    bddp zbefore = bddsize(z);
+    bddreorder();
+    z2 = pairs_zdd(bad);
+    test_result("ZDD cost reduces the ZDD",
+                bddgetreordercost() == BDD_REORDER_ZDD && z2 == z &&
+                bddsize(z) < zbefore && tables_consistent());
+    bddfree(z2); bddfree(f); bddfree(z);
+    bddsetreordercost(BDD_REORDER_ALL);
+
+    // Sequences are not reordered
+    bddp s = bddpush(bddsingle, v[3]);
+    test_result("Pushed variable is fixed", Var[v[3]].gfix != 0);
+    bddfree(s);
+    bool thrown = false;
+    try { bddsetreordercost(3); } catch (const BDDException&) { thrown = true; }
+    test_result("Invalid cost throws", thrown);
+}
+
+void test_ite() {
+    std::cout << "\n=== Testing three-operand cache ===" << endl;
+
+    struct bddcachestat stats[BDD_CACHE_OPMAX];
+    for (int mode = BDD_GC_FULL; mode <= BDD_GC_EPOCH; mode++) {
+        bddinit(1000, 100000);
+        bddsetgcmode(mode);
+        test_result("Cache3 has a quarter of the cache entries",
+                    Cache3Spc == CacheSpc >> B_CACHE3_SHIFT && Cache3 != 0);
+        vector<bddp> x;
+        for (int i = 0; i < 6; i++) x.push_back(bddprime(bddnewvar()));
+        bddp f = bddxor(x[0], x[3]);
+        bddp g = bddor(x[1], x[4]);
+        bddp h = bddand(x[2], x[5]);
+        bddcopy(f); bddcopy(g); bddcopy(h);  // operands referred only once are not cached
+
+        bddclearcachestats();
+        bddp r1 = bddite(f, g, h);
+        bddp r2 = bddite(f, g, h);
+        bddcachestats(stats);
+        bddp nf = bddnot(f);
+        bddp r3 = bddite(nf, h, g);  // the same standard triple
+        test_result(mode == BDD_GC_FULL ? "ITE hits the cache (full)" : "ITE hits the cache (epoch)",
+                    r1 == r2 && r3 == r1 && stats[BC_ITE].hit > 0);
+
+        // Entries of collected nodes are not returned
+        bddp t = bddxor(r1, x[0]);
+        bddp u = bddite(t, f, g);
+        bddcopy(t);
+        bddp u2 = bddite(t, f, g);
+        bddfree(u); bddfree(u2); bddfree(t); bddfree(t);
+        bddgc();
+        t = bddxor(r1, x[0]);
+        u = bddite(t, f, g);
+        bddp nt = bddnot(t);
+        bddp ft = bddand(t, f), gt = bddand(nt, g), e = bddor(ft, gt);
+        test_result("ITE after GC is correct", u == e);
+        bddfree(ft); bddfree(gt); bddfree(e); bddfree(u); bddfree(t); bddfree(nt);
+        bddfree(r1); bddfree(r2); bddfree(r3); bddfree(nf);
+        bddfree(f); bddfree(g); bddfree(h);
+        bddfree(f); bddfree(g); bddfree(h);
+        for (size_t i = 0; i < x.size(); i++) bddfree(x[i]);
+        bddgc();
+        test_result("ITE leaves no node", bddused() == 0);
+    }
+}
+
+void test_andexist() {
+    std::cout << "\n=== Testing bddandexist ===" << endl;
+
+    bddinit(1000, 100000);
+    const int n = 8;
+    vector<bddp> x;
+    for (int i = 0; i < n; i++) x.push_back(bddprime(bddnewvar()));
+    srand(12);
+    vector<bddp> fs;
+    fs.push_back(bddfalse);
+    fs.push_back(bddtrue);
+    for (int i = 0; i < 24; i++) {
+        bddp f = bddcopy(x[rand() % n]);
+        for (int j = 0; j < 4; j++) {
+            bddp y = x[rand() % n], r;
+            switch (rand() % 3) {
+            case 0: r = bddand(f, y); break;
+            case 1: r = bddor(f, y); break;
+            default: r = bddxor(f, y);
+            }
+            bddfree(f);
+            f = r;
+        }
+        fs.push_back(f);
+        fs.push_back(bddnot(f));
+    }
+    vector<bddp> cs;
+    cs.push_back(bddfalse);
+    cs.push_back(bddor(x[0], x[5]));
+    cs.push_back(bddor(x[2], x[7]));
+    bddp c = bddfalse;
+    for (int i = 0; i < n; i += 2) { bddp t = bddor(c, x[i]); bddfree(c); c = t; }
+    cs.push_back(c);
+
+    bool ok = true;
+    for (size_t i = 0; i < fs.size(); i++)
+        for (size_t j = 0; j < fs.size(); j++)
+            for (size_t k = 0; k < cs.size(); k++) {
+                bddp a = bddandexist(fs[i], fs[j], cs[k]);
+                bddp fg = bddand(fs[i], fs[j]);
+                bddp e = bddexist(fg, cs[k]);
+                if (a != e) ok = false;
+                bddfree(a); bddfree(fg); bddfree(e);
+            }
+    test_result("bddandexist equals bddexist(bddand(f, g), c)", ok);
+
+    bool thrown = false;
+    bddp z = bddchange(bddsingle, 1);
+    try { bddandexist(fs[2], z, cs[1]); } catch (const BDDException&) { thrown = true; }
+    test_result("bddandexist rejects a ZDD operand", thrown);
+    bddfree(z);
+
+    for (size_t i = 0; i < fs.size(); i++) bddfree(fs[i]);
+    for (size_t i = 0; i < cs.size(); i++) bddfree(cs[i]);
+    for (size_t i = 0; i < x.size(); i++) bddfree(x[i]);
+    bddgc();
+    test_result("bddandexist leaves no node", bddused() == 0);
+}
+
+// Value of f for the assignment a (a[v] for VarID v)
+static int eval(bddp f, const vector<int>& a) {
+    while (!B_CST(f)) {
+        bddvar v = bddtop(f);
+        bddp g = a[v] ? bddat1(f, v) : bddat0(f, v);
+        bddfree(g);  // f keeps the node
+        f = g;
+    }
+    return f == bddtrue;
+}
+
+void test_compose() {
+    std::cout << "\n=== Testing bddvectorcompose and bddpermute ===" << endl;
+
+    bddinit(1000, 1000000);
+    const int n = 6;
+    vector<bddp> x(n + 1);
+    for (int i = 1; i <= n; i++) x[i] = bddprime(bddnewvar());
+    srand(13);
+    vector<bddp> fs;
+    for (int i = 0; i < 12; i++) {
+        bddp f = bddcopy(x[1 + rand() % n]);
+        for (int j = 0; j < 5; j++) {
+            bddp y = x[1 + rand() % n], r;
+            if (rand() % 2) y = bddnot(y); else y = bddcopy(y);
+            switch (rand() % 3) {
+            case 0: r = bddand(f, y); break;
+            case 1: r = bddor(f, y); break;
+            default: r = bddxor(f, y);
+            }
+            bddfree(f); bddfree(y);
+            f = r;
+        }
+        fs.push_back(f);
+    }
+
+    bool comp_ok = true, perm_ok = true, chain_ok = true;
+    vector<int> a(n + 1), b(n + 1);
+    for (size_t i = 0; i < fs.size(); i++) {
+        // vec[v] is another function, or kept by bddnull
+        vector<bddp> vec(n + 1, bddnull);
+        for (int v = 1; v <= n; v++)
+            if (rand() % 3) vec[v] = fs[rand() % fs.size()];
+        bddp h = bddvectorcompose(fs[i], vec.data(), n + 1);
+        for (int m = 0; m < (1 << n); m++) {
+            for (int v = 1; v <= n; v++) a[v] = (m >> (v - 1)) & 1;
+            for (int v = 1; v <= n; v++) b[v] = vec[v] == bddnull ? a[v] : eval(vec[v], a);
+            if (eval(h, a) != eval(fs[i], b)) comp_ok = false;
+        }
+        bddfree(h);
+
+        vector<bddvar> perm(n + 1, 0);
+        for (int v = 1; v <= n; v++) perm[v] = v;
+        for (int v = n; v > 1; v--) std::swap(perm[v], perm[1 + rand() % v]);
+        h = bddpermute(fs[i], perm.data(), n + 1);
+        for (int m = 0; m < (1 << n); m++) {
+            for (int v = 1; v <= n; v++) a[v] = (m >> (v - 1)) & 1;
+            for (int v = 1; v <= n; v++) b[v] = a[perm[v]];
+            if (eval(h, a) != eval(fs[i], b)) perm_ok = false;
+        }
+        bddfree(h);
+
+        // Exchanging 2 and 5 equals the chained substitution
+        vector<bddvar> sw(n + 1, 0);
+        sw[2] = 5; sw[5] = 2;
+        h = bddpermute(fs[i], sw.data(), n + 1);
+        vec.assign(n + 1, bddnull);
+        vec[2] = x[5]; vec[5] = x[2];
+        bddp g = bddvectorcompose(fs[i], vec.data(), n + 1);
+        if (h != g) chain_ok = false;
+        bddfree(h); bddfree(g);
+    }
+    test_result("bddvectorcompose substitutes at once", comp_ok);
+    test_result("bddpermute renames the variables", perm_ok);
+    test_result("bddpermute equals bddvectorcompose by literals", chain_ok);
+
+    // ZDD: a cyclic shift n times returns the original
+    bddp z = make_random_family(n, 10, 14, 2);
+    vector<bddvar> cyc(n + 1, 0);
+    for (int v = 1; v <= n; v++) cyc[v] = v % n + 1;
+    bddp w = bddcopy(z);
+    bool cyc_ok = true;
+    for (int i = 0; i < n; i++) {
+        bddp t = bddpermute(w, cyc.data(), n + 1);
+        bddfree(w);
+        w = t;
+        if (bddcard(w) != bddcard(z) || (i < n - 1 && w == z && bddsize(z) > 1)) cyc_ok = false;
+    }
+    test_result("ZDD cyclic permutation", cyc_ok && w == z);
+    bddfree(w);
+
+    // The negation of a ZDD (the empty set toggled) is kept
+    bddp nz = bddnot(z);
+    w = bddpermute(nz, cyc.data(), n + 1);
+    bddp pz = bddpermute(z, cyc.data(), n + 1);
+    test_result("ZDD permutation keeps the empty set", w == B_NOT(pz));
+    bddfree(w); bddfree(pz); bddfree(nz); bddfree(z);
+
+    bool thrown1 = false, thrown2 = false;
+    vector<bddvar> bad(n + 1, 0);
+    bad[1] = 2;
+    try { bddpermute(fs[0], bad.data(), n + 1); } catch (const BDDException&) { thrown1 = true; }
+    bad[1] = n + 1;
+    try { bddpermute(fs[0], bad.data(), n + 1); } catch (const BDDException&) { thrown2 = true; }
+    test_result("bddpermute rejects a non-permutation", thrown1 && thrown2);
+
+    for (size_t i = 0; i < fs.size(); i++) bddfree(fs[i]);
+    for (int i = 1; i <= n; i++) bddfree(x[i]);
+    bddgc();
+    test_result("Compose leaves no node", bddused() == 0);
+}
+
+void test_zdd_algebra() {
+    std::cout << "\n=== Testing native ZDD product, division and meet ===" << endl;
+
+    struct bddcachestat stats[BDD_CACHE_OPMAX];
+    for (int mode = BDD_GC_FULL; mode <= BDD_GC_EPOCH; mode++) {
+        bddinit(1000, 1000000);
+        bddsetgcmode(mode);
+        const int n = 10;
+        for (int i = 0; i < n; i++) bddnewvar();
+        srand(16);
+        vector<bddp> zs;
+        for (int i = 0; i < 6; i++) zs.push_back(make_random_family(n, 5, 16 + i));
+        bddclearcachestats();
+        bool ok = true;
+        for (size_t i = 0; i < zs.size(); i++)
+            for (size_t j = 0; j < zs.size(); j++) {
+                bddp m1 = bddmult(zs[i], zs[j]), m2 = bddmult(zs[j], zs[i]);
+                bddp q = bdddiv(m1, zs[j]);
+                bddp e = bddmeet(zs[i], zs[j]), e2 = bddmeet(zs[j], zs[i]);
+                // The quotient times the divisor is contained in the dividend
+                bddp r = bddmult(q, zs[j]);
+                bddp d = bddsubtract(r, m1);
+                if (m1 != m2 || e != e2 || d != bddempty) ok = false;
+                bddfree(m1); bddfree(m2); bddfree(q); bddfree(e); bddfree(e2);
+                bddfree(r); bddfree(d);
+            }
+        bddcachestats(stats);
+        test_result(mode == BDD_GC_FULL ? "Native ZDD algebra is consistent (full)"
+                                        : "Native ZDD algebra is consistent (epoch)",
+                    ok && stats[BC_ZDD_MULT].hit > 0);
+        bool thrown = false;
+        try { bdddiv(zs[0], bddempty); } catch (const BDDException&) { thrown = true; }
+        test_result("bdddiv by the empty set throws", thrown);
+        for (size_t i = 0; i < zs.size(); i++) bddfree(zs[i]);
+        bddgc();
+        test_result("Native ZDD algebra leaves no node", bddused() == 0);
+    }
+}
+
+void test_nary() {
+    std::cout << "\n=== Testing n-ary ZDD union and intersection ===" << endl;
+
+    bddinit(1000, 1000000);
+    const int n = 8;
+    for (int i = 0; i < n; i++) bddnewvar();
+    srand(17);
+    vector<bddp> zs;
+    for (int i = 0; i < 12; i++) {
+        bddp z = make_random_family(n, 24, 17 + i, 2);
+        // Some operands have the empty set
+        if (i % 3 == 0) z = B_NOT(z);
+        zs.push_back(z);
+    }
+    zs.push_back(zs[1]);
+    zs.push_back(bddsingle);
+    zs.push_back(bddempty);
+
+    bool u_ok = true, i_ok = true;
+    for (size_t k = 1; k <= zs.size(); k++) {
+        vector<bddp> fs(zs.begin(), zs.begin() + k);
+        std::rotate(fs.begin(), fs.begin() + k / 2, fs.end());
+        bddp u = bddcopy(fs[0]), x = bddcopy(fs[0]);
+        for (size_t i = 1; i < k; i++) {
+            bddp t = bddunion(u, fs[i]);
+            bddfree(u); u = t;
+            t = bddintersec(x, fs[i]);
+            bddfree(x); x = t;
+        }
+        bddp un = bddunionN(fs.data(), k), xn = bddintersecN(fs.data(), k);
+        if (un != u) u_ok = false;
+        if (xn != x) i_ok = false;
+        bddfree(u); bddfree(x); bddfree(un); bddfree(xn);
+    }
+    // Intersections of the operands sharing many sets
+    for (int k = 2; k <= 6; k++) {
+        vector<bddp> fs;
+        for (int i = 0; i < k; i++) fs.push_back(bddunion(zs[0], zs[i + 1]));
+        bddp x = bddcopy(fs[0]);
+        for (int i = 1; i < k; i++) { bddp t = bddintersec(x, fs[i]); bddfree(x); x = t; }
+        bddp xn = bddintersecN(fs.data(), k);
+        if (xn != x || x == bddempty) i_ok = false;
+        bddfree(x); bddfree(xn);
+        for (int i = 0; i < k; i++) bddfree(fs[i]);
+    }
+    test_result("bddunionN equals the chain of bddunion", u_ok);
+    test_result("bddintersecN equals the chain of bddintersec", i_ok);
+    test_result("bddunionN of no operand is empty", bddunionN(zs.data(), 0) == bddempty);
+
+    bddp nul[2] = { zs[0], bddnull };
+    test_result("bddunionN returns bddnull for a bddnull operand",
+                bddunionN(nul, 2) == bddnull && bddintersecN(nul, 2) == bddnull);
+
+    bool thrown1 = false, thrown2 = false;
+    try { bddintersecN(zs.data(), 0); } catch (const BDDException&) { thrown1 = true; }
+    bddp x1 = bddprime(1);
+    bddp bad[2] = { zs[0], x1 };
+    try { bddunionN(bad, 2); } catch (const BDDException&) { thrown2 = true; }
+    test_result("bddintersecN and bddunionN reject invalid operands", thrown1 && thrown2);
+    bddfree(x1);
+
+    for (int i = 0; i < 12; i++) bddfree(zs[i]);
+    bddgc();
+    test_result("N-ary operations leave no node", bddused() == 0);
+}
+
+void test_card() {
+    std::cout << "\n=== Testing exact counts ===" << endl;
+
+    bddinit(1000, 1000000);
+    const int n = 80;
+    for (int i = 0; i < n; i++) bddnewvar();
+
+    // The power set of n items
+    bddp p = bddsingle;
+    for (int v = 1; v <= n; v++) {
+        bddp t = bddchange(p, v), u = bddunion(p, t);
+        bddfree(p); bddfree(t);
+        p = u;
+    }
+    char s[64];
+    unsigned long long w[3] = { 0, 0, 0 };
+    test_result("bddcardmp10 of 2^80", std::string(bddcardmp10(p, s)) == "1208925819614629174706176");
+    test_result("bddcardmp16 of 2^80", std::string(bddcardmp16(p, s)) == "100000000000000000000");
+    test_result("bddcardmp of 2^80",
+                bddcardmp(p, w, 3) == 2 && w[0] == 0 && w[1] == 0x10000 && w[2] == 0);
+    test_result("bddcard64 saturates", bddcard64(p) == ~0ULL);
+#ifdef __SIZEOF_INT128__
+    test_result("bddcard128 of 2^80", bddcard128(p) == ((unsigned __int128)1 << 80));
+#endif
+
+    // The power set without the empty set, and the empty set toggled back
+    bddp q = bddnot(p);
+    test_result("bddcardmp10 of 2^80 - 1", std::string(bddcardmp10(q, s)) == "1208925819614629174706175");
+    test_result("Counts of the constants", bddcard64(bddempty) == 0 && bddcard64(bddsingle) == 1 &&
+                bddcard64(bddnull) == 0 && std::string(bddcardmp10(bddempty, s)) == "0");
+
+    // Sets of at most two items among 40
+    bddp r = bddsingle;
+    for (int v = 1; v <= 40; v++) {
+        bddp t = bddchange(r, v), u = bddunion(r, t);
+        bddfree(r); bddfree(t);
+        r = u;
+    }
+    bddp small = bddfalse;
+    for (int v = 1; v <= 40; v++)
+        for (int u = v + 1; u <= 40; u++) {
+            bddp a = bddchange(bddsingle, v), b = bddchange(a, u), c = bddunion(small, b);
+            bddfree(a); bddfree(b); bddfree(small);
+            small = c;
+        }
+    test_result("bddcard64 equals bddcard", bddcard64(small) == bddcard(small) &&
+                bddcard64(small) == 780 && bddcard64(r) == (1ULL << 40) &&
+                bddcard64(r) > (unsigned long long)bddcard(r));
+    bddfree(r);
+
+    // The counts are kept across GC, except those of the collected nodes
+    bddp a = bddchange(bddsingle, n), g = bddunion(small, a);
+    bddfree(a);
+    test_result("bddcard64 of a new family", bddcard64(g) == 781);
+    size_t kept = CountMemo->pos.size();
+    bddp top = B_ABS(g);
+    bddfree(g);
+    bddgc();
+    bool swept = CountMemo->pos.count(top) == 0 && CountMemo->pos.size() < kept &&
+                 CountMemo->pos.count(B_ABS(p)) == 1;
+    test_result("Counts survive GC", swept && std::string(bddcardmp10(p, s)) == "1208925819614629174706176");
+
+    // Reordering renews the counts
+    for (int lev = 1; lev < 20; lev++) bddswaplev(lev);
+    test_result("Counts after reordering", std::string(bddcardmp10(q, s)) == "1208925819614629174706175" &&
+                bddcard64(small) == 780);
+
+    bool thrown = false;
+    bddp x = bddprime(1);
+    try { bddcard64(x); } catch (const BDDException&) { thrown = true; }
+    test_result("bddcard64 rejects a BDD", thrown);
+    bddfree(x);
+
+    bddfree(p); bddfree(q); bddfree(small);
+    bddgc();
+    test_result("Counts leave no node", bddused() == 0 && CountMemo->pos.empty());
+}
+
+// Probability over all the assignments (sets) of n variables
+static double brute_prob(bddp f, int n, const double *p, bool zdd) {
+    double sum = 0;
+    for (int m = 0; m < (1 << n); m++) {
+        bddp g = bddcopy(f);
+        double w = 1;
+        for (int v = 1; v <= n; v++) {
+            bool in = (m >> (v - 1)) & 1;
+            w *= in ? p[v] : 1 - p[v];
+            bddp t = zdd ? (in ? bddonset0(g, v) : bddoffset(g, v))
+                         : (in ? bddat1(g, v) : bddat0(g, v));
+            bddfree(g);
+            g = t;
+        }
+        if (g == bddtrue) sum += w;
+        bddfree(g);
+    }
+    return sum;
+}
+
+void test_prob() {
+    std::cout << "\n=== Testing probability and semiring evaluation ===" << endl;
+
+    bddinit(1000, 1000000);
+    const int n = 8;
+    for (int i = 0; i < n; i++) bddnewvar();
+    double p[n + 1], q[n + 1], one[n + 1];
+    srand(19);
+    for (int v = 0; v <= n; v++) {
+        p[v] = (rand() % 1000) / 1000.0;
+        q[v] = 1 - p[v];
+        one[v] = 1;
+    }
+
+    // Random BDDs with complement edges
+    vector<bddp> bs;
+    for (int i = 1; i <= n; i++) bs.push_back(bddprime(i));
+    for (int i = 0; i < 24; i++) {
+        bddp a = bs[rand() % bs.size()], b = bs[rand() % bs.size()];
+        bddp nb = bddnot(b);
+        bddp c = (i % 3 == 0) ? bddxor(a, b) : (i % 3 == 1) ? bddand(a, b) : bddor(a, nb);
+        bddfree(nb);
+        bs.push_back(c);
+    }
+    bool bp_ok = true, be_ok = true;
+    for (size_t i = 0; i < bs.size(); i++) {
+        bddp fs[2] = { bs[i], bddnot(bs[i]) };
+        for (int k = 0; k < 2; k++) {
+            double e = brute_prob(fs[k], n, p, false);
+            if (fabs(bddprob(fs[k], p) - e) > 1e-9) bp_ok = false;
+            if (fabs(bddeval<BDD_RealSemiring>(fs[k], q, p) - e) > 1e-9) be_ok = false;
+        }
+        bddfree(fs[1]);
+    }
+    test_result("bddprob of BDDs", bp_ok);
+    test_result("bddeval of BDDs", be_ok);
+
+    // Random ZDDs, some of which have the empty set by a negated root
+    vector<bddp> zs;
+    for (int i = 0; i < 12; i++) {
+        bddp z = make_random_family(n, 10, 19 + i);
+        zs.push_back(z);
+        zs.push_back(B_NOT(z));
+    }
+    bddp single = bddchange(bddsingle, n);
+    zs.push_back(single);
+    bool zp_ok = true, ze_ok = true, zc_ok = true;
+    for (size_t i = 0; i < zs.size(); i++) {
+        double e = brute_prob(zs[i], n, p, true);
+        if (fabs(bddprob(zs[i], p) - e) > 1e-9) zp_ok = false;
+        if (fabs(bddeval<BDD_RealSemiring>(zs[i], q, p) - e) > 1e-9) ze_ok = false;
+        if (bddeval<BDD_RealSemiring>(zs[i], one, one) != (double)bddcard(zs[i])) zc_ok = false;
+    }
+    test_result("bddprob of ZDDs", zp_ok);
+    test_result("bddeval of ZDDs", ze_ok);
+    test_result("bddeval counts the sets", zc_ok);
+    test_result("bddprob of the constants", bddprob(bddfalse, p) == 0 && bddprob(bddtrue, p) == 1 &&
+                bddprob(bddnull, p) == 0);
+
+    // Certain variables (p = 0 or 1), also skipped by the ZDD edges
+    double pc[n + 1], qc[n + 1];
+    for (int v = 0; v <= n; v++) {
+        pc[v] = (v % 4 == 0) ? 1 : (v % 4 == 1) ? 0 : p[v];
+        qc[v] = 1 - pc[v];
+    }
+    bool c_ok = true;
+    for (size_t i = 0; i < bs.size(); i++) {
+        double e = brute_prob(bs[i], n, pc, false);
+        if (fabs(bddprob(bs[i], pc) - e) > 1e-9) c_ok = false;
+        if (fabs(bddeval<BDD_RealSemiring>(bs[i], qc, pc) - e) > 1e-9) c_ok = false;
+    }
+    for (size_t i = 0; i < zs.size(); i++) {
+        double e = brute_prob(zs[i], n, pc, true);
+        if (fabs(bddprob(zs[i], pc) - e) > 1e-9) c_ok = false;
+        if (fabs(bddeval<BDD_RealSemiring>(zs[i], qc, pc) - e) > 1e-9) c_ok = false;
+    }
+    test_result("bddprob and bddeval with certain variables", c_ok);
+
+    // The node list has the children first
+    bddp f = bs.back();
+    bddp sz = bddnodelist(f, 0, 0);
+    vector<struct bddnode> list(sz);
+    bddnodelist(f, list.data(), sz);
+    bool l_ok = sz == bddsize(f);
+    for (bddp i = 0; i < sz; i++)
+        if ((list[i].lo >> 1) > i || (list[i].hi >> 1) > i) l_ok = false;
+    test_result("bddnodelist lists the children first", l_ok);
+    for (size_t i = 0; i < bs.size(); i++) bddfree(bs[i]);
+    for (size_t i = 0; i < zs.size(); i += 2) bddfree(zs[i]);
+    bddgc();
+    test_result("bddnodelist and bddprob leave no node", bddused() == 0);
+
+    // A wide BDD evaluated by threads
+    bddinit(100000, 10000000);
+    const int m = 2 * 12;
+    for (int i = 0; i < m; i++) bddnewvar();
+    bddp w = bddfalse;
+    for (int i = 1; i <= m / 2; i++) {
+        bddp x = bddprime(i), y = bddprime(i + m / 2), a = bddand(x, y), t = bddxor(w, a);
+        bddfree(x); bddfree(y); bddfree(a); bddfree(w);
+        w = t;
+    }
+    double pw[m + 1], qw[m + 1];
+    for (int v = 0; v <= m; v++) { pw[v] = 0.3 + 0.01 * v; qw[v] = 1 - pw[v]; }
+    double s1 = bddeval<BDD_RealSemiring>(w, qw, pw, 1);
+    double s4 = bddeval<BDD_RealSemiring>(w, qw, pw, 4);
+    test_result("bddeval with threads", bddsize(w) > 4096 && s1 == s4 && fabs(bddprob(w, pw) - s1) < 1e-9);
+    bddfree(w);
+    bddgc();
+    test_result("Evaluation leaves no node", bddused() == 0);
+}
+
+void test_visit() {
+    std::cout << "\n=== Testing read-only traversals ===" << endl;
+
+    bddinit(1000, 1000000);
+    const int n = 16;
+    for (int i = 0; i < n; i++) bddnewvar();
+    srand(23);
+    vector<bddp> fs;
+    for (int i = 1; i <= n; i++) fs.push_back(bddprime(i));
+    for (int i = 0; i < 200; i++) {
+        bddp a = fs[rand() % fs.size()], b = fs[rand() % fs.size()];
+        fs.push_back((i % 2) ? bddxor(a, b) : bddor(a, b));
+    }
+    vector<bddp> sizes;
+    for (size_t i = 0; i < fs.size(); i++) sizes.push_back(bddsize(fs[i]));
+    bddp total = bddvsize(fs.data(), fs.size());
+
+    // The traversals leave the nodes unchanged
+    bool same = true;
+    for (size_t i = 0; i < fs.size(); i++)
+        if (bddsize(fs[i]) != sizes[i]) same = false;
+    test_result("bddsize is repeatable", same && bddvsize(fs.data(), fs.size()) == total);
+
+    // Sizes on several threads at once
+    std::atomic<int> bad(0);
+    vector<std::thread> th;
+    for (int t = 0; t < 4; t++)
+        th.emplace_back([&, t] {
+            for (int r = 0; r < 50; r++)
+                for (size_t i = t; i < fs.size(); i += 3)
+                    if (bddsize(fs[i]) != sizes[i] || bddvsize(fs.data(), fs.size()) != total) bad++;
+        });
+    for (auto &x : th) x.join();
+    test_result("bddsize runs concurrently", bad == 0);
+
+    FILE *fp = tmpfile();
+    bddexport(fp, fs.data(), fs.size());
+    rewind(fp);
+    vector<bddp> gs(fs.size());
+    bddimport(fp, gs.data(), gs.size());
+    fclose(fp);
+    test_result("bddexport after concurrent traversals", gs == fs);
+
+    for (size_t i = 0; i < fs.size(); i++) { bddfree(fs[i]); bddfree(gs[i]); }
+    bddgc();
+    test_result("Traversals leave no node", bddused() == 0);
+}
+
+void test_snapshot() {
+    std::cout << "\n=== Testing binary snapshots ===" << endl;
+
+    bddinit(1000, 1000000);
+    const int n = 12;
+    for (int i = 0; i < n; i++) bddnewvar();
+    bddswaplev(2); bddswaplev(5); bddswaplev(9);
+    srand(29);
+    vector<bddp> fs;
+    for (int i = 1; i <= n; i++) fs.push_back(bddprime(i));
+    for (int i = 0; i < 60; i++) {
+        bddp a = fs[rand() % fs.size()], b = fs[rand() % fs.size()];
+        fs.push_back((i % 2) ? bddxor(a, b) : bddor(a, b));
+    }
+    for (int i = 0; i < 20; i++) {
+        bddp z = make_random_family(n, 8, 29 + i);
+        fs.push_back((i % 2) ? B_NOT(z) : z);
+    }
+    fs.push_back(bddtrue);
+    fs.push_back(bddfalse);
+
+    double p[n + 1];
+    for (int v = 0; v <= n; v++) p[v] = (rand() % 1000) / 1000.0;
+    vector<double> pr;
+    for (size_t i = 0; i < fs.size(); i++) pr.push_back(bddprob(fs[i], p));
+    bddp total = bddvsize(fs.data(), fs.size());
+    bddgc();
+
+    const char *path = "./test_snapshot.bin";
+    FILE *fp = fopen(path, "wb");
+    bddexportbin(fp, fs.data(), fs.size());
+    fclose(fp);
+
+    // Loading into the same manager shares the nodes
+    vector<bddp> gs(fs.size() + 1);
+    bddimportbin(path, gs.data(), gs.size());
+    bool same = gs[fs.size()] == bddnull;
+    for (size_t i = 0; i < fs.size(); i++) if (gs[i] != fs[i]) same = false;
+    test_result("bddimportbin into the same manager", same && bddused() == total);
+    for (size_t i = 0; i < fs.size(); i++) bddfree(gs[i]);
+
+    // Loading into a new manager restores the variable order
+    bddinit(1000, 1000000);
+    bddimportbin(path, gs.data(), fs.size());
+    bool ok = bddvarused() == n && bddvsize(gs.data(), fs.size()) == total &&
+              bddlevofvar(3) == 2 && bddlevofvar(2) == 3;
+    for (size_t i = 0; i < fs.size(); i++)
+        if (fabs(bddprob(gs[i], p) - pr[i]) > 1e-12) ok = false;
+    test_result("bddimportbin into a new manager", ok);
+    for (size_t i = 0; i < fs.size(); i++) bddfree(gs[i]);
+
+    // A registered group is moved as a whole
+    bddinit(1000, 1000000);
+    for (int i = 0; i < n; i++) bddnewvar();
+    for (int lev = 8; lev < n; lev++) bddswaplev(lev);
+    for (int lev = 7; lev < n - 1; lev++) bddswaplev(lev);
+    bddvargroup(n - 1, 2, BDD_GROUP_MOVE);
+    bddp x7 = bddprime(7), x1 = bddprime(1), h = bddand(x7, x1);
+    bddfree(x7); bddfree(x1);
+    bddimportbin(path, gs.data(), fs.size());
+    ok = bddvsize(gs.data(), fs.size()) == total &&
+         bddlevofvar(3) == 2 && bddlevofvar(7) == 7 && bddlevofvar(8) == 8;
+    for (size_t i = 0; i < fs.size(); i++)
+        if (fabs(bddprob(gs[i], p) - pr[i]) > 1e-12) ok = false;
+    x7 = bddprime(7); x1 = bddprime(1);
+    bddp h2 = bddand(x7, x1);
+    test_result("bddimportbin with a variable group", ok && h2 == h);
+    for (size_t i = 0; i < fs.size(); i++) bddfree(gs[i]);
+    bddfree(h); bddfree(h2); bddfree(x7); bddfree(x1);
+
+    // Broken files
+    fp = fopen(path, "r+b");
+    fseek(fp, -8, SEEK_END);
+    unsigned long long big = ~0ULL;
+    fwrite(&big, 8, 1, fp);
+    fclose(fp);
+    bool thrown1 = false, thrown2 = false;
+    try { bddimportbin(path, gs.data(), fs.size()); } catch (const BDDException&) { thrown1 = true; }
+    fp = fopen(path, "wb");
+    fputs("_i 0\n", fp);
+    fclose(fp);
+    try { bddimportbin(path, gs.data(), fs.size()); } catch (const BDDException&) { thrown2 = true; }
+    // A BDD node with f0 == f1 and a ZDD node with an empty 1-edge
+    bool thrown3 = true;
+    const unsigned long long order = 0x0102030405060708ULL;
+    const unsigned long long recs[2][2] = { { 0, 0 }, { 1, 0 } };
+    for (int k = 0; k < 2; k++) {
+        unsigned long long w[10] = { 0, order, 1, 1, 1, 1, 1, 2, recs[k][0], recs[k][1] };
+        memcpy(w, "BDDSNAP2", 8);
+        fp = fopen(path, "wb");
+        fwrite(w, 8, 10, fp);
+        fclose(fp);
+        bool t = false;
+        try { bddimportbin(path, gs.data(), 1); }
+        catch (const BDDFileFormatException&) { t = true; }
+        if (!t) thrown3 = false;
+    }
+    // A valid snapshot written in the other byte order
+    bool thrown4 = false;
+    {
+        unsigned long long w[6] = { 0, __builtin_bswap64(order), 0, 1, 0, 0 };
+        memcpy(w, "BDDSNAP2", 8);
+        fp = fopen(path, "wb");
+        fwrite(w, 8, 6, fp);
+        fclose(fp);
+        try { bddimportbin(path, gs.data(), 1); }
+        catch (const BDDFileFormatException&) { thrown4 = true; }
+        w[1] = order;
+        fp = fopen(path, "wb");
+        fwrite(w, 8, 6, fp);
+        fclose(fp);
+        bddimportbin(path, gs.data(), 1);
+        thrown4 = thrown4 && gs[0] == bddfalse;
+    }
+    remove(path);
+    bddgc();
+    test_result("bddimportbin rejects broken files",
+                thrown1 && thrown2 && thrown3 && bddused() == 0);
+    test_result("bddimportbin checks the byte order", thrown4);
+}
+
+void test_import_mem() {
+    std::cout << "\n=== Testing imports from memory ===" << endl;
+
+    bddinit(1000, 1000000);
+    for (int i = 0; i < 6; i++) bddnewvar();
+    bddp x = bddprime(2), y = bddprime(5), f[3];
+    f[0] = bddxor(x, y);
+    f[1] = bddnot(x);
+    f[2] = bddnull;
+    FILE *fp = tmpfile();
+    bddexport(fp, f, 2);
+    rewind(fp);
+    std::string text;
+    for (int c; (c = fgetc(fp)) != EOF; ) text.push_back((char)c);
+    fclose(fp);
+
+    bddp g[3];
+    bddimportmem(text.data(), text.size(), g, 3);
+    test_result("bddimportmem equals the export", g[0] == f[0] && g[1] == f[1] && g[2] == bddnull);
+    bddfree(g[0]); bddfree(g[1]);
+
+    // Tokens may be separated by any white space, and the buffer is not
+    // null-terminated
+    std::string spaced = text;
+    std::replace(spaced.begin(), spaced.end(), '\n', ' ');
+    spaced = "\t\r\n" + spaced + "garbage";
+    bddimportmem(spaced.data(), spaced.size() - 7, g, 2);
+    test_result("bddimportmem with other white spaces", g[0] == f[0] && g[1] == f[1]);
+    bddfree(g[0]); bddfree(g[1]);
+
+    bool thrown = false;
+    try { bddimportmem(text.data(), text.size() / 2, g, 2); } catch (const BDDException&) { thrown = true; }
+    test_result("bddimportmem of a truncated buffer throws", thrown);
+
+    // A number must be a whole token in the range, and a bad one in the
+    // middle leaves no node
+    const char *bad[] = { "_i 6x _o 1 _n 0 F", "_i 99999999999999999999 _o 1 _n 0 F",
+                          "_i - _o 1 _n 0 F", "_i 6 _o 1 _n +" };
+    int caught = 0;
+    for (int i = 0; i < 4; i++) {
+        try { bddimportmem(bad[i], strlen(bad[i]), g, 1); }
+        catch (const BDDFileFormatException&) { caught++; }
+    }
+    bddgc();
+    bddp used = bddused();
+    std::string broken = text;
+    broken.insert(broken.rfind('\n', broken.size() - 2), "z");
+    caught += (int)(broken == text);
+    try { bddimportmem(broken.data(), broken.size(), g, 2); }
+    catch (const BDDFileFormatException&) { caught++; }
+    bddgc();
+    test_result("bddimportmem rejects bad numbers", caught == 5 && bddused() == used);
+
+    bddp z = bddchange(bddsingle, 3), zz = bddunion(z, bddsingle);
+    fp = tmpfile();
+    bddexport(fp, &zz, 1);
+    rewind(fp);
+    text.clear();
+    for (int c; (c = fgetc(fp)) != EOF; ) text.push_back((char)c);
+    fclose(fp);
+    bddimportzmem(text.data(), text.size(), g, 1);
+    test_result("bddimportzmem equals the export", g[0] == zz);
+    bddfree(g[0]);
+
+    bddfree(x); bddfree(y); bddfree(f[0]); bddfree(f[1]); bddfree(z); bddfree(zz);
+    bddgc();
+    test_result("Imports from memory leave no node", bddused() == 0);
+}
+
+void test_compact() {
+    std::cout << "\n=== Testing node compaction ===" << endl;
+
+    for (int t = 0; t < 4; t++) {
+        bddsetuniquetable((t % 2) ? BDD_UT_OPEN : BDD_UT_CHAIN);
+        bddinit(256, 1000000);
+        const int n = 12;
+        for (int i = 0; i < n; i++) bddnewvar();
+        srand(31 + t);
+
+        // Scramble the free list by building and freeing in turn
+        vector<bddp> fs;
+        for (int i = 1; i <= n; i++) fs.push_back(bddprime(i));
+        for (int r = 0; r < 6; r++) {
+            for (int i = 0; i < 40; i++) {
+                bddp a = fs[rand() % fs.size()], b = fs[rand() % fs.size()];
+                fs.push_back((i % 2) ? bddxor(a, b) : bddand(a, b));
+            }
+            for (size_t i = n; i < fs.size(); i += 2) {
+                bddfree(fs[i]);
+                fs.erase(fs.begin() + i);
+            }
+            bddgc();
+        }
+        bddp z = make_random_family(n, 30, 31 + t);
+        fs.push_back(z);
+
+        double p[n + 1];
+        for (int v = 0; v <= n; v++) p[v] = (rand() % 1000) / 1000.0;
+        vector<double> pr;
+        for (size_t i = 0; i < fs.size(); i++) pr.push_back(bddprob(fs[i], p));
+        bddp card = bddcard(z);
+        bddgc();
+        bddp used = bddused();
+        for (size_t i = 0; i < fs.size(); i++) bddregroot(&fs[i]);
+
+        // An unregistered bddp keeps its node
+        bddp h = bddcopy(fs[fs.size() / 2]);
+        bddp moved = bddcompact(t < 2 ? BDD_COMPACT_DFS : BDD_COMPACT_LEVEL);
+        bool ok = tables_consistent() && bddused() == used &&
+                  bddcard(fs.back()) == card && h == fs[fs.size() / 2] && moved > 0;
+        for (size_t i = 0; i < fs.size(); i++)
+            if (fabs(bddprob(fs[i], p) - pr[i]) > 1e-12) ok = false;
+        bddp x = bddand(fs[n], fs[n + 1]);
+        bddp y = bddand(fs[n + 1], fs[n]);
+        if (x != y || fabs(bddprob(x, p) - bddprob(y, p)) > 1e-12) ok = false;
+        bddfree(x); bddfree(y);
+        test_result(t == 0 ? "bddcompact keeps the functions (chain, DFS)" :
+                    t == 1 ? "bddcompact keeps the functions (open, DFS)" :
+                    t == 2 ? "bddcompact keeps the functions (chain, level)" :
+                             "bddcompact keeps the functions (open, level)", ok);
+
+        // Without unknown bddp, the nodes are packed at the lowest indices
+        bddfree(h);
+        bddcompact();
+        bool packed = true;
+        for (bddp i = bddused(); i < NodeSpc; i++) if (Node[i].varrfc != 0) packed = false;
+        bddp w = bddcard(fs.back());
+        test_result(t == 0 ? "bddcompact packs the nodes (chain)" :
+                    t == 1 ? "bddcompact packs the nodes (open)" :
+                    t == 2 ? "bddcompact packs the nodes (chain, level)" :
+                             "bddcompact packs the nodes (open, level)",
+                    packed && w == card && tables_consistent());
+
+        for (size_t i = fs.size(); i > 0; i--) bddunregroot(&fs[i - 1]);
+        for (size_t i = 0; i < fs.size(); i++) bddfree(fs[i]);
+        bddgc();
+        test_result("Compacted nodes leave no node", bddused() == 0);
+    }
+    bool thrown = false;
+    bddp r = bddnull;
+    try { bddunregroot(&r); } catch (const BDDException&) { thrown = true; }
+    test_result("bddunregroot of an unregistered variable throws", thrown);
+    bddsetuniquetable(BDD_UT_CHAIN);
+}
+
+void test_bfs() {
+    std::cout << "\n=== Testing level-by-level apply ===" << endl;
+
+    bddinit(1000, 1000000);
+    const int n = 14;
+    for (int i = 0; i < n; i++) bddnewvar();
+    bddswaplev(4);
+    srand(37);
+    vector<bddp> fs, zs;
+    for (int i = 1; i <= n; i++) fs.push_back(bddprime(i));
+    for (int i = 0; i < 60; i++) {
+        bddp a = fs[rand() % fs.size()], b = fs[rand() % fs.size()];
+        bddp c = (i % 3 == 0) ? bddxor(a, b) : (i % 3 == 1) ? bddor(a, b) : bddand(a, b);
+        fs.push_back((i % 4 == 0) ? B_NOT(c) : c);
+    }
+    for (int i = 0; i < 24; i++) {
+        bddp z = make_random_family(n, 12, 37 + i);
+        zs.push_back((i % 3 == 0) ? B_NOT(z) : z);
+    }
+    zs.push_back(bddempty);
+    zs.push_back(bddsingle);
+
+    bool same[6] = {true, true, true, true, true, true};
+    for (int k = 0; k < 300; k++) {
+        int op = k % 6;
+        const vector<bddp>& xs = (op < 3) ? fs : zs;
+        bddp a = xs[rand() % xs.size()], b = xs[rand() % xs.size()];
+        cache_clear();
+        bddp h1 = bddbfsapply(op, a, b);
+        cache_clear();
+        bddp h2 = (op == BDD_BFS_AND) ? bddand(a, b) : (op == BDD_BFS_OR) ? bddor(a, b) :
+                  (op == BDD_BFS_XOR) ? bddxor(a, b) : (op == BDD_BFS_INTERSEC) ? bddintersec(a, b) :
+                  (op == BDD_BFS_UNION) ? bddunion(a, b) : bddsubtract(a, b);
+        if (h1 != h2) same[op] = false;
+        bddfree(h1); bddfree(h2);
+    }
+    test_result("bddbfsapply AND equals bddand", same[0]);
+    test_result("bddbfsapply OR equals bddor", same[1]);
+    test_result("bddbfsapply XOR equals bddxor", same[2]);
+    test_result("bddbfsapply INTERSEC equals bddintersec", same[3]);
+    test_result("bddbfsapply UNION equals bddunion", same[4]);
+    test_result("bddbfsapply SUBTRACT equals bddsubtract", same[5]);
+
+    // The results go to the cache shared with apply
+    bddp a = fs[n + 5], b = fs[n + 9];
+    cache_clear();
+    bddp h1 = bddbfsapply(BDD_BFS_AND, a, b);
+    bddp h2 = bddrcache(BC_AND, a > b ? a : b, a > b ? b : a);
+    test_result("bddbfsapply stores the results to the cache", h2 == h1);
+    bddfree(h1);
+
+    // Above the threshold, the operations switch automatically
+    bddsetbfsthreshold(8);
+    bool autook = true;
+    for (int k = 0; k < 100; k++) {
+        bddp x = zs[rand() % zs.size()], y = zs[rand() % zs.size()];
+        cache_clear();
+        bddp u1 = bddunion(x, y);
+        bddsetbfsthreshold(0);
+        cache_clear();
+        bddp u2 = bddunion(x, y);
+        bddsetbfsthreshold(8);
+        if (u1 != u2) autook = false;
+        bddfree(u1); bddfree(u2);
+    }
+    test_result("bddsetbfsthreshold switches the operations", autook && bddgetbfsthreshold() == 8);
+    bddsetbfsthreshold(0);
+
+    bool thrown = false;
+    try { bddbfsapply(6, fs[0], fs[1]); } catch (const BDDException&) { thrown = true; }
+    bddp g = bddand(fs[n], fs[n + 1]);
+    test_result("bddbfsapply of an illegal operation throws", thrown && g != bddnull);
+    bddfree(g);
+
+    for (size_t i = 0; i < fs.size(); i++) bddfree(fs[i]);
+    for (size_t i = 0; i < zs.size(); i++) bddfree(zs[i]);
+    bddgc();
+    test_result("Level-by-level apply leaves no node", bddused() == 0);
+}
+
+void test_parallel() {
+    std::cout << "\n=== Testing parallel apply ===" << endl;
+
+    bool thrown = false;
+    try { bddinit(1000, 1000000, 0.5, 0); } catch (const BDDException&) { thrown = true; }
+    test_result("bddinit with no thread throws", thrown);
+
+    bddinit(1000, 1000000, 0.5, 4);
+    test_result("bddinit sets the number of threads", bddgetapplythreads() == 4);
+    const int n = 16;
+    for (int i = 0; i < n; i++) bddnewvar();
+    bddswaplev(5);
+    srand(41);
+    vector<bddp> fs, zs;
+    for (int i = 1; i <= n; i++) fs.push_back(bddprime(i));
+    for (int i = 0; i < 80; i++) {
+        bddp a = fs[rand() % fs.size()], b = fs[rand() % fs.size()];
+        bddp c = (i % 3 == 0) ? bddxor(a, b) : (i % 3 == 1) ? bddor(a, b) : bddand(a, b);
+        fs.push_back((i % 4 == 0) ? B_NOT(c) : c);
+    }
+    for (int i = 0; i < 24; i++) {
+        bddp z = make_random_family(n, 16, 41 + i);
+        zs.push_back((i % 3 == 0) ? B_NOT(z) : z);
+    }
+
+    // The results are the same nodes as those of the sequential apply
+    bool same[7] = {true, true, true, true, true, true, true};
+    for (int k = 0; k < 350; k++) {
+        int op = k % 7;
+        const vector<bddp>& xs = (op < 3) ? fs : zs;
+        bddp a = xs[rand() % xs.size()], b = xs[rand() % xs.size()];
+        bddp h[2];
+        for (int t = 0; t < 2; t++) {
+            bddsetapplythreads(t ? 1 : 4);
+            cache_clear();
+            h[t] = (op == 0) ? bddand(a, b) : (op == 1) ? bddor(a, b) :
+                   (op == 2) ? bddxor(a, b) : (op == 3) ? bddintersec(a, b) :
+                   (op == 4) ? bddunion(a, b) : (op == 5) ? bddsubtract(a, b) : bddmeet(a, b);
+        }
+        if (h[0] != h[1]) same[op] = false;
+        bddfree(h[0]); bddfree(h[1]);
+    }
+    bddsetapplythreads(4);
+    test_result("Parallel AND equals sequential one", same[0]);
+    test_result("Parallel OR equals sequential one", same[1]);
+    test_result("Parallel XOR equals sequential one", same[2]);
+    test_result("Parallel INTERSEC equals sequential one", same[3]);
+    test_result("Parallel UNION equals sequential one", same[4]);
+    test_result("Parallel SUBTRACT equals sequential one", same[5]);
+    test_result("Parallel MEET equals sequential one", same[6]);
+
+    for (size_t i = 0; i < fs.size(); i++) bddfree(fs[i]);
+    for (size_t i = 0; i < zs.size(); i++) bddfree(zs[i]);
+    bddgc();
+    test_result("Parallel apply leaves no node", bddused() == 0);
+
+    // A full node table is left to GC, and the operation is run again
+    bddinit(256, 4000, 0.5, 8);
+    for (int i = 0; i < n; i++) bddnewvar();
+    struct bddgcstat st0, st1;
+    bddgcstats(&st0);
+    bool fullok = true;
+    for (int k = 0; k < 300 && fullok; k++) {
+        bddp d[2];
+        for (int e = 0; e < 2; e++) {
+            d[e] = bddfalse;
+            for (int j = 0; j < 6; j++) {
+                bddp c = bddtrue;
+                for (int v = 1; v <= n; v++) {
+                    if (rand() % 3) continue;
+                    bddp x = bddprime(v);
+                    bddp t = bddand(c, (rand() % 2) ? B_NOT(x) : x);
+                    bddfree(c); bddfree(x);
+                    c = t;
+                }
+                bddp t = bddor(d[e], c);
+                bddfree(d[e]); bddfree(c);
+                d[e] = t;
+            }
+        }
+        bddp r = bddxor(d[0], d[1]);
+        bddsetapplythreads(1);
+        bddp r1 = bddxor(d[0], d[1]);
+        bddsetapplythreads(8);
+        if (r == bddnull || r != r1) fullok = false;
+        bddfree(r); bddfree(r1); bddfree(d[0]); bddfree(d[1]);
+    }
+    bddgcstats(&st1);
+    test_result("Parallel apply runs with GC on a full node table",
+                fullok && st1.count > st0.count);
+    bddgc();
+    test_result("Parallel apply after GC leaves no node", bddused() == 0);
+
+    bddinit(1000, 10000);
+    test_result("bddinit resets the number of threads", bddgetapplythreads() == 1);
+}
+
 // Main test function
 int main() {
     std::cout << "=== BDDC Cache Functions Test ===" << endl;
@@ -213,6 +1687,25 @@ int main() {
     try {
         test_setcacheratiovalue();
         test_allocatecache();
+        test_cacheways();
+        test_gcmode();
+        test_rehash();
+        test_deep();
+        test_reorder();
+        test_group();
+        test_ite();
+        test_andexist();
+        test_compose();
+        test_zdd_algebra();
+        test_nary();
+        test_card();
+        test_prob();
+        test_visit();
+        test_snapshot();
+        test_import_mem();
+        test_compact();
+        test_bfs();
+        test_parallel();
         
         std::cout << "\n=== Test Summary ===" << endl;
         std::cout << "Total tests: " << test_count << endl;
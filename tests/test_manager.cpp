@@ -0,0 +1,526 @@
+/*********************************************
+ * BDD Manager Test Program                  *
+ * Tests independent managers and threads    *
+ *********************************************/
+
+#include <iostream>
+#include <vector>
+#include <thread>
+#include <exception>
+#include <cstring>
+#define BDD_CPP
+#include "../include/bddc.h"
+#include "../include/BDD.h"
+#include "../include/ZDD.h"
+#include "../include/PiDD.h"
+
+using namespace std;
+using namespace sapporobdd;
+
+// Test counter
+int test_count = 0;
+int pass_count = 0;
+int fail_count = 0;
+
+// Test result recording
+void test_result(const char* test_name, bool passed) {
+    test_count++;
+    if (passed) {
+        pass_count++;
+        std::cout << "[PASS] " << test_name << endl;
+    } else {
+        fail_count++;
+        std::cout << "[**FAIL] " << test_name << endl;
+    }
+}
+
+// Builds the BDD of the n-queens problem in the current manager
+// and returns its size
+bddword queens_size(int n) {
+    vector<vector<BDD> > x(n, vector<BDD>(n));
+    for (int i = 0; i < n; i++)
+        for (int j = 0; j < n; j++) x[i][j] = BDDvar(BDD_NewVar());
+
+    BDD f = 1;
+    for (int i = 0; i < n; i++) {
+        BDD row = 0;
+        for (int j = 0; j < n; j++) {
+            BDD g = x[i][j];
+            for (int k = 0; k < n; k++) if (k != j) g &= ~x[i][k];
+            row |= g;
+        }
+        f &= row;
+    }
+    for (int i = 0; i < n; i++)
+        for (int j = 0; j < n; j++)
+            for (int k = 0; k < n; k++) {
+                if (k == i) continue;
+                int d = k - i;
+                f &= ~(x[i][j] & x[k][j]);
+                if (j + d >= 0 && j + d < n) f &= ~(x[i][j] & x[k][j + d]);
+                if (j - d >= 0 && j - d < n) f &= ~(x[i][j] & x[k][j - d]);
+            }
+    return f.Size();
+}
+
+// Builds a ZDD of pseudo-random sets in the current manager and
+// returns its cardinality
+bddword sets_card(int n, int count, unsigned int seed) {
+    while (BDD_VarUsed() < n) BDD_NewVar();
+    ZDD f = 0;
+    for (int i = 0; i < count; i++) {
+        ZDD s = 1;
+        for (int v = 1; v <= n; v++) {
+            seed = seed * 1103515245U + 12345U;
+            if ((seed >> 16) & 1) s = s.Change(v);
+        }
+        f += s;
+    }
+    return f.Card();
+}
+
+void test_explicit_manager() {
+    std::cout << "\n=== Testing explicit manager API ===" << endl;
+
+    BDDManager* m = bddmgrnew(256, 100000);
+    test_result("bddmgrnew returns a manager", m != 0);
+    test_result("bddmgrnew keeps the current manager",
+                bddmgrcurrent() == bddmgrdefault());
+
+    bddvar v1 = bddmnewvar(m);
+    bddvar v2 = bddmnewvar(m);
+    bddp a = bddmprime(m, v1);
+    bddp b = bddmprime(m, v2);
+    bddp c = bddmand(m, a, b);
+    test_result("bddmand builds a node", bddmsize(m, c) == 2);
+    test_result("bddmvarused counts manager variables", bddmvarused(m) == 2);
+    test_result("bddmused counts manager nodes", bddmused(m) == 3);
+    bddmfree(m, a);
+    bddmfree(m, b);
+    bddmfree(m, c);
+
+    BDDManager* old = bddmgrswitch(m);
+    test_result("bddmgrswitch returns the previous manager", old == bddmgrdefault());
+    test_result("bddmgrswitch sets the current manager", bddmgrcurrent() == m);
+    test_result("Current manager sees its own variables", BDD_VarUsed() == 2);
+    bddmgrswitch(0);
+    test_result("bddmgrswitch(0) restores the default manager",
+                bddmgrcurrent() == bddmgrdefault());
+
+    bddmgrdelete(m);
+
+    bool thrown = false;
+    try {
+        bddmgrdelete(bddmgrdefault());
+    } catch (const BDDException&) {
+        thrown = true;
+    }
+    test_result("Deleting the default manager throws", thrown);
+}
+
+void test_handle_owner() {
+    std::cout << "\n=== Testing objects of another manager ===" << endl;
+
+    BDDManager* m = bddmgrnew(256, 100000);
+    bddmgrswitch(m);
+    BDD_NewVar(); BDD_NewVar();
+    BDD* f = new BDD(BDDvar(1) & BDDvar(2));
+    ZDD* z = new ZDD(ZDD(1).Change(1) + ZDD(1).Change(2));
+    bddmgrswitch(0);
+    bddmgc(m);
+    bddword used = bddused(), live = bddmused(m);
+
+    // Copies made while the default manager is current count in m
+    BDD* g = new BDD(*f);
+    ZDD* y = new ZDD(std::move(*z));
+    delete f;
+    delete z;
+    bddmgc(m);
+    bool ok = g->GetManager() == m && y->GetManager() == m &&
+              live == 4 && bddmused(m) == live && bddused() == used;
+
+    // Destroyed on a thread whose current manager is the default one
+    thread th([&]() { delete g; delete y; });
+    th.join();
+    bddmgc(m);
+    test_result("Objects update the manager that made them",
+                ok && bddmused(m) == 0 && bddused() == used);
+    bddmgrdelete(m);
+}
+
+void test_expr_manager() {
+    std::cout << "\n=== Testing ZDD_Expr chains of another manager ===" << endl;
+
+    BDDManager* m = bddmgrnew(256, 100000);
+    bddmgrswitch(m);
+    BDD_NewVar(); BDD_NewVar(); BDD_NewVar();
+    ZDD* a = new ZDD(ZDD(1).Change(1));
+    ZDD* b = new ZDD(ZDD(1).Change(2));
+    ZDD* c = new ZDD(ZDD(1).Change(3));
+    ZDD* ab = new ZDD(*a + *b);
+    ZDD* ac = new ZDD(*a + *c);
+    bddmgrswitch(0);
+
+    // Evaluated while the default manager is current
+    bddword used = bddused();
+    ZDD* u = new ZDD(ZDD_Expr<'+'>(*a) + *b + *c);
+    ZDD* x = new ZDD(ZDD_Expr<'&'>(*ab) & *ac);
+    bool ok = u->GetManager() == m && x->GetManager() == m &&
+              bddused() == used;
+    bddmgrswitch(m);
+    ok = ok && u->Card() == 3 && *x == *a;
+    bddmgrswitch(0);
+    test_result("ZDD_Expr is evaluated on the manager of its operands", ok);
+
+    ZDD d = ZDD(1);
+    bool thrown = false;
+    try {
+        ZDD y = ZDD_Expr<'+'>(*a) + d;
+    } catch (const BDDException&) {
+        thrown = true;
+    }
+    test_result("ZDD_Expr of different managers throws", thrown);
+
+    delete a; delete b; delete c; delete ab; delete ac;
+    delete u; delete x;
+    bddmgrdelete(m);
+}
+
+void test_package_data() {
+    std::cout << "\n=== Testing package data per manager ===" << endl;
+
+    BDDManager* m1 = bddmgrnew(256, 100000);
+    BDDManager* m2 = bddmgrnew(256, 100000);
+    bddmgrswitch(m1);
+    BDDV_Init(256, 100000);
+    PiDD_NewVar(); PiDD_NewVar(); PiDD_NewVar();
+    bool ok1 = BDD_TopLev() == (int)bddvarused() - BDDV_SysVarTop &&
+               PiDD_VarUsed() == 3;
+
+    bddmgrswitch(m2);
+    bool thrown = false;
+    int v = 0;
+    try {
+        v = BDD_NewVar();
+    } catch (const BDDException&) {
+        thrown = true;
+    }
+    test_result("BDDV_Init of another manager leaves BDD_NewVar working",
+                !thrown && v == 1 && BDD_TopLev() == 1);
+    PiDD_NewVar(); PiDD_NewVar();
+    bool ok2 = PiDD_VarUsed() == 2 && PiDD_LevOfX[2] == BDD_TopLev();
+
+    bddmgrswitch(m1);
+    test_result("PiDD variables are counted per manager",
+                ok1 && ok2 && PiDD_VarUsed() == 3 &&
+                PiDD_LevOfX[3] == BDD_TopLev());
+    bddmgrswitch(0);
+    bddmgrdelete(m1);
+    bddmgrdelete(m2);
+    test_result("The default manager keeps no BDDV variables",
+                BDD_TopLev() == BDD_VarUsed());
+}
+
+void test_pidd_levels() {
+    std::cout << "\n=== Testing PiDD levels moved by reordering ===" << endl;
+
+    // PiDD.h also declares a global PiDD
+    typedef sapporobdd::PiDD Pi;
+    BDDManager* m = bddmgrnew(256, 100000);
+    bddmgrswitch(m);
+    BDD_NewVar();
+    for (int i = 0; i < 5; i++) PiDD_NewVar();
+    Pi p = Pi(1).Swap(1, 2) + Pi(1).Swap(3, 5) + Pi(1).Swap(2, 4);
+    Pi q = Pi(1).Swap(4, 5) + Pi(1).Swap(1, 3);
+    Pi r = p * q;
+    int lev5 = PiDD_LevOfX[5];
+
+    // A variable below the group shifts all the PiDD levels
+    BDD_NewVarOfLev(1);
+    BDD_NewVarOfLev(1);
+    bool shifted = PiDD_LevOfX[5] == lev5 + 2;
+    for (int x = 2; x <= 5; x++)
+        for (int y = 1; y < x; y++)
+            if (PiDD_XOfLev[PiDD_Lev_XY(x, y)] != x ||
+                PiDD_Y_Lev(PiDD_Lev_XY(x, y)) != y) shifted = false;
+    test_result("PiDD levels follow the shifted variables",
+                shifted && p * q == r && (p * q).Card() == r.Card());
+
+    BDD_Reorder();
+    test_result("PiDD operations after reordering", p * q == r &&
+                PiDD_XOfLev[PiDD_LevOfX[5]] == 5 &&
+                PiDD_LevOfX[5] - PiDD_LevOfX[2] == 4 + 3 + 2);
+
+    p = Pi(0); q = Pi(0); r = Pi(0);
+    bddmgrswitch(0);
+    bddmgrdelete(m);
+}
+
+void test_threads() {
+    std::cout << "\n=== Testing one manager per thread ===" << endl;
+
+    const int nthreads = 4;
+    const int q = 6;
+    const int nvar = 24;
+    const int count = 300;
+
+    // Reference values in a fresh manager of the main thread
+    BDDManager* ref = bddmgrnew(256, 1000000);
+    bddmgrswitch(ref);
+    bddword qsize = queens_size(q);
+    bddword card = sets_card(nvar, count, 1U);
+    bddmgrswitch(0);
+    bddmgrdelete(ref);
+
+    vector<bddword> qsizes(nthreads), cards(nthreads);
+    vector<int> failed(nthreads, 0);
+    vector<thread> threads;
+    for (int t = 0; t < nthreads; t++) {
+        threads.push_back(thread([&, t]() {
+            BDDManager* m = bddmgrnew(256, 1000000);
+            bddmgrswitch(m);
+            try {
+                qsizes[t] = queens_size(q);
+                cards[t] = sets_card(nvar, count, 1U);
+            } catch (const std::exception&) {
+                failed[t] = 1;
+            }
+            bddmgrswitch(0);
+            bddmgrdelete(m);
+        }));
+    }
+    for (int t = 0; t < nthreads; t++) threads[t].join();
+
+    bool ok = true;
+    for (int t = 0; t < nthreads; t++)
+        if (failed[t] || qsizes[t] != qsize || cards[t] != card) ok = false;
+    test_result("Threads with their own managers agree with the reference", ok);
+}
+
+void test_unique_table() {
+    std::cout << "\n=== Testing unique-table engines ===" << endl;
+
+    bddword qsize[2], card[2], used[2];
+    bool ok = true;
+    for (int e = 0; e < 2; e++) {
+        int type = (e == 0) ? BDD_UT_CHAIN : BDD_UT_OPEN;
+        BDDManager* m = bddmgrnew(256, 1000000);
+        bddmsetuniquetable(m, type);
+        bddminit(m, 256, 1000000);
+        if (bddmgetuniquetable(m) != type) ok = false;
+        bddmgrswitch(m);
+        qsize[e] = queens_size(7);
+        BDD_GC();
+        card[e] = sets_card(49, 500, 7U);
+        BDD_GC();
+        used[e] = BDD_Used();
+        bddmgrswitch(0);
+        bddmgrdelete(m);
+    }
+    test_result("bddsetuniquetable selects the engine at bddinit", ok);
+    test_result("Open addressing gives the same BDD as chaining",
+                qsize[0] == qsize[1] && card[0] == card[1]);
+    test_result("Open addressing frees the same nodes in GC", used[0] == used[1]);
+
+    bool thrown = false;
+    try {
+        bddsetuniquetable(2);
+    } catch (const BDDException&) {
+        thrown = true;
+    }
+    test_result("Illegal unique-table engine throws", thrown);
+}
+
+void test_node_table() {
+    std::cout << "\n=== Testing node-table allocations ===" << endl;
+
+    const int types[3] = {BDD_NT_MALLOC, BDD_NT_MMAP, BDD_NT_HUGEPAGE};
+    bddword qsize[3], card[3], used[3];
+    bool ok = true;
+    for (int e = 0; e < 3; e++) {
+        BDDManager* m = bddmgrnew(256, 1000000);
+        bddmsetnodetable(m, types[e]);
+        // Small initial size, so that the table is enlarged many times
+        bddminit(m, 256, 4000000);
+        if (bddmgetnodetable(m) != types[e]) ok = false;
+        bddmgrswitch(m);
+        qsize[e] = queens_size(7);
+        card[e] = sets_card(40, 2000, 3U);
+        BDD_GC();
+        used[e] = BDD_Used();
+        bddmgrswitch(0);
+        bddmgrdelete(m);
+    }
+    test_result("bddsetnodetable selects the allocation at bddinit", ok);
+    test_result("Reserved node table gives the same BDD",
+                qsize[0] == qsize[1] && qsize[0] == qsize[2] &&
+                card[0] == card[1] && card[0] == card[2]);
+    test_result("Reserved node table keeps the same nodes",
+                used[0] == used[1] && used[0] == used[2]);
+
+    bool thrown = false;
+    try {
+        bddsetnodetable(3);
+    } catch (const BDDException&) {
+        thrown = true;
+    }
+    test_result("Illegal node-table allocation throws", thrown);
+}
+
+// Applies the same random ZDD operations in two managers with
+// different GC modes, running GC after every step
+void test_gc_epoch() {
+    std::cout << "\n=== Testing epoch GC ===" << endl;
+
+    const int nvar = 12, npool = 16, steps = 1500;
+    BDDManager* m[2];
+    vector<vector<bddp> > pool(2, vector<bddp>(npool, bddempty));
+    m[0] = bddmgrnew(256, 100000);
+    m[1] = bddmgrnew(256, 100000);
+    bddmsetgcmode(m[1], BDD_GC_EPOCH);
+    bddmsetcacheways(m[1], 4);
+    for (int k = 0; k < 2; k++)
+        for (int v = 0; v < nvar; v++) bddmnewvar(m[k]);
+
+    bool same = true;
+    int gcs = 0;
+    unsigned int seed = 12345U;
+    for (int step = 0; step < steps && same; step++) {
+        seed = seed * 1103515245U + 12345U;
+        int op = (seed >> 8) % 6;
+        int a = (seed >> 12) % npool, b = (seed >> 16) % npool, c = (seed >> 20) % npool;
+        bddvar v = (seed >> 24) % nvar + 1;
+        bddp card[2];
+        char mp[2][64];
+        for (int k = 0; k < 2; k++) {
+            bddp* p = &pool[k][0];
+            bddp h;
+            switch (op) {
+            case 0: h = bddmunion(m[k], p[a], p[b]); break;
+            case 1: h = bddmintersec(m[k], p[a], p[b]); break;
+            case 2: h = bddmsubtract(m[k], p[a], p[b]); break;
+            case 3: h = bddmchange(m[k], p[a], v); break;
+            case 4: {
+                bddp s = bddmchange(m[k], bddsingle, v);
+                h = bddmunion(m[k], p[a], s);
+                bddmfree(m[k], s);
+                break;
+            }
+            default: h = bddmoffset(m[k], p[a], v); break;
+            }
+            bddmfree(m[k], p[c]);
+            p[c] = h;
+            card[k] = bddmcard(m[k], h);
+            bddmcardmp16(m[k], h, mp[k]);
+            if (bddmgc(m[k]) == 0 && k == 1) gcs++;
+        }
+        if (card[0] != card[1] || strcmp(mp[0], mp[1]) != 0) same = false;
+    }
+    for (int k = 0; k < 2; k++) {
+        for (int i = 0; i < npool; i++) bddmfree(m[k], pool[k][i]);
+        bddmgrdelete(m[k]);
+    }
+    test_result("Epoch GC gives the same results as full GC", same);
+    test_result("Epoch counter wrapped around", gcs > 255);
+}
+
+// Runs the same random ZDD operations with sequential and parallel GC
+void test_gc_threads() {
+    std::cout << "\n=== Testing parallel GC ===" << endl;
+
+    const int nvar = 16, npool = 32, steps = 600;
+    bool same = true;
+    bddword used[2];
+    struct bddgcstat st[2];
+    BDDManager* m[2];
+    vector<vector<bddp> > pool(2, vector<bddp>(npool, bddempty));
+    for (int k = 0; k < 2; k++) {
+        m[k] = bddmgrnew(256, 1000000);
+        for (int v = 0; v < nvar; v++) bddmnewvar(m[k]);
+    }
+    bddmsetgcthreads(m[1], 4);
+    bddmsetuniquetable(m[1], BDD_UT_OPEN);
+    bddminit(m[1], 256, 1000000);
+    for (int v = 0; v < nvar; v++) bddmnewvar(m[1]);
+    test_result("bddsetgcthreads sets the number of threads",
+                bddmgetgcthreads(m[1]) == 4);
+
+    unsigned int seed = 777U;
+    for (int step = 0; step < steps && same; step++) {
+        seed = seed * 1103515245U + 12345U;
+        int op = (seed >> 8) % 4;
+        int a = (seed >> 12) % npool, b = (seed >> 17) % npool, c = (seed >> 22) % npool;
+        bddvar v = (seed >> 27) % nvar + 1;
+        bddp card[2];
+        for (int k = 0; k < 2; k++) {
+            bddp* p = &pool[k][0];
+            bddp s = bddmchange(m[k], bddsingle, v);
+            bddp h;
+            switch (op) {
+            case 0: h = bddmunion(m[k], p[a], p[b]); break;
+            case 1: h = bddmunion(m[k], p[a], s); break;
+            case 2: h = bddmsubtract(m[k], p[a], p[b]); break;
+            default: h = bddmchange(m[k], p[b], v); break;
+            }
+            bddmfree(m[k], s);
+            bddmfree(m[k], p[c]);
+            p[c] = h;
+            card[k] = bddmcard(m[k], h);
+            if (step % 20 == 0) bddmgc(m[k]);
+        }
+        if (card[0] != card[1]) same = false;
+    }
+    for (int k = 0; k < 2; k++) {
+        bddmgc(m[k]);
+        used[k] = bddmused(m[k]);
+        bddmgcstats(m[k], &st[k]);
+    }
+    test_result("Parallel GC gives the same results as sequential GC", same);
+    test_result("Parallel GC frees the same nodes", used[0] == used[1]);
+    test_result("bddgcstats counts GCs and freed nodes",
+                st[1].count == st[0].count && st[1].freed == st[0].freed &&
+                st[1].freed > 0 && st[1].time >= st[1].lasttime);
+
+    for (int k = 0; k < 2; k++) {
+        for (int i = 0; i < npool; i++) bddmfree(m[k], pool[k][i]);
+        bddmgc(m[k]);
+    }
+    test_result("Parallel GC frees all the nodes",
+                bddmused(m[1]) == 0 && bddmused(m[0]) == 0);
+    for (int k = 0; k < 2; k++) bddmgrdelete(m[k]);
+
+    bool thrown = false;
+    try {
+        bddsetgcthreads(0);
+    } catch (const BDDException&) {
+        thrown = true;
+    }
+    test_result("Illegal number of GC threads throws", thrown);
+}
+
+int main() {
+    std::cout << "=== BDD Manager Test ===" << endl;
+
+    try {
+        test_explicit_manager();
+        test_handle_owner();
+        test_expr_manager();
+        test_package_data();
+        test_pidd_levels();
+        test_threads();
+        test_unique_table();
+        test_node_table();
+        test_gc_epoch();
+        test_gc_threads();
+    } catch (const std::exception& e) {
+        std::cout << "Exception occurred: " << e.what() << endl;
+        test_result("Test completed without fatal errors", false);
+    }
+
+    cout << "\nBDD manager test completed." << endl;
+    cout << "Total tests: " << test_count << endl;
+    cout << "Passed: " << pass_count << endl;
+    cout << "Failed: " << fail_count << endl;
+
+    return (fail_count > 0) ? 1 : 0;
+}